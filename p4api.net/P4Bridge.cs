@@ -163,6 +163,9 @@ namespace Perforce.P4
         [DllImport(bridgeDll, CallingConvention = CallingConvention.Cdecl)]
         public static extern long GetStringReleases();
 
+        [DllImport(bridgeDll, CallingConvention = CallingConvention.Cdecl)]
+        public static extern long GetSlabStringAllocs();
+
 
         public static String GetAllocObjectName(int type)
         {
@@ -293,6 +296,25 @@ namespace Perforce.P4
 											int bufSz,
 											bool dispayText);
 
+		/// <summary>
+		/// Delegate definition for the input data callback.
+		/// </summary>
+		/// <param name="cmdID">Id if the command making the callback</param>
+		/// <param name="buffer">Buffer to fill with the next part of the data</param>
+		/// <param name="bufSz">Size of the buffer</param>
+		/// <returns>Bytes written, 0 at the end of the data, -1 to fail</returns>
+		public delegate int InputDataDelegate(uint cmdID, IntPtr buffer, int bufSz);
+
+		/// <summary>
+		/// Delegate definition for the progress callback, see
+		/// P4Bridge.SetProgressCallbackFn().
+		/// </summary>
+		/// <param name="cmdID">Id if the command making the callback</param>
+		/// <param name="info">Pointer to the progress totals</param>
+		/// <returns>Non zero to cancel the command</returns>
+		[UnmanagedFunctionPointer(CallingConvention.StdCall)]
+		public delegate int ProgressDelegate(uint cmdID, IntPtr info);
+
         /// <summary>
 		/// Delegate definition for the parallel operations callback.
 		/// </summary>
@@ -618,161 +640,1040 @@ namespace Perforce.P4
         [DllImport(bridgeDll, EntryPoint = "RunCommand",
 			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
 		public static extern
-			bool RunCommandA(	IntPtr pServer,
-								String cmd,
-								uint cmdId, 
-								bool tagged,
-								String[] args,
-								int argc);
+			bool RunCommandA(	IntPtr pServer,
+								String cmd,
+								uint cmdId, 
+								bool tagged,
+								String[] args,
+								int argc);
+
+		/// <summary>
+		/// Run a command on the P4 Server
+		/// </summary>
+		/// <remarks>
+		/// The W version is used to pass Unicode (wide) parameters
+		/// </remarks>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmd">Command. i.e "fstat"</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="tagged">If true, use tagged protocol the receive the 
+		/// output</param>
+		/// <param name="args">Arguments for the command</param>
+		/// <param name="argc">Argument count</param>
+		/// <returns></returns>
+		[DllImport(bridgeDll, EntryPoint = "RunCommand",
+			CallingConvention = CallingConvention.Cdecl,
+			CharSet = CharSet.Ansi)]
+		public static extern
+			bool RunCommandW(	IntPtr pServer,
+								String cmd,
+								uint cmdId,
+								bool tagged,
+								IntPtr[] args,
+								int argc);
+
+		/// <summary>
+		/// Capture a command so it can be run many times with ExecutePrepared
+		/// </summary>
+		/// <remarks>
+		/// The A version is used to pass ASCII parameters
+		/// </remarks>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmd">Command. i.e "changes"</param>
+		/// <param name="cmdId">Default Id for each run of the command</param>
+		/// <param name="tagged">If true, use tagged protocol the receive the 
+		/// output</param>
+		/// <param name="args">Arguments for the command</param>
+		/// <param name="argc">Argument count</param>
+		/// <returns>P4PreparedCommand Handle, free with Release()</returns>
+		[DllImport(bridgeDll, EntryPoint = "PrepareCommand",
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			IntPtr PrepareCommandA(	IntPtr pServer,
+								String cmd,
+								uint cmdId, 
+								bool tagged,
+								String[] args,
+								int argc);
+
+		/// <summary>
+		/// Capture a command so it can be run many times with ExecutePrepared
+		/// </summary>
+		/// <remarks>
+		/// The W version is used to pass Unicode (wide) parameters
+		/// </remarks>
+		[DllImport(bridgeDll, EntryPoint = "PrepareCommand",
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			IntPtr PrepareCommandW(	IntPtr pServer,
+								String cmd,
+								uint cmdId,
+								bool tagged,
+								IntPtr[] args,
+								int argc);
+
+		/// <summary>
+		/// Limit the tagged output of a prepared command to the given fields
+		/// </summary>
+		/// <param name="pPrepared">P4PreparedCommand Handle</param>
+		/// <param name="keys">Field names to keep</param>
+		/// <param name="count">Field count, zero keeps every field</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			void SetPreparedProjection(IntPtr pPrepared, String[] keys, int count);
+
+		/// <summary>
+		/// Run a command captured by PrepareCommand
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pPrepared">P4PreparedCommand Handle</param>
+		/// <param name="cmdId">Unique Id for this run, zero to use the 
+		/// prepared Id</param>
+		/// <returns></returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			bool ExecutePrepared(IntPtr pServer, IntPtr pPrepared, uint cmdId);
+
+		/// <summary>
+		/// Cancel a running command
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="CmdId">Unique Id for the run of the command</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void CancelCommand(IntPtr pServer, uint CmdId);
+
+		/// <summary>
+		/// Limit how long commands may run before they are cancelled
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="deadlineMs">Maximum run time in milliseconds, 0 for 
+		/// no limit</param>
+		/// <param name="inactivityMs">Maximum time between output in 
+		/// milliseconds, 0 for no limit</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetCommandTimeout(IntPtr pServer, int deadlineMs, int inactivityMs);
+
+		/// <summary>
+		/// Did a command time out?
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="CmdId">Unique Id for the run of the command</param>
+		/// <returns>0 if not, 1 if it passed its deadline, 2 if it timed 
+		/// out waiting for output</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int GetCommandTimeoutStatus(IntPtr pServer, uint CmdId);
+
+		/// <summary>
+		/// Disconnect servers whose connection has not been used for idleMs
+		/// </summary>
+		/// <param name="idleMs">Idle time in milliseconds, 0 stops idle
+		/// disconnects</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetIdleDisconnect(int idleMs);
+
+		/// <summary>
+		/// The idle time set by SetIdleDisconnect
+		/// </summary>
+		/// <returns>Idle time in milliseconds, 0 if idle disconnects are 
+		/// off</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int GetIdleDisconnect();
+
+		/// <summary>
+		/// Stop idle disconnects and wait for the background thread to exit.
+		/// Call it before unloading the bridge.
+		/// </summary>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void ShutdownIdleDisconnect();
+
+		/// <summary>
+		/// Connection counts for all servers
+		/// </summary>
+		/// <param name="live">Servers with an open connection</param>
+		/// <param name="idle">Servers disconnected for being idle</param>
+		/// <param name="reconnected">Total reconnects after an idle 
+		/// disconnect</param>
+		/// <param name="disconnected">Total idle disconnects</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void GetIdleConnectionCounts(out int live, out int idle, out int reconnected, out int disconnected);
+
+		/// <summary>
+		/// (Re)connect now rather than on the next command
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <returns>0 if the connection could not be made</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int PrewarmConnection(IntPtr pServer);
+
+		/// <summary>
+		/// Create an empty list of servers to run a command against in 
+		/// parallel
+		/// </summary>
+		/// <returns>P4FanOut Handle, free with Release()</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr CreateFanOut();
+
+		/// <summary>
+		/// Add a server to a fan-out
+		/// </summary>
+		/// <param name="pFanOut">P4FanOut Handle</param>
+		/// <param name="server">Host:port for the P4 server.</param>
+		/// <param name="user">User name for the login.</param>
+		/// <param name="password">Password for the login.</param>
+		/// <param name="ws_client">Workspace (client) to be used.</param>
+		/// <param name="charset">Charset if the server is Unicode, null for 
+		///     utf8</param>
+		/// <returns>Index of the target</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			int FanOutAddTarget(IntPtr pFanOut,
+								String server,
+								String user,
+								String password,
+								String ws_client,
+								String charset);
+
+		/// <summary>
+		/// Run a command on every server in a fan-out at the same time. The 
+		/// command id of each run is its target index.
+		/// </summary>
+		/// <param name="pFanOut">P4FanOut Handle</param>
+		/// <param name="cmd">Command. i.e "info"</param>
+		/// <param name="tagged">If true, use tagged protocol the receive the 
+		/// output</param>
+		/// <param name="args">Arguments for the command</param>
+		/// <param name="argc">Argument count</param>
+		/// <param name="timeoutMs">Deadline for each server, including 
+		/// connecting, 0 for no limit</param>
+		/// <param name="maxThreads">Maximum servers to run at once, 0 for 
+		/// all of them</param>
+		/// <returns>Number of servers the command succeeded on</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			int RunFanOut(IntPtr pFanOut,
+								String cmd,
+								bool tagged,
+								String[] args,
+								int argc,
+								int timeoutMs,
+								int maxThreads);
+
+		/// <summary>
+		/// The P4BridgeServer used for a target, use it to read the results.
+		/// It belongs to the fan-out, do not release it.
+		/// </summary>
+		/// <param name="pFanOut">P4FanOut Handle</param>
+		/// <param name="idx">Target index</param>
+		/// <returns>P4BridgeServer Handle</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr FanOutGetServer(IntPtr pFanOut, int idx);
+
+		/// <summary>
+		/// How the command went on a target
+		/// </summary>
+		/// <param name="pFanOut">P4FanOut Handle</param>
+		/// <param name="idx">Target index</param>
+		/// <returns>1 succeeded, 0 failed, -1 timed out, -2 could not 
+		/// connect, -3 not run</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int FanOutGetStatus(IntPtr pFanOut, int idx);
+
+		/// <summary>
+		/// The error if a target could not connect
+		/// </summary>
+		/// <param name="pFanOut">P4FanOut Handle</param>
+		/// <param name="idx">Target index</param>
+		/// <returns>P4ClientError Handle, null if there was no error</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr FanOutGetConnectError(IntPtr pFanOut, int idx);
+
+		/// <summary>
+		/// Time taken to connect and run the command on a target
+		/// </summary>
+		/// <param name="pFanOut">P4FanOut Handle</param>
+		/// <param name="idx">Target index</param>
+		/// <returns>Milliseconds</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int FanOutGetElapsed(IntPtr pFanOut, int idx);
+
+		/// <summary>
+		/// Cache the results of read-only commands such as depots, users and 
+		/// groups. The cache is shared by all servers and is off until given 
+		/// a size.
+		/// </summary>
+		/// <param name="maxBytes">Size limit, 0 turns the cache off</param>
+		/// <param name="ttlMs">How long results are kept, in 
+		/// milliseconds</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetResultCache(int maxBytes, int ttlMs);
+
+		/// <summary>
+		/// Replace the list of commands whose results may be cached
+		/// </summary>
+		/// <param name="cmds">Command names</param>
+		/// <param name="count">Command count, 0 restores the default 
+		/// list</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			void SetResultCacheCommands(String[] cmds, int count);
+
+		/// <summary>
+		/// Drop cached results
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle, IntPtr.Zero for all
+		/// servers</param>
+		/// <param name="cmd">Command, null for all commands</param>
+		/// <returns>Number of results dropped</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			int InvalidateResultCache(IntPtr pServer, String cmd);
+
+		/// <summary>
+		/// Result cache statistics
+		/// </summary>
+		/// <param name="hits">Cached runs found</param>
+		/// <param name="misses">Cached runs not found or expired</param>
+		/// <param name="evictions">Results dropped to make room</param>
+		/// <param name="entries">Results held now</param>
+		/// <param name="bytes">Bytes held now</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void GetResultCacheCounts(out int hits, out int misses, out int evictions, out int entries, out int bytes);
+
+		/// <summary>
+		/// Walk a workspace on a pool of threads, applying the P4IGNORE rules
+		/// and collecting the size, modification time and, optionally, the 
+		/// MD5 digest of every file
+		/// </summary>
+		/// <param name="root">Directory to walk</param>
+		/// <param name="flags">1 to compute digests, 2 to skip the P4IGNORE
+		/// rules</param>
+		/// <param name="threads">Threads to use, 0 for one per core</param>
+		/// <returns>P4WorkspaceScan Handle, free with Release()</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			IntPtr ScanWorkspace(String root, int flags, int threads);
+
+		/// <summary>
+		/// Compare a scan with the tagged output of an 'fstat -Ol' run
+		/// </summary>
+		/// <param name="pScan">P4WorkspaceScan Handle</param>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the fstat</param>
+		/// <returns>Number of files that are not unchanged</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int CompareScan(IntPtr pScan, IntPtr pServer, uint cmdId);
+
+		/// <summary>
+		/// The number of files in a scan
+		/// </summary>
+		/// <param name="pScan">P4WorkspaceScan Handle</param>
+		/// <returns>Count</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int GetScanCount(IntPtr pScan);
+
+		/// <summary>
+		/// The files in a scan packed into one buffer. Each file is: long 
+		/// size, long mtime, int status, 32 byte digest, int path length, 
+		/// UTF-8 path.
+		/// </summary>
+		/// <param name="pScan">P4WorkspaceScan Handle</param>
+		/// <param name="length">Length of the buffer</param>
+		/// <returns>Handle (pointer) to the buffer</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetScanPacked(IntPtr pScan, out int length);
+
+		/// <summary>
+		/// Create an empty index of the have revision, head revision and 
+		/// open action of workspace files
+		/// </summary>
+		/// <returns>P4FileIndex Handle, free with Release()</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr CreateFileIndex();
+
+		/// <summary>
+		/// Replace the contents of an index with the tagged output of an 
+		/// fstat or have command
+		/// </summary>
+		/// <param name="pIndex">P4FileIndex Handle</param>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <returns>Number of files in the index</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int FileIndexLoad(IntPtr pIndex, IntPtr pServer, uint cmdId);
+
+		/// <summary>
+		/// Keep an index up to date from the sync, open, revert and submit 
+		/// commands run on a server
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pIndex">P4FileIndex Handle, IntPtr.Zero to stop</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void AttachFileIndex(IntPtr pServer, IntPtr pIndex);
+
+		/// <summary>
+		/// What the index knows about a file
+		/// </summary>
+		/// <param name="pIndex">P4FileIndex Handle</param>
+		/// <param name="path">Depot or local path</param>
+		/// <param name="haveRev">Have revision</param>
+		/// <param name="headRev">Head revision</param>
+		/// <param name="action">Open action string, owned by the index</param>
+		/// <param name="type">File type string, owned by the index</param>
+		/// <param name="change">Open change</param>
+		/// <returns>1 if the file is in the index</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			int FileIndexLookup(IntPtr pIndex, String path, out int haveRev, 
+				out int headRev, out IntPtr action, out IntPtr type, out int change);
+
+		/// <summary>
+		/// The number of files in an index
+		/// </summary>
+		/// <param name="pIndex">P4FileIndex Handle</param>
+		/// <returns>Count</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int FileIndexCount(IntPtr pIndex);
+
+		/// <summary>
+		/// Have we told the server to disconnect?
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+        /// <returns>boolean if we have an active p4 connection</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int IsConnected(IntPtr pServer);
+
+		/***********************************************************************
+		 * 
+		 * Callback management
+		 * 
+		 **********************************************************************/
+
+		/// <summary>
+		/// Set the callback for tagged output
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pNew">Pinned pointer to the callback delegate</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetTaggedOutputCallbackFn(IntPtr pServer, IntPtr pNew);
+
+		/// <summary>
+		/// Set the callback for error output
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pNew">Pinned pointer to the callback delegate</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetErrorCallbackFn(IntPtr pServer, IntPtr pNew);
+
+		/// <summary>
+		/// Set the callback for Info (non tagged) output
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pcb">Pinned pointer to the callback delegate</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetInfoResultsCallbackFn(IntPtr pServer, IntPtr pcb);
+
+		/// <summary>
+		/// Set the callback for the progress of a command. The callback gets
+		/// the command id and a pointer to the totals: int type, int done,
+		/// then long filesDone, filesTotal, bytesDone, bytesTotal, elapsedMs
+		/// and bytesPerSecond. It returns non zero to cancel the command.
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pcb">Pinned pointer to the callback delegate</param>
+		/// <param name="intervalMs">Least time between two calls</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetProgressCallbackFn(IntPtr pServer, IntPtr pcb, int intervalMs);
+
+		/// <summary>
+		/// Set the callback for text output
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pNew">Pinned pointer to the callback delegate</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetTextResultsCallbackFn(IntPtr pServer, IntPtr pNew);
+
+		/// <summary>
+		/// Set the callback for binary output
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pNew">Pinned pointer to the callback delegate</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetBinaryResultsCallbackFn(IntPtr pServer, IntPtr pNew);
+
+		/// <summary>
+		/// Set the call back to receive input prompts from the sever
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pNew">Pinned pointer to the callback delegate</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			 void SetPromptCallbackFn(IntPtr pServer, IntPtr pNew);
+
+        /// <summary>
+        /// Set the call back to receive parallel sync handling (see ClientTransfer)
+        /// </summary>
+        /// <param name="pServer">P4BridgeServer Handle</param>
+        /// <param name="pNew">Pinned pointer to the callback delegate</param>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+             void SetParallelTransferCallbackFn(IntPtr pServer, IntPtr pNew);
+        
+        /***********************************************************************
+		  * 
+		  * Output retrieval
+		  * 
+		  **********************************************************************/
+
+        /// <summary>
+        /// Get the number of entries in the tagged output for the last command
+        /// </summary>
+        /// <param name="pServer">P4BridgeServer Handle</param>
+        /// <param name="cmdId">Unique Id for the run of the command</param>
+        /// <returns>StrDictListIterator Handle (pointer) used to read the data</returns>
+        [DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int GetTaggedOutputCount(IntPtr pServer, uint cmdId);
+
+		/// <summary>
+		/// Get the tagged output for the last command
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+        /// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <returns>StrDictListIterator Handle (pointer) used to read the data</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetTaggedOutput(IntPtr pServer, uint cmdId);
+
+		/// <summary>
+		/// Choose how the tagged output of later commands is stored
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="mode">0 a dictionary per item, 1 a string pool per 
+		/// command, 2 a string pool kept between commands</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetTaggedIntern(IntPtr pServer, int mode);
+
+		/// <summary>
+		/// Get the interned tagged output as ids, for each item the field 
+		/// count followed by a key id and value id per field
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="length">Number of ints in the array</param>
+		/// <returns>Array of ints, owned by the server</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetTaggedOutputIds(IntPtr pServer, uint cmdId, out int length);
+
+		/// <summary>
+		/// Get the value id of one field for every item, -1 where not set
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="key">Field name</param>
+		/// <param name="length">Number of items</param>
+		/// <returns>Array of ints, owned by the server</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			IntPtr GetTaggedColumn(IntPtr pServer, uint cmdId, String key, out int length);
+
+		/// <summary>
+		/// Get the string for an id
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="id">String id</param>
+		/// <returns>Pointer to the string</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetTaggedString(IntPtr pServer, uint cmdId, int id);
+
+		/// <summary>
+		/// Get every interned string in id order, each followed by a NUL
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="length">Size of the table in bytes</param>
+		/// <returns>Pointer to the table, owned by the server</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetTaggedStringTable(IntPtr pServer, uint cmdId, out int length);
+
+		/// <summary>
+		/// Move the results of later commands to temporary files once they 
+		/// grow past a threshold
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="thresholdBytes">Spill once this much is held, 0 to never spill</param>
+		/// <param name="dir">Directory for the files, null for the system temporary directory</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			void SetResultSpill(IntPtr pServer, long thresholdBytes, String dir);
+
+		/// <summary>
+		/// Were the results of the last command spilled to temporary files?
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <returns>1 if spilled</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int IsResultSpilled(IntPtr pServer, uint cmdId);
+
+		/// <summary>
+		/// Serialize all of the results of the last command into one 
+		/// versioned blob that LoadResults can read back
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="length">Size of the blob in bytes</param>
+		/// <returns>Pointer to the blob, owned by the server</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr SerializeResults(IntPtr pServer, uint cmdId, out long length);
+
+		/// <summary>
+		/// Load a blob written by SerializeResults
+		/// </summary>
+		/// <param name="data">The blob</param>
+		/// <param name="length">Size of the blob in bytes</param>
+		/// <returns>P4ResultSet Handle, IntPtr.Zero if the blob is damaged, 
+		/// free with Release()</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr LoadResults(byte[] data, long length);
+
+		/// <summary>
+		/// Get an iterator over the tagged output of a result set
+		/// </summary>
+		/// <param name="pSet">P4ResultSet Handle</param>
+		/// <returns>StrDictListIterator Handle, release before the result set</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetResultSetTaggedOutput(IntPtr pSet);
+
+		/// <summary>
+		/// The number of items of tagged output in a result set
+		/// </summary>
+		/// <param name="pSet">P4ResultSet Handle</param>
+		/// <returns>Count</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int GetResultSetTaggedCount(IntPtr pSet);
+
+		/// <summary>
+		/// Get the first error in a result set
+		/// </summary>
+		/// <param name="pSet">P4ResultSet Handle</param>
+		/// <returns>P4ClientError Handle</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetResultSetErrors(IntPtr pSet);
+
+		/// <summary>
+		/// Get the first info message in a result set
+		/// </summary>
+		/// <param name="pSet">P4ResultSet Handle</param>
+		/// <returns>P4ClientInfoMsg Handle</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetResultSetInfo(IntPtr pSet);
+
+		/// <summary>
+		/// Get the text output of a result set
+		/// </summary>
+		/// <param name="pSet">P4ResultSet Handle</param>
+		/// <returns>Pointer to the text</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetResultSetText(IntPtr pSet);
+
+		/// <summary>
+		/// Get the binary output of a result set
+		/// </summary>
+		/// <param name="pSet">P4ResultSet Handle</param>
+		/// <param name="length">Size of the binary output in bytes</param>
+		/// <returns>Pointer to the data</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetResultSetBinary(IntPtr pSet, out long length);
+
+		/// <summary>
+		/// Create a writer that streams tagged output as newline delimited 
+		/// JSON to a file descriptor, or a HANDLE on Windows
+		/// </summary>
+		/// <param name="handle">File descriptor or HANDLE, left open</param>
+		/// <param name="flags">1 to also keep the tagged output, 2 to read 
+		/// invalid UTF-8 bytes as Latin-1</param>
+		/// <returns>P4NdjsonWriter Handle, release it with Release()</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr CreateNdjsonFileWriter(long handle, int flags);
+
+		/// <summary>
+		/// Create a writer that streams tagged output as newline delimited 
+		/// JSON to a ring buffer drained with ReadNdjson()
+		/// </summary>
+		/// <param name="ringBytes">Size of the ring</param>
+		/// <param name="flags">As for CreateNdjsonFileWriter</param>
+		/// <returns>P4NdjsonWriter Handle, release it with Release()</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr CreateNdjsonRingWriter(int ringBytes, int flags);
+
+		/// <summary>
+		/// Stream the tagged output of the commands run on a server to a writer
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="pWriter">P4NdjsonWriter Handle, IntPtr.Zero to stop</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void AttachNdjsonWriter(IntPtr pServer, IntPtr pWriter);
+
+		/// <summary>
+		/// Read from the ring of a writer
+		/// </summary>
+		/// <param name="pWriter">P4NdjsonWriter Handle</param>
+		/// <param name="buffer">Where to copy the output</param>
+		/// <param name="size">Size of the buffer</param>
+		/// <param name="timeoutMs">How long to wait, -1 for ever</param>
+		/// <returns>Bytes copied, 0 on timeout, -1 once closed and empty</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int ReadNdjson(IntPtr pWriter, byte[] buffer, int size, int timeoutMs);
+
+		/// <summary>
+		/// Write out the output buffered for a file descriptor
+		/// </summary>
+		/// <param name="pWriter">P4NdjsonWriter Handle</param>
+		/// <returns>1 on success, 0 if a write failed</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int FlushNdjsonWriter(IntPtr pWriter);
+
+		/// <summary>
+		/// Stop a writer, waking anything waiting on its ring
+		/// </summary>
+		/// <param name="pWriter">P4NdjsonWriter Handle</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void CloseNdjsonWriter(IntPtr pWriter);
 
 		/// <summary>
-		/// Run a command on the P4 Server
+		/// Get the totals for a writer
+		/// </summary>
+		/// <param name="pWriter">P4NdjsonWriter Handle</param>
+		/// <param name="records">Records written</param>
+		/// <param name="bytes">Bytes written</param>
+		/// <param name="invalid">Invalid UTF-8 sequences replaced</param>
+		/// <param name="dropped">Records not written</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void GetNdjsonCounts(IntPtr pWriter, out long records, out long bytes, 
+				out long invalid, out long dropped);
+
+		/// <summary>
+		/// Choose how diffs run on the client by later commands are reported
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="mode">0 through a temporary file, 1 in memory with a 
+		/// hunk per text callback, 2 in memory kept as hunk records</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetDiffMode(IntPtr pServer, int mode);
+
+		/// <summary>
+		/// Get the hunks of the files diffed by a command run with diff mode 2.
+		/// Each hunk is two longs (offset and length of its text) followed by
+		/// six ints (file, kind, from start, from count, to start, to count).
 		/// </summary>
-		/// <remarks>
-		/// The W version is used to pass Unicode (wide) parameters
-		/// </remarks>
 		/// <param name="pServer">P4BridgeServer Handle</param>
-		/// <param name="cmd">Command. i.e "fstat"</param>
 		/// <param name="cmdId">Unique Id for the run of the command</param>
-		/// <param name="tagged">If true, use tagged protocol the receive the 
-		/// output</param>
-		/// <param name="args">Arguments for the command</param>
-		/// <param name="argc">Argument count</param>
-		/// <returns></returns>
-		[DllImport(bridgeDll, EntryPoint = "RunCommand",
-			CallingConvention = CallingConvention.Cdecl,
-			CharSet = CharSet.Ansi)]
+		/// <param name="count">Number of hunks</param>
+		/// <returns>Pointer to the hunks</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			bool RunCommandW(	IntPtr pServer,
-								String cmd,
-								uint cmdId,
-								bool tagged,
-								IntPtr[] args,
-								int argc);
+			IntPtr GetDiffHunks(IntPtr pServer, uint cmdId, out int count);
 
 		/// <summary>
-		/// Cancel a running command
+		/// Get the text the hunk offsets refer to
 		/// </summary>
 		/// <param name="pServer">P4BridgeServer Handle</param>
-		/// <param name="CmdId">Unique Id for the run of the command</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="length">Size of the text in bytes</param>
+		/// <returns>Pointer to the text</returns>
 		[DllImport(bridgeDll,
 			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			void CancelCommand(IntPtr pServer, uint CmdId);
+			IntPtr GetDiffText(IntPtr pServer, uint cmdId, out long length);
 
 		/// <summary>
-		/// Have we told the server to disconnect?
+		/// Get the local file a hunk belongs to
 		/// </summary>
 		/// <param name="pServer">P4BridgeServer Handle</param>
-        /// <returns>boolean if we have an active p4 connection</returns>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="idx">File number of the hunk</param>
+		/// <returns>Pointer to the file name</returns>
 		[DllImport(bridgeDll,
 			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			int IsConnected(IntPtr pServer);
+			IntPtr GetDiffFile(IntPtr pServer, uint cmdId, int idx);
 
-		/***********************************************************************
-		 * 
-		 * Callback management
-		 * 
-		 **********************************************************************/
+		/// <summary>
+		/// Create an empty policy for deciding resolves in the bridge
+		/// </summary>
+		/// <returns>P4ResolvePolicy Handle, release it with Release()</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr CreateResolvePolicy();
 
 		/// <summary>
-		/// Set the callback for tagged output
+		/// Add a rule after the existing rules of a policy
 		/// </summary>
-		/// <param name="pServer">P4BridgeServer Handle</param>
-		/// <param name="pNew">Pinned pointer to the callback delegate</param>
+		/// <param name="pPolicy">P4ResolvePolicy Handle</param>
+		/// <param name="pattern">Local files the rule applies to, null for all</param>
+		/// <param name="resolveType">Type of resolve, null for all</param>
+		/// <param name="action">0 safe, 1 merge, 2 force merge, 3 theirs, 
+		/// 4 yours, 5 skip</param>
+		/// <returns>1 if the rule was added</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			int ResolvePolicyAddRule(IntPtr pPolicy, String pattern, String resolveType, int action);
+
+		/// <summary>
+		/// Remove every rule of a policy
+		/// </summary>
+		/// <param name="pPolicy">P4ResolvePolicy Handle</param>
 		[DllImport(bridgeDll,
 			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			void SetTaggedOutputCallbackFn(IntPtr pServer, IntPtr pNew);
+			void ResolvePolicyClear(IntPtr pPolicy);
 
 		/// <summary>
-		/// Set the callback for error output
+		/// Decide the resolves of the commands run on a server with a policy
 		/// </summary>
 		/// <param name="pServer">P4BridgeServer Handle</param>
-		/// <param name="pNew">Pinned pointer to the callback delegate</param>
+		/// <param name="pPolicy">P4ResolvePolicy Handle, IntPtr.Zero to stop</param>
 		[DllImport(bridgeDll,
 			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			void SetErrorCallbackFn(IntPtr pServer, IntPtr pNew);
+			void AttachResolvePolicy(IntPtr pServer, IntPtr pPolicy);
 
 		/// <summary>
-		/// Set the callback for Info (non tagged) output
+		/// Get a record of each file resolved by a policy. Each record is two
+		/// string pointers (path, type) followed by six ints (rule, result, 
+		/// your, their, both and conflict chunks). A policy that skips every
+		/// file previews the chunk counts without resolving anything.
 		/// </summary>
 		/// <param name="pServer">P4BridgeServer Handle</param>
-		/// <param name="pcb">Pinned pointer to the callback delegate</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="count">Number of records</param>
+		/// <returns>Pointer to the records</returns>
 		[DllImport(bridgeDll,
 			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			void SetInfoResultsCallbackFn(IntPtr pServer, IntPtr pcb);
+			IntPtr GetResolveSummary(IntPtr pServer, uint cmdId, out int count);
 
 		/// <summary>
-		/// Set the callback for text output
+		/// Get a ticket from the process wide ticket cache. The ticket file
+		/// is only read when it has changed.
 		/// </summary>
-		/// <param name="pServer">P4BridgeServer Handle</param>
-		/// <param name="pNew">Pinned pointer to the callback delegate</param>
+		/// <param name="path">Ticket file, null for the default</param>
+		/// <param name="port">Server port</param>
+		/// <param name="user">User name</param>
+		/// <param name="buf">Buffer for the ticket, may be null</param>
+		/// <param name="bufSize">Size of buf</param>
+		/// <returns>Length of the ticket, 0 if there is none, or minus the 
+		/// size needed if buf is too small</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			int LookupTicket(String path, String port, String user, byte[] buf, int bufSize);
+
+		/// <summary>
+		/// Set how often the ticket cache checks a ticket file for changes
+		/// </summary>
+		/// <param name="ms">Interval in milliseconds, 0 to check on every lookup</param>
 		[DllImport(bridgeDll,
 			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			void SetTextResultsCallbackFn(IntPtr pServer, IntPtr pNew);
+			void SetTicketCacheRecheck(int ms);
 
 		/// <summary>
-		/// Set the callback for binary output
+		/// Get the number of ticket lookups answered from the cache, the 
+		/// number that read a ticket file and the number of file changes seen
 		/// </summary>
-		/// <param name="pServer">P4BridgeServer Handle</param>
-		/// <param name="pNew">Pinned pointer to the callback delegate</param>
 		[DllImport(bridgeDll,
 			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			void SetBinaryResultsCallbackFn(IntPtr pServer, IntPtr pNew);
+			void GetTicketCacheCounts(out int hits, out int misses, out int reloads);
 
 		/// <summary>
-		/// Set the call back to receive input prompts from the sever
+		/// Resolve the connection settings of many directories in one call.
+		/// Directories resolved before come from a cache unless a config 
+		/// file or directory they depend on has changed.
 		/// </summary>
-		/// <param name="pServer">P4BridgeServer Handle</param>
-		/// <param name="pNew">Pinned pointer to the callback delegate</param>
+		/// <param name="dirs">Directories, as UTF-8 string pointers</param>
+		/// <param name="count">Number of directories</param>
+		/// <returns>P4ConfigBatch Handle, release it with Release()</returns>
 		[DllImport(bridgeDll,
 			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			 void SetPromptCallbackFn(IntPtr pServer, IntPtr pNew);
+			IntPtr ResolveConfigs(IntPtr[] dirs, int count);
 
-        /// <summary>
-        /// Set the call back to receive parallel sync handling (see ClientTransfer)
-        /// </summary>
-        /// <param name="pServer">P4BridgeServer Handle</param>
-        /// <param name="pNew">Pinned pointer to the callback delegate</param>
-        [DllImport(bridgeDll,
-            CallingConvention = CallingConvention.Cdecl)]
-        public static extern
-             void SetParallelTransferCallbackFn(IntPtr pServer, IntPtr pNew);
-        
-        /***********************************************************************
-		  * 
-		  * Output retrieval
-		  * 
-		  **********************************************************************/
+		/// <summary>
+		/// Get the settings resolved by ResolveConfigs. Each row is seven 
+		/// string pointers: directory, port, user, client, password, charset
+		/// and config file. Settings that are not set are null.
+		/// </summary>
+		/// <param name="pBatch">P4ConfigBatch Handle</param>
+		/// <param name="count">Number of rows</param>
+		/// <returns>Pointer to the rows</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetConfigRows(IntPtr pBatch, out int count);
 
-        /// <summary>
-        /// Get the number of entries in the tagged output for the last command
-        /// </summary>
-        /// <param name="pServer">P4BridgeServer Handle</param>
-        /// <param name="cmdId">Unique Id for the run of the command</param>
-        /// <returns>StrDictListIterator Handle (pointer) used to read the data</returns>
-        [DllImport(bridgeDll,
+		/// <summary>
+		/// Set how often a cached directory is checked for config changes
+		/// </summary>
+		/// <param name="ms">Interval in milliseconds, 0 to check on every lookup</param>
+		[DllImport(bridgeDll,
 			CallingConvention = CallingConvention.Cdecl)]
 		public static extern
-			int GetTaggedOutputCount(IntPtr pServer, uint cmdId);
+			void SetConfigCacheRecheck(int ms);
 
 		/// <summary>
-		/// Get the tagged output for the last command
+		/// Get a setting of one server. A server has the global settings 
+		/// until it is given its own with UpdateServerVar.
 		/// </summary>
 		/// <param name="pServer">P4BridgeServer Handle</param>
-        /// <param name="cmdId">Unique Id for the run of the command</param>
-		/// <returns>StrDictListIterator Handle (pointer) used to read the data</returns>
+		/// <param name="var">Name of the setting</param>
+		/// <returns>The value, release it with ReleaseString(), or 
+		/// IntPtr.Zero if it is not set</returns>
 		[DllImport(bridgeDll,
-			CallingConvention = CallingConvention.Cdecl)]
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
 		public static extern
-			IntPtr GetTaggedOutput(IntPtr pServer, uint cmdId);
+			IntPtr GetServerVar(IntPtr pServer, String var);
+
+		/// <summary>
+		/// Give one server its own value for a setting, without changing 
+		/// the global settings or any other server
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="var">Name of the setting</param>
+		/// <param name="val">The value, null to unset it for this server</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			void UpdateServerVar(IntPtr pServer, String var, String val);
+
+		/// <summary>
+		/// Go back to the global value of a setting for one server
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="var">Name of the setting, null for every setting</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			void ResetServerVar(IntPtr pServer, String var);
 
 		/// <summary>
 		/// Get the error output for the last command
@@ -807,6 +1708,42 @@ namespace Perforce.P4
 		public static extern
 			IntPtr GetInfoResults(IntPtr pServer, uint cmdId);
 
+		/// <summary>
+		/// Get all of the info output for the last command in one call
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+        /// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="utf16">Non zero to get the messages as UTF-16</param>
+		/// <param name="count">Number of messages</param>
+		/// <param name="pool">String pool the messages point into</param>
+		/// <param name="poolSize">Size of the pool in bytes</param>
+		/// <returns>Array of count {code, level, offset, length} int
+		/// quadruples, offset and length are in pool units. Valid until the
+		/// next call or command</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetPackedInfoResults(IntPtr pServer, uint cmdId, int utf16,
+				out int count, out IntPtr pool, out int poolSize);
+
+		/// <summary>
+		/// Get all of the error output for the last command in one call
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+        /// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="utf16">Non zero to get the messages as UTF-16</param>
+		/// <param name="count">Number of messages</param>
+		/// <param name="pool">String pool the messages point into</param>
+		/// <param name="poolSize">Size of the pool in bytes</param>
+		/// <returns>Array of count {code, severity, offset, length} int
+		/// quadruples, offset and length are in pool units. Valid until the
+		/// next call or command</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			IntPtr GetPackedErrorResults(IntPtr pServer, uint cmdId, int utf16,
+				out int count, out IntPtr pool, out int poolSize);
+
 		/// <summary>
 		/// Get the text output for the last command
 		/// </summary>
@@ -888,6 +1825,32 @@ namespace Perforce.P4
 		public static extern
 			IntPtr GetDataSet(IntPtr pServer, uint cmdId);
 
+		/// <summary>
+		/// Use a native buffer as the data set of the next command without 
+		/// copying it. The buffer must stay pinned until the command completes.
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="data">Pointer to the data</param>
+		/// <param name="length">Size of the data in bytes</param>
+		/// <returns>1 on success, 0 if the data is too large</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			int SetDataSetBuffer(IntPtr pServer, uint cmdId, IntPtr data, long length);
+
+		/// <summary>
+		/// Read the data set of the next command a chunk at a time from a
+		/// callback, as the command needs it
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="cmdId">Unique Id for the run of the command</param>
+		/// <param name="pNew">InputDataDelegate function pointer</param>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl)]
+		public static extern
+			void SetDataSetCallback(IntPtr pServer, uint cmdId, IntPtr pNew);
+
         /***********************************************************************
          * 
          * Set Debug Level
@@ -1380,6 +2343,20 @@ namespace Perforce.P4
         public static extern
             IntPtr GetTicket(IntPtr port, IntPtr user);
 
+		/// <summary>
+		/// Get the existing ticket for a connection from the ticket file a
+		/// server uses, its own P4TICKETS or the file set for it
+		/// </summary>
+		/// <param name="pServer">P4BridgeServer Handle</param>
+		/// <param name="port">Server port</param>
+		/// <param name="user">User name</param>
+		/// <returns>The ticket, release it with ReleaseString(), or
+		/// IntPtr.Zero if there is none</returns>
+		[DllImport(bridgeDll,
+			CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Ansi)]
+		public static extern
+			IntPtr GetServerTicket(IntPtr pServer, String port, String user);
+
 		/***********************************************************************
 		 * 
 		 * IsIgnored
@@ -1445,6 +2422,116 @@ namespace Perforce.P4
         public static extern
             void ReleaseString(IntPtr pObj);
 
+        /// <summary>
+        /// Choose where the strings returned for a server are allocated
+        /// </summary>
+        /// <param name="pServer">P4BridgeServer Handle</param>
+        /// <param name="mode">0 for one allocation per string, 1 for a slab
+        /// released with ReleaseAll, 2 to also release it when the next 
+        /// command runs</param>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            void SetStringSlab(IntPtr pServer, int mode);
+
+        /// <summary>
+        /// Release every slab string returned for a server
+        /// </summary>
+        /// <param name="pServer">P4BridgeServer Handle</param>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            void ReleaseAll(IntPtr pServer);
+
+        /// <summary>
+        /// Delete many objects allocated on the bridge's heap in one call
+        /// </summary>
+        /// <param name="handles">The objects, IntPtr.Zero entries are skipped</param>
+        /// <param name="count">Number of handles</param>
+        /// <returns>The number of objects deleted</returns>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            int ReleaseMany(IntPtr[] handles, int count);
+
+        /// <summary>
+        /// Create a session that owns the handles read from a command's 
+        /// results and deletes them together
+        /// </summary>
+        /// <returns>P4ResultSession Handle, release it with Release()</returns>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            IntPtr CreateResultSession();
+
+        /// <summary>
+        /// Give handles to a session, they must not be released on their own
+        /// </summary>
+        /// <param name="pSession">P4ResultSession Handle</param>
+        /// <param name="handles">The objects</param>
+        /// <param name="count">Number of handles</param>
+        /// <returns>The number of handles the session owns</returns>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            int ResultSessionAdopt(IntPtr pSession, IntPtr[] handles, int count);
+
+        /// <summary>
+        /// Get the tagged output of a command, with the iterator owned by a
+        /// session
+        /// </summary>
+        /// <param name="pSession">P4ResultSession Handle</param>
+        /// <param name="pServer">P4BridgeServer Handle</param>
+        /// <param name="cmdId">Unique Id for the run of the command</param>
+        /// <returns>StrDictListIterator Handle, do not release it</returns>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            IntPtr ResultSessionGetTaggedOutput(IntPtr pSession, IntPtr pServer, uint cmdId);
+
+        /// <summary>
+        /// Delete every handle a session owns, the session can be used again
+        /// </summary>
+        /// <param name="pSession">P4ResultSession Handle</param>
+        /// <returns>The number of handles deleted</returns>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            int ReleaseResultSession(IntPtr pSession);
+
+        /// <summary>
+        /// Record the calls the p4api makes while commands run on a server
+        /// </summary>
+        /// <param name="pServer">P4BridgeServer Handle</param>
+        /// <param name="path">The file to write</param>
+        /// <returns>1 if recording, 0 if the file can not be written</returns>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            int StartCallRecording(IntPtr pServer, string path);
+
+        /// <summary>
+        /// Finish the recording of a server
+        /// </summary>
+        /// <param name="pServer">P4BridgeServer Handle</param>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            void StopCallRecording(IntPtr pServer);
+
+        /// <summary>
+        /// Push a recording through the client of a command without a server
+        /// </summary>
+        /// <param name="pServer">P4BridgeServer Handle</param>
+        /// <param name="cmdId">Unique Id for the run of the command</param>
+        /// <param name="path">The recording</param>
+        /// <param name="repeat">How many times to replay it</param>
+        /// <returns>The number of calls replayed, -1 if the file is not a recording</returns>
+        [DllImport(bridgeDll,
+            CallingConvention = CallingConvention.Cdecl)]
+        public static extern
+            int ReplayCallRecording(IntPtr pServer, uint cmdId, string path, int repeat);
+
 		/***********************************************************************
 		 * 
 		 * KeyValuePair Functions
@@ -240,7 +240,6 @@ namespace Perforce.P4
                          String ws_client,
                          String cwd)
         {
-            RunCmdLastContactMap = new Dictionary<uint, CmdContactTimer>();
             // by default we are owned by the creating thread
             SetThreadOwner(Thread.CurrentThread.ManagedThreadId);
 
@@ -416,8 +415,6 @@ namespace Perforce.P4
                          String trust_flag,
                          String fingerprint)
         {
-            RunCmdLastContactMap = new Dictionary<uint, CmdContactTimer>();
-
             _server = server;
             _user = user;
             _pass = pass;
@@ -816,6 +813,13 @@ namespace Perforce.P4
                     return;
                 }
 
+                // the bridge disconnects idle servers itself once SetIdleDisconnect is on
+                if (P4Bridge.GetIdleDisconnect() > 0)
+                {
+                    DisconnectTimer.Stop();
+                    return;
+                }
+
                 // have we actually timed out, or did another command run after we acquired the lock?
                 if ((DateTime.Now - lastRunCommand).TotalMilliseconds > IdleDisconnectWaitTime)
                 {
@@ -877,130 +881,33 @@ namespace Perforce.P4
 #if DEBUG
         // long delays for debugging so it won't time out / disconnect while stepping through code
 
-        public TimeSpan RunCmdTimeout = TimeSpan.FromSeconds(5000);
+        private TimeSpan _runCmdTimeout = TimeSpan.FromSeconds(5000);
 
         public double IdleDisconnectWaitTime = 5000;
 #else
-		public TimeSpan RunCmdTimeout = TimeSpan.FromSeconds(30);
+		private TimeSpan _runCmdTimeout = TimeSpan.FromSeconds(30);
 
 		public double IdleDisconnectWaitTime = 5000;
 #endif
 
-        private Dictionary<uint, CmdContactTimer> RunCmdLastContactMap = null;
-
-        public bool IsCommandPaused(uint cmdId)
-        {
-            return RunCmdLastContactMap[cmdId].IsPaused;
-
-        }
-        public void PauseRunCmdTimer(uint cmdId)
-        {
-            if (RunCmdLastContactMap == null || !RunCmdLastContactMap.ContainsKey(cmdId))
-            {
-                return;
-            }
-            RunCmdLastContactMap[cmdId].Pause();
-        }
-
-        public void ContinueRunCmdTimer(uint cmdId)
-        {
-            if (RunCmdLastContactMap == null || !RunCmdLastContactMap.ContainsKey(cmdId))
-            {
-                return;
-            }
-            RunCmdLastContactMap[cmdId].Continue();
-        }
-
-        public class CmdContactTimer : IDisposable
+        /// <summary>
+        /// Time a command may go without output before it is cancelled. The
+        /// bridge enforces it once it has been set, commands are not limited
+        /// until then.
+        /// </summary>
+        public TimeSpan RunCmdTimeout
         {
-            private uint cmdId = 0;
-            private int CallbackCnt = 0;
-            private Dictionary<uint, CmdContactTimer> RunCmdLastContactMap = null;
-            DateTime LastContact = DateTime.MaxValue;
-
-            private CmdContactTimer() { }
-            public CmdContactTimer(Dictionary<uint, CmdContactTimer> runCmdLastContactMap, uint _cmdId)
-            {
-                if (runCmdLastContactMap == null)
-                {
-                    throw new ArgumentNullException("runCmdLastContactMap");
-                }
-
-                lock (runCmdLastContactMap)
-                {
-                    cmdId = _cmdId;
-                    CallbackCnt = 0;
-                    LastContact = DateTime.Now;
-
-                    RunCmdLastContactMap = runCmdLastContactMap;
-
-                    RunCmdLastContactMap[cmdId] = this;
-                }
-            }
-
-            public void Pause()
-            {
-                lock (RunCmdLastContactMap)
-                {
-                    if (RunCmdLastContactMap == null || !RunCmdLastContactMap.ContainsKey(cmdId))
-                    {
-                        return;
-                    }
-                    LastContact = DateTime.MaxValue;
-                    CallbackCnt++;
-                }
-            }
-
-            public void Continue()
-            {
-                lock (RunCmdLastContactMap)
-                {
-                    if (RunCmdLastContactMap == null || !RunCmdLastContactMap.ContainsKey(cmdId))
-                    {
-                        return;
-                    }
-                    CallbackCnt--;
-
-                    if (CallbackCnt == 0)
-                    {
-                        LastContact = DateTime.Now;
-                    }
-                }
-            }
-
-            #region IDisposable Members
-
-            public void Dispose()
-            {
-                lock (RunCmdLastContactMap)
-                {
-                    if (RunCmdLastContactMap != null || RunCmdLastContactMap.ContainsKey(cmdId))
-                    {
-                        RunCmdLastContactMap.Remove(cmdId);
-                    }
-                }
-            }
-
-            public bool IsPaused
-            {
-                get
-                {
-                    lock (RunCmdLastContactMap)
-                    {
-                        return LastContact == DateTime.MaxValue;
-                    }
-                }
-            }
-
-            public bool OverDue(TimeSpan RunCmdTimeout)
+            get { return _runCmdTimeout; }
+            set
             {
-                lock (RunCmdLastContactMap)
+                _runCmdTimeout = value;
+                if (pServer != IntPtr.Zero)
                 {
-                    return ((DateTime.Now - RunCmdLastContactMap[cmdId].LastContact) > RunCmdTimeout);
+                    double ms = value.TotalMilliseconds;
+                    P4Bridge.SetCommandTimeout(pServer, 0,
+                        (ms <= 0) ? 0 : (ms >= int.MaxValue) ? int.MaxValue : (int)ms);
                 }
-
             }
-            #endregion
         }
 
         //need a unique id to send to the Client for the IKeepAlive interface
@@ -1161,7 +1068,7 @@ namespace Perforce.P4
                     // update the lastRunCommand
                     lastRunCommand = DateTime.Now;
                     lastCmdId = 0;
-                    if (IdleDisconnectWaitTime > 0)
+                    if (IdleDisconnectWaitTime > 0 && P4Bridge.GetIdleDisconnect() <= 0)
                     {
                         if (DisconnectTimer == null)
                         {
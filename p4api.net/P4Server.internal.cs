@@ -416,42 +416,34 @@ namespace Perforce.P4
 		{
 			lock (TaggedOutputCallback_Int_Sync)
 			{
-				PauseRunCmdTimer(cmdId);
-				try
-				{
-					// no callback set, so ignore
-					if (TaggedOutputReceived == null)
-						return;
+				// no callback set, so ignore
+				if (TaggedOutputReceived == null)
+					return;
 
-					if ((!String.IsNullOrEmpty(Key)) && (pValue != IntPtr.Zero))
-					{
-						if (CurrentObject == null)
-							CurrentObject = new TaggedObject();
+				if ((!String.IsNullOrEmpty(Key)) && (pValue != IntPtr.Zero))
+				{
+					if (CurrentObject == null)
+						CurrentObject = new TaggedObject();
 
-						CurrentObject[Key] = MarshalPtrToString(pValue);
-					}
-					else
+					CurrentObject[Key] = MarshalPtrToString(pValue);
+				}
+				else
+				{
+					Delegate[] targetList = TaggedOutputReceived.GetInvocationList();
+					foreach (TaggedOutputDelegate d in targetList)
 					{
-						Delegate[] targetList = TaggedOutputReceived.GetInvocationList();
-						foreach (TaggedOutputDelegate d in targetList)
+						try
 						{
-							try
-							{
-								d(cmdId, objID, CurrentObject);
-							}
-							catch
-							{
-								// problem with delegate, so remove from the list
-								TaggedOutputReceived -= d;
-							}
+							d(cmdId, objID, CurrentObject);
+						}
+						catch
+						{
+							// problem with delegate, so remove from the list
+							TaggedOutputReceived -= d;
 						}
-						//get ready for the next object
-						CurrentObject = null;
 					}
-				}
-				finally
-				{
-					ContinueRunCmdTimer(cmdId);
+					//get ready for the next object
+					CurrentObject = null;
 				}
 			}
 		}
@@ -476,37 +468,29 @@ namespace Perforce.P4
 		{
 			lock (ErrorCallback_Int_Sync)
 			{
-				PauseRunCmdTimer(cmdId);
-				try
+				// no callback set, so ignore
+				if (ErrorReceived == null)
+					return;
+
+				String data = null;
+				if (pData != IntPtr.Zero)
 				{
-					// no callback set, so ignore
-					if (ErrorReceived == null)
-						return;
+					data = MarshalPtrToString(pData);
+				}
 
-					String data = null;
-					if (pData != IntPtr.Zero)
+				Delegate[] targetList = ErrorReceived.GetInvocationList();
+				foreach (ErrorDelegate d in targetList)
+				{
+					try
 					{
-						data = MarshalPtrToString(pData);
+						d(cmdId, severity, errorNumber, data);
 					}
-
-					Delegate[] targetList = ErrorReceived.GetInvocationList();
-					foreach (ErrorDelegate d in targetList)
+					catch
 					{
-						try
-						{
-							d(cmdId, severity, errorNumber, data);
-						}
-						catch
-						{
-							// problem with delegate, so remove from the list
-							ErrorReceived -= d;
-						}
+						// problem with delegate, so remove from the list
+						ErrorReceived -= d;
 					}
 				}
-				finally
-				{
-					ContinueRunCmdTimer(cmdId);
-				}
 			}
 		}
 
@@ -553,37 +537,29 @@ namespace Perforce.P4
 		{
 			lock (InfoResultsCallback_Sync)
 			{
-				PauseRunCmdTimer(cmdId);
-				try
+				// no callback set, so ignore
+				if (InfoResultsReceived == null)
+					return;
+
+				String data = null;
+				if (pData != IntPtr.Zero)
 				{
-					// no callback set, so ignore
-					if (InfoResultsReceived == null)
-						return;
+					data = MarshalPtrToString(pData);
+				}
 
-					String data = null;
-					if (pData != IntPtr.Zero)
+				Delegate[] targetList = InfoResultsReceived.GetInvocationList();
+				foreach (InfoResultsDelegate d in targetList)
+				{
+					try
 					{
-						data = MarshalPtrToString(pData);
+						d(cmdId, msgId, level, data);
 					}
-
-					Delegate[] targetList = InfoResultsReceived.GetInvocationList();
-					foreach (InfoResultsDelegate d in targetList)
+					catch
 					{
-						try
-						{
-							d(cmdId, msgId, level, data);
-						}
-						catch
-						{
-							// problem with delegate, so remove from the list
-							InfoResultsReceived -= d;
-						}
+						// problem with delegate, so remove from the list
+						InfoResultsReceived -= d;
 					}
 				}
-				finally
-				{
-					ContinueRunCmdTimer(cmdId);
-				}
 			}
 		}
 
@@ -628,37 +604,29 @@ namespace Perforce.P4
 		{
 			lock (TextResultsCallback_Int_Sync)
 			{
-				PauseRunCmdTimer(cmdId);
-				try
+				// no callback set, so ignore
+				if (TextResultsReceived == null)
+					return;
+
+				String data = null;
+				if (pData != IntPtr.Zero)
 				{
-					// no callback set, so ignore
-					if (TextResultsReceived == null)
-						return;
+					data = MarshalPtrToString(pData);
+				}
 
-					String data = null;
-					if (pData != IntPtr.Zero)
+				Delegate[] targetList = TextResultsReceived.GetInvocationList();
+				foreach (TextResultsDelegate d in targetList)
+				{
+					try
 					{
-						data = MarshalPtrToString(pData);
+						d(cmdId, data);
 					}
-
-					Delegate[] targetList = TextResultsReceived.GetInvocationList();
-					foreach (TextResultsDelegate d in targetList)
+					catch
 					{
-						try
-						{
-							d(cmdId, data);
-						}
-						catch
-						{
-							// problem with delegate, so remove from the list
-							TextResultsReceived -= d;
-						}
+						// problem with delegate, so remove from the list
+						TextResultsReceived -= d;
 					}
 				}
-				finally
-				{
-					ContinueRunCmdTimer(cmdId);
-				}
 			}
 		}
 
@@ -708,37 +676,29 @@ namespace Perforce.P4
 		{
 			lock (BinaryResultsCallback_Int_Sync)
 			{
-				PauseRunCmdTimer(cmdId);
-				try
+				// no callback set, so ignore
+				if (BinaryResultsReceived == null)
+					return;
+
+				byte[] data = null;
+				if (pData != IntPtr.Zero)
 				{
-					// no callback set, so ignore
-					if (BinaryResultsReceived == null)
-						return;
+					data = MarshalPtrToByteArrary(pData, cnt);
+				}
 
-					byte[] data = null;
-					if (pData != IntPtr.Zero)
+				Delegate[] targetList = BinaryResultsReceived.GetInvocationList();
+				foreach (BinaryResultsDelegate d in targetList)
+				{
+					try
 					{
-						data = MarshalPtrToByteArrary(pData, cnt);
+						d(cmdId, data);
 					}
-
-					Delegate[] targetList = BinaryResultsReceived.GetInvocationList();
-					foreach (BinaryResultsDelegate d in targetList)
+					catch
 					{
-						try
-						{
-							d(cmdId, data);
-						}
-						catch
-						{
-							// problem with delegate, so remove from the list
-							BinaryResultsReceived -= d;
-						}
+						// problem with delegate, so remove from the list
+						BinaryResultsReceived -= d;
 					}
 				}
-				finally
-				{
-					ContinueRunCmdTimer(cmdId);
-				}
 			}
 		}
 
@@ -779,35 +739,27 @@ namespace Perforce.P4
 		{
 			lock (PromptCallback_Int_Sync)
 			{
-				PauseRunCmdTimer(cmdId);
-				try
-				{
-					// no callback set, so ignore
-					if (PromptHandler == null)
-						return;
+				// no callback set, so ignore
+				if (PromptHandler == null)
+					return;
 
-					String msg = null;
-					if (pMsg != IntPtr.Zero)
-					{
-						msg = MarshalPtrToString(pMsg);
-					}
+				String msg = null;
+				if (pMsg != IntPtr.Zero)
+				{
+					msg = MarshalPtrToString(pMsg);
+				}
 
-					String response = null;
-					try
-					{
-						response = PromptHandler(cmdId, msg, display);
-					}
-					catch
-					{
-						// problem with delegate, so clear it
-						PromptHandler = null;
-					}
-					CopyStringToIntPtr(response, pRspBuf, buffSize);
+				String response = null;
+				try
+				{
+					response = PromptHandler(cmdId, msg, display);
 				}
-				finally 
+				catch
 				{
-					ContinueRunCmdTimer(cmdId);
+					// problem with delegate, so clear it
+					PromptHandler = null;
 				}
+				CopyStringToIntPtr(response, pRspBuf, buffSize);
 			}
 		}
 
@@ -1010,37 +962,29 @@ namespace Perforce.P4
 		{
 			lock (ResolveCallback_Int_Sync)
 			{
-				PauseRunCmdTimer(cmdId);
-				try
-				{
-					P4ClientMerge.MergeStatus result = P4ClientMerge.MergeStatus.CMS_NONE;
+				P4ClientMerge.MergeStatus result = P4ClientMerge.MergeStatus.CMS_NONE;
 
-					// no callback set, so ignore
-					if (ResolveHandler == null)
-						return -1;
+				// no callback set, so ignore
+				if (ResolveHandler == null)
+					return -1;
 
-					P4ClientMerge Merger = null;
-					if (pMerger != IntPtr.Zero)
-					{
-						Merger = new P4ClientMerge(this, pMerger);
-					}
+				P4ClientMerge Merger = null;
+				if (pMerger != IntPtr.Zero)
+				{
+					Merger = new P4ClientMerge(this, pMerger);
+				}
 
-					try
-					{
-						result = ResolveHandler(cmdId, Merger);
-					}
-					catch
-					{
-						// problem with delegate, so clear it
-						PromptHandler = null;
-						result = P4ClientMerge.MergeStatus.CMS_QUIT;
-					}
-					return (int)result;
+				try
+				{
+					result = ResolveHandler(cmdId, Merger);
 				}
-				finally
+				catch
 				{
-					ContinueRunCmdTimer(cmdId);
+					// problem with delegate, so clear it
+					PromptHandler = null;
+					result = P4ClientMerge.MergeStatus.CMS_QUIT;
 				}
+				return (int)result;
 			}
 		}
 
@@ -1073,37 +1017,29 @@ namespace Perforce.P4
 		{
 			lock (ResolveACallback_Int_Sync)
 			{
-				PauseRunCmdTimer(cmdId);
-				try
-				{
-					P4ClientMerge.MergeStatus result = P4ClientMerge.MergeStatus.CMS_NONE;
+				P4ClientMerge.MergeStatus result = P4ClientMerge.MergeStatus.CMS_NONE;
 
-					// no callback set, so ignore
-					if (ResolveAHandler == null)
-						return -1;
+				// no callback set, so ignore
+				if (ResolveAHandler == null)
+					return -1;
 
-					P4ClientResolve Resolver = null;
-					if (pResolver != IntPtr.Zero)
-					{
-						Resolver = new P4ClientResolve(this, pResolver);
-					}
+				P4ClientResolve Resolver = null;
+				if (pResolver != IntPtr.Zero)
+				{
+					Resolver = new P4ClientResolve(this, pResolver);
+				}
 
-					try
-					{
-						result = ResolveAHandler(cmdId, Resolver);
-					}
-					catch
-					{
-						// problem with delegate, so clear it
-						PromptHandler = null;
-						result = P4ClientMerge.MergeStatus.CMS_QUIT;
-					}
-					return (int)result;
+				try
+				{
+					result = ResolveAHandler(cmdId, Resolver);
 				}
-				finally
+				catch
 				{
-					ContinueRunCmdTimer(cmdId);
+					// problem with delegate, so clear it
+					PromptHandler = null;
+					result = P4ClientMerge.MergeStatus.CMS_QUIT;
 				}
+				return (int)result;
 			}
 		}
 
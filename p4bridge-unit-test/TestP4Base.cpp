@@ -7,6 +7,8 @@ CREATE_TEST_SUITE(TestP4Base)
 TestP4Base::TestP4Base(void)
 {
     UnitTestSuite::RegisterTest(&p4BaseSmokeTest, "p4BaseSmokeTest");
+
+    UnitTestSuite::RegisterBenchmark(&BenchValidateHandle, "BenchValidateHandle");
 }
 
 TestP4Base::~TestP4Base(void)
@@ -171,3 +173,25 @@ bool TestP4Base::p4BaseSmokeTest()
     }();
     return rv;
 }
+
+bool TestP4Base::BenchValidateHandle()
+{
+    class1 * obj = new class1();
+
+    bool rv = [&] {
+    volatile int valid = 0;
+    BenchmarkResult r = UnitTestBenchmark::Run("ValidateHandle", 1000, 200, 10000, [&] {
+        valid += p4base::ValidateHandle( obj, 1 );
+    });
+
+    ASSERT_EQUAL(valid, 1000 + r.Calls)
+    ASSERT_EQUAL(r.AllocsPerCall, 0.0)
+    ASSERT_BENCHMARK(r)
+
+        return true;
+    }();
+
+    delete obj;
+
+    return rv;
+}
@@ -15,5 +15,7 @@ public:
     bool TearDown(const char* testName);
 
     static bool p4BaseSmokeTest();
+
+    static bool BenchValidateHandle();
 };
 
@@ -4,9 +4,17 @@
 #include "../p4bridge/P4BridgeServer.h"
 #include "../p4bridge/P4BridgeClient.h"
 #include "../p4bridge/P4Connection.h"
+#include "../p4bridge/ResultCache.h"
+#include "../p4bridge/TicketCache.h"
+#include "../p4bridge/FileIndex.h"
+#include "../p4bridge/ResultSet.h"
+#include "../p4bridge/ResultSpill.h"
+#include "../p4bridge/NdjsonWriter.h"
+#include "../p4bridge/ResultSession.h"
 
 #include <strtable.h>
 #include <strarray.h>
+#include <mapapi.h>
 
 CREATE_TEST_SUITE(TestP4BridgeClient)
 
@@ -16,6 +24,26 @@ TestP4BridgeClient::TestP4BridgeClient(void) {
     UnitTestSuite::RegisterTest(OutputTextTest, "OutputTextTest");
     UnitTestSuite::RegisterTest(OutputBinaryTest, "OutputBinaryTest");
     UnitTestSuite::RegisterTest(OutputStatTest, "OutputStatTest");
+    UnitTestSuite::RegisterTest(PreparedCommandProjectionTest, "PreparedCommandProjectionTest");
+    UnitTestSuite::RegisterTest(CommandTimeoutTest, "CommandTimeoutTest");
+    UnitTestSuite::RegisterTest(ResultCacheTest, "ResultCacheTest");
+    UnitTestSuite::RegisterTest(FileIndexTest, "FileIndexTest");
+    UnitTestSuite::RegisterTest(TaggedInternTest, "TaggedInternTest");
+    UnitTestSuite::RegisterTest(StringPoolTest, "StringPoolTest");
+    UnitTestSuite::RegisterTest(ResultSpillTest, "ResultSpillTest");
+    UnitTestSuite::RegisterTest(ResultSetTest, "ResultSetTest");
+    UnitTestSuite::RegisterTest(NdjsonWriterTest, "NdjsonWriterTest");
+    UnitTestSuite::RegisterTest(InputDataTest, "InputDataTest");
+    UnitTestSuite::RegisterTest(DiffHunkTest, "DiffHunkTest");
+    UnitTestSuite::RegisterTest(ResolvePolicyTest, "ResolvePolicyTest");
+    UnitTestSuite::RegisterTest(ServerEnviroTest, "ServerEnviroTest");
+    UnitTestSuite::RegisterTest(PackedMessagesTest, "PackedMessagesTest");
+    UnitTestSuite::RegisterTest(ResultSessionTest, "ResultSessionTest");
+    UnitTestSuite::RegisterTest(ProgressTest, "ProgressTest");
+
+    UnitTestSuite::RegisterBenchmark(BenchOutputStat, "BenchOutputStat");
+    UnitTestSuite::RegisterBenchmark(BenchGetEntry, "BenchGetEntry");
+    UnitTestSuite::RegisterBenchmark(BenchTranslate, "BenchTranslate");
 
     UnitTestSuite::RegisterTest(HandleErrorCallbackTest, "HandleErrorCallbackTest");
     UnitTestSuite::RegisterTest(OutputInfoCallbackTest, "OutputInfoCallbackTest");
@@ -277,6 +305,138 @@ bool TestP4BridgeClient::OutputStatTest() {
     return rv;
 }
 
+bool TestP4BridgeClient::PreparedCommandProjectionTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    const char* args[] = { "-m1", "//depot/..." };
+    P4PreparedCommand * pPrepared = new P4PreparedCommand("changes", 7, 1, args, 2);
+
+    const char* keys[] = { "change", "user" };
+    pPrepared->SetProjection(keys, 2);
+
+    StrBufDict * pObj1 = new StrBufDict();
+
+    pObj1->SetVar("change", "42");
+    pObj1->SetVar("user", "fred");
+    pObj1->SetVar("desc", "a long description");
+
+    ui->SetProjection(pPrepared->GetProjection());
+    ui->OutputStat( pObj1 );
+    ui->SetProjection(NULL);
+
+    StrDictListIterator * pTaggedData = ui->GetTaggedOutput();
+
+    bool rv = [&]() -> bool {
+
+    ASSERT_STRING_EQUAL(pPrepared->GetCmd(), "changes")
+    ASSERT_EQUAL(pPrepared->GetArgc(), 2)
+    ASSERT_STRING_EQUAL(pPrepared->GetArgv()[0], "-m1")
+    ASSERT_STRING_EQUAL(pPrepared->GetArgv()[1], "//depot/...")
+
+    ASSERT_NOT_NULL(pTaggedData)
+
+    StrDictList * curItem = pTaggedData->GetNextItem();
+    ASSERT_NOT_NULL(curItem)
+
+    int count = 0;
+    KeyValuePair * curEntry = pTaggedData->GetNextEntry();
+    while (curEntry != nullptr)
+    {
+        ASSERT_TRUE(curEntry->key != "desc")
+        count++;
+        curEntry = pTaggedData->GetNextEntry();
+    }
+    ASSERT_EQUAL(count, 2)
+
+    // clearing the projection keeps every field
+    pPrepared->SetProjection(NULL, 0);
+    ASSERT_NULL(pPrepared->GetProjection())
+        return true;
+    }();
+
+    delete pObj1;
+	delete pTaggedData;
+    delete pPrepared;
+
+	delete pServer;
+
+    return rv;
+}
+
+static long long fakeNowMs = 0;
+
+static long long FakeClock()
+{
+    return fakeNowMs;
+}
+
+bool TestP4BridgeClient::CommandTimeoutTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    // drive the timeouts from a fake clock so the test does not depend on sleeps
+    fakeNowMs = 1000;
+    P4Connection::SetClock(FakeClock);
+
+    bool rv = [&]() -> bool {
+    // inactivity timeout, output keeps the command alive
+    pCon->IsAlive(1);
+    pCon->SetTimeouts(0, 200);
+    pCon->StartCommandTimer();
+    ASSERT_EQUAL(pCon->IsAlive(), 1)
+
+    fakeNowMs += 120;
+    ui->OutputText("Zero\n", 5);
+    fakeNowMs += 120;
+    ASSERT_EQUAL(pCon->IsAlive(), 1)
+    ASSERT_EQUAL(pServer->GetCommandTimeoutStatus(7), CMD_NOT_TIMED_OUT)
+
+    fakeNowMs += 80;
+    ASSERT_EQUAL(pCon->IsAlive(), 0)
+    ASSERT_EQUAL(pCon->GetTimeoutStatus(), CMD_INACTIVITY_TIMEOUT)
+    ASSERT_EQUAL(pServer->GetCommandTimeoutStatus(7), CMD_INACTIVITY_TIMEOUT)
+
+    // the status belongs to the command that timed out
+    ASSERT_EQUAL(pServer->GetCommandTimeoutStatus(8), CMD_NOT_TIMED_OUT)
+
+    // partial results are kept
+    ASSERT_STRING_EQUAL(ui->GetTextResults(), "Zero\n")
+
+    // deadline, output does not extend it
+    pCon->IsAlive(1);
+    pCon->SetTimeouts(200, 0);
+    pCon->StartCommandTimer();
+    ASSERT_EQUAL(pCon->GetTimeoutStatus(), CMD_NOT_TIMED_OUT)
+
+    fakeNowMs += 120;
+    ui->OutputText("One\n", 4);
+    fakeNowMs += 79;
+    ASSERT_EQUAL(pCon->IsAlive(), 1)
+    fakeNowMs += 1;
+    ASSERT_EQUAL(pCon->IsAlive(), 0)
+    ASSERT_EQUAL(pCon->GetTimeoutStatus(), CMD_DEADLINE_EXCEEDED)
+
+    // no limits
+    pCon->IsAlive(1);
+    pCon->SetTimeouts(0, 0);
+    pCon->StartCommandTimer();
+    fakeNowMs += 100000;
+    ASSERT_EQUAL(pCon->IsAlive(), 1)
+        return true;
+    }();
+
+    P4Connection::SetClock(NULL);
+
+	delete pServer;
+
+    return rv;
+}
+
 bool bPassedCallbacksTests = true;
 
 void STDCALL ErrorCallbackFn(int cmdId, int severity, int errorId, const char *msg) 
@@ -660,3 +820,1139 @@ bool TestP4BridgeClient::PromptCallbackTest()
 
     return rv;
 }
+
+static string cacheEvents;
+
+void STDCALL CacheInfoCallbackFn(int cmdId, int msgId, int level, const char *msg)
+{
+    cacheEvents += "i";
+}
+
+void STDCALL CacheTaggedCallbackFn(int cmdId, int objId, const char *key, const char *val)
+{
+    // once per record
+    if (key && !strcmp(key, "group"))
+        cacheEvents += "t";
+}
+
+void STDCALL CacheTextCallbackFn(int cmdId, const char *msg)
+{
+    cacheEvents += "x";
+}
+
+bool TestP4BridgeClient::ResultCacheTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    const char* args[] = { "-v" };
+    string key = ResultCache::MakeKey("localhost:6666", "admin", "ws", "ticket1", "none", "/", "groups", 1, args, 1, NULL);
+    string otherKey = ResultCache::MakeKey("localhost:6666", "admin", "ws", "ticket1", "none", "/", "groups", 1, NULL, 0, NULL);
+    string otherLogin = ResultCache::MakeKey("localhost:6666", "admin", "ws", "ticket2", "none", "/", "groups", 1, args, 1, NULL);
+
+    bool rv = [&]() -> bool {
+    ASSERT_TRUE(key != otherKey)
+    // a different login is a different key
+    ASSERT_TRUE(key != otherLogin)
+
+    // off until given a size
+    ASSERT_FALSE(ResultCache::IsCacheable("groups"))
+    ResultCache::Configure(4096, 60000);
+    ASSERT_TRUE(ResultCache::IsCacheable("groups"))
+    ASSERT_FALSE(ResultCache::IsCacheable("sync"))
+
+    int hits, misses, evictions, entries, bytes;
+    ResultCache::GetCounts(&hits, &misses, &evictions, &entries, &bytes);
+    int startHits = hits;
+
+    StrBufDict obj;
+    obj.SetVar("group", "devs");
+    obj.SetVar("user", "fred");
+    ResultCapture capture;
+    ui->clear_results();
+    ui->SetResultCapture(&capture);
+    ui->HandleInfoMsg(1, '0', "info message");
+    ui->OutputStat(&obj);
+    ui->OutputText("text", 4);
+    ui->OutputStat(&obj);
+    ui->SetResultCapture(NULL);
+    ResultCache::Store(key, "localhost:6666", "groups", &capture, ui);
+
+    ui->clear_results();
+    ASSERT_FALSE(ResultCache::Replay(otherKey, ui))
+    ASSERT_FALSE(ResultCache::Replay(otherLogin, ui))
+
+    // replayed in the order the command produced them
+    pServer->SetInfoResultsCallbackFn(CacheInfoCallbackFn);
+    pServer->SetTaggedOutputCallbackFn(CacheTaggedCallbackFn);
+    pServer->SetTextResultsCallbackFn(CacheTextCallbackFn);
+    cacheEvents.clear();
+    ASSERT_TRUE(ResultCache::Replay(key, ui))
+    ASSERT_STRING_EQUAL(cacheEvents.c_str(), "itxt")
+    pServer->SetInfoResultsCallbackFn(NULL);
+    pServer->SetTaggedOutputCallbackFn(NULL);
+    pServer->SetTextResultsCallbackFn(NULL);
+
+    StrDictListIterator * pTaggedData = ui->GetTaggedOutput();
+    ASSERT_NOT_NULL(pTaggedData)
+    ASSERT_NOT_NULL(pTaggedData->GetNextItem())
+    KeyValuePair * curEntry = pTaggedData->GetNextEntry();
+    ASSERT_NOT_NULL(curEntry)
+    ASSERT_STRING_EQUAL(curEntry->key.c_str(), "group")
+    ASSERT_STRING_EQUAL(curEntry->value.c_str(), "devs")
+    delete pTaggedData;
+
+    ASSERT_NOT_NULL(ui->GetInfoResults())
+    ASSERT_STRING_EQUAL(ui->GetInfoResults()->Message.c_str(), "info message")
+
+    ResultCache::GetCounts(&hits, &misses, &evictions, &entries, &bytes);
+    ASSERT_EQUAL(hits, startHits + 1)
+    ASSERT_EQUAL(entries, 1)
+
+    // results with errors are not kept
+    ResultCapture failed;
+    ui->SetResultCapture(&failed);
+    ui->HandleInfoMsg(1, '0', "info message");
+    ui->HandleError(E_FAILED, 0, "failed");
+    ui->SetResultCapture(NULL);
+    ResultCache::Store(otherKey, "localhost:6666", "groups", &failed, ui);
+    ResultCache::GetCounts(&hits, &misses, &evictions, &entries, &bytes);
+    ASSERT_EQUAL(entries, 1)
+
+    ASSERT_EQUAL(ResultCache::Invalidate(NULL, "users"), 0)
+    ASSERT_EQUAL(ResultCache::Invalidate("localhost:6666", NULL), 1)
+    ASSERT_FALSE(ResultCache::Replay(key, ui))
+
+        return true;
+    }();
+
+    ResultCache::Configure(0, 0);
+	delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::FileIndexTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    P4FileIndex * pIndex = new P4FileIndex();
+
+    bool rv = [&]() -> bool {
+    // load from fstat output
+    StrDictList * pFstat = new StrDictList();
+    pFstat->Data()->SetVar("depotFile", "//depot/main/a.txt");
+    pFstat->Data()->SetVar("clientFile", "/ws/main/a.txt");
+    pFstat->Data()->SetVar("headRev", "3");
+    pFstat->Data()->SetVar("haveRev", "2");
+    pFstat->Data()->SetVar("headType", "text");
+    StrDictList * pNext = new StrDictList();
+    pFstat->Next(pNext);
+    pNext->Data()->SetVar("depotFile", "//depot/main/b.bin");
+    pNext->Data()->SetVar("clientFile", "/ws/main/b.bin");
+    pNext->Data()->SetVar("headRev", "1");
+    pNext->Data()->SetVar("haveRev", "1");
+    pNext->Data()->SetVar("headType", "binary+l");
+    // opened for add, so there is no head revision yet
+    StrDictList * pAdd = new StrDictList();
+    pNext->Next(pAdd);
+    pAdd->Data()->SetVar("depotFile", "//depot/main/new.txt");
+    pAdd->Data()->SetVar("clientFile", "/ws/main/new.txt");
+    pAdd->Data()->SetVar("action", "add");
+    pAdd->Data()->SetVar("change", "12");
+    pAdd->Data()->SetVar("type", "text");
+
+    int count = pIndex->Load(pFstat);
+    delete pFstat;
+    ASSERT_EQUAL(count, 3)
+
+    P4FileIndex::FileInfo info;
+    ASSERT_TRUE(pIndex->Lookup("/ws/main/a.txt", info))
+    ASSERT_EQUAL(info.haveRev, 2)
+    ASSERT_EQUAL(info.headRev, 3)
+    ASSERT_STRING_EQUAL(info.type, "text")
+    ASSERT_STRING_EQUAL(info.action, "")
+    ASSERT_FALSE(pIndex->Lookup("/ws/main/c.txt", info))
+
+    ASSERT_TRUE(pIndex->Lookup("/ws/main/new.txt", info))
+    ASSERT_EQUAL(info.headRev, 0)
+    ASSERT_EQUAL(info.haveRev, 0)
+    ASSERT_STRING_EQUAL(info.action, "add")
+    ASSERT_EQUAL(info.change, 12)
+    ASSERT_STRING_EQUAL(info.type, "text")
+
+    // a sync seen by the client updates the have revision
+    const char* syncArgs[] = { "//depot/main/..." };
+    ui->SetFileIndex(pIndex, P4FileIndex::UpdateKind("sync", syncArgs, 1));
+    StrBufDict sync;
+    sync.SetVar("depotFile", "//depot/main/a.txt");
+    sync.SetVar("clientFile", "/ws/main/a.txt");
+    sync.SetVar("rev", "3");
+    sync.SetVar("action", "updated");
+    ui->OutputStat(&sync);
+
+    // as does an edit, even with a projection
+    std::set<std::string> projection;
+    projection.insert("depotFile");
+    ui->SetProjection(&projection);
+    ui->SetFileIndex(pIndex, P4FileIndex::UpdateKind("edit", NULL, 0));
+    StrBufDict edit;
+    edit.SetVar("depotFile", "//depot/main/a.txt");
+    edit.SetVar("clientFile", "//ws/main/a.txt");
+    edit.SetVar("action", "edit");
+    edit.SetVar("type", "text");
+    ui->OutputStat(&edit);
+    ui->SetProjection(NULL);
+
+    ASSERT_TRUE(pIndex->Lookup("//depot/main/a.txt", info))
+    ASSERT_EQUAL(info.haveRev, 3)
+    ASSERT_STRING_EQUAL(info.action, "edit")
+    // client syntax does not replace the local path
+    ASSERT_STRING_EQUAL(info.localFile, "/ws/main/a.txt")
+
+    // a new file added by sync is found by both paths
+    ui->SetFileIndex(pIndex, P4FileIndex::UpdateKind("sync", NULL, 0));
+    StrBufDict added;
+    added.SetVar("depotFile", "//depot/main/c.txt");
+    added.SetVar("clientFile", "/ws/main/c.txt");
+    added.SetVar("rev", "1");
+    added.SetVar("action", "added");
+    ui->OutputStat(&added);
+    ASSERT_TRUE(pIndex->Lookup("/ws/main/c.txt", info))
+    ASSERT_TRUE(pIndex->Lookup("//depot/main/c.txt", info))
+    ASSERT_EQUAL(pIndex->Count(), 4)
+
+    // previews change nothing
+    const char* previewArgs[] = { "-n", "//depot/main/..." };
+    ASSERT_EQUAL(P4FileIndex::UpdateKind("sync", previewArgs, 2), FILEINDEX_NONE)
+
+    // submit clears the action
+    ui->SetFileIndex(pIndex, P4FileIndex::UpdateKind("submit", NULL, 0));
+    StrBufDict submit;
+    submit.SetVar("depotFile", "//depot/main/a.txt");
+    submit.SetVar("rev", "4");
+    submit.SetVar("action", "edit");
+    ui->OutputStat(&submit);
+    ui->SetFileIndex(NULL, FILEINDEX_NONE);
+
+    ASSERT_TRUE(pIndex->Lookup("/ws/main/a.txt", info))
+    ASSERT_EQUAL(info.haveRev, 4)
+    ASSERT_EQUAL(info.headRev, 4)
+    ASSERT_STRING_EQUAL(info.action, "")
+
+        return true;
+    }();
+
+    ui->SetFileIndex(NULL, FILEINDEX_NONE);
+    delete pIndex;
+	delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::TaggedInternTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    bool rv = [&]() -> bool {
+    ASSERT_EQUAL(ui->GetInternMode(), TAGGED_INTERN_PER_COMMAND)
+
+    const char* types[] = { "text", "binary+l", "text" };
+    for (int i = 0; i < 3; i++)
+    {
+        char path[64];
+        sprintf(path, "//depot/main/file%d.txt", i);
+        StrBufDict dict;
+        dict.SetVar("depotFile", path);
+        dict.SetVar("headType", types[i]);
+        if (i != 1)
+            dict.SetVar("headAction", "edit");
+        ui->OutputStat(&dict);
+    }
+
+    // read back as usual
+    StrDictList * pItem = ui->GetTaggedOutputList();
+    ASSERT_NOT_NULL(pItem)
+    ASSERT_NOT_NULL(pItem->Pooled())
+    ASSERT_STRING_EQUAL(pItem->Data()->GetVar("depotFile")->Text(), "//depot/main/file0.txt")
+    ASSERT_STRING_EQUAL(pItem->Data()->GetVar("headType")->Text(), "text")
+    ASSERT_NULL(pItem->Data()->GetVar("change"))
+
+    // keys and repeated values are stored once: "", 3 keys, 3 paths,
+    //  2 types and one action
+    StringPool * pool = ui->GetTaggedStrings();
+    ASSERT_EQUAL(pool->Count(), 10)
+
+    int length = 0;
+    const int * ids = ui->GetTaggedOutputIds(&length);
+    ASSERT_NOT_NULL(ids)
+    ASSERT_EQUAL(length, 3 + 2 * (3 + 2 + 3))
+    ASSERT_EQUAL(ids[0], 3)
+    ASSERT_STRING_EQUAL(pool->Get(ids[1]), "depotFile")
+    ASSERT_STRING_EQUAL(pool->Get(ids[4]), "text")
+
+    const int * column = ui->GetTaggedColumn("headType", &length);
+    ASSERT_EQUAL(length, 3)
+    ASSERT_EQUAL(column[0], column[2])
+    ASSERT_NOT_EQUAL(column[0], column[1])
+    ASSERT_STRING_EQUAL(pool->Get(column[1]), "binary+l")
+
+    column = ui->GetTaggedColumn("headAction", &length);
+    ASSERT_EQUAL(column[1], -1)
+    column = ui->GetTaggedColumn("noSuchField", &length);
+    ASSERT_EQUAL(column[0], -1)
+
+    const char * table = ui->GetTaggedStringTable(&length);
+    ASSERT_STRING_EQUAL(table + 1, "depotFile")
+
+    // a per command pool goes with the results
+    ui->clear_results();
+    ASSERT_EQUAL(pool->Count(), 1)
+
+    // a per connection pool keeps its ids
+    ui->SetInternMode(TAGGED_INTERN_PER_CONNECTION);
+    StrBufDict dict;
+    dict.SetVar("depotFile", "//depot/main/file0.txt");
+    ui->OutputStat(&dict);
+    column = ui->GetTaggedColumn("depotFile", &length);
+    int id = column[0];
+    ui->clear_results();
+    ui->OutputStat(&dict);
+    column = ui->GetTaggedColumn("depotFile", &length);
+    ASSERT_EQUAL(column[0], id)
+
+    // interning off stores dictionaries as before
+    ui->SetInternMode(TAGGED_INTERN_OFF);
+    ui->clear_results();
+    ui->OutputStat(&dict);
+    ASSERT_NULL(ui->GetTaggedOutputList()->Pooled())
+    ASSERT_STRING_EQUAL(ui->GetTaggedOutputList()->Data()->GetVar("depotFile")->Text(), "//depot/main/file0.txt")
+    ASSERT_NULL(ui->GetTaggedOutputIds(&length))
+
+        return true;
+    }();
+
+	delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::StringPoolTest() {
+    StringPool pool;
+
+    bool rv = [&]() -> bool {
+    // long values are added without a lookup and short ones are interned,
+    //  growing the table must only count the interned ones
+    std::string big(300, 'x');
+    std::vector<unsigned int> ids;
+    for (int i = 0; i < 4000; i++)
+    {
+        big[0] = 'a' + (i % 26);
+        pool.Add(big.c_str(), big.length());
+
+        char name[32];
+        sprintf(name, "value%d", i % 1000);
+        unsigned int id = pool.Intern(name);
+        if (i < 1000)
+        {
+            ids.push_back(id);
+        }
+        else
+        {
+            ASSERT_EQUAL(id, ids[i % 1000])
+        }
+    }
+
+    ASSERT_EQUAL(pool.Count(), 1 + 4000 + 1000)
+    ASSERT_EQUAL(pool.Find("value999", 8), (int) ids[999])
+    ASSERT_STRING_EQUAL(pool.Get(ids[42]), "value42")
+    ASSERT_EQUAL(pool.Find(big.c_str(), big.length()), -1)
+    ASSERT_EQUAL(pool.Length(1), 300u)
+
+    pool.Clear();
+    ASSERT_EQUAL(pool.Count(), 1)
+    ASSERT_EQUAL(pool.Find("value1", 6), -1)
+
+        return true;
+    }();
+
+    return rv;
+}
+
+bool TestP4BridgeClient::ResultSpillTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    bool rv = [&]() -> bool {
+    ui->SetSpill(4096, NULL);
+
+    // small results stay in memory
+    ui->OutputText("small", 5);
+    ASSERT_FALSE(ui->IsSpilled())
+    ui->clear_results();
+
+    std::string text;
+    std::string binary;
+    for (int i = 0; i < 200; i++)
+    {
+        char line[64];
+        sprintf(line, "line %d\n", i);
+        ui->OutputText(line, -1);
+        text += line;
+
+        binary.append(8, (char) i);
+        ui->OutputBinary(binary.data() + binary.size() - 8, 8);
+
+        char path[64];
+        sprintf(path, "//depot/main/file%d.txt", i);
+        StrBufDict dict;
+        dict.SetVar("depotFile", path);
+        dict.SetVar("headRev", i + 1);
+        ui->OutputStat(&dict);
+    }
+    ASSERT_TRUE(ui->IsSpilled())
+    ASSERT_NULL(ui->GetTaggedOutputList())
+    // the strings of the spilled records left the pool with them
+    ASSERT_EQUAL(ui->GetTaggedStrings()->Count(), 0)
+
+    // the usual functions read the spilled results
+    ASSERT_STRING_EQUAL(ui->GetTextResults(), text.c_str())
+    ASSERT_EQUAL(ui->GetBinaryResultsCount(), binary.size())
+    ASSERT_TRUE(memcmp(ui->GetBinaryResults(), binary.data(), binary.size()) == 0)
+    ASSERT_EQUAL(ui->GetTaggedOutputCount(), 199)
+
+    // more text after the results were read
+    ui->OutputText("more", 4);
+    text += "more";
+    ASSERT_STRING_EQUAL(ui->GetTextResults(), text.c_str())
+
+    StrDictListIterator * pTagged = ui->GetTaggedOutput();
+    ASSERT_NOT_NULL(pTagged)
+    int count = 0;
+    int fields = 0;
+    StrDictList * pItem;
+    while ((pItem = pTagged->GetNextItem()) != NULL)
+    {
+        char path[64];
+        sprintf(path, "//depot/main/file%d.txt", count);
+        if (strcmp(pItem->Data()->GetVar("depotFile")->Text(), path) != 0)
+            break;
+        if (pItem->Data()->GetVar("headRev")->Atoi() != count + 1)
+            break;
+        while (pTagged->GetNextEntry() != NULL)
+            fields++;
+        count++;
+    }
+    delete pTagged;
+    ASSERT_EQUAL(count, 200)
+    ASSERT_EQUAL(fields, 400)
+
+    // the batch accessors read the spilled records too
+    int length = 0;
+    const int * ids = ui->GetTaggedOutputIds(&length);
+    ASSERT_NOT_NULL(ids)
+    ASSERT_EQUAL(length, 200 * 5)
+    ASSERT_EQUAL(ids[0], 2)
+    StringPool * pool = ui->GetTaggedStrings();
+    ASSERT_STRING_EQUAL(pool->Get(ids[1]), "depotFile")
+    ASSERT_STRING_EQUAL(pool->Get(ids[2]), "//depot/main/file0.txt")
+
+    const int * column = ui->GetTaggedColumn("headRev", &length);
+    ASSERT_EQUAL(length, 200)
+    ASSERT_STRING_EQUAL(pool->Get(column[199]), "200")
+
+    // two keys, 200 paths and 200 revisions, however often they are read
+    ASSERT_EQUAL(pool->Count(), 402)
+    ids = ui->GetTaggedOutputIds(&length);
+    ASSERT_EQUAL(pool->Count(), 402)
+    ASSERT_STRING_EQUAL(pool->Get(ids[2]), "//depot/main/file0.txt")
+
+    // cleared results go back to memory
+    ui->clear_results();
+    ASSERT_FALSE(ui->IsSpilled())
+    ASSERT_EQUAL(ui->GetBinaryResultsCount(), 0)
+    ASSERT_NULL(ui->GetTaggedOutput())
+
+    // a field count larger than the bytes left could hold is rejected
+    //  before anything is allocated for it
+    const char bad[] = { '\xff', '\xff', '\xff', '\x0f', 3, 0, 0, 0, 'k', 'e', 'y', 0 };
+    SpilledStrDict record;
+    ASSERT_EQUAL(record.Set(bad, 0, sizeof(bad)), 0)
+
+        return true;
+    }();
+
+    ui->SetSpill(0, NULL);
+	delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::ResultSetTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    P4ResultSet * pSet = new P4ResultSet();
+
+    bool rv = [&]() -> bool {
+    StrBufDict dict1;
+    dict1.SetVar("change", "12");
+    dict1.SetVar("desc", "first\nchange");
+    ui->OutputStat(&dict1);
+    StrBufDict dict2;
+    dict2.SetVar("change", "13");
+    ui->OutputStat(&dict2);
+    ui->HandleInfoMsg(1, '0', "info message");
+    ui->HandleError(E_WARN, 17, "warning message");
+    ui->OutputText("some\0text", 9);
+    ui->OutputBinary("\0\1\2", 3);
+
+    long long length = 0;
+    const char * blob = ui->Serialize(&length);
+    ASSERT_NOT_NULL(blob)
+    std::vector<char> copy(blob, blob + length);
+
+    // the results don't have to exist any more
+    ui->clear_results();
+
+    ASSERT_TRUE(pSet->Load(copy.data(), copy.size()))
+    ASSERT_EQUAL(pSet->GetTaggedOutputCount(), 2)
+
+    StrDictListIterator * pTagged = pSet->GetTaggedOutput();
+    ASSERT_NOT_NULL(pTagged)
+    StrDictList * pItem = pTagged->GetNextItem();
+    ASSERT_NOT_NULL(pItem)
+    ASSERT_STRING_EQUAL(pItem->Data()->GetVar("desc")->Text(), "first\nchange")
+    KeyValuePair * pEntry = pTagged->GetNextEntry();
+    ASSERT_STRING_EQUAL(pEntry->key.c_str(), "change")
+    ASSERT_STRING_EQUAL(pEntry->value.c_str(), "12")
+    pItem = pTagged->GetNextItem();
+    ASSERT_STRING_EQUAL(pItem->Data()->GetVar("change")->Text(), "13")
+    ASSERT_NULL(pTagged->GetNextItem())
+    delete pTagged;
+
+    ASSERT_NOT_NULL(pSet->GetInfoResults())
+    ASSERT_STRING_EQUAL(pSet->GetInfoResults()->Message.c_str(), "info message")
+    ASSERT_EQUAL(pSet->GetInfoResults()->Level, '0')
+    ASSERT_NOT_NULL(pSet->GetErrorResults())
+    ASSERT_EQUAL(pSet->GetErrorResults()->Severity, E_WARN)
+    ASSERT_EQUAL(pSet->GetErrorResults()->ErrorCode, 17)
+    // all of the text, not just up to the embedded NUL
+    ASSERT_EQUAL(pSet->GetTextResultsLength(), 9)
+    ASSERT_TRUE(memcmp(pSet->GetTextResults(), "some\0text", 10) == 0)
+    ASSERT_EQUAL(pSet->GetBinaryResultsCount(), 3)
+    ASSERT_EQUAL(pSet->GetBinaryResults()[2], 2)
+
+    // damaged or newer blobs are refused
+    ASSERT_FALSE(pSet->Load(copy.data(), copy.size() - 1))
+    ASSERT_NULL(pSet->GetErrorResults())
+    copy[4] = RESULT_SET_VERSION + 1;
+    ASSERT_FALSE(pSet->Load(copy.data(), copy.size()))
+
+        return true;
+    }();
+
+    delete pSet;
+	delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::NdjsonWriterTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    P4NdjsonWriter * pWriter = new P4NdjsonWriter(4096, 0);
+
+    bool rv = [&]() -> bool {
+    ui->SetNdjsonWriter(pWriter);
+    StrBufDict dict1;
+    dict1.SetVar("path", "//depot/a b.txt");
+    dict1.SetVar("desc", "say \"hi\"\\\n");
+    dict1.SetVar("func", "skipped");
+    ui->OutputStat(&dict1);
+    StrBufDict dict2;
+    dict2.SetVar("name", "caf\xe9");
+    dict2.SetVar("ctl", "\x01");
+    ui->OutputStat(&dict2);
+    ui->SetNdjsonWriter(NULL);
+
+    // streamed records are not kept without NDJSON_KEEP_RESULTS
+    ASSERT_NULL(ui->GetTaggedOutput())
+
+    pWriter->Close();
+    char buffer[1024];
+    int read = pWriter->Read(buffer, sizeof(buffer), 0);
+    ASSERT_TRUE(read > 0)
+    std::string json(buffer, read);
+    ASSERT_STRING_EQUAL(json.c_str(),
+        "{\"path\":\"//depot/a b.txt\",\"desc\":\"say \\\"hi\\\"\\\\\\n\"}\n"
+        "{\"name\":\"caf\xEF\xBF\xBD\",\"ctl\":\"\\u0001\"}\n")
+    ASSERT_EQUAL(pWriter->Read(buffer, sizeof(buffer), 0), -1)
+
+    long long records = 0, bytes = 0, invalid = 0, dropped = 0;
+    pWriter->GetCounts(&records, &bytes, &invalid, &dropped);
+    ASSERT_EQUAL(records, 2)
+    ASSERT_EQUAL(bytes, (long long) json.size())
+    ASSERT_EQUAL(invalid, 1)
+    ASSERT_EQUAL(dropped, 0)
+
+    // valid UTF-8 is kept, overlong forms and lone bytes are not
+    std::string out;
+    ASSERT_EQUAL(P4NdjsonWriter::AppendString(out, "\xC3\xA9\xC0\xAF", 4, false), 2)
+    ASSERT_STRING_EQUAL(out.c_str(), "\"\xC3\xA9\xEF\xBF\xBD\xEF\xBF\xBD\"")
+    out.clear();
+    ASSERT_EQUAL(P4NdjsonWriter::AppendString(out, "caf\xe9", 4, true), 1)
+    ASSERT_STRING_EQUAL(out.c_str(), "\"caf\xC3\xA9\"")
+
+        return true;
+    }();
+
+    delete pWriter;
+	delete pServer;
+
+    return rv;
+}
+
+// Hands out INPUT_TOTAL bytes of input, a buffer at a time
+#define INPUT_TOTAL 300000
+static int inputSent = 0;
+
+int STDCALL InputDataChunkFn(int cmdId, char *buffer, int size)
+{
+    if (cmdId != 7)
+        return -1;
+    int n = 0;
+    while (n < size && inputSent < INPUT_TOTAL)
+    {
+        buffer[n++] = 'a' + (inputSent++ % 26);
+    }
+    return n;
+}
+
+bool TestP4BridgeClient::InputDataTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    bool rv = [&]() -> bool {
+    ui->SetDataSet("copied data");
+
+    // read from the callback across several chunks
+    inputSent = 0;
+    ui->SetDataSetCallback(InputDataChunkFn);
+    StrBuf buf;
+    Error e;
+    ui->InputData(&buf, &e);
+    ASSERT_FALSE(e.Test())
+    ASSERT_EQUAL(buf.Length(), INPUT_TOTAL)
+    ASSERT_EQUAL(buf.Text()[0], 'a')
+    ASSERT_EQUAL(buf.Text()[INPUT_TOTAL - 1], 'a' + ((INPUT_TOTAL - 1) % 26))
+    ASSERT_EQUAL(buf.Text()[INPUT_TOTAL], '\0')
+
+    // a native buffer is used as is, and takes the place of the data set
+    ui->ClearInputSource();
+    const char native[] = "Change: new\n\nDescription:\n\tbig\n";
+    ASSERT_TRUE(ui->SetDataSetBuffer(native, sizeof(native) - 1))
+    ui->InputData(&buf, &e);
+    ASSERT_STRING_EQUAL(buf.Text(), native)
+
+    // a rejected buffer does not leave the previous one in place
+    ASSERT_FALSE(ui->SetDataSetBuffer(native, -1))
+    ui->InputData(&buf, &e);
+    ASSERT_STRING_EQUAL(buf.Text(), "copied data")
+
+    // a command answered from the result cache is done with it too
+    ASSERT_TRUE(ui->SetDataSetBuffer(native, sizeof(native) - 1))
+    ResultCache::Configure(4096, 60000);
+    std::string auth = pCon->GetPassword().Text();
+    std::string ticket;
+    if (TicketCache::Lookup(pServer->GetServerTicketFile().c_str(), pCon->GetPort().Text(), pCon->GetUser().Text(), ticket))
+    {
+        auth.push_back('\0');
+        auth.append(ticket);
+    }
+    std::string key = ResultCache::MakeKey(pCon->GetPort().Text(), pCon->GetUser().Text(),
+        pCon->GetClient().Text(), auth.c_str(), pCon->GetCharset().Text(),
+        pCon->GetCwd().Text(), "groups", 1, NULL, 0, NULL);
+    ResultCapture capture;
+    ui->SetResultCapture(&capture);
+    ui->HandleInfoMsg(1, '0', "cached");
+    ui->SetResultCapture(NULL);
+    ResultCache::Store(key, pCon->GetPort().Text(), "groups", &capture, ui);
+    ASSERT_EQUAL(pServer->run_command("groups", 7, 1, NULL, 0), 1)
+    ResultCache::Configure(0, 0);
+    ui->InputData(&buf, &e);
+    ASSERT_STRING_EQUAL(buf.Text(), "copied data")
+
+    // once the command is done the data set is back
+    ui->ClearInputSource();
+    ui->InputData(&buf, &e);
+    ASSERT_STRING_EQUAL(buf.Text(), "copied data")
+
+        return true;
+    }();
+
+	delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::DiffHunkTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    bool rv = [&]() -> bool {
+    // output written to the capture comes back in memory, whatever its size
+    DiffCapture capture;
+    FILE * out = capture.Open();
+    ASSERT_NOT_NULL(out)
+    for (int i = 0; i < 20000; i++)
+    {
+        fprintf(out, "%dc%d\n< old\n---\n> new\n", i + 1, i + 1);
+    }
+    capture.Finish();
+    std::vector<DiffHunk> hunks;
+    DiffCapture::Split(capture.Text().data(), capture.Text().size(), 0, 0, hunks);
+    ASSERT_EQUAL((int) hunks.size(), 20000)
+    ASSERT_EQUAL(hunks[19999].fromStart, 20000)
+
+    // normal output
+    const char * normal = "1c1\n< a\n---\n> b\n3a4,5\n> x\n> y\n7,8d8\n< p\n< q\n";
+    hunks.clear();
+    DiffCapture::Split(normal, strlen(normal), 2, 100, hunks);
+    ASSERT_EQUAL((int) hunks.size(), 3)
+    ASSERT_EQUAL(hunks[0].kind, DIFF_HUNK_CHANGE)
+    ASSERT_EQUAL(hunks[0].file, 2)
+    ASSERT_EQUAL(hunks[0].textOffset, 100)
+    ASSERT_EQUAL(hunks[0].textLength, 16)
+    ASSERT_EQUAL(hunks[1].kind, DIFF_HUNK_ADD)
+    ASSERT_EQUAL(hunks[1].fromStart, 3)
+    ASSERT_EQUAL(hunks[1].fromCount, 0)
+    ASSERT_EQUAL(hunks[1].toStart, 4)
+    ASSERT_EQUAL(hunks[1].toCount, 2)
+    ASSERT_EQUAL(hunks[2].kind, DIFF_HUNK_DELETE)
+    ASSERT_EQUAL(hunks[2].fromCount, 2)
+
+    // unified output, the file names stay with the first hunk
+    const char * unified = "--- a\n+++ b\n@@ -1 +1 @@\n-a\n+b\n@@ -5,0 +6,2 @@\n+x\n+y\n";
+    hunks.clear();
+    DiffCapture::Split(unified, strlen(unified), 0, 0, hunks);
+    ASSERT_EQUAL((int) hunks.size(), 2)
+    ASSERT_EQUAL(hunks[0].textOffset, 0)
+    ASSERT_EQUAL(hunks[1].kind, DIFF_HUNK_ADD)
+    ASSERT_EQUAL(hunks[1].toStart, 6)
+    ASSERT_EQUAL(hunks[1].toCount, 2)
+
+    // RCS output, added lines that look like commands are skipped
+    const char * rcs = "d1 1\na1 2\nd2 1\na9 9\n";
+    hunks.clear();
+    DiffCapture::Split(rcs, strlen(rcs), 0, 0, hunks);
+    ASSERT_EQUAL((int) hunks.size(), 2)
+    ASSERT_EQUAL(hunks[1].toStart, 1)
+    ASSERT_EQUAL(hunks[1].toCount, 2)
+
+    // output with no hunks is kept as one record
+    const char * summary = "add 1 chunks 2 lines\n";
+    hunks.clear();
+    DiffCapture::Split(summary, strlen(summary), 0, 0, hunks);
+    ASSERT_EQUAL((int) hunks.size(), 1)
+    ASSERT_EQUAL(hunks[0].kind, DIFF_HUNK_OTHER)
+
+    int count = -1;
+    ASSERT_NULL(ui->GetDiffHunks(&count))
+    ASSERT_EQUAL(count, 0)
+
+        return true;
+    }();
+
+	delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::ResolvePolicyTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+	P4Connection* pCon = pServer->getConnection(7);
+	P4BridgeClient * ui = pCon->getUi();
+
+    P4ResolvePolicy * pPolicy = new P4ResolvePolicy();
+
+    bool rv = [&]() -> bool {
+    ASSERT_TRUE(P4ResolvePolicy::Match("...", "/ws/src/a.c"))
+    ASSERT_TRUE(P4ResolvePolicy::Match(".../*.xml", "/ws/gen/out.xml"))
+    ASSERT_TRUE(P4ResolvePolicy::Match("/ws/gen/...", "\\ws\\gen\\deep\\out.xml"))
+    ASSERT_TRUE(P4ResolvePolicy::Match("/ws/*/out.xml", "/ws/gen/out.xml"))
+    ASSERT_FALSE(P4ResolvePolicy::Match("/ws/*.xml", "/ws/gen/out.xml"))
+    ASSERT_FALSE(P4ResolvePolicy::Match(".../*.xml", "/ws/gen/out.xmlx"))
+    ASSERT_FALSE(P4ResolvePolicy::Match("/ws/gen", "/ws/gen/out.xml"))
+
+    ASSERT_TRUE(pPolicy->AddRule(NULL, NULL, RESOLVE_ACTION_SAFE))
+    ASSERT_TRUE(pPolicy->AddRule(".../generated/...", "Content", RESOLVE_ACTION_THEIRS))
+    ASSERT_FALSE(pPolicy->AddRule(NULL, NULL, 42))
+    ASSERT_EQUAL(pPolicy->Count(), 2)
+
+    int count = -1;
+    ASSERT_NULL(ui->GetResolveSummary(&count))
+    ASSERT_EQUAL(count, 0)
+
+    // deleting an attached policy detaches it
+    pServer->SetResolvePolicy(pPolicy);
+    delete pPolicy;
+    pPolicy = NULL;
+    pServer->SetResolvePolicy(NULL);
+
+        return true;
+    }();
+
+    delete pPolicy;
+	delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::ServerEnviroTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+    P4BridgeServer *pOther = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+    bool rv = [&]() -> bool {
+    P4BridgeServer::Update("P4NOENV", "global");
+
+    // servers read through to the global settings
+    string value;
+    ASSERT_TRUE(pServer->GetVar("P4NOENV", value))
+    ASSERT_STRING_EQUAL(value.c_str(), "global")
+
+    // a server's own value changes neither the global value nor another server
+    pServer->UpdateVar("P4NOENV", "mine");
+    ASSERT_TRUE(pServer->GetVar("P4NOENV", value))
+    ASSERT_STRING_EQUAL(value.c_str(), "mine")
+    ASSERT_TRUE(pOther->GetVar("P4NOENV", value))
+    ASSERT_STRING_EQUAL(value.c_str(), "global")
+    ASSERT_STRING_EQUAL(P4BridgeServer::Get("P4NOENV"), "global")
+
+    pServer->UpdateVar("P4NOENV", NULL);
+    ASSERT_FALSE(pServer->GetVar("P4NOENV", value))
+
+    // a change to the global settings is seen by servers without their own
+    P4BridgeServer::Update("P4NOENV", "changed");
+    ASSERT_TRUE(pOther->GetVar("P4NOENV", value))
+    ASSERT_STRING_EQUAL(value.c_str(), "changed")
+    pServer->ResetVar("P4NOENV");
+    ASSERT_TRUE(pServer->GetVar("P4NOENV", value))
+    ASSERT_STRING_EQUAL(value.c_str(), "changed")
+
+    // settings with a connection setter reach the connection
+    pServer->UpdateVar("P4IGNORE", ".serverignore");
+    P4Connection* pCon = pServer->getConnection(7);
+    ASSERT_STRING_EQUAL(pCon->GetIgnoreFile().Text(), ".serverignore")
+
+        return true;
+    }();
+
+    P4BridgeServer::Reload();
+    delete pOther;
+    delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::PackedMessagesTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+    P4Connection* pCon = pServer->getConnection(7);
+    P4BridgeClient * ui = pCon->getUi();
+
+    ui->HandleInfoMsg( 10, '0', "Zero" );
+    ui->HandleInfoMsg( 11, '1', "Caf\xc3\xa9" );
+    ui->HandleError( 3, 12, "Warn" );
+    ui->HandleError( 4, 13, "Bad \xff" );
+
+    bool rv = [&]() -> bool {
+    int count = -1;
+    const char* pool = NULL;
+    int poolSize = -1;
+
+    // UTF-8, offsets and lengths in bytes
+    const PackedMessage* pInfo = ui->PackMessages(PACKED_INFO, false, &count, &pool, &poolSize);
+    ASSERT_NOT_NULL(pInfo)
+    ASSERT_EQUAL(count, 2)
+    ASSERT_EQUAL(poolSize, 9)
+    ASSERT_EQUAL(pInfo[0].code, 10)
+    ASSERT_EQUAL(pInfo[0].level, '0')
+    ASSERT_EQUAL(pInfo[1].offset, 4)
+    ASSERT_EQUAL(pInfo[1].length, 5)
+    ASSERT_TRUE(string(pool + pInfo[1].offset, pInfo[1].length) == "Caf\xc3\xa9")
+
+    // UTF-16, offsets and lengths in 16 bit units
+    pInfo = ui->PackMessages(PACKED_INFO, true, &count, &pool, &poolSize);
+    ASSERT_EQUAL(count, 2)
+    ASSERT_EQUAL(poolSize, 16)
+    ASSERT_EQUAL(pInfo[1].offset, 4)
+    ASSERT_EQUAL(pInfo[1].length, 4)
+    const unsigned short* u16 = (const unsigned short*) pool;
+    ASSERT_EQUAL(u16[pInfo[1].offset + 3], 0xE9)
+
+    // invalid UTF-8 becomes U+FFFD
+    const PackedMessage* pErr = ui->PackMessages(PACKED_ERRORS, true, &count, &pool, &poolSize);
+    ASSERT_NOT_NULL(pErr)
+    ASSERT_EQUAL(count, 2)
+    ASSERT_EQUAL(pErr[0].code, 12)
+    ASSERT_EQUAL(pErr[0].level, 3)
+    ASSERT_EQUAL(pErr[1].level, 4)
+    ASSERT_EQUAL(pErr[1].length, 5)
+    u16 = (const unsigned short*) pool;
+    ASSERT_EQUAL(u16[pErr[1].offset + 4], 0xFFFD)
+
+    // nothing to pack
+    ui->clear_results();
+    ASSERT_NULL(ui->PackMessages(PACKED_ERRORS, false, &count, &pool, &poolSize))
+    ASSERT_EQUAL(count, 0)
+    ASSERT_EQUAL(poolSize, 0)
+
+        return true;
+    }();
+
+    delete pServer;
+
+    return rv;
+}
+
+// counts how many have been deleted, to see what a session releases
+class CountedError : public P4ClientError
+{
+public:
+    CountedError(const char* msg) : P4ClientError(3, 0, msg) {}
+    virtual ~CountedError() { deleted++; }
+
+    static int deleted;
+};
+
+int CountedError::deleted = 0;
+
+bool TestP4BridgeClient::ResultSessionTest() {
+    P4ResultSession *pSession = new P4ResultSession();
+
+    bool rv = [&]() -> bool {
+    CountedError::deleted = 0;
+
+    // many handles in one call, NULL entries skipped
+    void* handles[3] = { new CountedError("one"), NULL, new CountedError("two") };
+    ASSERT_EQUAL(P4ResultSession::ReleaseMany(handles, 3), 2)
+    ASSERT_EQUAL(CountedError::deleted, 2)
+
+    // a session deletes what it owns and can be used again
+    pSession->Adopt(new CountedError("three"));
+    pSession->Adopt(new CountedError("four"));
+    pSession->Adopt(NULL);
+    pSession->Adopt(pSession);
+    ASSERT_EQUAL(pSession->Count(), 2)
+    ASSERT_EQUAL(pSession->ReleaseAll(), 2)
+    ASSERT_EQUAL(CountedError::deleted, 4)
+    ASSERT_EQUAL(pSession->Count(), 0)
+
+    // deleting the session deletes what it still owns
+    pSession->Adopt(new CountedError("five"));
+    delete pSession;
+    pSession = NULL;
+    ASSERT_EQUAL(CountedError::deleted, 5)
+
+        return true;
+    }();
+
+    delete pSession;
+
+    return rv;
+}
+
+int progressCalls = 0;
+int progressCancel = 0;
+ProgressInfo lastProgress;
+
+int STDCALL ProgressTestCallbackFn(int cmdId, const ProgressInfo *info)
+{
+    progressCalls++;
+    lastProgress = *info;
+    return progressCancel;
+}
+
+bool TestP4BridgeClient::ProgressTest() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+    P4Connection* pCon = pServer->getConnection(7);
+    P4BridgeClient * ui = pCon->getUi();
+
+    ClientProgress* pFiles = NULL;
+    ClientProgress* pFile = NULL;
+
+    bool rv = [&]() -> bool {
+    // nothing is created without a callback
+    ASSERT_EQUAL(ui->ProgressIndicator(), 0)
+    ASSERT_NULL(ui->CreateProgress(CPT_FILESTRANSFERRED))
+
+    progressCalls = 0;
+    progressCancel = 0;
+    pServer->SetProgressCallbackFn(ProgressTestCallbackFn, 100000);
+    ASSERT_EQUAL(ui->ProgressIndicator(), 1)
+
+    StrRef desc("sync");
+    pFiles = ui->CreateProgress(CPT_FILESTRANSFERRED);
+    ASSERT_NOT_NULL(pFiles)
+    ASSERT_EQUAL(progressCalls, 1)
+    pFiles->Description(&desc, CPU_FILES);
+    pFiles->Total(3);
+
+    // a file's updates are added to the totals but not reported yet
+    pFile = ui->CreateProgress(CPT_RECVFILE);
+    pFile->Description(&desc, CPU_KBYTES);
+    pFile->Total(2);
+    ASSERT_EQUAL(pFile->Update(1), 0)
+    pFile->Done(0);
+    ASSERT_EQUAL(progressCalls, 1)
+    ASSERT_EQUAL(ui->GetProgress().bytesDone, 2048)
+    ASSERT_EQUAL(ui->GetProgress().bytesTotal, 2048)
+
+    // the end of the file count is always reported
+    pFiles->Update(1);
+    pFiles->Done(0);
+    ASSERT_EQUAL(progressCalls, 2)
+    ASSERT_EQUAL(lastProgress.done, 1)
+    ASSERT_EQUAL(lastProgress.filesDone, 3)
+    ASSERT_EQUAL(lastProgress.filesTotal, 3)
+    ASSERT_EQUAL(lastProgress.bytesDone, 2048)
+
+    // the callback can cancel, and the totals start over with the next command
+    delete pFile;
+    pFile = NULL;
+    pServer->SetProgressCallbackFn(ProgressTestCallbackFn, 0);
+    progressCancel = 1;
+    ui->clear_results();
+    ASSERT_EQUAL(ui->GetProgress().filesTotal, 0)
+    pFile = ui->CreateProgress(CPT_SENDFILE);
+    pFile->Description(&desc, CPU_KBYTES);
+    pFile->Total(4);
+    ASSERT_EQUAL(pFile->Update(1), 1)
+
+        return true;
+    }();
+
+    delete pFile;
+    delete pFiles;
+    delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::BenchOutputStat() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+    P4Connection* pCon = pServer->getConnection(7);
+    P4BridgeClient * ui = pCon->getUi();
+
+    StrBufDict dict;
+    dict.SetVar("depotFile", "//depot/main/src/file.cpp");
+    dict.SetVar("clientFile", "/home/user/ws/main/src/file.cpp");
+    dict.SetVar("rev", "12");
+    dict.SetVar("haveRev", "12");
+    dict.SetVar("action", "edit");
+    dict.SetVar("type", "text");
+
+    bool rv = [&]() -> bool {
+    BenchmarkResult r = UnitTestBenchmark::Run("OutputStat", 1000, 200, 1000, [&] {
+        ui->OutputStat(&dict);
+    }, [&] {
+        ui->clear_results();
+    });
+    ASSERT_EQUAL(r.Calls, 200000)
+    ASSERT_BENCHMARK(r)
+
+        return true;
+    }();
+
+    delete pServer;
+
+    return rv;
+}
+
+bool TestP4BridgeClient::BenchGetEntry() {
+    P4BridgeServer *pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+    P4Connection* pCon = pServer->getConnection(7);
+    P4BridgeClient * ui = pCon->getUi();
+
+    StrBufDict dict;
+    char key[32];
+    for (int i = 0; i < 20; i++)
+    {
+        sprintf(key, "field%d", i);
+        dict.SetVar(key, "//depot/main/src/file.cpp");
+    }
+    ui->OutputStat(&dict);
+
+    StrDictListIterator * pIt = ui->GetTaggedOutput();
+
+    bool rv = [&]() -> bool {
+    ASSERT_NOT_NULL(pIt)
+    ASSERT_NOT_NULL(pIt->GetNextItem())
+
+    int idx = 0;
+    BenchmarkResult r = UnitTestBenchmark::Run("GetEntry", 1000, 200, 1000, [&] {
+        pIt->GetEntry(idx++ % 20);
+    });
+    ASSERT_NOT_NULL(pIt->GetEntry(19))
+    ASSERT_BENCHMARK(r)
+
+        return true;
+    }();
+
+    delete pIt;
+    delete pServer;
+
+    return rv;
+}
+
+extern "C" void * CreateMapApi();
+extern "C" void DeleteMapApi(void * pMap);
+extern "C" void Insert2(void * pMap, const char * l, const char * r, int t);
+extern "C" const char * Translate(void * pMap, const char * p, MapDir d);
+
+bool TestP4BridgeClient::BenchTranslate() {
+    void * pMap = CreateMapApi();
+    Insert2(pMap, "//depot/main/...", "//ws/main/...", MapInclude);
+    Insert2(pMap, "//depot/main/doc/...", "//ws/main/doc/...", MapExclude);
+    Insert2(pMap, "//depot/rel/....cpp", "//ws/rel/....cpp", MapInclude);
+
+    bool rv = [&]() -> bool {
+    const char * pPath = Translate(pMap, "//depot/main/src/file.cpp", MapLeftRight);
+    ASSERT_NOT_NULL(pPath)
+    ASSERT_STRING_EQUAL(pPath, "//ws/main/src/file.cpp")
+    Utils::ReleaseString((void*) pPath);
+
+    BenchmarkResult r = UnitTestBenchmark::Run("Translate", 1000, 200, 1000, [&] {
+        Utils::ReleaseString((void*) Translate(pMap, "//depot/main/src/file.cpp", MapLeftRight));
+    });
+    ASSERT_EQUAL(r.AllocsPerCall, 1.0)
+    ASSERT_BENCHMARK(r)
+
+        return true;
+    }();
+
+    DeleteMapApi(pMap);
+
+    return rv;
+}
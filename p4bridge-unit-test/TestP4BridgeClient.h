@@ -19,6 +19,26 @@ public:
     static bool OutputTextTest();
     static bool OutputBinaryTest();
     static bool OutputStatTest();
+    static bool PreparedCommandProjectionTest();
+    static bool CommandTimeoutTest();
+    static bool ResultCacheTest();
+    static bool FileIndexTest();
+    static bool TaggedInternTest();
+    static bool StringPoolTest();
+    static bool ResultSpillTest();
+    static bool ResultSetTest();
+    static bool NdjsonWriterTest();
+    static bool InputDataTest();
+    static bool DiffHunkTest();
+    static bool ResolvePolicyTest();
+    static bool ServerEnviroTest();
+    static bool PackedMessagesTest();
+    static bool ResultSessionTest();
+    static bool ProgressTest();
+
+    static bool BenchOutputStat();
+    static bool BenchGetEntry();
+    static bool BenchTranslate();
 
     static bool HandleErrorCallbackTest();
     static bool OutputInfoCallbackTest();
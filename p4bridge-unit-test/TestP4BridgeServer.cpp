@@ -8,6 +8,12 @@
 #include "../p4bridge/P4BridgeClient.h"
 #include "../p4bridge/P4BridgeServer.h"
 #include "../p4bridge/P4Connection.h"
+#include "../p4bridge/IdleConnectionManager.h"
+#include "../p4bridge/P4FanOut.h"
+#include "../p4bridge/WorkspaceScanner.h"
+#include "../p4bridge/TicketCache.h"
+#include "../p4bridge/ConfigCache.h"
+#include "../p4bridge/CallRecorder.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -31,6 +37,8 @@
 #include <sstream>
 #include <fstream>
 #include <stdlib.h>
+#include <thread>
+#include <chrono>
 
 #ifdef OS_NT
 // Does not return the right value, but is available in VS2010, and does most of what we want
@@ -64,13 +72,15 @@ TestP4BridgeServer::TestP4BridgeServer()
     UnitTestSuite::RegisterTest(TestParallelSyncCallback, "TestParallelSyncCallback");
 #endif
     UnitTestSuite::RegisterTest(TestSetProtocol, "TestSetProtocol");
+    UnitTestSuite::RegisterTest(TestIdleDisconnect, "TestIdleDisconnect");
+    UnitTestSuite::RegisterTest(TestFanOut, "TestFanOut");
+    UnitTestSuite::RegisterTest(TestWorkspaceScan, "TestWorkspaceScan");
+    UnitTestSuite::RegisterTest(TestTicketCache, "TestTicketCache");
+    UnitTestSuite::RegisterTest(TestConfigCache, "TestConfigCache");
+    UnitTestSuite::RegisterTest(TestCallRecording, "TestCallRecording");
 }
 
 
-TestP4BridgeServer::~TestP4BridgeServer()
-{
-}
-
 char unitTestSrcDir[MAX_PATH];
 char unitTestZip[MAX_PATH];
 
@@ -79,25 +89,25 @@ char unitTestZip[MAX_PATH];
 const char* testClient = "admin_space";
 const char* testClient2 = "admin_space2";
 
-const char* TestDir = MYTESTDIR;
-const char* TestZip = MYTESTDIR "\\a.tar";
+const char* TestDir = UnitTestFrameWork::ForWorker(MYTESTDIR);
+const char* TestZip = UnitTestFrameWork::ForWorker(MYTESTDIR "\\a.tar");
 const char* utar_cmd = TAR " xvf a.tar";
-const char* rcp_cmd = P4D " -r " MYTESTDIR " -jr checkpoint.1";
-const char* udb_cmd = P4D " -r " MYTESTDIR " -xu";
-const char* p4d_cmd = P4D " -p6666 -IdUnitTestServer -r" MYTESTDIR " -Llog";
-
-const char* TestLog = MYTESTDIR "\\log";
-const char* testCfgFile = MYTESTDIR "\\admin_space\\myP4Config.txt";
-const char* testTicketFile = MYTESTDIR "\\admin_space\\p4tickets.txt";
-const char* newTicketFile = MYTESTDIR "\\admin_space\\.p4tickets.txt";
-const char* newEnviroFile = MYTESTDIR "\\admin_space\\.p4enviro.txt";
-const char* testCfgDir = MYTESTDIR "\\admin_space";
-const char* testCfgDir2 = MYTESTDIR "\\admin_space2";
-const char* testIgnoreFile = MYTESTDIR "\\admin_space\\myP4Ignore.txt";
-const char* testIgnoredFile1 = MYTESTDIR "\\admin_space\\foofoofoo.foo";
-const char* testIgnoredFile2 = MYTESTDIR "\\admin_space\\moomoomoo.moo";
-const char* testParallelDir1 = MYTESTDIR "\\admin_space\\TestData\\parallel\\";
-const char* testParallelDir2 = MYTESTDIR "\\admin_space2\\TestData\\parallel\\";
+const char* rcp_cmd = UnitTestFrameWork::ForWorker(P4D " -r " MYTESTDIR " -jr checkpoint.1");
+const char* udb_cmd = UnitTestFrameWork::ForWorker(P4D " -r " MYTESTDIR " -xu");
+const char* p4d_cmd = UnitTestFrameWork::ForWorker(P4D " -p6666 -IdUnitTestServer -r" MYTESTDIR " -Llog");
+
+const char* TestLog = UnitTestFrameWork::ForWorker(MYTESTDIR "\\log");
+const char* testCfgFile = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space\\myP4Config.txt");
+const char* testTicketFile = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space\\p4tickets.txt");
+const char* newTicketFile = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space\\.p4tickets.txt");
+const char* newEnviroFile = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space\\.p4enviro.txt");
+const char* testCfgDir = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space");
+const char* testCfgDir2 = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space2");
+const char* testIgnoreFile = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space\\myP4Ignore.txt");
+const char* testIgnoredFile1 = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space\\foofoofoo.foo");
+const char* testIgnoredFile2 = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space\\moomoomoo.moo");
+const char* testParallelDir1 = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space\\TestData\\parallel\\");
+const char* testParallelDir2 = UnitTestFrameWork::ForWorker(MYTESTDIR "\\admin_space2\\TestData\\parallel\\");
 const char* defaultApplication = "Perforce .NET API Bridge Unit Tests";
 const char* defaultVersion = "2021.1.0.0";
 const char* tarBall = "\\a.tar";
@@ -116,27 +126,38 @@ const char* utar_cmd = TAR " --warning=no-unknown-keyword -xf a.tar";
 #endif
 
 #if defined(OS_MACOSX) || defined(OS_LINUX)
-const char* TestDir = MYTESTDIR;
-const char* TestZip = MYTESTDIR "/a.tar";
-const char* rcp_cmd = P4D " -C1 -r " MYTESTDIR " -jr checkpoint.1";
-const char* udb_cmd = P4D " -C1 -r " MYTESTDIR " -xu";
-const char* p4d_cmd = P4D " -C1 -p6666 -IdUnitTestServer -r" MYTESTDIR " -L log";
-const char* TestLog = MYTESTDIR "/log";
-const char* testCfgFile = MYTESTDIR "/admin_space/myP4Config.txt";
-const char* testTicketFile = MYTESTDIR "/admin_space/p4tickets.txt";
-const char* newTicketFile = MYTESTDIR "/admin_space/.p4tickets.txt";
-const char* newEnviroFile = MYTESTDIR "/admin_space/.p4enviro.txt";
-const char* testCfgDir = MYTESTDIR "/admin_space";
-const char* testCfgDir2 = MYTESTDIR "/admin_space2";
-const char* testIgnoreFile = MYTESTDIR "/admin_space/myP4Ignore.txt";
-const char* testIgnoredFile1 = MYTESTDIR "/admin_space/foofoofoo.foo";
-const char* testIgnoredFile2 = MYTESTDIR "/admin_space/moomoomoo.moo";
-const char* testParallelDir1 = MYTESTDIR "/admin_space/TestData/parallel/";
-const char* testParallelDir2 = MYTESTDIR "/admin_space2/TestData/parallel/";
+const char* TestDir = UnitTestFrameWork::ForWorker(MYTESTDIR);
+const char* TestZip = UnitTestFrameWork::ForWorker(MYTESTDIR "/a.tar");
+const char* rcp_cmd = UnitTestFrameWork::ForWorker(P4D " -C1 -r " MYTESTDIR " -jr checkpoint.1");
+const char* udb_cmd = UnitTestFrameWork::ForWorker(P4D " -C1 -r " MYTESTDIR " -xu");
+const char* p4d_cmd = UnitTestFrameWork::ForWorker(P4D " -C1 -p6666 -IdUnitTestServer -r" MYTESTDIR " -L log");
+const char* TestLog = UnitTestFrameWork::ForWorker(MYTESTDIR "/log");
+const char* testCfgFile = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space/myP4Config.txt");
+const char* testTicketFile = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space/p4tickets.txt");
+const char* newTicketFile = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space/.p4tickets.txt");
+const char* newEnviroFile = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space/.p4enviro.txt");
+const char* testCfgDir = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space");
+const char* testCfgDir2 = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space2");
+const char* testIgnoreFile = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space/myP4Ignore.txt");
+const char* testIgnoredFile1 = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space/foofoofoo.foo");
+const char* testIgnoredFile2 = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space/moomoomoo.moo");
+const char* testParallelDir1 = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space/TestData/parallel/");
+const char* testParallelDir2 = UnitTestFrameWork::ForWorker(MYTESTDIR "/admin_space2/TestData/parallel/");
 const char* defaultVersion = "1.0.0.1";
 const char* tarBall = "/a.tar";
 #endif
 
+const char* TestPort = UnitTestFrameWork::PortForWorker("localhost:6666");
+
+// the server root as restored from a.tar, copied for each test
+const char* FixtureDir = UnitTestFrameWork::ForWorker(MYTESTDIR "_fixture");
+bool fixtureReady = false;
+
+TestP4BridgeServer::~TestP4BridgeServer()
+{
+    UnitTestSuite::rmDir(FixtureDir);
+}
+
 const char* testProgramName = "BridgeUnitTests";
 const char* testProgramVer = "1.2.3.4.A.b.C";
 
@@ -175,45 +196,66 @@ bool TestP4BridgeServer::Setup()
     if (!UnitTestSuite::mkDir(TestDir))
         return false;
 
-    if (!UnitTestSuite::copyFile(unitTestZip, TestZip))
-        return false;
-
-    UnitTestSuite::chDir(TestDir);
+    if (fixtureReady)
+    {
+        // restore the server root from the snapshot rather than extracting
+        //  a.tar and replaying the checkpoint again
+        if (!UnitTestSuite::copyDir(FixtureDir, TestDir))
+            return false;
 
-    pi = UnitTestSuite::RunProgram(utar_cmd, TestDir, true, true);
-    if (!pi)
+        UnitTestSuite::chDir(TestDir);
+    }
+    else
     {
-        UnitTestSuite::chDir(unitTestSrcDir);
-        return false;
+        if (!UnitTestSuite::copyFile(unitTestZip, TestZip))
+            return false;
+
+        UnitTestSuite::chDir(TestDir);
+
+        pi = UnitTestSuite::RunProgram(utar_cmd, TestDir, true, true);
+        if (!pi)
+        {
+            UnitTestSuite::chDir(unitTestSrcDir);
+            return false;
+        }
+        CleanResults(pi);
+
+        pi = UnitTestSuite::RunProgram(rcp_cmd, TestDir, true, true);
+        if (!pi)
+        {
+            UnitTestSuite::chDir(unitTestSrcDir);
+            return false;
+        }
+        CleanResults(pi);
+
+        pi = UnitTestSuite::RunProgram(udb_cmd, TestDir, true, true);
+        if (!pi) {
+            UnitTestSuite::chDir(unitTestSrcDir);
+            return false;
+        }
+        CleanResults(pi);
+
+        // snapshot the root before the server touches it, for the next tests
+        UnitTestSuite::rmDir(FixtureDir);
+        fixtureReady = UnitTestSuite::mkDir(FixtureDir) &&
+            UnitTestSuite::copyDir(TestDir, FixtureDir);
     }
-    CleanResults(pi);
 
-    pi = UnitTestSuite::RunProgram(rcp_cmd, TestDir, true, true);
+    pi = UnitTestSuite::RunProgram(p4d_cmd, TestDir, false, false);
     if (!pi)
     {
         UnitTestSuite::chDir(unitTestSrcDir);
         return false;
     }
-    CleanResults(pi);
-
-    pi = UnitTestSuite::RunProgram(udb_cmd, TestDir, true, true);
-    if (!pi) {
-        UnitTestSuite::chDir(unitTestSrcDir);
-        return false;
-    }
-    CleanResults(pi);
 
-    pi = UnitTestSuite::RunProgram(p4d_cmd, TestDir, false, false);
-    if (!pi)
+    if (!UnitTestSuite::waitForServer(TestPort, SERVER_START_TIMEOUT_MS))
     {
+        UnitTestSuite::EndProcess(pi);
+        pi = 0;
         UnitTestSuite::chDir(unitTestSrcDir);
         return false;
     }
 
-#ifndef OS_NT
-    sleep(2);  // give the server time to get ready...
-#endif
-
 // change default .p4enviro and .p4tickets file locations
 // so we don't trash the build system environment during our tests.
 
@@ -272,7 +314,7 @@ bool TestP4BridgeServer::ServerConnectionTest()
 {
     P4ClientError* connectionError = nullptr;
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", "");
+    ps = new P4BridgeServer(TestPort, "admin", "", "");
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
         //ps->SetLogCallFn((LogCallbackFn *) &TestP4BridgeServer::LogCallback);
@@ -287,7 +329,7 @@ bool TestP4BridgeServer::ServerConnectionTest()
 bool TestP4BridgeServer::CreateClient(const char* name, const char* workspace_root)
 {
     P4ClientError* connectionError = nullptr;
-    ps = new P4BridgeServer("localhost:6666", "admin", "", "");
+    ps = new P4BridgeServer(TestPort, "admin", "", "");
 
     // connect and see if the api returned an error.
     if (!CheckConnection(ps, connectionError))
@@ -354,7 +396,7 @@ bool TestP4BridgeServer::TestUnicodeClientToNonUnicodeServer()
     P4ClientError* connectionError = nullptr;
 
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -387,7 +429,7 @@ bool TestP4BridgeServer::TestUnicodeUserName()
     bool rv = [&] {
         // create a new server
         //Aleksey (Alexei) in Cyrillic = "\xD0\x90\xD0\xbb\xD0\xB5\xD0\xBA\xD1\x81\xD0\xB5\xD0\xB9\0" IN utf-8
-        ps = new P4BridgeServer("localhost:6666", "\xD0\x90\xD0\xBB\xD0\xB5\xD0\xBA\xD1\x81\xD0\xB5\xD0\xB9\0", "pass",
+        ps = new P4BridgeServer(TestPort, "\xD0\x90\xD0\xBB\xD0\xB5\xD0\xBA\xD1\x81\xD0\xB5\xD0\xB9\0", "pass",
             "\xD0\x90\xD0\xbb\xD0\xB5\xD0\xBA\xD1\x81\xD0\xB5\xD0\xB9\0");
         ASSERT_NOT_NULL(ps);
 
@@ -416,7 +458,7 @@ bool TestP4BridgeServer::TestUntaggedCommand()
 {
     P4ClientError* connectionError = nullptr;
 
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -444,7 +486,7 @@ bool TestP4BridgeServer::TestTaggedCommand()
 {
     P4ClientError* connectionError = nullptr;
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -491,7 +533,7 @@ bool TestP4BridgeServer::TestTextOutCommand()
 {
     P4ClientError* connectionError = nullptr;
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -523,7 +565,7 @@ bool TestP4BridgeServer::TestBinaryOutCommand()
 {
     P4ClientError* connectionError = nullptr;
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -554,7 +596,7 @@ bool TestP4BridgeServer::TestErrorOutCommand()
 {
     P4ClientError* connectionError = nullptr;
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -593,7 +635,7 @@ bool TestP4BridgeServer::TestGetSet()
 
     P4ClientError* connectionError = nullptr;
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", "");
+    ps = new P4BridgeServer(TestPort, "admin", "", "");
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -744,7 +786,7 @@ bool TestP4BridgeServer::TestEnviro()
 
 bool TestP4BridgeServer::TestConnectSetClient()
 {
-    ps = new P4BridgeServer("localhost:6666", "admin", NULL, NULL);
+    ps = new P4BridgeServer(TestPort, "admin", NULL, NULL);
     ASSERT_NOT_NULL(ps);
     ps->set_client(testClient);
 
@@ -760,7 +802,7 @@ void WriteConfigFile(const char* file)
     std::filebuf fb;
     fb.open(file, std::ios::out);
     std::ostream os(&fb);
-    os << "P4PORT=localhost:6666\n";
+    os << "P4PORT=" << TestPort << "\n";
     os << "P4USER=admin\n";
     os << "P4CLIENT=testClient\n";
     fb.close();
@@ -816,7 +858,7 @@ bool TestP4BridgeServer::TestGetConfig()
         ASSERT_STRING_EQUAL(newConfig1.c_str(), "myP4Config.txt");
 
         // create a new server
-        ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+        ps = new P4BridgeServer(TestPort, "admin", "", testClient);
         ASSERT_NOT_NULL(ps);
 
         // Associate the server with a directory
@@ -877,7 +919,7 @@ bool TestP4BridgeServer::TestSetCwd()
         ASSERT_TRUE(TestP4BridgeServer::CreateClient(testClient, testCfgDir));
 
         // create a new server
-        ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+        ps = new P4BridgeServer(TestPort, "admin", "", testClient);
         ASSERT_NOT_NULL(ps);
 
         // Associate the server with a directory
@@ -965,7 +1007,7 @@ bool TestP4BridgeServer::TestSetVars()
     StrPtr* pptr = nullptr;
 
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -1124,7 +1166,7 @@ bool TestP4BridgeServer::TestParallelSync()
     ASSERT_TRUE(TestP4BridgeServer::CreateClient(testClient2, testCfgDir2));
 
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rval = [&] {
         ASSERT_NOT_NULL(ps);
@@ -1196,7 +1238,7 @@ bool TestP4BridgeServer::TestParallelSync()
         delete ps;
 
         // reconnect, and switch to a different client
-        ps = new P4BridgeServer("localhost:6666", "admin", "", testClient2);
+        ps = new P4BridgeServer(TestPort, "admin", "", testClient2);
         ASSERT_NOT_NULL(ps);
 
         // connect and see if the api returned an error.
@@ -1272,7 +1314,7 @@ bool TestP4BridgeServer::TestParallelSyncCallback()
 
         {
             // run p4 configure set net.parallel.max=4	
-            P4BridgeServer* pServer = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+            P4BridgeServer* pServer = new P4BridgeServer(TestPort, "admin", "", testClient);
 
             const char* const args[] = { "set", "net.parallel.max=4" };
             ASSERT_INT_TRUE(pServer->run_command("configure", 0, 1, args, 2));
@@ -1290,7 +1332,7 @@ bool TestP4BridgeServer::TestParallelSyncCallback()
         }
 
         // make a new connection to pick up the net.parallel.max value
-        ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+        ps = new P4BridgeServer(TestPort, "admin", "", testClient);
         P4Connection* pCon = ps->getConnection(7);
         P4BridgeClient* ui = pCon->getUi();
 
@@ -1356,7 +1398,7 @@ bool TestP4BridgeServer::TestDefaultProgramNameAndVersion()
     ASSERT_TRUE(TestP4BridgeServer::CreateClient(testClient, testCfgDir));
 
     // create a new server
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -1441,7 +1483,7 @@ bool TestP4BridgeServer::TestSetTicketFile()
 {
     ASSERT_TRUE(TestP4BridgeServer::CreateClient(testClient, testCfgDir));
 
-    ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
 
     bool rv = [&] {
         ASSERT_NOT_NULL(ps);
@@ -1466,7 +1508,7 @@ bool TestP4BridgeServer::TestSetTicketFile()
 
         remove(testTicketFile);
 
-        ps = new P4BridgeServer("localhost:6666", "admin", "pass1234", testClient);
+        ps = new P4BridgeServer(TestPort, "admin", "pass1234", testClient);
         ps->set_ticketFile(testTicketFile);
 
         // connect and see if the api returned an error.
@@ -1514,14 +1556,14 @@ bool TestP4BridgeServer::TestSetProtocol()
         // turn on rpc=3 on the server and reconnect
         {
             const char* args[] = { "set", "rpc=3" };
-            P4BridgeServer* pServer = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+            P4BridgeServer* pServer = new P4BridgeServer(TestPort, "admin", "", testClient);
             ASSERT_TRUE(pServer->connected(&connectionError) == 1);
             ASSERT_INT_TRUE(pServer->run_command("configure", 0, true, args, 2));
             delete pServer;
         }
 
         // create a another connection
-        ps = new P4BridgeServer("localhost:6666", "admin", "", testClient);
+        ps = new P4BridgeServer(TestPort, "admin", "", testClient);
         ASSERT_NOT_NULL(ps);
 
         // must run SetProtocol before the connection is established
@@ -1560,3 +1602,466 @@ bool TestP4BridgeServer::TestSetProtocol()
     }();
     return rv;
 }
+
+bool TestP4BridgeServer::TestIdleDisconnect()
+{
+    P4ClientError* connectionError = nullptr;
+    // create a new server
+    ps = new P4BridgeServer(TestPort, "admin", "", testClient);
+
+    bool rv = [&] {
+        ASSERT_NOT_NULL(ps);
+
+        // connect and see if the api returned an error. 
+        if (!CheckConnection(ps, connectionError))
+            return false;
+
+        const char* const params[] = { "//depot/MyCode/*" };
+
+        ASSERT_INT_TRUE(ps->run_command("files", 7, 1, params, 1))
+        ASSERT_TRUE(ps->IsConnected())
+
+        int live = 0, idle = 0, reconnected = 0, disconnected = 0;
+        IdleConnectionManager::GetCounts(&live, &idle, &reconnected, &disconnected);
+        int startReconnected = reconnected;
+        int startDisconnected = disconnected;
+
+        IdleConnectionManager::SetIdleTimeout(200);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+        ASSERT_FALSE(ps->IsConnected())
+        IdleConnectionManager::GetCounts(&live, &idle, &reconnected, &disconnected);
+        ASSERT_EQUAL(idle, 1)
+        ASSERT_EQUAL(disconnected, startDisconnected + 1)
+
+        // results of the last command are still there
+        StrDictListIterator* out = ps->get_ui(7)->GetTaggedOutput();
+        ASSERT_NOT_NULL(out);
+        delete out;
+
+        // the next command reconnects
+        ASSERT_INT_TRUE(ps->Prewarm())
+        ASSERT_TRUE(ps->IsConnected())
+        ASSERT_INT_TRUE(ps->run_command("files", 7, 1, params, 1))
+        IdleConnectionManager::GetCounts(&live, &idle, &reconnected, &disconnected);
+        ASSERT_EQUAL(reconnected, startReconnected + 1)
+        ASSERT_EQUAL(idle, 0)
+
+        return true;
+    }();
+
+    IdleConnectionManager::SetIdleTimeout(0);
+
+    return rv;
+}
+
+bool TestP4BridgeServer::TestFanOut()
+{
+    P4FanOut* pFanOut = new P4FanOut();
+
+    bool rv = [&] {
+        pFanOut->AddTarget(TestPort, "admin", "", testClient, NULL);
+        // nothing is listening here
+        pFanOut->AddTarget("localhost:6", "admin", "", testClient, NULL);
+        ASSERT_EQUAL(pFanOut->Count(), 2)
+        ASSERT_EQUAL(pFanOut->GetStatus(0), FANOUT_NOT_RUN)
+
+        const char* const params[] = { "//depot/MyCode/*" };
+
+        ASSERT_EQUAL(pFanOut->Run("files", 1, params, 1, 30000, 0), 1)
+
+        ASSERT_EQUAL(pFanOut->GetStatus(0), FANOUT_OK)
+        ASSERT_NULL(pFanOut->GetConnectError(0))
+        P4BridgeServer* pServer = pFanOut->GetServer(0);
+        ASSERT_NOT_NULL(pServer)
+        StrDictListIterator* out = pServer->get_ui(0)->GetTaggedOutput();
+        ASSERT_NOT_NULL(out);
+        delete out;
+
+        ASSERT_EQUAL(pFanOut->GetStatus(1), FANOUT_CONNECT_FAILED)
+        ASSERT_NOT_NULL(pFanOut->GetConnectError(1))
+
+        // out of range
+        ASSERT_NULL(pFanOut->GetServer(2))
+        ASSERT_EQUAL(pFanOut->GetStatus(-1), FANOUT_NOT_RUN)
+
+        return true;
+    }();
+
+    delete pFanOut;
+
+    return rv;
+}
+
+bool TestP4BridgeServer::TestWorkspaceScan()
+{
+#ifdef OS_NT
+    const string sep = "\\";
+#else
+    const string sep = "/";
+#endif
+    string root = string(TestDir) + sep + "scan";
+    string sub = root + sep + "sub";
+    string hello = root + sep + "hello.txt";
+    string deep = sub + sep + "deep.txt";
+    string ignored = sub + sep + "skip.foo";
+    string build = root + sep + "build";
+    string win = root + sep + "win.txt";
+    string wide = root + sep + "wide.txt";
+
+    const char* pIgnore = P4BridgeServer::Get("P4IGNORE");
+    oldIgnore = (pIgnore ? pIgnore : "");
+
+    P4WorkspaceScan* pScan = new P4WorkspaceScan();
+
+    bool rv = [&] {
+        ASSERT_TRUE(UnitTestSuite::mkDir(root.c_str()))
+        ASSERT_TRUE(UnitTestSuite::mkDir(sub.c_str()))
+        ASSERT_TRUE(UnitTestSuite::mkDir(build.c_str()))
+
+        std::ofstream(hello.c_str(), std::ios::binary) << "hello\n";
+        std::ofstream(deep.c_str(), std::ios::binary) << "deep\n";
+        std::ofstream(ignored.c_str(), std::ios::binary) << "ignored\n";
+        // CRLF line endings, digested by the server as "one\ntwo\n"
+        std::ofstream(win.c_str(), std::ios::binary) << "one\r\ntwo\r\n";
+        // utf16 is digested by the server as UTF-8, so can't be verified
+        std::ofstream(wide.c_str(), std::ios::binary).write("\xFF\xFEh\0i\0", 6);
+        // the ignored directory is skipped with everything in it
+        std::ofstream((build + sep + "out.txt").c_str(), std::ios::binary) << "built\n";
+        std::ofstream((root + sep + "myP4Ignore.txt").c_str()) << "*.foo\nbuild/\n";
+
+#ifdef OS_NT
+        ASSERT_FALSE(_putenv("P4IGNORE="))
+#else
+        char p4ignore[] = "P4IGNORE";
+        unsetenv(p4ignore);
+#endif
+        P4BridgeServer::Update("P4IGNORE", "myP4Ignore.txt");
+
+        // hello.txt, deep.txt, win.txt, wide.txt and the ignore file itself
+        ASSERT_EQUAL(pScan->Scan(root.c_str(), SCAN_DIGEST, 4), 5)
+
+        const P4WorkspaceScan::Entry* pEntry = pScan->GetEntry(0);
+        ASSERT_NOT_NULL(pEntry)
+        ASSERT_STRING_EQUAL(pEntry->path.c_str(), hello.c_str())
+        ASSERT_EQUAL(pEntry->size, 6)
+        ASSERT_STRING_EQUAL(pEntry->digest.c_str(), "B1946AC92492D2347C6235B4D2611184")
+
+        // hello.txt unchanged, deep.txt changed, gone.txt deleted, 
+        //  myP4Ignore.txt added, win.txt unchanged, wide.txt unverified
+        StrDictList* pFstat = new StrDictList();
+        pFstat->Data()->SetVar("clientFile", hello.c_str());
+        pFstat->Data()->SetVar("digest", "B1946AC92492D2347C6235B4D2611184");
+        pFstat->Data()->SetVar("haveRev", "1");
+        StrDictList* pNext = new StrDictList();
+        pFstat->Next(pNext);
+        pNext->Data()->SetVar("clientFile", deep.c_str());
+        pNext->Data()->SetVar("digest", "00000000000000000000000000000000");
+        pNext->Data()->SetVar("haveRev", "1");
+        StrDictList* pLast = new StrDictList();
+        pNext->Next(pLast);
+        pLast->Data()->SetVar("clientFile", (root + sep + "gone.txt").c_str());
+        pLast->Data()->SetVar("haveRev", "1");
+        StrDictList* pWin = new StrDictList();
+        pLast->Next(pWin);
+        pWin->Data()->SetVar("clientFile", win.c_str());
+        pWin->Data()->SetVar("digest", "2094B601DAAC3D68F5AED51D3C20F7CD");
+        pWin->Data()->SetVar("fileSize", "8");
+        pWin->Data()->SetVar("headType", "text");
+        pWin->Data()->SetVar("haveRev", "1");
+        StrDictList* pWide = new StrDictList();
+        pWin->Next(pWide);
+        pWide->Data()->SetVar("clientFile", wide.c_str());
+        pWide->Data()->SetVar("digest", "49F68A5C8493EC2C0BF489821C21FC3B");
+        pWide->Data()->SetVar("fileSize", "2");
+        pWide->Data()->SetVar("headType", "utf16");
+        pWide->Data()->SetVar("haveRev", "1");
+
+        int differences = pScan->Compare(pFstat);
+        delete pFstat;
+
+        ASSERT_EQUAL(differences, 4)
+        ASSERT_EQUAL(pScan->Count(), 6)
+        for (int i = 0; i < pScan->Count(); i++)
+        {
+            pEntry = pScan->GetEntry(i);
+            int expected = SCAN_ADDED;
+            if (pEntry->path == hello || pEntry->path == win)
+                expected = SCAN_UNCHANGED;
+            else if (pEntry->path == wide)
+                expected = SCAN_UNVERIFIED;
+            else if (pEntry->path == deep)
+                expected = SCAN_MODIFIED;
+            else if (pEntry->path == root + sep + "gone.txt")
+                expected = SCAN_DELETED;
+            ASSERT_EQUAL(pEntry->status, expected)
+        }
+
+        int length = 0;
+        ASSERT_NOT_NULL(pScan->GetPacked(&length))
+        ASSERT_TRUE(length > 0)
+
+        return true;
+    }();
+
+    delete pScan;
+
+    return rv;
+}
+
+bool TestP4BridgeServer::TestTicketCache()
+{
+#ifdef OS_NT
+    const string sep = "\\";
+#else
+    const string sep = "/";
+#endif
+    string tickets = string(TestDir) + sep + "cachedTickets.txt";
+    string otherTickets = string(TestDir) + sep + "otherTickets.txt";
+    P4BridgeServer* pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+
+    bool rv = [&] {
+        TicketCache::SetRecheckInterval(0);
+
+        int hits0, misses0, reloads0;
+        TicketCache::GetCounts(&hits0, &misses0, &reloads0);
+
+        std::ofstream(tickets.c_str(), std::ios::binary) << "localhost:6666=admin:ABCDEF0123\n";
+
+        string ticket;
+        ASSERT_TRUE(TicketCache::Lookup(tickets.c_str(), "localhost:6666", "admin", ticket))
+        ASSERT_STRING_EQUAL(ticket.c_str(), "ABCDEF0123")
+        ASSERT_TRUE(TicketCache::Lookup(tickets.c_str(), "localhost:6666", "admin", ticket))
+        ASSERT_FALSE(TicketCache::Lookup(tickets.c_str(), "localhost:6666", "nobody", ticket))
+
+        int hits, misses, reloads;
+        TicketCache::GetCounts(&hits, &misses, &reloads);
+        ASSERT_EQUAL(hits - hits0, 1)
+        ASSERT_EQUAL(misses - misses0, 2)
+
+        // a new ticket of a different length is seen on the next lookup
+        std::ofstream(tickets.c_str(), std::ios::binary) << "localhost:6666=admin:0123456789ABCDEF\n";
+        ASSERT_TRUE(TicketCache::Lookup(tickets.c_str(), "localhost:6666", "admin", ticket))
+        ASSERT_STRING_EQUAL(ticket.c_str(), "0123456789ABCDEF")
+        TicketCache::GetCounts(&hits, &misses, &reloads);
+        ASSERT_EQUAL(reloads - reloads0, 1)
+
+        // inside the recheck interval the file is not looked at until the
+        //  cache is invalidated
+        TicketCache::SetRecheckInterval(60000);
+        ASSERT_TRUE(TicketCache::Lookup(tickets.c_str(), "localhost:6666", "admin", ticket))
+        std::ofstream(tickets.c_str(), std::ios::binary) << "localhost:6666=admin:FEDCBA\n";
+        ASSERT_TRUE(TicketCache::Lookup(tickets.c_str(), "localhost:6666", "admin", ticket))
+        ASSERT_STRING_EQUAL(ticket.c_str(), "0123456789ABCDEF")
+        std::ofstream(otherTickets.c_str(), std::ios::binary) << "localhost:6666=admin:0THER\n";
+        ASSERT_TRUE(TicketCache::Lookup(otherTickets.c_str(), "localhost:6666", "admin", ticket))
+        TicketCache::Invalidate(tickets.c_str());
+        ASSERT_TRUE(TicketCache::Lookup(tickets.c_str(), "localhost:6666", "admin", ticket))
+        ASSERT_STRING_EQUAL(ticket.c_str(), "FEDCBA")
+
+        // other ticket files stay cached
+        TicketCache::GetCounts(&hits0, &misses0, &reloads0);
+        ASSERT_TRUE(TicketCache::Lookup(otherTickets.c_str(), "localhost:6666", "admin", ticket))
+        ASSERT_STRING_EQUAL(ticket.c_str(), "0THER")
+        TicketCache::GetCounts(&hits, &misses, &reloads);
+        ASSERT_EQUAL(hits - hits0, 1)
+        ASSERT_EQUAL(misses - misses0, 0)
+
+        // a server looks in its own ticket file
+        pServer->UpdateVar("P4TICKETS", tickets.c_str());
+        ASSERT_STRING_EQUAL(pServer->GetServerTicketFile().c_str(), tickets.c_str())
+        ASSERT_STRING_EQUAL(pServer->GetServerTicket("localhost:6666", "admin").c_str(), "FEDCBA")
+
+        return true;
+    }();
+
+    TicketCache::SetRecheckInterval(TICKET_CACHE_RECHECK_MS);
+    delete pServer;
+    remove(tickets.c_str());
+    remove(otherTickets.c_str());
+    return rv;
+}
+
+bool TestP4BridgeServer::TestConfigCache()
+{
+#ifdef OS_NT
+    const string sep = "\\";
+#else
+    const string sep = "/";
+#endif
+    string root = string(TestDir) + sep + "cfgcache";
+    string sub = root + sep + "sub";
+    string rootCfg = root + sep + "myP4Config.txt";
+    string subCfg = sub + sep + "myP4Config.txt";
+
+    P4ConfigBatch* pBatch = new P4ConfigBatch();
+
+    bool rv = [&] {
+        ASSERT_TRUE(UnitTestSuite::mkDir(root.c_str()))
+        ASSERT_TRUE(UnitTestSuite::mkDir(sub.c_str()))
+
+        P4BridgeServer::Update("P4CONFIG", "myP4Config.txt");
+        ConfigCache::SetRecheckInterval(0);
+
+        std::ofstream(rootCfg.c_str(), std::ios::binary) << "P4PORT=localhost:1111\nP4USER=one\n";
+
+        int hits0, misses0, reloads0;
+        ConfigCache::GetCounts(&hits0, &misses0, &reloads0);
+
+        ConfigValues values;
+        ConfigCache::Resolve(sub.c_str(), values);
+        ASSERT_STRING_EQUAL(values.port.c_str(), "localhost:1111")
+        ASSERT_STRING_EQUAL(values.user.c_str(), "one")
+        ASSERT_STRING_EQUAL(values.configFile.c_str(), rootCfg.c_str())
+
+        // a trailing separator is the same directory
+        ConfigCache::Resolve((sub + sep).c_str(), values);
+        ASSERT_STRING_EQUAL(values.port.c_str(), "localhost:1111")
+
+        int hits, misses, reloads;
+        ConfigCache::GetCounts(&hits, &misses, &reloads);
+        ASSERT_EQUAL(hits - hits0, 1)
+        ASSERT_EQUAL(misses - misses0, 1)
+
+        // a closer config file is picked up
+        std::ofstream(subCfg.c_str(), std::ios::binary) << "P4PORT=localhost:2222\n";
+        ConfigCache::Resolve(sub.c_str(), values);
+        ASSERT_STRING_EQUAL(values.port.c_str(), "localhost:2222")
+        ASSERT_STRING_EQUAL(values.configFile.c_str(), subCfg.c_str())
+        ConfigCache::GetCounts(&hits, &misses, &reloads);
+        ASSERT_EQUAL(reloads - reloads0, 1)
+
+        char const * dirs[] = { root.c_str(), sub.c_str() };
+        pBatch->Resolve(dirs, 2);
+        int count = 0;
+        const ConfigInfo* rows = pBatch->GetRows(&count);
+        ASSERT_NOT_NULL(rows)
+        ASSERT_EQUAL(count, 2)
+        ASSERT_STRING_EQUAL(rows[0].port, "localhost:1111")
+        ASSERT_STRING_EQUAL(rows[1].port, "localhost:2222")
+        ASSERT_STRING_EQUAL(rows[1].dir, sub.c_str())
+
+        // changing the environment drops the cached directories
+        P4BridgeServer::Update("P4CONFIG", "otherP4Config.txt");
+        ConfigCache::Resolve(sub.c_str(), values);
+        ASSERT_STRING_EQUAL(values.configFile.c_str(), "noconfig")
+
+        return true;
+    }();
+
+    delete pBatch;
+    ConfigCache::SetRecheckInterval(CONFIG_CACHE_RECHECK_MS);
+    P4BridgeServer::Reload();
+    remove(subCfg.c_str());
+    remove(rootCfg.c_str());
+    return rv;
+}
+
+bool TestP4BridgeServer::TestCallRecording()
+{
+#ifdef OS_NT
+    const string sep = "\\";
+#else
+    const string sep = "/";
+#endif
+    string path = string(TestDir) + sep + "calls.p4cr";
+
+    P4BridgeServer* pServer = new P4BridgeServer(nullptr, nullptr, nullptr, nullptr);
+    // no server to ask, so recording a message does not try to connect
+    pServer->UseUnicode(0);
+
+    bool rv = [&] {
+        ASSERT_TRUE(UnitTestSuite::mkDir(TestDir))
+
+        P4BridgeClient* ui = pServer->getConnection(7)->getUi();
+
+        P4CallRecorder rec;
+        ASSERT_TRUE(rec.Open(path.c_str()))
+        ui->SetCallRecorder(&rec);
+
+        ui->OutputText("Some text", -1);
+
+        StrBufDict dict;
+        dict.SetVar("depotFile", "//depot/a.txt");
+        dict.SetVar("rev", "3");
+        ui->OutputStat(&dict);
+
+        Error info;
+        info.Set(E_INFO, "All done");
+        ui->Message(&info);
+
+        Error failed;
+        failed.Set(E_FAILED, "It broke");
+        ui->Message(&failed);
+
+        ui->SetCallRecorder(NULL);
+        ASSERT_EQUAL(rec.Count(), 4)
+        rec.Close();
+
+        // the results of the last replay are kept, and the messages are
+        //  replayed as recorded without settling the server's Unicode mode
+        pServer->UseUnicode(-1);
+        ASSERT_EQUAL(P4CallRecorder::Replay(path.c_str(), pServer, 7, 3), 12)
+        ASSERT_EQUAL(pServer->GetUnicodeState(), -1)
+        pServer->UseUnicode(0);
+
+        ASSERT_STRING_EQUAL(ui->GetTextResults(), "Some text")
+
+        StrDictListIterator* pIt = ui->GetTaggedOutput();
+        ASSERT_NOT_NULL(pIt)
+        StrDictList* pItem = pIt->GetNextItem();
+        ASSERT_NOT_NULL(pItem)
+        KeyValuePair* pEntry = pIt->GetNextEntry();
+        ASSERT_NOT_NULL(pEntry)
+        ASSERT_STRING_EQUAL(pEntry->key.c_str(), "depotFile")
+        ASSERT_STRING_EQUAL(pEntry->value.c_str(), "//depot/a.txt")
+        ASSERT_NULL(pIt->GetNextItem())
+        delete pIt;
+
+        P4ClientInfoMsg* pInfo = ui->GetInfoResults();
+        ASSERT_NOT_NULL(pInfo)
+        ASSERT_STRING_EQUAL(pInfo->Message.c_str(), "All done")
+        ASSERT_NULL(pInfo->Next)
+
+        P4ClientError* pErr = ui->GetErrorResults();
+        ASSERT_NOT_NULL(pErr)
+        ASSERT_EQUAL(pErr->Severity, E_FAILED)
+        ASSERT_STRING_EQUAL(pErr->Message.c_str(), "It broke")
+        ASSERT_NULL(pErr->Next)
+
+        // each command recorded starts with cleared results, and a response
+        //  that was not echoed is not written
+        ASSERT_TRUE(rec.Open(path.c_str()))
+        ui->SetCallRecorder(&rec);
+        const char* args[] = { "-O" };
+        rec.Command("passwd", args, 1);
+        ui->OutputText("First", -1);
+        rec.Command("info", NULL, 0);
+        ui->OutputText("Second", -1);
+        StrBuf rsp;
+        rsp.Set("secret");
+        rec.Prompt(StrRef("Password: "), rsp, 1);
+        ui->SetCallRecorder(NULL);
+        ASSERT_EQUAL(rec.Count(), 5)
+        rec.Close();
+
+        ASSERT_EQUAL(P4CallRecorder::Replay(path.c_str(), pServer, 7, 1), 3)
+        ASSERT_STRING_EQUAL(ui->GetTextResults(), "Second")
+
+        std::ifstream in(path.c_str(), std::ios::binary);
+        string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        ASSERT_TRUE(bytes.find("Password: ") != string::npos)
+        ASSERT_TRUE(bytes.find("secret") == string::npos)
+
+        // not a recording
+        std::ofstream(path.c_str(), std::ios::binary) << "nothing";
+        ASSERT_EQUAL(P4CallRecorder::Replay(path.c_str(), pServer, 7, 1), -1)
+
+        return true;
+    }();
+
+    delete pServer;
+    remove(path.c_str());
+    return rv;
+}
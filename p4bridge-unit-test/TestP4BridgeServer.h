@@ -41,6 +41,12 @@ public:
 	static bool TestGetTicketFile();
 	static bool TestSetProtocol();
 	static bool TestSetTicketFile();
+	static bool TestIdleDisconnect();
+	static bool TestFanOut();
+	static bool TestWorkspaceScan();
+	static bool TestTicketCache();
+	static bool TestConfigCache();
+	static bool TestCallRecording();
 
 	static int STDCALL LogCallback(int level, const char *file, int line, const char *msg);
 };
@@ -23,6 +23,8 @@ CREATE_TEST_SUITE(TestP4BridgeServerUtf8)
 
 TestP4BridgeServerUtf8::TestP4BridgeServerUtf8()
 {
+    // these tests all use MYTESTDIR8 and port 6666
+    UnitTestSuite::RunOnOneWorker();
     UnitTestSuite::RegisterTest(ServerConnectionTest, "ServerConnectionTest");
     UnitTestSuite::RegisterTest(TestNonUnicodeClientToUnicodeServer, "TestNonUnicodeClientToUnicodeServer");
     UnitTestSuite::RegisterTest(TestUntaggedCommand, "TestUntaggedCommand");
@@ -34,8 +36,13 @@ TestP4BridgeServerUtf8::TestP4BridgeServerUtf8()
 }
 
 
+// the server root as restored from u.tar, copied for each test
+const char * FixtureDir8 = MYTESTDIR8 "_fixture8";
+bool fixtureReady8 = false;
+
 TestP4BridgeServerUtf8::~TestP4BridgeServerUtf8()
 {
+    UnitTestSuite::rmDir(FixtureDir8);
 }
 
 char unitTestSrcDir8[MAX_PATH];
@@ -111,44 +118,69 @@ bool TestP4BridgeServerUtf8::Setup()
 
     UnitTestSuite::mkDir( TestDir8 );
 
-    if (! UnitTestSuite::copyFile(unitTestZip8, TestZip8))
-        return false;
-
-    UnitTestSuite::chDir(TestDir8);
-
-    pi8= UnitTestSuite::RunProgram(utar_cmd8, TestDir8, true, true);
-    if (!pi8)
+    if (fixtureReady8)
     {
-        UnitTestSuite::chDir(unitTestSrcDir8);
-        return false;
+        // restore the server root from the snapshot rather than extracting
+        //  u.tar and replaying the checkpoint again
+        if (! UnitTestSuite::copyDir(FixtureDir8, TestDir8))
+            return false;
+
+        UnitTestSuite::chDir(TestDir8);
     }
-    CleanResults(pi8);
+    else
+    {
+        if (! UnitTestSuite::copyFile(unitTestZip8, TestZip8))
+            return false;
 
-    pi8 = UnitTestSuite::RunProgram(rcp_cmd8, TestDir8, true, true);
-    if (!pi8) 
-	{
-        UnitTestSuite::chDir(unitTestSrcDir8);
-        return false;
-	}
-    CleanResults(pi8);
+        UnitTestSuite::chDir(TestDir8);
+
+        pi8= UnitTestSuite::RunProgram(utar_cmd8, TestDir8, true, true);
+        if (!pi8)
+        {
+            UnitTestSuite::chDir(unitTestSrcDir8);
+            return false;
+        }
+        CleanResults(pi8);
+
+        pi8 = UnitTestSuite::RunProgram(rcp_cmd8, TestDir8, true, true);
+        if (!pi8) 
+        {
+            UnitTestSuite::chDir(unitTestSrcDir8);
+            return false;
+        }
+        CleanResults(pi8);
+
+        pi8 = UnitTestSuite::RunProgram(udb_cmd8, TestDir8, true, true);
+        if (!pi8)
+        {
+            UnitTestSuite::chDir(unitTestSrcDir8);
+            return false;
+        }
+        CleanResults(pi8);
+
+        //server deployed by u.tar is already in Unicode mode
+        //pi8 = UnitTestSuite::RunProgram(p4d_xi_cmd8, TestDir8, false, true);
+        //if (!pi8) return false;
+
+        //CleanResults(pi8);
+
+        // snapshot the root before the server touches it, for the next tests
+        UnitTestSuite::rmDir(FixtureDir8);
+        fixtureReady8 = UnitTestSuite::mkDir(FixtureDir8) &&
+            UnitTestSuite::copyDir(TestDir8, FixtureDir8);
+    }
 
-    pi8 = UnitTestSuite::RunProgram(udb_cmd8, TestDir8, true, true);
+    pi8 = UnitTestSuite::RunProgram(p4d_cmd8, TestDir8, false, false);
     if (!pi8)
     {
         UnitTestSuite::chDir(unitTestSrcDir8);
         return false;
     }
-    CleanResults(pi8);
-
-    //server deployed by u.tar is already in Unicode mode
-    //pi8 = UnitTestSuite::RunProgram(p4d_xi_cmd8, TestDir8, false, true);
-    //if (!pi8) return false;
 
-    //CleanResults(pi8);
-
-    pi8 = UnitTestSuite::RunProgram(p4d_cmd8, TestDir8, false, false);
-    if (!pi8)
+    if (! UnitTestSuite::waitForServer("localhost:6666", SERVER_START_TIMEOUT_MS))
     {
+        UnitTestSuite::EndProcess(pi8);
+        pi8 = 0;
         UnitTestSuite::chDir(unitTestSrcDir8);
         return false;
     }
@@ -164,10 +196,6 @@ bool TestP4BridgeServerUtf8::Setup()
     setenv("P4ENVIRO", newEnviroFile8, 1);
 #endif
 
-
-#ifndef OS_NT
-    sleep(2);  // give the server time to get ready...
-#endif
     return true;
 }
 
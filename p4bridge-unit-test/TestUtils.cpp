@@ -11,6 +11,9 @@ CREATE_TEST_SUITE(TestUtils)
 TestUtils::TestUtils(void)
 {
     UnitTestSuite::RegisterTest(&TestAllocString, "TestCopyStr");
+    UnitTestSuite::RegisterTest(&TestStringSlab, "TestStringSlab");
+
+    UnitTestSuite::RegisterBenchmark(&BenchAllocString, "BenchAllocString");
 }
 
 TestUtils::~TestUtils(void)
@@ -39,3 +42,68 @@ bool TestUtils::TestAllocString(void)
 
     return true;
 }
+
+bool TestUtils::TestStringSlab(void)
+{
+    Utils::StringSlab slab;
+
+    long heapAllocs = Utils::AllocCount();
+    long heapFrees = Utils::FreeCount();
+    long slabAllocs = Utils::SlabAllocCount();
+
+    const char * pFirst = Utils::AllocString("12345", &slab);
+    std::string longValue(10000, 'x');
+    const char * pLong = Utils::AllocString(longValue, &slab);
+    const char * pHeap = Utils::AllocString("678");
+
+    ASSERT_EQUAL(0,strcmp(pFirst, "12345"));
+    ASSERT_EQUAL(longValue.length(),strlen(pLong));
+    ASSERT_EQUAL(2,slab.Count());
+    ASSERT_EQUAL(slabAllocs + 2,Utils::SlabAllocCount());
+    ASSERT_EQUAL(heapAllocs + 1,Utils::AllocCount());
+
+    // empty strings are still NULL and take nothing from the slab
+    ASSERT_NULL(Utils::AllocString("", &slab));
+    ASSERT_EQUAL(2,slab.Count());
+
+    // releasing a slab string leaves it to the slab, also when it has a
+    //  block of its own
+    Utils::ReleaseString((void*) pFirst);
+    Utils::ReleaseString((void*) pLong);
+    ASSERT_EQUAL(heapFrees,Utils::FreeCount());
+    ASSERT_EQUAL(0,strcmp(pFirst, "12345"));
+    ASSERT_EQUAL(longValue.length(),strlen(pLong));
+    ASSERT_TRUE(Utils::StringSlab::Owns(pFirst + 2));
+    ASSERT_FALSE(Utils::StringSlab::Owns(pHeap));
+
+    Utils::ReleaseString((void*) pHeap);
+    ASSERT_EQUAL(heapFrees + 1,Utils::FreeCount());
+
+    slab.Clear();
+    ASSERT_EQUAL(0,slab.Count());
+    ASSERT_EQUAL(0,slab.Bytes());
+    ASSERT_FALSE(Utils::StringSlab::Owns(pFirst));
+
+    return true;
+}
+
+bool TestUtils::BenchAllocString(void)
+{
+    BenchmarkResult heap = UnitTestBenchmark::Run("AllocString", 1000, 200, 1000, [] {
+        Utils::ReleaseString((void*) Utils::AllocString("//depot/main/src/file.cpp"));
+    });
+    ASSERT_EQUAL(1.0,heap.AllocsPerCall);
+    ASSERT_BENCHMARK(heap);
+
+    // slab strings are not counted as allocations
+    Utils::StringSlab slab;
+    BenchmarkResult slabbed = UnitTestBenchmark::Run("AllocStringSlab", 1000, 200, 1000, [&] {
+        Utils::AllocString("//depot/main/src/file.cpp", &slab);
+    }, [&] {
+        slab.Clear();
+    });
+    ASSERT_EQUAL(0.0,slabbed.AllocsPerCall);
+    ASSERT_BENCHMARK(slabbed);
+
+    return true;
+}
@@ -14,5 +14,8 @@ public:
     bool TearDown(const char* testName);
 
     static bool TestAllocString();
+    static bool TestStringSlab();
+
+    static bool BenchAllocString();
 };
 
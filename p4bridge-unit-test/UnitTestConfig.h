@@ -25,3 +25,6 @@
 #define MYTESTDIR "/tmp/MyTestDirBridge"
 #define MYTESTDIR8 "/tmp/MyTestDirBridge"
 #endif
+
+// How long a test waits for the p4d it started to accept connections
+#define SERVER_START_TIMEOUT_MS 10000
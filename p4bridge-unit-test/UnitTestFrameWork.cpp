@@ -1,20 +1,33 @@
 #include "stdafx.h"
 #include "UnitTestFrameWork.h"
+#include "UnitTestConfig.h"
 
 #include <exception>
 #include <typeinfo>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <list>
+#include <thread>
 using namespace std;
 
 #ifdef OS_NT
 #include <excpt.h>
 #include <Shellapi.h>
+#include <winsock2.h>
 #else
 #include <unistd.h>
 #include <limits.h>
 #include <sys/wait.h>
 #include <signal.h>
 #include <ftw.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include <csignal>
 #include <iostream>
 #include <sstream>
@@ -40,10 +53,17 @@ void UnitTestSuite::RegisterTest(UnitTest * test, const char * testName)
 	}
 }
 
+void UnitTestSuite::RegisterBenchmark(UnitTest * test, const char * testName)
+{
+	RegisterTest(test, testName);
+	pLastTest->IsBenchmark = true;
+}
+
 UnitTestSuite::UnitTestSuite()
 {
 	pFirstTest = 0;
 	pLastTest = 0;
+	oneWorker = false;
 
 	pNextTestSuite = 0;
 
@@ -196,7 +216,10 @@ int UnitTestSuite::RunProgram(const char *cmdLine, const char *cwd, bool newCons
 
 bool UnitTestSuite::EndProcess(pid_t pi)
 {
-    int rv = kill(pi,SIGKILL);  // do we need to wait for this like in OS_NT?
+    int rv = kill(pi,SIGKILL);
+    // reap it like in OS_NT, so its port is free for the next server
+    if (!rv)
+        waitpid(pi, nullptr, 0);
     return(! rv);
 }
 #endif
@@ -257,7 +280,8 @@ bool UnitTestSuite::rmDir(const char * path)
     }
 
 	// Validate it is really gone!
-	sleep(2);
+	for (int i = 0; (i < 40) && (stat(path, &info) != -1); i++)
+		usleep(50 * 1000);
 	if (stat(path, &info) != -1)
     {
 	    printf("rmDir: Unable to remove %s! \n",path);
@@ -359,6 +383,100 @@ bool UnitTestSuite::copyFile(const char *source, const char *destination)
     return true;
 }
 
+/*
+ * A cross platform copy of a directory tree
+ */
+bool UnitTestSuite::copyDir(const char *src, const char *dest)
+{
+#ifdef OS_NT
+	char szFrom[MAX_PATH+3];  // +3 for the wildcard and the double null terminate
+	char szTo[MAX_PATH+1];
+
+	strcpy(szFrom, src);
+	strcat(szFrom, "\\*");
+	int len = static_cast<int>(strlen(szFrom));
+	szFrom[len+1] = 0;
+
+	strcpy(szTo, dest);
+	len = static_cast<int>(strlen(szTo));
+	szTo[len+1] = 0;
+
+	SHFILEOPSTRUCTA fos = {0};
+	fos.wFunc = FO_COPY;
+	fos.pFrom = szFrom;
+	fos.pTo = szTo;
+	fos.fFlags = FOF_NO_UI;
+	int rv = SHFileOperation(&fos);
+	if (rv != 0)
+		printf("copy of %s to %s failed %02x\n", src, dest, rv);
+	return(rv == 0);
+#else
+	DIR *dir = opendir(src);
+	if (dir == nullptr)
+	{
+		printf("copyDir: %s: %s\n", src, strerror(errno));
+		return false;
+	}
+
+	bool ok = true;
+	while (struct dirent *entry = readdir(dir))
+	{
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+			continue;
+
+		string from = string(src) + "/" + entry->d_name;
+		string to = string(dest) + "/" + entry->d_name;
+		struct stat info;
+		if (lstat(from.c_str(), &info) < 0)
+		{
+			ok = false;
+			break;
+		}
+		if (S_ISDIR(info.st_mode))
+			ok = mkDir(to.c_str()) && copyDir(from.c_str(), to.c_str());
+		else if (S_ISREG(info.st_mode))
+			ok = copyFile(from.c_str(), to.c_str());
+		// synced files are read only, keep the mode
+		if (ok)
+			chmod(to.c_str(), info.st_mode & 07777);
+		if (!ok)
+			break;
+	}
+	closedir(dir);
+	return ok;
+#endif
+}
+
+/*
+ * Poll a server until it accepts a connection, rather than guessing how
+ * long it takes to start
+ */
+bool UnitTestSuite::waitForServer(const char *port, int timeoutMs)
+{
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() +
+		std::chrono::milliseconds(timeoutMs);
+	while (true)
+	{
+		ClientApi client;
+		Error e;
+		client.SetPort(port);
+		client.Init(&e);
+		if (!e.Test())
+		{
+			client.Final(&e);
+			return true;
+		}
+		if (std::chrono::steady_clock::now() >= end)
+		{
+			StrBuf msg;
+			e.Fmt(&msg);
+			printf("waitForServer: %s", msg.Text());
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+}
+
 bool UnitTestFrameWork::isSkipTest(const char* pTestName) {
 	if (matchName.empty())
 		return false;
@@ -373,7 +491,9 @@ void UnitTestSuite::RunTests()
 	while (pCurrentTest)
 	{
 		// if we are we skipping tests, do it now
-		if (UnitTestFrameWork::isSkipTest(pCurrentTest->TestName)) {
+		if (UnitTestFrameWork::isSkipTest(pCurrentTest->TestName) ||
+			(pCurrentTest->IsBenchmark && !UnitTestBenchmark::Enabled()) ||
+			!UnitTestFrameWork::isWorkerTest(oneWorker)) {
 			pCurrentTest = pCurrentTest->pNext;
 			continue;
 		}
@@ -525,6 +645,7 @@ void UnitTestFrameWork::RegisterTestSuite(UnitTestSuite * pSuite)
 
 int UnitTestFrameWork::testsPassed = 0;
 int UnitTestFrameWork::testsFailed = 0;
+int UnitTestFrameWork::testIndex = 0;
 std::string UnitTestFrameWork::matchName;
 std::string UnitTestFrameWork::srcDir;
 
@@ -532,12 +653,16 @@ void UnitTestFrameWork::RunTests()
 {
 	testsPassed = 0;
 	testsFailed = 0;
+	testIndex = 0;
 
 	if (pFirstTestSuite)
 		pFirstTestSuite->RunTests();
 
 	printf("Tests Passed %d, TestFailed: %d\n", testsPassed, testsFailed);
 
+	if (!UnitTestBenchmark::WriteResults())
+		printf("Unable to write the benchmark results\n");
+
 	// delete all the test suites
 	while (pFirstTestSuite)
 	{
@@ -547,3 +672,518 @@ void UnitTestFrameWork::RunTests()
 	}
 	p4base::Cleanup();
 }
+
+/*
+ * Parallel runs, each worker is a copy of this program started by
+ * RunParallel() and told which worker it is in the environment
+ */
+
+#define WORKER_ENV "BRIDGE_UNIT_WORKER"
+#define WORKERS_ENV "BRIDGE_UNIT_WORKERS"
+#define WORKER_PORT_ENV "BRIDGE_UNIT_PORT"
+
+static int WorkerCount()
+{
+	const char* workers = getenv(WORKERS_ENV);
+	return workers ? atoi(workers) : 0;
+}
+
+int UnitTestFrameWork::WorkerId()
+{
+	static int id = -2;
+	if (id == -2)
+	{
+		const char* worker = getenv(WORKER_ENV);
+		id = (worker && (WorkerCount() > 1)) ? atoi(worker) : -1;
+	}
+	return id;
+}
+
+bool UnitTestFrameWork::isWorkerTest(bool oneWorker)
+{
+	int id = WorkerId();
+	if (id < 0)
+		return true;
+	if (oneWorker)
+		return id == 0;
+	return ((testIndex++ % WorkerCount()) == id);
+}
+
+// the strings handed out by ForWorker() and PortForWorker() live as long as
+//  the program
+static const char* KeepText(const std::string& text)
+{
+	static std::list<std::string> texts;
+	texts.push_back(text);
+	return texts.back().c_str();
+}
+
+// p4port with the port field, after the last ':', replaced by the one
+//  RunParallel() found for this worker
+static std::string WorkerP4Port(const std::string& p4port)
+{
+	const char* port = getenv(WORKER_PORT_ENV);
+	if (!port)
+		return p4port;
+	size_t colon = p4port.rfind(':');
+	return ((colon == std::string::npos) ? std::string() : p4port.substr(0, colon + 1)) + port;
+}
+
+const char* UnitTestFrameWork::ForWorker(const char* text)
+{
+	int id = WorkerId();
+	if (id < 0)
+		return text;
+
+	std::string suffix = "_w" + std::to_string(id);
+	size_t len8 = strlen(MYTESTDIR8);
+	size_t len = strlen(MYTESTDIR);
+
+	std::string out;
+	for (const char* p = text; *p; )
+	{
+		// MYTESTDIR8 first, MYTESTDIR can be the start of it
+		if (!strncmp(p, MYTESTDIR8, len8))
+		{
+			out.append(MYTESTDIR8).append(suffix);
+			p += len8;
+		}
+		else if (!strncmp(p, MYTESTDIR, len))
+		{
+			out.append(MYTESTDIR).append(suffix);
+			p += len;
+		}
+		else if (((p == text) || (p[-1] == ' ')) && !strncmp(p, "-p", 2) && p[2] && (p[2] != ' '))
+		{
+			// the P4PORT of a p4d command line
+			const char* end = strchr(p, ' ');
+			if (!end)
+				end = p + strlen(p);
+			out.append("-p").append(WorkerP4Port(std::string(p + 2, end)));
+			p = end;
+		}
+		else
+		{
+			out += *p++;
+		}
+	}
+	return KeepText(out);
+}
+
+const char* UnitTestFrameWork::PortForWorker(const char* p4port)
+{
+	if (WorkerId() < 0)
+		return p4port;
+	return KeepText(WorkerP4Port(p4port));
+}
+
+/*
+ * Ask the system for count free ports by binding to port 0. Every socket
+ * stays bound until all the ports are known, so none is handed out twice.
+ * A port can still be taken before the worker's p4d listens on it; that
+ * worker's tests then fail to connect rather than reach another server.
+ */
+static bool FindFreePorts(int count, std::vector<int>& ports)
+{
+	ports.clear();
+#ifdef OS_NT
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+		return false;
+	typedef SOCKET Socket;
+	const Socket noSocket = INVALID_SOCKET;
+	typedef int AddrLen;
+#else
+	typedef int Socket;
+	const Socket noSocket = -1;
+	typedef socklen_t AddrLen;
+#endif
+	std::vector<Socket> sockets;
+	bool ok = true;
+	while ((int) ports.size() < count)
+	{
+		Socket s = socket(AF_INET, SOCK_STREAM, 0);
+		if (s == noSocket)
+		{
+			ok = false;
+			break;
+		}
+		sockets.push_back(s);
+
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_ANY);
+		addr.sin_port = 0;
+		AddrLen addrLen = sizeof(addr);
+		if ((bind(s, (struct sockaddr*) &addr, sizeof(addr)) != 0) ||
+			(getsockname(s, (struct sockaddr*) &addr, &addrLen) != 0))
+		{
+			ok = false;
+			break;
+		}
+		// 6666 is kept for the suites that run on one worker
+		int port = ntohs(addr.sin_port);
+		if (port != 6666)
+			ports.push_back(port);
+	}
+	for (size_t i = 0; i < sockets.size(); i++)
+	{
+#ifdef OS_NT
+		closesocket(sockets[i]);
+#else
+		close(sockets[i]);
+#endif
+	}
+#ifdef OS_NT
+	WSACleanup();
+#endif
+	return ok;
+}
+
+static std::string WorkerLog(int id)
+{
+	return "BridgeUnit_worker" + std::to_string(id) + ".log";
+}
+
+int UnitTestFrameWork::RunParallel(int workers, int argc, char* argv[])
+{
+	// the workers get the same arguments, less the worker count
+	std::vector<std::string> args;
+	for (int idx = 1; idx < argc; idx++)
+	{
+		if (strcmp(argv[idx], "-w") == 0)
+			idx++;
+		else
+			args.push_back(argv[idx]);
+	}
+
+	// each worker starts its own p4d, on a port nothing else is listening on
+	std::vector<int> ports;
+	if (!FindFreePorts(workers, ports))
+	{
+		printf("Error, could not find %d free ports for the workers\n", workers);
+		return workers;
+	}
+
+	std::string workerCount = std::to_string(workers);
+#ifdef OS_NT
+	char self[MAX_PATH];
+	GetModuleFileNameA(NULL, self, MAX_PATH);
+	std::string cmdLine = std::string("\"") + self + "\"";
+	for (size_t i = 0; i < args.size(); i++)
+		cmdLine += " \"" + args[i] + "\"";
+
+	std::vector<HANDLE> processes;
+	SetEnvironmentVariableA(WORKERS_ENV, workerCount.c_str());
+	for (int id = 0; id < workers; id++)
+	{
+		SetEnvironmentVariableA(WORKER_ENV, std::to_string(id).c_str());
+		SetEnvironmentVariableA(WORKER_PORT_ENV, std::to_string(ports[id]).c_str());
+
+		SECURITY_ATTRIBUTES sa = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+		HANDLE log = CreateFileA(WorkerLog(id).c_str(), GENERIC_WRITE, FILE_SHARE_READ, &sa,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		STARTUPINFOA si;
+		PROCESS_INFORMATION pi;
+		ZeroMemory(&si, sizeof(si));
+		si.cb = sizeof(si);
+		si.dwFlags = STARTF_USESTDHANDLES;
+		si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+		si.hStdOutput = log;
+		si.hStdError = log;
+
+		std::vector<char> cmd(cmdLine.begin(), cmdLine.end());
+		cmd.push_back('\0');
+		if (CreateProcessA(NULL, cmd.data(), NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi))
+		{
+			CloseHandle(pi.hThread);
+			processes.push_back(pi.hProcess);
+		}
+		else
+		{
+			printf("CreateProcess failed (%d).\n", GetLastError());
+		}
+		CloseHandle(log);
+	}
+	SetEnvironmentVariableA(WORKER_ENV, NULL);
+	SetEnvironmentVariableA(WORKERS_ENV, NULL);
+	SetEnvironmentVariableA(WORKER_PORT_ENV, NULL);
+
+	for (size_t i = 0; i < processes.size(); i++)
+	{
+		WaitForSingleObject(processes[i], INFINITE);
+		CloseHandle(processes[i]);
+	}
+#else
+	char self[PATH_MAX];
+#if defined(OS_LINUX)
+	ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+	if (len > 0)
+		self[len] = '\0';
+	else
+#endif
+	if (realpath(argv[0], self) == nullptr)
+	{
+		strncpy(self, argv[0], sizeof(self) - 1);
+		self[sizeof(self) - 1] = '\0';
+	}
+
+	std::vector<char*> childArgv;
+	childArgv.push_back(self);
+	for (size_t i = 0; i < args.size(); i++)
+		childArgv.push_back((char*) args[i].c_str());
+	childArgv.push_back(nullptr);
+
+	fflush(stdout);
+	std::vector<pid_t> pids;
+	for (int id = 0; id < workers; id++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+		{
+			printf("Error, failed to fork\n %s",strerror(errno));
+		}
+		else if (pid == 0)
+		{
+			// we are the worker
+			setenv(WORKERS_ENV, workerCount.c_str(), 1);
+			setenv(WORKER_ENV, std::to_string(id).c_str(), 1);
+			setenv(WORKER_PORT_ENV, std::to_string(ports[id]).c_str(), 1);
+			if (!freopen(WorkerLog(id).c_str(), "w", stdout))
+				_exit(1);
+			dup2(fileno(stdout), fileno(stderr));
+			execv(self, childArgv.data());
+			printf("\nexecv %s error %s\n", self, strerror(errno));
+			_exit(1);
+		}
+		else
+		{
+			pids.push_back(pid);
+		}
+	}
+
+	for (size_t i = 0; i < pids.size(); i++)
+	{
+		int status;
+		while ((waitpid(pids[i], &status, 0) == -1) && (errno == EINTR))
+			;
+	}
+#endif
+
+	// show what each worker did and add up the results
+	int passed = 0;
+	int failed = 0;
+	for (int id = 0; id < workers; id++)
+	{
+		printf("==== Worker %d ====\n", id);
+		std::ifstream log(WorkerLog(id).c_str());
+		std::string line;
+		bool finished = false;
+		while (std::getline(log, line))
+		{
+			printf("%s\n", line.c_str());
+			int p, f;
+			if (sscanf(line.c_str(), "Tests Passed %d, TestFailed: %d", &p, &f) == 2)
+			{
+				passed += p;
+				failed += f;
+				finished = true;
+			}
+		}
+		if (!finished)
+		{
+			printf("\t<<<<***Worker %d did not finish!!***>>>>\n", id);
+			failed++;
+		}
+	}
+	printf("All workers: Tests Passed %d, TestFailed: %d\n", passed, failed);
+	return failed;
+}
+
+/*
+ * UnitTestBenchmark
+ */
+
+bool UnitTestBenchmark::enabled = false;
+AllocCounter * UnitTestBenchmark::pAllocCounter = Utils::AllocCount;
+std::string UnitTestBenchmark::resultsFile;
+int UnitTestBenchmark::tolerance = 25;
+std::vector<BenchmarkResult> UnitTestBenchmark::results;
+std::vector<BenchmarkResult> UnitTestBenchmark::baseline;
+
+BenchmarkResult UnitTestBenchmark::Run(const char* name, int warmUp, int samples, int batch,
+	std::function<void()> body, std::function<void()> reset)
+{
+	if (samples < 1)
+		samples = 1;
+	if (batch < 1)
+		batch = 1;
+
+	for (int i = 0; i < warmUp; i++)
+		body();
+	if (reset)
+		reset();
+
+	std::vector<double> perCall;
+	perCall.reserve(samples);
+	long allocs = 0;
+	for (int s = 0; s < samples; s++)
+	{
+		long startAllocs = pAllocCounter ? pAllocCounter() : 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < batch; i++)
+			body();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		allocs += (pAllocCounter ? pAllocCounter() : 0) - startAllocs;
+
+		double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		perCall.push_back(ns / batch);
+
+		if (reset)
+			reset();
+	}
+	std::sort(perCall.begin(), perCall.end());
+
+	BenchmarkResult result;
+	result.Name = name;
+	result.Calls = samples * batch;
+	result.MinNs = perCall.front();
+	result.MedianNs = perCall[perCall.size() / 2];
+	size_t p99 = (perCall.size() * 99 + 99) / 100;
+	result.P99Ns = perCall[p99 - 1];
+	result.AllocsPerCall = (double) allocs / result.Calls;
+
+	printf("\t%s: %d calls, min %.1f ns, median %.1f ns, p99 %.1f ns, %.2f allocs/call\n",
+		name, result.Calls, result.MinNs, result.MedianNs, result.P99Ns, result.AllocsPerCall);
+
+	results.push_back(result);
+	return result;
+}
+
+static std::string JsonEscape(const std::string& s)
+{
+	std::string out;
+	for (size_t i = 0; i < s.size(); i++)
+	{
+		if ((s[i] == '"') || (s[i] == '\\'))
+			out += '\\';
+		out += s[i];
+	}
+	return out;
+}
+
+bool UnitTestBenchmark::WriteResults()
+{
+	if (resultsFile.empty())
+		return true;
+
+	// parallel workers each write their own file
+	std::string path = resultsFile;
+	if (UnitTestFrameWork::WorkerId() >= 0)
+		path += ".w" + std::to_string(UnitTestFrameWork::WorkerId());
+
+	FILE* f = fopen(path.c_str(), "w");
+	if (!f)
+		return false;
+
+	fprintf(f, "{\n  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& r = results[i];
+		fprintf(f, "    {\"name\": \"%s\", \"calls\": %d, \"min_ns\": %.1f, \"median_ns\": %.1f, "
+			"\"p99_ns\": %.1f, \"allocs_per_call\": %.3f}%s\n",
+			JsonEscape(r.Name).c_str(), r.Calls, r.MinNs, r.MedianNs, r.P99Ns, r.AllocsPerCall,
+			(i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+	return fclose(f) == 0;
+}
+
+// The value of "key" in one object of a results file, as written above
+static bool JsonValue(const std::string& obj, const char* key, std::string& value)
+{
+	std::string quoted = std::string("\"") + key + "\":";
+	size_t pos = obj.find(quoted);
+	if (pos == std::string::npos)
+		return false;
+	pos = obj.find_first_not_of(' ', pos + quoted.size());
+	if (pos == std::string::npos)
+		return false;
+
+	value.clear();
+	if (obj[pos] == '"')
+	{
+		for (pos++; (pos < obj.size()) && (obj[pos] != '"'); pos++)
+		{
+			if ((obj[pos] == '\\') && (pos + 1 < obj.size()))
+				pos++;
+			value += obj[pos];
+		}
+		return true;
+	}
+	size_t end = obj.find_first_of(",}", pos);
+	value = obj.substr(pos, end - pos);
+	return true;
+}
+
+bool UnitTestBenchmark::LoadBaseline(const char* path)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+	std::stringstream text;
+	text << in.rdbuf();
+	std::string json = text.str();
+
+	baseline.clear();
+	size_t start = json.find('[');
+	while ((start != std::string::npos) && ((start = json.find('{', start)) != std::string::npos))
+	{
+		size_t end = json.find('}', start);
+		if (end == std::string::npos)
+			break;
+		std::string obj = json.substr(start, end - start + 1);
+		start = end + 1;
+
+		BenchmarkResult r;
+		std::string v;
+		if (!JsonValue(obj, "name", r.Name))
+			continue;
+		r.Calls = JsonValue(obj, "calls", v) ? atoi(v.c_str()) : 0;
+		r.MinNs = JsonValue(obj, "min_ns", v) ? atof(v.c_str()) : 0;
+		r.MedianNs = JsonValue(obj, "median_ns", v) ? atof(v.c_str()) : 0;
+		r.P99Ns = JsonValue(obj, "p99_ns", v) ? atof(v.c_str()) : 0;
+		r.AllocsPerCall = JsonValue(obj, "allocs_per_call", v) ? atof(v.c_str()) : 0;
+		baseline.push_back(r);
+	}
+	return true;
+}
+
+bool UnitTestBenchmark::CheckBaseline(const BenchmarkResult& result)
+{
+	for (size_t i = 0; i < baseline.size(); i++)
+	{
+		const BenchmarkResult& base = baseline[i];
+		if (base.Name != result.Name)
+			continue;
+
+		bool ok = true;
+		if (result.MedianNs > base.MedianNs * (100 + tolerance) / 100)
+		{
+			printf("\t%s: median %.1f ns, baseline %.1f ns (+%d%% allowed)\n",
+				result.Name.c_str(), result.MedianNs, base.MedianNs, tolerance);
+			ok = false;
+		}
+		// allocation counts do not vary between runs, allow for rounding only
+		if (result.AllocsPerCall > base.AllocsPerCall + 0.01)
+		{
+			printf("\t%s: %.2f allocs/call, baseline %.2f\n",
+				result.Name.c_str(), result.AllocsPerCall, base.AllocsPerCall);
+			ok = false;
+		}
+		return ok;
+	}
+	return true;
+}
@@ -1,11 +1,18 @@
 #pragma once
 
+#include <functional>
+#include <vector>
+
 namespace std {
 	class exception;
 }
 
 typedef bool UnitTest(void);
 
+// Returns a running count of allocations, used to count the allocations made
+//  by a benchmark
+typedef long AllocCounter(void);
+
 #ifdef OS_NT
 struct _PROCESS_INFORMATION;
 typedef struct _PROCESS_INFORMATION * LPPROCESS_INFORMATION;
@@ -29,9 +36,21 @@ typedef struct testList
 {
     const char * TestName;
     UnitTest * Test;
+    bool IsBenchmark;   // only run when benchmarks are turned on
     testList * pNext;
 } TestList;
 
+// The timing of one benchmark, per call
+typedef struct benchmarkResult
+{
+    std::string Name;
+    int Calls;              // timed calls, after the warm-up
+    double MinNs;
+    double MedianNs;
+    double P99Ns;
+    double AllocsPerCall;
+} BenchmarkResult;
+
 class UnitTestSuite
 {
 private:
@@ -45,8 +64,15 @@ private:
 
     static char rootbuf[4096];
 
+    bool oneWorker;     // every test of the suite runs on the same worker
+
 protected:
     void RegisterTest(UnitTest * test, const char* testName);
+    void RegisterBenchmark(UnitTest * test, const char* testName);
+
+    // Run every test of the suite on one worker when the tests run in
+    //  parallel, for suites whose tests share a fixed port or directory
+    void RunOnOneWorker() { oneWorker = true; }
 
     static void ReportException(std::exception& e);
 
@@ -67,6 +93,13 @@ protected:
 
     static bool copyFile(const char *src, const char *dest);
 
+    // copy the contents of the src directory into dest, which must exist
+    static bool copyDir(const char *src, const char *dest);
+
+    // wait for a server to accept connections, false if it does not within
+    //  timeoutMs
+    static bool waitForServer(const char *port, int timeoutMs);
+
     static bool getRoot(char *buf, int bufsize);
 
 public:
@@ -97,6 +130,7 @@ private:
     static int testsFailed;
 	static std::string matchName;
     static std::string srcDir;  // full path to source directory
+    static int testIndex;       // tests run or skipped by this worker so far
 
 public:
     UnitTestFrameWork(void);
@@ -116,12 +150,76 @@ public:
 	// true if the test should be skipped
 	static bool isSkipTest(const char* pTest);
 
+	// Run the tests in workers processes at once. Each worker runs every
+	//  workers'th test, with its own test directories and a free port for
+	//  p4d. args, less the worker count, are passed on to every worker,
+	//  returns the number of failures.
+	static int RunParallel(int workers, int argc, char* argv[]);
+
+	// The worker this process is, -1 when the tests are not run in parallel
+	static int WorkerId();
+
+	// text with the test directories, and the port of a p4d -p option,
+	//  made unique to this worker, text itself when the tests are not run
+	//  in parallel
+	static const char* ForWorker(const char* text);
+
+	// p4port ([protocol:][host:]port) with its port field replaced by this
+	//  worker's port, p4port itself when the tests are not run in parallel
+	static const char* PortForWorker(const char* p4port);
+
+	// true if this worker runs the next test, every test when the tests are
+	//  not run in parallel. oneWorker tests all run on worker 0.
+	static bool isWorkerTest(bool oneWorker);
+
     static void RunTests();
     
     static void IncrementTestsPassed() { testsPassed++; }
     static void IncrementTestsFailed() { testsFailed++; }
 };
 
+/*
+ * UnitTestBenchmark, times a piece of code for the benchmark tests and
+ *  compares the results with a baseline from an earlier run
+ */
+class UnitTestBenchmark
+{
+private:
+    static bool enabled;
+    static AllocCounter * pAllocCounter;
+    static std::string resultsFile;
+    static int tolerance;
+    static std::vector<BenchmarkResult> results;
+    static std::vector<BenchmarkResult> baseline;
+
+public:
+    static bool Enabled() { return enabled; }
+    static void Enabled(bool bNew) { enabled = bNew; }
+
+    // Counts the allocations of a benchmark, Utils::AllocCount by default
+    static void SetAllocCounter(AllocCounter * pNew) { pAllocCounter = pNew; }
+
+    // Call body warmUp times untimed, then time samples batches of batch
+    //  calls each. reset, if set, is called between batches and not timed.
+    //  The result is kept for WriteResults().
+    static BenchmarkResult Run(const char* name, int warmUp, int samples, int batch,
+        std::function<void()> body, std::function<void()> reset = nullptr);
+
+    // Write the results of every benchmark run as JSON when a file was set
+    static void SetResultsFile(const char* path) { resultsFile = path; }
+    static bool WriteResults();
+
+    // Read the results of an earlier run to compare against
+    static bool LoadBaseline(const char* path);
+
+    // How much slower than the baseline, in percent, a median may be
+    static void SetTolerance(int percent) { tolerance = percent; }
+
+    // false if the result is slower than its baseline by more than the
+    //  tolerance or allocates more, true if there is no baseline for it
+    static bool CheckBaseline(const BenchmarkResult& result);
+};
+
 #define DECLARE_TEST_SUITE(t) static t * TestInstance; \
     static t * Create();
 
@@ -167,5 +265,7 @@ public:
 #define ASSERT_W_STRING_EQUAL(a, b) if (!UnitTestSuite::Assert((wcscmp((a),(b)) == 0), "ASSERT_W_STRING_EQUAL Failed", __LINE__, __FILE__)) return false;
 #define ASSERT_W_STRING_STARTS_WITH(a, b) if (!UnitTestSuite::Assert((wcsncmp((a),(b), strlen(b)) == 0), "ASSERT_STRING_STARTS_WITH Failed", __LINE__, __FILE__)) return false;
 
+#define ASSERT_BENCHMARK(r) if (!UnitTestSuite::Assert(UnitTestBenchmark::CheckBaseline(r), "ASSERT_BENCHMARK Failed", __LINE__, __FILE__)) return false;
+
 #define DELETE_OBJECT(obj) if( obj != NULL ) { delete obj; obj = NULL; }
 #define DELETE_ARRAY(obj) if( obj != NULL ) { delete[] obj; obj = NULL; }
@@ -10,6 +10,7 @@
 int main(int argc, char* argv[])
 {
     UnitTestFrameWork *frame = new UnitTestFrameWork();
+    int workers = 0;
 
     if (argc > 0){
         for (int idx = 1; idx < argc; idx++)
@@ -22,6 +23,23 @@ int main(int argc, char* argv[])
                 UnitTestSuite::BreakOnFailure(true); 
             else if (strcmp(argv[idx], "-e") == 0) // end on fail
                 UnitTestSuite::EndOnFailure(true); 
+            else if ((strcmp(argv[idx], "-w") == 0) && (idx + 1 < argc)) // run the tests in parallel workers
+                workers = atoi(argv[++idx]);
+            else if (strcmp(argv[idx], "-p") == 0) // run the benchmarks too
+                UnitTestBenchmark::Enabled(true);
+            else if ((strcmp(argv[idx], "-j") == 0) && (idx + 1 < argc)) // write benchmark results as JSON
+            {
+                UnitTestBenchmark::Enabled(true);
+                UnitTestBenchmark::SetResultsFile(argv[++idx]);
+            }
+            else if ((strcmp(argv[idx], "-B") == 0) && (idx + 1 < argc)) // compare benchmarks with a baseline
+            {
+                UnitTestBenchmark::Enabled(true);
+                if (!UnitTestBenchmark::LoadBaseline(argv[++idx]))
+                    printf("Unable to read the benchmark baseline %s\n", argv[idx]);
+            }
+            else if ((strcmp(argv[idx], "-t") == 0) && (idx + 1 < argc)) // baseline tolerance in percent
+                UnitTestBenchmark::SetTolerance(atoi(argv[++idx]));
             else
             {
 			// assume this is a test name to match (don't run tests that do not match)
@@ -29,6 +47,14 @@ int main(int argc, char* argv[])
         }
         }
     } 
+
+    // the workers parse the same options again, so start them only once all are known
+    if (workers > 1)
+    {
+        int failed = UnitTestFrameWork::RunParallel(workers, argc, argv);
+        delete frame;
+        return failed ? 1 : 0;
+    }
     
     UnitTestFrameWork::RunTests();
 #ifdef _DEBUG_MEMORY
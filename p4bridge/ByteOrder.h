@@ -0,0 +1,101 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ByteOrder.h
+ *
+ * Description	:  Reading and writing the 32 and 64 bit integers and length
+ *  prefixed strings of the bridge's binary formats: serialized result sets,
+ *  spilled tagged records and call recordings. Integers are always little
+ *  endian, whatever the byte order of the machine, so files and buffers can
+ *  be read on another platform.
+ *
+ ******************************************************************************/
+
+#include <vector>
+#include <stddef.h>
+
+inline void PutU32(std::vector<char> &out, unsigned int v)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back((char) ((v >> (8 * i)) & 0xFF));
+}
+
+inline void SetU32(std::vector<char> &out, size_t at, unsigned int v)
+{
+	for (int i = 0; i < 4; i++)
+		out[at + i] = (char) ((v >> (8 * i)) & 0xFF);
+}
+
+inline void SetU64(std::vector<char> &out, size_t at, unsigned long long v)
+{
+	for (int i = 0; i < 8; i++)
+		out[at + i] = (char) ((v >> (8 * i)) & 0xFF);
+}
+
+inline unsigned int GetU32(const char *p)
+{
+	unsigned int v = 0;
+	for (int i = 3; i >= 0; i--)
+		v = (v << 8) | (unsigned char) p[i];
+	return v;
+}
+
+inline unsigned long long GetU64(const char *p)
+{
+	unsigned long long v = 0;
+	for (int i = 7; i >= 0; i--)
+		v = (v << 8) | (unsigned char) p[i];
+	return v;
+}
+
+inline void PutString(std::vector<char> &out, const char *s, size_t len)
+{
+	PutU32(out, (unsigned int) len);
+	out.insert(out.end(), s, s + len);
+	out.push_back('\0');
+}
+
+// Read a length prefixed, NUL terminated string, NULL if it runs past end
+inline const char *GetString(const char *base, size_t &offset, size_t end, size_t &len)
+{
+	if (offset + 4 > end)
+		return NULL;
+	len = GetU32(base + offset);
+	if (len >= end - offset - 4 || base[offset + 4 + len] != '\0')
+		return NULL;
+	const char *s = base + offset + 4;
+	offset += 4 + len + 1;
+	return s;
+}
+
+inline const char *GetString(const char *base, size_t &offset, size_t end)
+{
+	size_t len;
+	return GetString(base, offset, end, len);
+}
@@ -0,0 +1,422 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: CallRecorder.cpp
+ *
+ * Description	:  P4CallRecorder
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4Connection.h"
+#include "CallRecorder.h"
+#include "ByteOrder.h"
+
+#define DELETE_OBJECT(obj) if( obj != NULL ) { delete obj; obj = NULL; }
+
+// Record kinds
+#define CR_MESSAGE		1
+#define CR_STAT			2
+#define CR_TEXT			3
+#define CR_BINARY		4
+#define CR_ERROR		5
+#define CR_PROMPT		6
+#define CR_RESOLVE		7
+#define CR_COMMAND		8
+
+#define CR_HEADER_SIZE 8
+#define CR_RECORD_HEADER_SIZE 12
+
+// Records are written to the file once this much is buffered
+#define CR_FLUSH_SIZE (256 * 1024)
+
+P4CallRecorder::P4CallRecorder() :
+	pFile(NULL),
+	recordStart(0),
+	count(0)
+{
+}
+
+P4CallRecorder::~P4CallRecorder()
+{
+	Close();
+}
+
+bool P4CallRecorder::Open(const char *path)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (pFile)
+	{
+		Error e;
+		pFile->Close(&e);
+		DELETE_OBJECT(pFile);
+	}
+	buffer.clear();
+	count = 0;
+
+	if (!path || !*path)
+		return false;
+
+	Error e;
+	pFile = FileSys::Create(FST_BINARY);
+	pFile->Set(StrRef(path));
+	pFile->Open(FOM_WRITE, &e);
+	if (e.Test())
+	{
+		DELETE_OBJECT(pFile);
+		return false;
+	}
+
+	buffer.insert(buffer.end(), "P4CR", "P4CR" + 4);
+	PutU32(buffer, CALL_RECORDING_VERSION);
+	return true;
+}
+
+void P4CallRecorder::Close()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!pFile)
+		return;
+	Flush();
+	Error e;
+	pFile->Close(&e);
+	DELETE_OBJECT(pFile);
+}
+
+int P4CallRecorder::Count()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	return count;
+}
+
+void P4CallRecorder::Flush()
+{
+	if (pFile && !buffer.empty())
+	{
+		Error e;
+		pFile->Write(buffer.data(), (int) buffer.size(), &e);
+		if (e.Test())
+		{
+			LOG_ERROR("Could not write the call recording, it is stopped");
+			pFile->Close(&e);
+			DELETE_OBJECT(pFile);
+		}
+	}
+	buffer.clear();
+}
+
+void P4CallRecorder::Begin(unsigned int kind)
+{
+	PutU32(buffer, kind);
+	buffer.resize(buffer.size() + 8);
+	recordStart = buffer.size();
+}
+
+void P4CallRecorder::End()
+{
+	SetU64(buffer, recordStart - 8, buffer.size() - recordStart);
+	count++;
+	if (buffer.size() >= CR_FLUSH_SIZE)
+		Flush();
+}
+
+void P4CallRecorder::Message(Error *err, bool unicode)
+{
+	// formatted the way P4BridgeClient::Message() does
+	StrBuf buf;
+	err->Fmt(buf, unicode ? EF_PLAIN : EF_PLAIN | EF_NOXLATE);
+	ErrorId *id = err->GetId(0);
+
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!pFile)
+		return;
+	Begin(CR_MESSAGE);
+	PutU32(buffer, id ? (unsigned int) id->code : 0);
+	PutU32(buffer, (unsigned int) err->GetSeverity());
+	PutU32(buffer, (unsigned int) err->GetGeneric());
+	PutU32(buffer, unicode ? 1 : 0);
+	PutString(buffer, buf.Text(), buf.Length());
+	End();
+}
+
+void P4CallRecorder::OutputStat(StrDict *dict)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!pFile)
+		return;
+	Begin(CR_STAT);
+	size_t countAt = buffer.size();
+	PutU32(buffer, 0);
+	unsigned int fields = 0;
+	StrRef var, val;
+	for (int i = 0; dict->GetVar(i, var, val); i++)
+	{
+		PutString(buffer, var.Text(), var.Length());
+		PutString(buffer, val.Text(), val.Length());
+		fields++;
+	}
+	SetU32(buffer, countAt, fields);
+	End();
+}
+
+void P4CallRecorder::OutputText(const char *data, int length)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!pFile)
+		return;
+	Begin(CR_TEXT);
+	PutString(buffer, data, length);
+	End();
+}
+
+void P4CallRecorder::OutputBinary(const char *data, int length)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!pFile)
+		return;
+	Begin(CR_BINARY);
+	PutString(buffer, data, length);
+	End();
+}
+
+void P4CallRecorder::OutputError(const char *err)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!pFile)
+		return;
+	Begin(CR_ERROR);
+	PutString(buffer, err, strlen(err));
+	End();
+}
+
+void P4CallRecorder::Prompt(const StrPtr &msg, const StrBuf &rsp, int noEcho)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!pFile)
+		return;
+	Begin(CR_PROMPT);
+	PutU32(buffer, (unsigned int) noEcho);
+	PutString(buffer, msg.Text(), msg.Length());
+	// a response that was not echoed is a password, it is not kept
+	if (noEcho)
+		PutString(buffer, "", 0);
+	else
+		PutString(buffer, rsp.Text(), rsp.Length());
+	End();
+}
+
+void P4CallRecorder::Command(const char *cmd, char const* const* args, int argc)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!pFile)
+		return;
+	Begin(CR_COMMAND);
+	PutString(buffer, cmd, strlen(cmd));
+	PutU32(buffer, (unsigned int) (args ? argc : 0));
+	for (int i = 0; args && i < argc; i++)
+		PutString(buffer, args[i] ? args[i] : "", args[i] ? strlen(args[i]) : 0);
+	End();
+}
+
+void P4CallRecorder::Resolve(int kind, int status)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!pFile)
+		return;
+	Begin(CR_RESOLVE);
+	PutU32(buffer, (unsigned int) kind);
+	PutU32(buffer, (unsigned int) status);
+	End();
+}
+
+/*******************************************************************************
+ *
+ *  Replay
+ *
+ *  Messages are rebuilt from their formatted text, with the code, severity
+ *   and generic they were recorded with. Each command recorded starts with
+ *   cleared results, as it did when it ran.
+ *
+ ******************************************************************************/
+
+static bool ReadRecording(const char *path, std::vector<char> &data)
+{
+	Error e;
+	FileSys *f = FileSys::Create(FST_BINARY);
+	f->Set(StrRef(path));
+	f->Open(FOM_READ, &e);
+	if (!e.Test())
+	{
+		char buf[64 * 1024];
+		int len;
+		while ((len = f->Read(buf, sizeof(buf), &e)) > 0 && !e.Test())
+			data.insert(data.end(), buf, buf + len);
+		f->Close(&e);
+	}
+	delete f;
+	return !e.Test();
+}
+
+// A message as the p4api would send it, '%' is doubled so the text is not
+//  taken for a parameter
+static void ReplayMessage(P4BridgeClient *ui, unsigned int code, int severity, int generic,
+	const char *text)
+{
+	StrBuf fmt;
+	for (const char *p = text; *p; p++)
+	{
+		if (*p == '%')
+			fmt.Append("%");
+		fmt.Append(p, 1);
+	}
+
+	ErrorId id;
+	id.code = code ? (int) code : ErrorOf(0, 0, severity, generic, 0);
+	id.fmt = fmt.Text();
+
+	Error e;
+	e.Set(id);
+	ui->Message(&e);
+}
+
+int P4CallRecorder::Replay(const char *path, P4BridgeServer *pServer, int cmdId, int repeat)
+{
+	LOG_ENTRY();
+	std::vector<char> data;
+	if (!path || !ReadRecording(path, data))
+		return -1;
+
+	const char *base = data.data();
+	size_t end = data.size();
+	if (end < CR_HEADER_SIZE || memcmp(base, "P4CR", 4) != 0 ||
+		GetU32(base + 4) > CALL_RECORDING_VERSION)
+	{
+		return -1;
+	}
+
+	P4Connection *connection = pServer->getConnection(cmdId);
+	P4BridgeClient *ui = connection ? connection->getUi() : NULL;
+	if (!ui)
+		return -1;
+	int replayed = 0;
+	for (int r = 0; r < repeat; r++)
+	{
+		ui->clear_results();
+
+		size_t offset = CR_HEADER_SIZE;
+		while (offset + CR_RECORD_HEADER_SIZE <= end)
+		{
+			unsigned int kind = GetU32(base + offset);
+			unsigned long long length = GetU64(base + offset + 4);
+			size_t pos = offset + CR_RECORD_HEADER_SIZE;
+			if (length > end - pos)
+				return -1;
+			size_t recordEnd = pos + (size_t) length;
+			offset = recordEnd;
+
+			const char *s;
+			size_t len;
+			switch (kind)
+			{
+			case CR_MESSAGE:
+			{
+				if (pos + 16 > recordEnd)
+					return -1;
+				unsigned int code = GetU32(base + pos);
+				int severity = (int) GetU32(base + pos + 4);
+				int generic = (int) GetU32(base + pos + 8);
+				int unicode = (int) GetU32(base + pos + 12);
+				pos += 16;
+				if (!(s = GetString(base, pos, recordEnd, len)))
+					return -1;
+				// asking a server that never connected would run a command
+				ui->SetReplayUnicode(unicode);
+				ReplayMessage(ui, code, severity, generic, s);
+				ui->SetReplayUnicode(-1);
+				break;
+			}
+			case CR_STAT:
+			{
+				if (pos + 4 > recordEnd)
+					return -1;
+				unsigned int fields = GetU32(base + pos);
+				pos += 4;
+				StrBufDict dict;
+				for (unsigned int i = 0; i < fields; i++)
+				{
+					size_t varLen;
+					const char *var = GetString(base, pos, recordEnd, varLen);
+					if (!var || !(s = GetString(base, pos, recordEnd, len)))
+						return -1;
+					dict.SetVar(StrRef(var, (int) varLen), StrRef(s, (int) len));
+				}
+				ui->OutputStat(&dict);
+				break;
+			}
+			case CR_TEXT:
+				if (!(s = GetString(base, pos, recordEnd, len)))
+					return -1;
+				ui->OutputText(s, (int) len);
+				break;
+			case CR_BINARY:
+				if (!(s = GetString(base, pos, recordEnd, len)))
+					return -1;
+				ui->OutputBinary(s, (int) len);
+				break;
+			case CR_ERROR:
+				if (!(s = GetString(base, pos, recordEnd, len)))
+					return -1;
+				ui->OutputError(s);
+				break;
+			case CR_PROMPT:
+			{
+				if (pos + 4 > recordEnd)
+					return -1;
+				int noEcho = (int) GetU32(base + pos);
+				pos += 4;
+				if (!(s = GetString(base, pos, recordEnd, len)))
+					return -1;
+				StrBuf rsp;
+				Error e;
+				ui->Prompt(StrRef(s, (int) len), rsp, noEcho, &e);
+				break;
+			}
+			case CR_COMMAND:
+				// the start of the next command, not a call
+				ui->clear_results();
+				continue;
+			default:
+				// resolves, and kinds added by later versions
+				continue;
+			}
+			replayed++;
+		}
+	}
+	return replayed;
+}
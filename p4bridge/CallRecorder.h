@@ -0,0 +1,114 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: CallRecorder.h
+ *
+ * Description	:  P4CallRecorder writes the calls the p4api makes on a
+ *  P4BridgeClient while a command runs (messages, tagged output, text,
+ *  binary output, prompts and resolves) to a file, each command's calls
+ *  following a record of the command. Replay() pushes a
+ *  recording back through a P4BridgeClient as fast as it can, so the
+ *  result pipeline of the bridge can be benchmarked and profiled without a
+ *  server.
+ *
+ *  The file starts with the 4 bytes "P4CR" and a 32 bit version, followed by
+ *  one record per call: a 32 bit kind and a 64 bit length followed by that
+ *  many bytes. Numbers are little endian, strings are a 32 bit length
+ *  followed by the bytes and a NUL, as in ResultSet.h.
+ *
+ ******************************************************************************/
+
+#include <vector>
+#include <mutex>
+
+class P4BridgeServer;
+
+// Version written by Open(), Replay() accepts this and older versions
+#define CALL_RECORDING_VERSION 2
+
+// Values for the kind of a recorded resolve
+#define CALL_RESOLVE_CONTENT	0
+#define CALL_RESOLVE_ACTION		1
+
+class P4CallRecorder
+{
+public:
+	P4CallRecorder();
+	~P4CallRecorder();
+
+	// Start a new recording in the file, false if it can not be written
+	bool Open(const char *path);
+
+	// Write what is left and close the file
+	void Close();
+
+	// The start of a command, the calls that follow are its own
+	void Command(const char *cmd, char const* const* args, int argc);
+
+	// The calls, recorded as they reach the client. Commands recorded at
+	//  the same time are interleaved. The response to a prompt that is not
+	//  echoed is recorded as empty.
+	void Message(Error *err, bool unicode);
+	void OutputStat(StrDict *dict);
+	void OutputText(const char *data, int length);
+	void OutputBinary(const char *data, int length);
+	void OutputError(const char *err);
+	void Prompt(const StrPtr &msg, const StrBuf &rsp, int noEcho);
+	void Resolve(int kind, int status);
+
+	// Number of calls and commands recorded since Open()
+	int Count();
+
+	// Clear the results of the command's client and push every call of a
+	//  recording through it, repeat times. A prompt is asked again, a
+	//  resolve is skipped as there is no file to merge. Messages take the
+	//  Unicode mode they were recorded with, the server is not asked. The
+	//  results are cleared again at the start of each command recorded.
+	//  Returns the number of calls replayed, -1 if the file can not be read,
+	//  is not a recording or cmdId has no client.
+	static int Replay(const char *path, P4BridgeServer *pServer, int cmdId, int repeat);
+
+private:
+	P4CallRecorder(const P4CallRecorder &);
+	P4CallRecorder &operator=(const P4CallRecorder &);
+
+	// Start and finish a record, with the mutex held
+	void Begin(unsigned int kind);
+	void End();
+
+	// Write the buffer to the file, with the mutex held
+	void Flush();
+
+	std::mutex mutex;
+	FileSys *pFile;
+	std::vector<char> buffer;
+	size_t recordStart;
+	int count;
+};
@@ -0,0 +1,349 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ConfigCache.cpp
+ *
+ * Description	:  ConfigCache
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4Connection.h"
+#include "ConfigCache.h"
+
+#include "enviro.h"
+#include "strarray.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+namespace {
+	struct Entry
+	{
+		Entry() : checkedMs(0) {}
+
+		ConfigValues values;
+		// the files and directories the values depend on
+		std::vector<std::pair<std::string, Utils::FileStamp> > watched;
+		long long checkedMs;
+	};
+
+	// resolved directories by P4CONFIG and directory, guarded by cache_mutex.
+	//  An entry is not changed once stored apart from checkedMs, so it can
+	//  be checked without the lock.
+	std::mutex cache_mutex;
+	std::map<std::string, std::shared_ptr<Entry> > entries;
+	int generation = 0;
+	int recheck_ms = CONFIG_CACHE_RECHECK_MS;
+
+	// The settings as the environment and the registry give them, checked
+	//  at most once per recheck interval for all directories. Guarded by
+	//  cache_mutex.
+	std::string enviro_print;
+	long long enviro_checked_ms = 0;
+
+	std::atomic<int> hit_count(0);
+	std::atomic<int> miss_count(0);
+	std::atomic<int> reload_count(0);
+
+	void Watch(Entry &entry, const std::string &path)
+	{
+		Utils::FileStamp stamp;
+		Utils::GetFileStamp(path, stamp);
+		entry.watched.push_back(std::make_pair(path, stamp));
+	}
+
+	bool Unchanged(const Entry &entry)
+	{
+		for (size_t i = 0; i < entry.watched.size(); i++)
+		{
+			Utils::FileStamp stamp;
+			Utils::GetFileStamp(entry.watched[i].first, stamp);
+			if (stamp != entry.watched[i].second)
+				return false;
+		}
+		return true;
+	}
+
+	std::string Value(Enviro &enviro, const char *var)
+	{
+		const char *val = enviro.Get(var);
+		return val ? val : "";
+	}
+
+	// The variables a resolved directory depends on besides its files.
+	//  Setting one in the environment, or in the registry on Windows,
+	//  changes every directory without changing any file.
+	const char *const enviro_vars[] = {
+		"P4CONFIG", "P4ENVIRO", "P4PORT", "P4USER", "P4CLIENT", "P4PASSWORD", "P4CHARSET"
+	};
+
+	std::string EnviroPrint()
+	{
+		Enviro enviro;
+		std::string print;
+		for (size_t i = 0; i < sizeof(enviro_vars) / sizeof(enviro_vars[0]); i++)
+		{
+			print.append(Value(enviro, enviro_vars[i]));
+			print.push_back('\0');
+		}
+		return print;
+	}
+
+	// The directory without a trailing separator, unless it is a root
+	std::string Normalize(const char *dir)
+	{
+		std::string d = dir ? dir : "";
+		while (d.length() > 1 && (d.back() == '/' || d.back() == '\\') &&
+			!(d.length() == 3 && d[1] == ':'))
+		{
+			d.pop_back();
+		}
+		return d;
+	}
+
+	/***************************************************************************
+	 *
+	 *  Load
+	 *
+	 *  Resolve a directory the same way ConnectionFromPath always has. The
+	 *   directories are stamped before the config files are read, so a
+	 *   change made while reading is seen by the next check.
+	 *
+	 **************************************************************************/
+
+	void Load(const std::string &dir, const std::string &p4config, Entry &entry)
+	{
+		std::string d = dir;
+		for (;;)
+		{
+			Watch(entry, d);
+			size_t sep = d.find_last_of("/\\");
+			if (sep == std::string::npos)
+				break;
+			if (sep == 0 || (sep == 2 && d[1] == ':'))
+			{
+				if (d.length() > sep + 1)
+					Watch(entry, d.substr(0, sep + 1));
+				break;
+			}
+			d.resize(sep);
+		}
+
+		Enviro enviro;
+		if (!p4config.empty())
+			enviro.Update("P4CONFIG", p4config.c_str());
+
+		std::string enviroFile = Value(enviro, "P4ENVIRO");
+		if (!enviroFile.empty())
+			Watch(entry, enviroFile);
+
+		enviro.Config(StrRef(dir.c_str()));
+
+		ConfigValues &values = entry.values;
+		values.port = Value(enviro, "P4PORT");
+		values.user = Value(enviro, "P4USER");
+		values.client = Value(enviro, "P4CLIENT");
+		values.password = Value(enviro, "P4PASSWORD");
+		values.charset = Value(enviro, "P4CHARSET");
+
+		StrBuf config = enviro.GetConfig();
+		const StrArray *configs = enviro.GetConfigs();
+		if (config == "noconfig" || !configs || !configs->Count())
+		{
+			values.configFile = config.Text();
+		}
+		else
+		{
+			// the closest config file, see P4BridgeServer::get_config
+			values.configFile = configs->Get(0)->Text();
+			for (int i = 0; i < configs->Count(); i++)
+				Watch(entry, configs->Get(i)->Text());
+		}
+	}
+}
+
+/*******************************************************************************
+ *
+ *  Resolve
+ *
+ *  The files and the environment are checked without the cache lock, so a
+ *   slow file system or registry does not hold up other lookups. A change
+ *   made while checking is seen by the next check.
+ *
+ ******************************************************************************/
+
+void ConfigCache::Resolve(const char *dir, ConfigValues &values)
+{
+	std::string d = Normalize(dir);
+	const char *cfg = P4BridgeServer::Get("P4CONFIG");
+	std::string p4config = cfg ? cfg : "";
+	std::string key = p4config + '\n' + d;
+	long long now = P4Connection::NowMs();
+
+	bool checkEnviro;
+	{
+		std::lock_guard<std::mutex> guard(cache_mutex);
+		checkEnviro = !enviro_checked_ms || (now - enviro_checked_ms >= recheck_ms);
+	}
+	if (checkEnviro)
+	{
+		std::string print = EnviroPrint();
+		std::lock_guard<std::mutex> guard(cache_mutex);
+		if (enviro_checked_ms && print != enviro_print)
+		{
+			reload_count++;
+			entries.clear();
+			generation++;
+		}
+		enviro_print = print;
+		// never 0 once checked
+		enviro_checked_ms = now ? now : 1;
+	}
+
+	int gen;
+	std::shared_ptr<Entry> cached;
+	{
+		std::lock_guard<std::mutex> guard(cache_mutex);
+		gen = generation;
+		std::map<std::string, std::shared_ptr<Entry> >::iterator it = entries.find(key);
+		if (it != entries.end())
+		{
+			if (now - it->second->checkedMs < recheck_ms)
+			{
+				hit_count++;
+				values = it->second->values;
+				return;
+			}
+			cached = it->second;
+		}
+	}
+
+	if (cached)
+	{
+		bool unchanged = Unchanged(*cached);
+
+		std::lock_guard<std::mutex> guard(cache_mutex);
+		std::map<std::string, std::shared_ptr<Entry> >::iterator it = entries.find(key);
+		if (unchanged)
+		{
+			if (it != entries.end() && it->second == cached)
+				cached->checkedMs = now;
+			hit_count++;
+			values = cached->values;
+			return;
+		}
+		reload_count++;
+		if (it != entries.end() && it->second == cached)
+			entries.erase(it);
+		gen = generation;
+	}
+
+	// resolved outside the lock so other directories aren't held up
+	miss_count++;
+	std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+	Load(d, p4config, *entry);
+	entry->checkedMs = now;
+	values = entry->values;
+
+	// don't keep it if the environment changed while it was resolved
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	if (gen == generation)
+		entries[key] = entry;
+}
+
+void ConfigCache::Invalidate()
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	entries.clear();
+	generation++;
+}
+
+void ConfigCache::SetRecheckInterval(int ms)
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	recheck_ms = (ms > 0) ? ms : 0;
+}
+
+void ConfigCache::GetCounts(int *hits, int *misses, int *reloads)
+{
+	if (hits) *hits = hit_count;
+	if (misses) *misses = miss_count;
+	if (reloads) *reloads = reload_count;
+}
+
+P4ConfigBatch::P4ConfigBatch() :
+	p4base(tP4ConfigBatch)
+{
+}
+
+P4ConfigBatch::~P4ConfigBatch()
+{
+}
+
+void P4ConfigBatch::Resolve(char const * const * paths, int count)
+{
+	LOG_ENTRY();
+	dirs.clear();
+	values.clear();
+	rows.clear();
+	for (int i = 0; paths && i < count; i++)
+	{
+		dirs.push_back(paths[i] ? paths[i] : "");
+		values.push_back(ConfigValues());
+		ConfigCache::Resolve(dirs.back().c_str(), values.back());
+	}
+}
+
+static const char *OrNull(const std::string &s)
+{
+	return s.empty() ? NULL : s.c_str();
+}
+
+const ConfigInfo* P4ConfigBatch::GetRows(int *count)
+{
+	if (count)
+		*count = (int) dirs.size();
+	if (dirs.empty())
+		return NULL;
+
+	rows.resize(dirs.size());
+	for (size_t i = 0; i < dirs.size(); i++)
+	{
+		rows[i].dir = dirs[i].c_str();
+		rows[i].port = OrNull(values[i].port);
+		rows[i].user = OrNull(values[i].user);
+		rows[i].client = OrNull(values[i].client);
+		rows[i].password = OrNull(values[i].password);
+		rows[i].charset = OrNull(values[i].charset);
+		rows[i].configFile = OrNull(values[i].configFile);
+	}
+	return rows.data();
+}
@@ -0,0 +1,117 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ConfigCache.h
+ *
+ * Description	:  ConfigCache keeps the connection settings resolved for each
+ *  directory from P4CONFIG files, P4ENVIRO and the environment, so asking
+ *  for the settings of many files does not walk up the directory tree and
+ *  parse the config files every time. The settings are the process wide
+ *  ones, the settings a server has of its own do not apply.
+ *
+ *  A cached directory is checked at most once per recheck interval: it is
+ *  resolved again if any config file it used, any directory above it
+ *  (where a config file could be added or removed) or the P4ENVIRO file
+ *  has changed. Every entry is dropped when the bridge's environment is
+ *  changed, or when the P4 variables of the process environment (or of
+ *  the registry on Windows) are found to have changed, which is also
+ *  checked at most once per recheck interval.
+ *
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+
+// Default for how often a cached directory is checked for changes
+#define CONFIG_CACHE_RECHECK_MS	1000
+
+// The settings resolved for a directory, an empty value was not set
+struct ConfigValues
+{
+	std::string port;
+	std::string user;
+	std::string client;
+	std::string password;
+	std::string charset;
+	std::string configFile;		// the closest config file, or "noconfig"
+};
+
+class ConfigCache
+{
+public:
+	// Resolve the settings for a directory, from the cache if nothing
+	//  they came from has changed
+	static void Resolve(const char *dir, ConfigValues &values);
+
+	// Drop every cached directory, called when the environment changes
+	static void Invalidate();
+
+	// How often in milliseconds a directory is checked for changes, 0 to
+	//  check on every lookup
+	static void SetRecheckInterval(int ms);
+
+	// hits: lookups answered from the cache
+	// misses: lookups that resolved the directory
+	// reloads: times a cached directory was found to have changed
+	static void GetCounts(int *hits, int *misses, int *reloads);
+};
+
+// One row of a P4ConfigBatch, laid out to be read directly from managed
+//  code. Values that are not set are NULL.
+struct ConfigInfo
+{
+	const char *dir;
+	const char *port;
+	const char *user;
+	const char *client;
+	const char *password;
+	const char *charset;
+	const char *configFile;
+};
+
+class P4ConfigBatch : public p4base
+{
+public:
+	P4ConfigBatch();
+	virtual ~P4ConfigBatch();
+
+	virtual int Type(void) { return tP4ConfigBatch; }
+
+	// Resolve the settings of every directory, replacing any earlier rows
+	void Resolve(char const * const * dirs, int count);
+
+	// The rows in the order of the directories, valid until the batch is
+	//  resolved again or deleted
+	const ConfigInfo* GetRows(int *count);
+
+private:
+	std::vector<std::string> dirs;
+	std::vector<ConfigValues> values;
+	std::vector<ConfigInfo> rows;
+};
@@ -0,0 +1,361 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: DiffCapture.cpp
+ *
+ * Description	:  DiffCapture
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "DiffCapture.h"
+
+#include <system_error>
+
+#ifdef OS_NT
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#define DIFF_PIPE_BUFFER (64 * 1024)
+
+DiffCapture::DiffCapture() :
+	out(NULL),
+	readFd(-1)
+{
+}
+
+DiffCapture::~DiffCapture()
+{
+	Finish();
+}
+
+static void ClosePipe(int fd)
+{
+#ifdef OS_NT
+	_close(fd);
+#else
+	close(fd);
+#endif
+}
+
+FILE* DiffCapture::Open()
+{
+	int fds[2];
+#ifdef OS_NT
+	if (_pipe(fds, DIFF_PIPE_BUFFER, _O_BINARY) != 0)
+		return NULL;
+	out = _fdopen(fds[1], "wb");
+#else
+	if (pipe(fds) != 0)
+		return NULL;
+	out = fdopen(fds[1], "wb");
+#endif
+	if (!out)
+	{
+		ClosePipe(fds[0]);
+		ClosePipe(fds[1]);
+		return NULL;
+	}
+	readFd = fds[0];
+
+	try
+	{
+		reader = std::thread(&DiffCapture::Read, this);
+	}
+	catch (std::system_error&)
+	{
+		fclose(out);
+		out = NULL;
+		ClosePipe(readFd);
+		readFd = -1;
+		return NULL;
+	}
+	return out;
+}
+
+void DiffCapture::Read()
+{
+	char buf[DIFF_PIPE_BUFFER];
+	for (;;)
+	{
+#ifdef OS_NT
+		int n = _read(readFd, buf, sizeof(buf));
+#else
+		ssize_t n = read(readFd, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR)
+			continue;
+#endif
+		if (n <= 0)
+			break;
+		text.append(buf, n);
+	}
+}
+
+void DiffCapture::Finish()
+{
+	// closing the write end is what ends the reader
+	if (out)
+	{
+		fclose(out);
+		out = NULL;
+	}
+	if (reader.joinable())
+		reader.join();
+	if (readFd >= 0)
+	{
+		ClosePipe(readFd);
+		readFd = -1;
+	}
+}
+
+/*******************************************************************************
+ *
+ *  Split
+ *
+ *  The first hunk header decides the format. Lines before it, such as the
+ *   file names of a unified diff, are kept with the first hunk. Output with
+ *   no hunk header at all, like that of -ds, is one DIFF_HUNK_OTHER record.
+ *
+ ******************************************************************************/
+
+enum DiffFormat { FMT_UNKNOWN, FMT_NORMAL, FMT_CONTEXT, FMT_UNIFIED, FMT_RCS };
+
+static bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool ParseNumber(const char *&p, const char *end, int &value)
+{
+	if (p >= end || !IsDigit(*p))
+		return false;
+	value = 0;
+	while (p < end && IsDigit(*p))
+		value = value * 10 + (*p++ - '0');
+	return true;
+}
+
+// "a" or "a,b" as a start and count. A single number is one line, unless it
+//  is zero.
+static bool ParseRange(const char *&p, const char *end, int &start, int &count)
+{
+	if (!ParseNumber(p, end, start))
+		return false;
+	int last = start;
+	if (p < end && *p == ',')
+	{
+		p++;
+		if (!ParseNumber(p, end, last))
+			return false;
+	}
+	count = (last >= start) ? last - start + 1 : 0;
+	if (start == 0 && last == 0)
+		count = 0;
+	return true;
+}
+
+// "start,count" as used by unified diffs, the count defaults to 1
+static bool ParseUnifiedRange(const char *&p, const char *end, int &start, int &count)
+{
+	if (!ParseNumber(p, end, start))
+		return false;
+	count = 1;
+	if (p < end && *p == ',')
+	{
+		p++;
+		if (!ParseNumber(p, end, count))
+			return false;
+	}
+	return true;
+}
+
+static bool StartsWith(const char *p, const char *end, const char *prefix)
+{
+	size_t n = strlen(prefix);
+	return (size_t) (end - p) >= n && memcmp(p, prefix, n) == 0;
+}
+
+static int KindOf(const DiffHunk &hunk)
+{
+	if (hunk.fromCount == 0)
+		return DIFF_HUNK_ADD;
+	if (hunk.toCount == 0)
+		return DIFF_HUNK_DELETE;
+	return DIFF_HUNK_CHANGE;
+}
+
+void DiffCapture::Split(const char *diff, size_t len, int file, long long base,
+	std::vector<DiffHunk> &hunks)
+{
+	DiffFormat format = FMT_UNKNOWN;
+	DiffHunk cur;
+	memset(&cur, 0, sizeof(cur));
+	cur.file = file;
+	bool haveHeader = false;
+	size_t start = 0;
+
+	// RCS output: lines of added text still to skip, and how far the new
+	//  file's line numbers have moved from the old one's
+	int skip = 0;
+	int delta = 0;
+
+	const char *end = diff + len;
+	const char *line = diff;
+	while (line < end)
+	{
+		const char *eol = (const char *) memchr(line, '\n', end - line);
+		const char *next = eol ? eol + 1 : end;
+		const char *lineEnd = eol ? eol : end;
+		if (skip > 0)
+		{
+			skip--;
+			line = next;
+			continue;
+		}
+
+		DiffHunk header;
+		memset(&header, 0, sizeof(header));
+		header.file = file;
+		bool isHeader = false;
+		const char *p = line;
+
+		if ((format == FMT_UNKNOWN || format == FMT_UNIFIED) && StartsWith(p, lineEnd, "@@ -"))
+		{
+			p += 4;
+			if (ParseUnifiedRange(p, lineEnd, header.fromStart, header.fromCount) &&
+				StartsWith(p, lineEnd, " +"))
+			{
+				p += 2;
+				if (ParseUnifiedRange(p, lineEnd, header.toStart, header.toCount))
+				{
+					header.kind = KindOf(header);
+					format = FMT_UNIFIED;
+					isHeader = true;
+				}
+			}
+		}
+		else if ((format == FMT_UNKNOWN || format == FMT_CONTEXT) && StartsWith(p, lineEnd, "***************"))
+		{
+			// the ranges are on the next two lines
+			header.kind = DIFF_HUNK_CHANGE;
+			format = FMT_CONTEXT;
+			isHeader = true;
+		}
+		else if (format == FMT_CONTEXT && haveHeader && StartsWith(p, lineEnd, "*** ") &&
+			(lineEnd - p) > 4 && IsDigit(p[4]))
+		{
+			p += 4;
+			ParseRange(p, lineEnd, cur.fromStart, cur.fromCount);
+			cur.kind = KindOf(cur);
+		}
+		else if (format == FMT_CONTEXT && haveHeader && StartsWith(p, lineEnd, "--- ") &&
+			(lineEnd - p) > 4 && IsDigit(p[4]))
+		{
+			p += 4;
+			ParseRange(p, lineEnd, cur.toStart, cur.toCount);
+			cur.kind = KindOf(cur);
+		}
+		else if ((format == FMT_UNKNOWN || format == FMT_NORMAL) && p < lineEnd && IsDigit(*p))
+		{
+			int fromStart, fromCount, toStart, toCount;
+			if (ParseRange(p, lineEnd, fromStart, fromCount) && p < lineEnd &&
+				(*p == 'a' || *p == 'c' || *p == 'd'))
+			{
+				char op = *p++;
+				if (ParseRange(p, lineEnd, toStart, toCount))
+				{
+					header.fromStart = fromStart;
+					header.toStart = toStart;
+					header.fromCount = (op == 'a') ? 0 : fromCount;
+					header.toCount = (op == 'd') ? 0 : toCount;
+					header.kind = (op == 'a') ? DIFF_HUNK_ADD :
+						(op == 'd') ? DIFF_HUNK_DELETE : DIFF_HUNK_CHANGE;
+					format = FMT_NORMAL;
+					isHeader = true;
+				}
+			}
+		}
+		else if ((format == FMT_UNKNOWN || format == FMT_RCS) && (lineEnd - p) > 1 &&
+			(*p == 'a' || *p == 'd') && IsDigit(p[1]))
+		{
+			char op = *p++;
+			int at, count;
+			if (ParseNumber(p, lineEnd, at) && p < lineEnd && *p++ == ' ' &&
+				ParseNumber(p, lineEnd, count))
+			{
+				header.fromStart = at;
+				if (op == 'a')
+				{
+					header.fromCount = 0;
+					header.toStart = at + delta + 1;
+					header.toCount = count;
+					header.kind = DIFF_HUNK_ADD;
+					delta += count;
+					skip = count;
+				}
+				else
+				{
+					header.fromCount = count;
+					header.toStart = at + delta - 1;
+					header.toCount = 0;
+					header.kind = DIFF_HUNK_DELETE;
+					delta -= count;
+				}
+				format = FMT_RCS;
+				isHeader = true;
+			}
+		}
+
+		if (isHeader)
+		{
+			size_t offset = line - diff;
+			if (haveHeader)
+			{
+				cur.textOffset = base + start;
+				cur.textLength = offset - start;
+				hunks.push_back(cur);
+				start = offset;
+			}
+			cur = header;
+			haveHeader = true;
+		}
+		line = next;
+	}
+
+	if (haveHeader || len > 0)
+	{
+		if (!haveHeader)
+			cur.kind = DIFF_HUNK_OTHER;
+		cur.textOffset = base + start;
+		cur.textLength = len - start;
+		hunks.push_back(cur);
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: DiffCapture.h
+ *
+ * Description	:  DiffCapture collects the output of a Diff in memory. The
+ *  P4API only writes a diff to a FILE, so it is given the write end of a
+ *  pipe drained by a thread, instead of a temporary file that is read back.
+ *
+ *  Split() cuts diff output into hunks and parses their line ranges, for
+ *  normal, context, unified and RCS output.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+
+// How P4BridgeClient::Diff() reports the output of a diff
+#define DIFF_OUTPUT_TEXT		0	// a line at a time through a temporary file
+#define DIFF_OUTPUT_HUNKS		1	// in memory, a hunk per text callback
+#define DIFF_OUTPUT_STRUCTURED	2	// in memory, as DiffHunk records
+
+// DiffHunk::kind
+#define DIFF_HUNK_OTHER		0	// not a hunk, e.g. the output of -ds
+#define DIFF_HUNK_ADD		1
+#define DIFF_HUNK_DELETE	2
+#define DIFF_HUNK_CHANGE	3
+
+// One hunk of diff output, laid out to be read directly from managed code.
+//  Line numbers start at 1, a range with no lines starts at the line it
+//  comes after.
+struct DiffHunk
+{
+	long long textOffset;	// the hunk in the diff text, including its header
+	long long textLength;
+	int file;				// which file of the command, in the order diffed
+	int kind;
+	int fromStart;
+	int fromCount;
+	int toStart;
+	int toCount;
+};
+
+class DiffCapture
+{
+public:
+	DiffCapture();
+	~DiffCapture();
+
+	// The FILE to give Diff::SetOutput(), NULL if no pipe could be made
+	FILE* Open();
+
+	// Close the FILE and wait for everything written to it to be read
+	void Finish();
+
+	const std::string& Text() { return text; }
+
+	// Split diff output into hunks, appended to hunks with their offsets
+	//  moved by base
+	static void Split(const char *diff, size_t len, int file, long long base,
+		std::vector<DiffHunk> &hunks);
+
+private:
+	FILE* out;
+	int readFd;
+	std::thread reader;
+	std::string text;
+
+	void Read();
+};
@@ -0,0 +1,136 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: EnviroSnapshot.cpp
+ *
+ * Description	:  EnviroSnapshot
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "EnviroSnapshot.h"
+
+// the values read from the global Enviro since it last changed, replaced
+//  as a whole under global_mutex and read with atomic_load
+static std::mutex global_mutex;
+static std::shared_ptr<const EnviroSnapshot::Vars> global_vars =
+	std::make_shared<const EnviroSnapshot::Vars>();
+static int global_generation = 0;
+
+EnviroSnapshot::EnviroSnapshot() :
+	overrides(std::make_shared<const Vars>())
+{
+}
+
+bool EnviroSnapshot::Get(const char *var, std::string &value) const
+{
+	value.clear();
+	if (!var)
+		return false;
+
+	std::shared_ptr<const Vars> vars = std::atomic_load(&overrides);
+	Vars::const_iterator it = vars->find(var);
+	if (it != vars->end())
+	{
+		value = it->second.value;
+		return it->second.set;
+	}
+	return GetGlobal(var, value);
+}
+
+void EnviroSnapshot::Update(const char *var, const char *value)
+{
+	if (!var)
+		return;
+
+	std::lock_guard<std::mutex> guard(writeMutex);
+	std::shared_ptr<Vars> vars = std::make_shared<Vars>(*std::atomic_load(&overrides));
+	Value &v = (*vars)[var];
+	v.set = (value != NULL);
+	v.value = value ? value : "";
+	std::atomic_store(&overrides, std::shared_ptr<const Vars>(vars));
+}
+
+void EnviroSnapshot::Reset(const char *var)
+{
+	std::lock_guard<std::mutex> guard(writeMutex);
+	std::shared_ptr<Vars> vars = std::make_shared<Vars>();
+	if (var)
+	{
+		*vars = *std::atomic_load(&overrides);
+		vars->erase(var);
+	}
+	std::atomic_store(&overrides, std::shared_ptr<const Vars>(vars));
+}
+
+std::shared_ptr<const EnviroSnapshot::Vars> EnviroSnapshot::Overrides() const
+{
+	return std::atomic_load(&overrides);
+}
+
+bool EnviroSnapshot::GetGlobal(const char *var, std::string &value)
+{
+	value.clear();
+	if (!var)
+		return false;
+
+	std::shared_ptr<const Vars> vars = std::atomic_load(&global_vars);
+	Vars::const_iterator it = vars->find(var);
+	if (it != vars->end())
+	{
+		value = it->second.value;
+		return it->second.set;
+	}
+
+	int generation;
+	{
+		std::lock_guard<std::mutex> guard(global_mutex);
+		generation = global_generation;
+	}
+
+	Value v;
+	v.set = P4BridgeServer::GetEnviroValue(var, v.value);
+	value = v.value;
+
+	// don't keep a value read before the Enviro changed
+	std::lock_guard<std::mutex> guard(global_mutex);
+	if (generation == global_generation)
+	{
+		std::shared_ptr<Vars> updated = std::make_shared<Vars>(*global_vars);
+		(*updated)[var] = v;
+		std::atomic_store(&global_vars, std::shared_ptr<const Vars>(updated));
+	}
+	return v.set;
+}
+
+void EnviroSnapshot::GlobalChanged()
+{
+	std::lock_guard<std::mutex> guard(global_mutex);
+	global_generation++;
+	std::atomic_store(&global_vars, std::make_shared<const Vars>());
+}
@@ -0,0 +1,96 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: EnviroSnapshot.h
+ *
+ * Description	:  EnviroSnapshot holds the environment settings of one
+ *  P4BridgeServer. A server starts with no settings of its own and reads
+ *  through to the global Enviro, whose values are copied into a shared
+ *  read-only table the first time each is asked for, so later lookups
+ *  don't take the global enviro lock. Settings updated on a server only
+ *  change that server.
+ *
+ *  A server's settings are what GetServerVar returns, what its connection
+ *  is given (see P4BridgeServer::ApplyVars) and where its tickets are
+ *  looked up. The static P4BridgeServer::Get, the process wide ticket
+ *  lookups and ConfigCache have no server and keep to the global
+ *  settings; IsIgnored and GetTicketFile read those from the shared table.
+ *
+ *  Both tables are copy-on-write: a reader takes a reference to the
+ *  current table and never blocks, a writer builds a new table and swaps
+ *  it in. The global table is emptied whenever the global Enviro changes.
+ *
+ *  The Enviro copy constructor crashes on Windows, so the values are kept
+ *  as strings rather than as a copy of the Enviro.
+ *
+ ******************************************************************************/
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+
+class EnviroSnapshot
+{
+public:
+	struct Value
+	{
+		bool set;			// false when the variable is not set
+		std::string value;
+	};
+	typedef std::map<std::string, Value> Vars;
+
+	EnviroSnapshot();
+
+	// The server's value if it has one, otherwise the global value.
+	//  Returns false if the variable is not set.
+	bool Get(const char *var, std::string &value) const;
+
+	// Set the server's value, a NULL value unsets the variable for this
+	//  server only
+	void Update(const char *var, const char *value);
+
+	// Go back to the global value of a variable, or of every variable if
+	//  var is NULL
+	void Reset(const char *var);
+
+	// The variables this server has its own value for
+	std::shared_ptr<const Vars> Overrides() const;
+
+	// A value from the global Enviro, read under its lock the first time
+	//  and from the shared table after that
+	static bool GetGlobal(const char *var, std::string &value);
+
+	// Called whenever the global Enviro changes
+	static void GlobalChanged();
+
+private:
+	std::shared_ptr<const Vars> overrides;
+	std::mutex writeMutex;
+};
@@ -0,0 +1,363 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: FileIndex.cpp
+ *
+ * Description	:  P4FileIndex
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4BridgeClient.h"
+#include "FileIndex.h"
+
+#include <algorithm>
+
+// Number of records added before they are merged into the sorted indexes
+#define FILEINDEX_MERGE_AT 1024
+
+P4FileIndex::P4FileIndex() :
+	p4base(tP4FileIndex),
+	indexed(0),
+	link(new ServerLink())
+{
+}
+
+P4FileIndex::~P4FileIndex()
+{
+	link->OwnerDeleted([this](P4BridgeServer *pServer) { pServer->FileIndexDeleted(this); });
+}
+
+void P4FileIndex::Clear()
+{
+	strings.Clear();
+	records.clear();
+	byDepot.clear();
+	byLocal.clear();
+	indexed = 0;
+}
+
+int P4FileIndex::UpdateKind(const char *cmd, char const * const * args, int argc)
+{
+	static const struct { const char *cmd; int kind; } kinds[] = {
+		{ "fstat", FILEINDEX_REFRESH },
+		{ "have", FILEINDEX_REFRESH },
+		{ "sync", FILEINDEX_SYNC },
+		{ "update", FILEINDEX_SYNC },
+		{ "flush", FILEINDEX_SYNC },
+		{ "edit", FILEINDEX_OPEN },
+		{ "add", FILEINDEX_OPEN },
+		{ "delete", FILEINDEX_OPEN },
+		{ "integrate", FILEINDEX_OPEN },
+		{ "integ", FILEINDEX_OPEN },
+		{ "copy", FILEINDEX_OPEN },
+		{ "merge", FILEINDEX_OPEN },
+		{ "move", FILEINDEX_OPEN },
+		{ "rename", FILEINDEX_OPEN },
+		{ "reopen", FILEINDEX_OPEN },
+		{ "undo", FILEINDEX_OPEN },
+		{ "reconcile", FILEINDEX_OPEN },
+		{ "revert", FILEINDEX_REVERT },
+		{ "submit", FILEINDEX_SUBMIT },
+	};
+
+	if (!cmd)
+		return FILEINDEX_NONE;
+	for (int i = 0; i < argc; i++)
+	{
+		if (args[i] && strcmp(args[i], "-n") == 0)
+			return FILEINDEX_NONE;
+	}
+	for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++)
+	{
+		if (strcmp(cmd, kinds[i].cmd) == 0)
+			return kinds[i].kind;
+	}
+	return FILEINDEX_NONE;
+}
+
+// "none" and missing revisions are 0
+static int GetRev(StrDict *dict, const char *var, int old)
+{
+	StrPtr *val = dict->GetVar(var);
+	if (!val)
+		return old;
+	return val->Atoi();
+}
+
+static bool IsDelete(StrPtr *action)
+{
+	return action && strstr(action->Text(), "delete");
+}
+
+/*******************************************************************************
+ *
+ *  Apply
+ *
+ *  Fold one record of tagged output into the index. Every command reports
+ *   the depot path, which identifies the file. 'have' reports the local path
+ *   as path, the others as clientFile unless it is in client syntax.
+ *
+ ******************************************************************************/
+
+void P4FileIndex::Apply(int kind, StrDict *dict, bool find)
+{
+	StrPtr *depot = dict->GetVar("depotFile");
+	if (!depot)
+		return;
+
+	StrPtr *local = dict->GetVar("path");
+	if (!local)
+	{
+		local = dict->GetVar("clientFile");
+		if (local && local->Length() > 1 && local->Text()[0] == '/' && local->Text()[1] == '/')
+			local = NULL;
+	}
+
+	int idx = find ? Find(depot->Text(), true) : -1;
+	if (idx < 0)
+	{
+		Record record;
+		memset(&record, 0, sizeof(record));
+		record.depotFile = strings.Intern(depot->Text(), depot->Length());
+		records.push_back(record);
+		idx = (int) records.size() - 1;
+	}
+	Record &record = records[idx];
+
+	if (local)
+	{
+		unsigned int id = strings.Intern(local->Text(), local->Length());
+		if (id != record.localFile && (size_t) idx < indexed)
+		{
+			// it moved in the local path order, rebuild that index
+			byLocal.clear();
+		}
+		record.localFile = id;
+	}
+
+	StrPtr *action = dict->GetVar("action");
+	StrPtr *type = dict->GetVar("type");
+	StrPtr *change = dict->GetVar("change");
+
+	switch (kind)
+	{
+	case FILEINDEX_REFRESH:
+		record.haveRev = GetRev(dict, "haveRev", record.haveRev);
+		// a file opened for add has no head revision, but is still open
+		if (action)
+			record.action = strings.Intern(action->Text(), action->Length());
+		if (change)
+			record.change = change->Atoi();
+		if (dict->GetVar("headRev"))
+		{
+			// fstat reports every field, so anything missing is not set
+			record.headRev = GetRev(dict, "headRev", 0);
+			if (!action)
+				record.action = 0;
+			if (!change)
+				record.change = 0;
+			if (!type)
+				type = dict->GetVar("headType");
+		}
+		if (type)
+			record.type = strings.Intern(type->Text(), type->Length());
+		break;
+
+	case FILEINDEX_SYNC:
+		{
+			int rev = GetRev(dict, "rev", record.haveRev);
+			record.haveRev = (action && strcmp(action->Text(), "deleted") == 0) ? 0 : rev;
+			if (rev > record.headRev)
+				record.headRev = rev;
+		}
+		break;
+
+	case FILEINDEX_OPEN:
+		if (action)
+			record.action = strings.Intern(action->Text(), action->Length());
+		if (type)
+			record.type = strings.Intern(type->Text(), type->Length());
+		if (change)
+			record.change = change->Atoi();
+		break;
+
+	case FILEINDEX_REVERT:
+		record.action = 0;
+		record.change = 0;
+		record.haveRev = GetRev(dict, "haveRev", record.haveRev);
+		break;
+
+	case FILEINDEX_SUBMIT:
+		if (dict->GetVar("rev"))
+		{
+			int rev = GetRev(dict, "rev", 0);
+			record.headRev = rev;
+			record.haveRev = IsDelete(action) ? 0 : rev;
+			record.action = 0;
+			record.change = 0;
+		}
+		break;
+	}
+}
+
+void P4FileIndex::Update(int kind, StrDict *dict)
+{
+	if (kind == FILEINDEX_NONE || !dict)
+		return;
+
+	std::lock_guard<std::mutex> guard(mutex);
+	Apply(kind, dict, true);
+	if (records.size() - indexed >= FILEINDEX_MERGE_AT || byLocal.size() != indexed)
+		Merge();
+}
+
+int P4FileIndex::Load(StrDictList *results)
+{
+	StrDictListIterator it(results);
+	return Load(&it);
+}
+
+int P4FileIndex::Load(StrDictListIterator *results)
+{
+	LOG_ENTRY();
+	std::lock_guard<std::mutex> guard(mutex);
+	Clear();
+	StrDictList *pItem;
+	while (results && (pItem = results->GetNextItem()) != NULL)
+	{
+		// a single run doesn't report a file twice, so skip the lookup
+		Apply(FILEINDEX_REFRESH, pItem->Data(), false);
+	}
+	Merge();
+	return (int) records.size();
+}
+
+/*******************************************************************************
+ *
+ *  Merge
+ *
+ *  Sort the records added since the last merge and merge them into the
+ *   sorted indexes. The local path index is rebuilt if it was cleared because
+ *   a file's local path changed.
+ *
+ ******************************************************************************/
+
+void P4FileIndex::Merge()
+{
+	const StringPool &pool = strings;
+	const std::vector<Record> &recs = records;
+	auto depotLess = [&](unsigned int a, unsigned int b) {
+		return strcmp(pool.Get(recs[a].depotFile), pool.Get(recs[b].depotFile)) < 0;
+	};
+	auto localLess = [&](unsigned int a, unsigned int b) {
+		return strcmp(pool.Get(recs[a].localFile), pool.Get(recs[b].localFile)) < 0;
+	};
+
+	size_t oldSize = byDepot.size();
+	for (size_t i = indexed; i < records.size(); i++)
+		byDepot.push_back((unsigned int) i);
+	std::sort(byDepot.begin() + oldSize, byDepot.end(), depotLess);
+	std::inplace_merge(byDepot.begin(), byDepot.begin() + oldSize, byDepot.end(), depotLess);
+
+	if (byLocal.size() != indexed)
+	{
+		byLocal.resize(records.size());
+		for (size_t i = 0; i < records.size(); i++)
+			byLocal[i] = (unsigned int) i;
+		std::sort(byLocal.begin(), byLocal.end(), localLess);
+	}
+	else
+	{
+		oldSize = byLocal.size();
+		for (size_t i = indexed; i < records.size(); i++)
+			byLocal.push_back((unsigned int) i);
+		std::sort(byLocal.begin() + oldSize, byLocal.end(), localLess);
+		std::inplace_merge(byLocal.begin(), byLocal.begin() + oldSize, byLocal.end(), localLess);
+	}
+
+	indexed = records.size();
+}
+
+int P4FileIndex::Find(const char *path, bool depot)
+{
+	const std::vector<unsigned int> &order = depot ? byDepot : byLocal;
+
+	// byLocal is only empty when it needs rebuilding, then search it all
+	size_t searched = (order.size() == indexed) ? indexed : 0;
+
+	if (searched)
+	{
+		std::vector<unsigned int>::const_iterator it = std::lower_bound(order.begin(), order.end(), path,
+			[&](unsigned int idx, const char *key) {
+				const Record &record = records[idx];
+				return strcmp(strings.Get(depot ? record.depotFile : record.localFile), key) < 0;
+			});
+		if (it != order.end())
+		{
+			const Record &record = records[*it];
+			if (strcmp(strings.Get(depot ? record.depotFile : record.localFile), path) == 0)
+				return (int) *it;
+		}
+	}
+
+	for (size_t i = searched; i < records.size(); i++)
+	{
+		if (strcmp(strings.Get(depot ? records[i].depotFile : records[i].localFile), path) == 0)
+			return (int) i;
+	}
+	return -1;
+}
+
+bool P4FileIndex::Lookup(const char *path, FileInfo &info)
+{
+	if (!path || !*path)
+		return false;
+
+	std::lock_guard<std::mutex> guard(mutex);
+	bool depot = (path[0] == '/' && path[1] == '/');
+	int idx = Find(path, depot);
+	if (idx < 0)
+		return false;
+
+	const Record &record = records[idx];
+	info.depotFile = strings.Get(record.depotFile);
+	info.localFile = strings.Get(record.localFile);
+	info.haveRev = record.haveRev;
+	info.headRev = record.headRev;
+	info.action = strings.Get(record.action);
+	info.type = strings.Get(record.type);
+	info.change = record.change;
+	return true;
+}
+
+int P4FileIndex::Count()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	return (int) records.size();
+}
@@ -0,0 +1,134 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: FileIndex.h
+ *
+ * Description	:  P4FileIndex is an in memory snapshot of the have revision,
+ *  head revision and open action of the files in a workspace. It is loaded
+ *  from the tagged output of one 'fstat' or 'have' run, then kept up to date
+ *  from the tagged output of the sync, open, revert and submit commands run
+ *  on any server it is attached to, so questions about a file can be
+ *  answered without running a command.
+ *
+ *  Paths are kept once in a StringPool and the records are found by binary
+ *  search on depot path or local path.
+ *
+ ******************************************************************************/
+
+#include "StringPool.h"
+#include "ServerLink.h"
+
+#include <vector>
+#include <mutex>
+
+class StrDict;
+class StrDictList;
+class StrDictListIterator;
+class P4BridgeServer;
+
+// Values returned by P4FileIndex::UpdateKind()
+#define FILEINDEX_NONE		0
+#define FILEINDEX_REFRESH	1	// fstat, have
+#define FILEINDEX_SYNC		2	// sync, update, flush
+#define FILEINDEX_OPEN		3	// edit, add, delete, integrate, ...
+#define FILEINDEX_REVERT	4	// revert
+#define FILEINDEX_SUBMIT	5	// submit
+
+class P4FileIndex : public p4base
+{
+public:
+	// What is known about a file. The strings belong to the index and are
+	//  valid until it is reloaded or released.
+	struct FileInfo
+	{
+		const char *depotFile;
+		const char *localFile;
+		int haveRev;
+		int headRev;
+		const char *action;
+		const char *type;
+		int change;
+	};
+
+	P4FileIndex();
+	virtual ~P4FileIndex();
+
+	virtual int Type(void) { return tP4FileIndex; }
+
+	// Replace the contents with the tagged output of an fstat or have run,
+	//  returns the number of files
+	int Load(StrDictList *results);
+	int Load(StrDictListIterator *results);
+
+	// How the tagged output of a command changes the index, previews (-n)
+	//  change nothing
+	static int UpdateKind(const char *cmd, char const * const * args, int argc);
+
+	// Apply one record of tagged output, kind is from UpdateKind()
+	void Update(int kind, StrDict *dict);
+
+	// Look up a file by depot path (starting with //) or local path
+	bool Lookup(const char *path, FileInfo &info);
+
+	int Count();
+
+	// Servers whose commands update the index, they are detached when the
+	//  index is deleted
+	std::shared_ptr<ServerLink> GetLink() { return link; }
+
+private:
+	struct Record
+	{
+		unsigned int depotFile;
+		unsigned int localFile;
+		unsigned int action;
+		unsigned int type;
+		int haveRev;
+		int headRev;
+		int change;
+	};
+
+	std::mutex mutex;
+	StringPool strings;
+	std::vector<Record> records;
+
+	// Record indexes sorted by depot and local path. Records added since the
+	//  last merge are not in these and are searched one by one.
+	std::vector<unsigned int> byDepot;
+	std::vector<unsigned int> byLocal;
+	size_t indexed;
+
+	std::shared_ptr<ServerLink> link;
+
+	void Apply(int kind, StrDict *dict, bool find);
+	int Find(const char *path, bool depot);
+	void Merge();
+	void Clear();
+};
@@ -0,0 +1,219 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: IdleConnectionManager.cpp
+ *
+ * Description	:  IdleConnectionManager
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4Connection.h"
+#include "IdleConnectionManager.h"
+
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+// registered servers, guarded by servers_mutex
+static std::mutex servers_mutex;
+static std::set<P4BridgeServer*> servers;
+
+// background thread state, guarded by thread_mutex
+static std::mutex thread_mutex;
+static std::condition_variable thread_cv;
+static std::thread idle_thread;
+static bool stop_thread = false;
+static int idle_timeout_ms = 0;
+
+static std::atomic<int> reconnect_count(0);
+static std::atomic<int> disconnect_count(0);
+
+void IdleConnectionManager::Register(P4BridgeServer* pServer)
+{
+	std::lock_guard<std::mutex> guard(servers_mutex);
+	servers.insert(pServer);
+}
+
+void IdleConnectionManager::Unregister(P4BridgeServer* pServer)
+{
+	std::lock_guard<std::mutex> guard(servers_mutex);
+	servers.erase(pServer);
+}
+
+/*******************************************************************************
+ *
+ *  SetIdleTimeout
+ *
+ *  Start, retime or stop the background thread. Only one thread is ever
+ *   running, regardless of the number of servers.
+ *
+ ******************************************************************************/
+
+void IdleConnectionManager::SetIdleTimeout(int idleMs)
+{
+	LOG_ENTRY();
+	if (idleMs <= 0)
+	{
+		Shutdown();
+		return;
+	}
+
+	std::unique_lock<std::mutex> guard(thread_mutex);
+	idle_timeout_ms = idleMs;
+	if (!idle_thread.joinable())
+	{
+#ifdef OS_NT
+		// the thread runs code from this DLL, keep it loaded until the
+		//  process exits. Joining it from DllMain would deadlock on the
+		//  loader lock, and detaching it would leave it running unloaded code.
+		HMODULE self;
+		GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+			(LPCWSTR) &thread_mutex, &self);
+#endif
+		stop_thread = false;
+		idle_thread = std::thread(Run);
+	}
+	else
+	{
+		// wake the thread so it picks up the new timeout
+		thread_cv.notify_all();
+	}
+}
+
+int IdleConnectionManager::GetIdleTimeout()
+{
+	std::lock_guard<std::mutex> guard(thread_mutex);
+	return idle_timeout_ms;
+}
+
+void IdleConnectionManager::Shutdown()
+{
+	std::thread stopping;
+	{
+		std::lock_guard<std::mutex> guard(thread_mutex);
+		idle_timeout_ms = 0;
+		stop_thread = true;
+		stopping.swap(idle_thread);
+	}
+	thread_cv.notify_all();
+
+	if (stopping.joinable())
+	{
+		stopping.join();
+	}
+}
+
+void IdleConnectionManager::CountReconnect()
+{
+	reconnect_count++;
+}
+
+void IdleConnectionManager::GetCounts(int* live, int* idle, int* reconnected, int* disconnected)
+{
+	int nLive = 0;
+	int nIdle = 0;
+	{
+		std::lock_guard<std::mutex> guard(servers_mutex);
+		for (std::set<P4BridgeServer*>::iterator it = servers.begin(); it != servers.end(); ++it)
+		{
+			// never waits on a running command while servers_mutex is held
+			int state = (*it)->GetIdleState();
+			if (state == IDLE_STATE_LIVE)
+				nLive++;
+			else if (state == IDLE_STATE_IDLE)
+				nIdle++;
+		}
+	}
+	if (live) *live = nLive;
+	if (idle) *idle = nIdle;
+	if (reconnected) *reconnected = reconnect_count;
+	if (disconnected) *disconnected = disconnect_count;
+}
+
+/*******************************************************************************
+ *
+ *  CheckIdle
+ *
+ *  Disconnect every server whose connection has not been used for the idle
+ *   timeout. Servers running a command are skipped.
+ *
+ ******************************************************************************/
+
+int IdleConnectionManager::CheckIdle()
+{
+	int idleMs = GetIdleTimeout();
+	if (idleMs <= 0)
+		return 0;
+
+	long long now = P4Connection::NowMs();
+	int count = 0;
+
+	std::lock_guard<std::mutex> guard(servers_mutex);
+	for (std::set<P4BridgeServer*>::iterator it = servers.begin(); it != servers.end(); ++it)
+	{
+		if ((*it)->DisconnectIfIdle(now, idleMs))
+			count++;
+	}
+	disconnect_count += count;
+	return count;
+}
+
+void IdleConnectionManager::Run()
+{
+	LOG_ENTRY();
+	std::unique_lock<std::mutex> guard(thread_mutex);
+	while (!stop_thread)
+	{
+		// check a few times per timeout so a connection is not kept much
+		//  longer than asked, but never spin
+		int waitMs = idle_timeout_ms / 4;
+		if (waitMs < 100)
+			waitMs = 100;
+		if (waitMs > 1000)
+			waitMs = 1000;
+
+		thread_cv.wait_for(guard, std::chrono::milliseconds(waitMs));
+		if (stop_thread)
+			break;
+
+		guard.unlock();
+		try
+		{
+			CheckIdle();
+		}
+		catch (std::exception& e)
+		{
+			P4BridgeServer::ReportException(e, "IdleConnectionManager::Run");
+		}
+		guard.lock();
+	}
+}
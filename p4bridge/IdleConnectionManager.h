@@ -0,0 +1,79 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: IdleConnectionManager.h
+ *
+ * Description	:  IdleConnectionManager keeps track of every P4BridgeServer
+ *  and uses a single background thread to disconnect the ones whose
+ *  connection has not been used for the idle timeout. The next command on a
+ *  disconnected server reconnects as usual.
+ *
+ ******************************************************************************/
+
+class P4BridgeServer;
+
+// P4BridgeServer::GetIdleState()
+#define IDLE_STATE_NONE		0	// never connected or closed
+#define IDLE_STATE_LIVE		1	// connected or running a command
+#define IDLE_STATE_IDLE		2	// disconnected for being idle
+
+class IdleConnectionManager
+{
+public:
+	// Every P4BridgeServer registers itself when created and unregisters
+	//  when it is deleted
+	static void Register(P4BridgeServer* pServer);
+	static void Unregister(P4BridgeServer* pServer);
+
+	// Set the idle timeout in milliseconds. A value greater than zero starts
+	//  the background thread, zero stops it.
+	static void SetIdleTimeout(int idleMs);
+	static int GetIdleTimeout();
+
+	// Stop the background thread and wait for it to exit. On Windows the
+	//  bridge is pinned in memory once the thread has started, so it is
+	//  never unloaded under a running thread.
+	static void Shutdown();
+
+	// Called by a P4BridgeServer when it reconnects a connection that was
+	//  disconnected for being idle
+	static void CountReconnect();
+
+	// live: servers with an open connection
+	// idle: servers disconnected for being idle and not used since
+	// reconnected: total number of reconnects after an idle disconnect
+	// disconnected: total number of idle disconnects
+	static void GetCounts(int* live, int* idle, int* reconnected, int* disconnected);
+
+	// Check every registered server once, returns the number disconnected
+	static int CheckIdle();
+
+private:
+	static void Run();
+};
@@ -0,0 +1,335 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: NdjsonWriter.cpp
+ *
+ * Description	:  P4NdjsonWriter
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "NdjsonWriter.h"
+
+#include <chrono>
+#include <algorithm>
+
+#ifndef OS_NT
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+// Output for a file descriptor is written in blocks of about this size
+#define NDJSON_BUFFER (64 * 1024)
+
+P4NdjsonWriter::P4NdjsonWriter(long long handle, int flags) :
+	p4base(tP4NdjsonWriter),
+	flags(flags),
+	useRing(false),
+	handle(handle),
+	failed(false),
+	ringHead(0),
+	ringCount(0),
+	closed(false),
+	records(0),
+	bytes(0),
+	invalid(0),
+	dropped(0),
+	link(new ServerLink())
+{
+	buffer.reserve(NDJSON_BUFFER * 2);
+}
+
+P4NdjsonWriter::P4NdjsonWriter(int ringBytes, int flags) :
+	p4base(tP4NdjsonWriter),
+	flags(flags),
+	useRing(true),
+	handle(-1),
+	failed(false),
+	ring((ringBytes > 0) ? ringBytes : NDJSON_BUFFER),
+	ringHead(0),
+	ringCount(0),
+	closed(false),
+	records(0),
+	bytes(0),
+	invalid(0),
+	dropped(0),
+	link(new ServerLink())
+{
+}
+
+P4NdjsonWriter::~P4NdjsonWriter()
+{
+	// wake a command waiting for room in the ring before waiting for it
+	Close();
+
+	link->OwnerDeleted([this](P4BridgeServer *pServer) { pServer->NdjsonWriterDeleted(this); });
+}
+
+/*******************************************************************************
+ *
+ *  AppendString
+ *
+ *  Runs of plain ASCII are copied in one go, everything else is looked at a
+ *   character at a time.
+ *
+ ******************************************************************************/
+
+int P4NdjsonWriter::AppendString(std::string &out, const char *s, size_t len, bool latin1)
+{
+	static const char hex[] = "0123456789abcdef";
+	int bad = 0;
+
+	out.push_back('"');
+	const unsigned char *p = (const unsigned char *) s;
+	const unsigned char *end = p + len;
+	while (p < end)
+	{
+		const unsigned char *run = p;
+		while (p < end && *p >= 0x20 && *p < 0x80 && *p != '"' && *p != '\\')
+			p++;
+		if (p > run)
+			out.append((const char *) run, p - run);
+		if (p >= end)
+			break;
+
+		unsigned char c = *p;
+		if (c < 0x80)
+		{
+			switch (c)
+			{
+			case '"':	out.append("\\\"", 2); break;
+			case '\\':	out.append("\\\\", 2); break;
+			case '\n':	out.append("\\n", 2); break;
+			case '\r':	out.append("\\r", 2); break;
+			case '\t':	out.append("\\t", 2); break;
+			case '\b':	out.append("\\b", 2); break;
+			case '\f':	out.append("\\f", 2); break;
+			default:
+				out.append("\\u00", 4);
+				out.push_back(hex[c >> 4]);
+				out.push_back(hex[c & 0xF]);
+				break;
+			}
+			p++;
+			continue;
+		}
+
+		unsigned int cp;
+		size_t n = Utils::Utf8Decode(p, end, cp);
+		if (n)
+		{
+			out.append((const char *) p, n);
+			p += n;
+			continue;
+		}
+
+		bad++;
+		if (latin1)
+		{
+			out.push_back((char) (0xC0 | (c >> 6)));
+			out.push_back((char) (0x80 | (c & 0x3F)));
+		}
+		else
+		{
+			out.append("\xEF\xBF\xBD", 3);
+		}
+		p++;
+	}
+	out.push_back('"');
+	return bad;
+}
+
+void P4NdjsonWriter::BeginRecord(std::string &out)
+{
+	out.clear();
+	out.push_back('{');
+}
+
+void P4NdjsonWriter::AddField(std::string &out, const StrPtr &key, const StrPtr &val)
+{
+	bool latin1 = (flags & NDJSON_LATIN1) != 0;
+	if (out.size() > 1)
+		out.push_back(',');
+	int bad = AppendString(out, key.Text(), key.Length(), latin1);
+	out.push_back(':');
+	bad += AppendString(out, val.Text(), val.Length(), latin1);
+	if (bad)
+		invalid += bad;
+}
+
+void P4NdjsonWriter::EndRecord(std::string &out)
+{
+	out.append("}\n", 2);
+}
+
+bool P4NdjsonWriter::Write(const std::string &record)
+{
+	std::lock_guard<std::mutex> guard(writeMutex);
+	bool ok = !closed &&
+		(useRing ? WriteRing(record.data(), record.size()) : WriteHandle(record.data(), record.size()));
+	if (ok)
+	{
+		records++;
+		bytes += record.size();
+	}
+	else
+	{
+		dropped++;
+	}
+	return ok;
+}
+
+/*******************************************************************************
+ *
+ *  File descriptor output
+ *
+ ******************************************************************************/
+
+static bool WriteAll(long long handle, const char *data, size_t len)
+{
+	while (len > 0)
+	{
+#ifdef OS_NT
+		DWORD chunk = (len > 0x40000000) ? 0x40000000 : (DWORD) len;
+		DWORD done = 0;
+		if (!WriteFile((HANDLE) (intptr_t) handle, data, chunk, &done, NULL) || done == 0)
+			return false;
+#else
+		ssize_t done = write((int) handle, data, len);
+		if (done < 0 && errno == EINTR)
+			continue;
+		if (done <= 0)
+			return false;
+#endif
+		data += done;
+		len -= done;
+	}
+	return true;
+}
+
+bool P4NdjsonWriter::WriteHandle(const char *data, size_t len)
+{
+	if (failed)
+		return false;
+	buffer.append(data, len);
+	if (buffer.size() >= NDJSON_BUFFER)
+	{
+		failed = !WriteAll(handle, buffer.data(), buffer.size());
+		buffer.clear();
+	}
+	return !failed;
+}
+
+bool P4NdjsonWriter::Flush()
+{
+	std::lock_guard<std::mutex> guard(writeMutex);
+	if (useRing || buffer.empty())
+		return !failed;
+	if (!failed)
+		failed = !WriteAll(handle, buffer.data(), buffer.size());
+	buffer.clear();
+	return !failed;
+}
+
+/*******************************************************************************
+ *
+ *  Ring output
+ *
+ *  A record that does not fit waits for the reader, so a slow consumer slows
+ *   the command down instead of the output piling up in memory. The ring must
+ *   be read from another thread while a command runs.
+ *
+ ******************************************************************************/
+
+bool P4NdjsonWriter::WriteRing(const char *data, size_t len)
+{
+	std::unique_lock<std::mutex> lock(ringMutex);
+	while (len > 0)
+	{
+		ringCv.wait(lock, [this]() { return closed || ringCount < ring.size(); });
+		if (closed)
+			return false;
+
+		size_t tail = (ringHead + ringCount) % ring.size();
+		size_t chunk = std::min(len, std::min(ring.size() - ringCount, ring.size() - tail));
+		memcpy(&ring[tail], data, chunk);
+		ringCount += chunk;
+		data += chunk;
+		len -= chunk;
+		ringCv.notify_all();
+	}
+	return true;
+}
+
+int P4NdjsonWriter::Read(char *out, int size, int timeoutMs)
+{
+	if (!useRing)
+		return -1;
+	if (!out || size <= 0)
+		return 0;
+
+	std::unique_lock<std::mutex> lock(ringMutex);
+	auto ready = [this]() { return closed || ringCount > 0; };
+	if (timeoutMs < 0)
+		ringCv.wait(lock, ready);
+	else if (!ringCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready))
+		return 0;
+
+	if (ringCount == 0)
+		return -1;
+
+	size_t copied = 0;
+	while (copied < (size_t) size && ringCount > 0)
+	{
+		size_t chunk = std::min((size_t) size - copied, std::min(ringCount, ring.size() - ringHead));
+		memcpy(out + copied, &ring[ringHead], chunk);
+		ringHead = (ringHead + chunk) % ring.size();
+		ringCount -= chunk;
+		copied += chunk;
+	}
+	ringCv.notify_all();
+	return (int) copied;
+}
+
+void P4NdjsonWriter::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		closed = true;
+	}
+	ringCv.notify_all();
+	Flush();
+}
+
+void P4NdjsonWriter::GetCounts(long long *nRecords, long long *nBytes, long long *nInvalid, long long *nDropped)
+{
+	if (nRecords) *nRecords = records;
+	if (nBytes) *nBytes = bytes;
+	if (nInvalid) *nInvalid = invalid;
+	if (nDropped) *nDropped = dropped;
+}
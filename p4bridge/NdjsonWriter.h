@@ -0,0 +1,128 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: NdjsonWriter.h
+ *
+ * Description	:  P4NdjsonWriter writes the tagged output of the commands
+ *  run on the servers it is attached to as newline delimited JSON, one
+ *  object per record, straight from OutputStat. The output goes to a file
+ *  descriptor (a HANDLE on Windows) owned by the caller, or to a ring buffer
+ *  the caller drains with Read(), so no field is marshaled one at a time.
+ *
+ *  Keys and values are escaped for JSON and checked to be UTF-8. Invalid
+ *  sequences are replaced with U+FFFD, or with NDJSON_LATIN1 each invalid
+ *  byte is read as a Latin-1 character so nothing is lost.
+ *
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "ServerLink.h"
+
+class P4BridgeServer;
+
+// Flags for P4NdjsonWriter
+#define NDJSON_KEEP_RESULTS	0x01	// still keep the tagged output in the client
+#define NDJSON_LATIN1		0x02	// invalid UTF-8 bytes are Latin-1, not replaced
+
+class P4NdjsonWriter : public p4base
+{
+public:
+	// Write to a file descriptor, or a HANDLE on Windows, left open
+	P4NdjsonWriter(long long handle, int flags);
+	// Write to a ring of ringBytes bytes, read with Read()
+	P4NdjsonWriter(int ringBytes, int flags);
+	virtual ~P4NdjsonWriter();
+
+	virtual int Type(void) { return tP4NdjsonWriter; }
+
+	int Flags() { return flags; }
+
+	// Build a record: {"key":"value",...} and a newline
+	void BeginRecord(std::string &out);
+	void AddField(std::string &out, const StrPtr &key, const StrPtr &val);
+	void EndRecord(std::string &out);
+
+	// Write a complete record. Records written from several threads are not
+	//  mixed. Waits for the reader when the ring is full.
+	bool Write(const std::string &record);
+
+	// Write out what is buffered for a file descriptor
+	bool Flush();
+
+	// Ring only: copy up to size bytes, waiting up to timeoutMs (-1 for ever)
+	//  for some. Returns the bytes copied, 0 on timeout, -1 once the writer
+	//  is closed and everything has been read.
+	int Read(char *buffer, int size, int timeoutMs);
+
+	// No more records. Wakes a waiting reader or writer, later records are
+	//  dropped.
+	void Close();
+
+	void GetCounts(long long *records, long long *bytes, long long *invalid, long long *dropped);
+
+	// Servers writing to this, they are detached when it is deleted
+	std::shared_ptr<ServerLink> GetLink() { return link; }
+
+	// Append s as a JSON string, returns the number of invalid UTF-8
+	//  sequences found
+	static int AppendString(std::string &out, const char *s, size_t len, bool latin1);
+
+private:
+	bool WriteHandle(const char *data, size_t len);
+	bool WriteRing(const char *data, size_t len);
+
+	int flags;
+	bool useRing;
+	long long handle;
+
+	// serializes whole records
+	std::mutex writeMutex;
+	std::string buffer;
+	bool failed;
+
+	// ring state
+	std::mutex ringMutex;
+	std::condition_variable ringCv;
+	std::vector<char> ring;
+	size_t ringHead;
+	size_t ringCount;
+	std::atomic<bool> closed;
+
+	std::atomic<long long> records;
+	std::atomic<long long> bytes;
+	std::atomic<long long> invalid;
+	std::atomic<long long> dropped;
+
+	std::shared_ptr<ServerLink> link;
+};
@@ -42,14 +42,52 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "P4BridgeClient.h"
 #include "P4BridgeServer.h"
 #include "P4Connection.h"
+#include "FileIndex.h"
+#include "NdjsonWriter.h"
+#include "ResultSpill.h"
+#include "ResultSet.h"
+#include "CallRecorder.h"
+#include "ResultCache.h"
+
 #include <strtable.h>
 #include <strarray.h>
 
+#include <climits>
+
+#define DELETE_OBJECT(obj) if( obj != NULL ) { delete obj; obj = NULL; }
+#define DELETE_ARRAY(obj)  if( obj != NULL ) { delete[] obj; obj = NULL; }
+
+// A per connection pool is started over once it holds this much
+#define TAGGED_POOL_MAX_BYTES (32 * 1024 * 1024)
+
+// Rough cost of holding tagged output in memory, used to decide when to
+//  spill it
+#define TAGGED_ITEM_OVERHEAD 64
+#define TAGGED_FIELD_OVERHEAD 32
+
+// Input data read from a callback starts with chunks of INPUT_CHUNK_MIN bytes,
+//  doubling up to INPUT_CHUNK_MAX
+#define INPUT_CHUNK_MIN (64 * 1024)
+#define INPUT_CHUNK_MAX (4 * 1024 * 1024)
+
 #include <diff.h>
 
 class DiffObj : public Diff
 {};
 
+// Marks the connection active when a handler starts and again when it
+//  returns, so the time spent in the callbacks does not count against the
+//  inactivity timeout
+class ActivityGuard
+{
+public:
+	ActivityGuard(P4Connection * con) : pCon(con) { if (pCon) pCon->Touch(); }
+	~ActivityGuard() { if (pCon) pCon->Touch(); }
+
+private:
+	P4Connection * pCon;
+};
+
 /*******************************************************************************
  *
  *  P4BridgeClient
@@ -73,7 +111,8 @@ class DiffObj : public Diff
  ******************************************************************************/
 
 P4BridgeClient::P4BridgeClient(P4BridgeServer* pserver, P4Connection* pcon)
-	: p4base(Type())
+	: p4base(Type()),
+	progressTotals(this)
 {
 	pCon = pcon;
 	pFirstError = NULL;
@@ -87,7 +126,36 @@ P4BridgeClient::P4BridgeClient(P4BridgeServer* pserver, P4Connection* pcon)
 	results_dictionary_tail = NULL;
 	results_dictionary_count = 0;
 
+	internMode = TAGGED_INTERN_PER_COMMAND;
+
+	spillThreshold = 0;
+	retainedBytes = 0;
+	spilling = false;
+	spillFailed = false;
+	spilledItems = 0;
+	pTextSpill = NULL;
+	pBinarySpill = NULL;
+	pTaggedSpill = NULL;
+
 	data_set = NULL;
+	data_buffer = NULL;
+	data_buffer_length = 0;
+	pInputDataCallbackFn = NULL;
+
+	pProjection = NULL;
+	pFileIndex = NULL;
+	fileIndexKind = 0;
+
+	pNdjson = NULL;
+	streamedItems = 0;
+
+	pRecorder = NULL;
+	replayUnicode = -1;
+	pCapture = NULL;
+
+	diffMode = DIFF_OUTPUT_TEXT;
+
+	pResolvePolicy = NULL;
 
 	objId = 0;
 
@@ -121,8 +189,17 @@ P4BridgeClient::~P4BridgeClient(void)
  *
  ******************************************************************************/
 
+int P4BridgeClient::UnicodeMessages()
+{
+	return (replayUnicode >= 0) ? replayUnicode : pServer->unicodeServer();
+}
+
 void P4BridgeClient::Message( Error *err )
 {
+	ActivityGuard activity(pCon);
+
+	if (pRecorder) pRecorder->Message( err, UnicodeMessages() != 0 );
+
 	if (err->GetSeverity() >= E_WARN)
 	{
 		// This is an error
@@ -141,7 +218,7 @@ void P4BridgeClient::Message( Error *err )
 		// Grab the  text
 		StrBuf buf;
 
-		if( pServer->unicodeServer())
+		if( UnicodeMessages() )
 			err->Fmt( buf, EF_PLAIN );
 		else
 			err->Fmt( buf, EF_PLAIN | EF_NOXLATE );
@@ -178,14 +255,25 @@ void P4BridgeClient::CallTextResultsCallbackFn(const char *data)
 
 void P4BridgeClient::OutputText( const char *data, int length )
 {
-	CallTextResultsCallbackFn( data );
+	ActivityGuard activity(pCon);
 
+	CallTextResultsCallbackFn( data );
 
 	// length might not have been sent for null terminated string
 	if (data && (length < 0)) 
-		text_results.Append( data );
-	else
-		text_results.Append( data, length );
+		length = (int) strlen( data );
+
+	if (pRecorder && data) pRecorder->OutputText( data, length );
+	if (pCapture) pCapture->Text( data, length );
+
+	if (spilling)
+	{
+		SpillAppend( pTextSpill, data, length );
+		return;
+	}
+
+	text_results.Append( data, length );
+	CountRetained( length );
 }
 
 /*******************************************************************************
@@ -239,28 +327,58 @@ void P4BridgeClient::CallTaggedOutputCallbackFn( int objId, const char *pKey, co
 
 void P4BridgeClient::OutputStat( StrDict *dict )
 {
-	StrDictList * pNew = new StrDictList();
+	ActivityGuard activity(pCon);
+
+	if (pRecorder) pRecorder->OutputStat( dict );
+	if (pCapture) pCapture->Tagged( dict );
+
+	// the index sees every field, whatever the projection
+	if (pFileIndex) pFileIndex->Update(fileIndexKind, dict);
 
-	if( results_dictionary_head == NULL )
+	StrDictList * pNew = NULL;
+	SpillRecord record;
+
+	// records streamed as NDJSON are only stored if the writer asks for it
+	bool keep = (pNdjson == NULL) || ((pNdjson->Flags() & NDJSON_KEEP_RESULTS) != 0);
+	if (pNdjson) pNdjson->BeginRecord(ndjsonRecord);
+
+	if( results_dictionary_head == NULL && spilledItems == 0 && streamedItems == 0 )
 	{
-		// first item, so set as head and tail
-		results_dictionary_head = pNew;
-		results_dictionary_tail = pNew;
-		// set the object id
+		// first item, set the object id
 		objId = 0;
 		results_dictionary_count = 0;
 	}
 	else
 	{
-		// add item to tail item and move tail pointer
-		results_dictionary_tail->Next(pNew);
-		results_dictionary_tail = pNew;
-
 		objId++;
 
 		results_dictionary_count++;
 	}
 
+	if (!keep)
+	{
+		streamedItems++;
+	}
+	else if (!spilling)
+	{
+		pNew = (internMode != TAGGED_INTERN_OFF) ?
+			new StrDictList(&taggedStrings) : new StrDictList();
+
+		if( results_dictionary_head == NULL )
+		{
+			// first item, so set as head and tail
+			results_dictionary_head = pNew;
+			results_dictionary_tail = pNew;
+		}
+		else
+		{
+			// add item to tail item and move tail pointer
+			results_dictionary_tail->Next(pNew);
+			results_dictionary_tail = pNew;
+		}
+	}
+	long long bytes = TAGGED_ITEM_OVERHEAD;
+
 	StrRef var, val;
 	for( int i = 0; dict->GetVar( i, var, val ); i++ )
 	{
@@ -269,6 +387,10 @@ void P4BridgeClient::OutputStat( StrDict *dict )
 		if (strcmp(key, "spec") == 0 || strcmp(key, "specFormatted") == 0 || strcmp(key, "func") == 0)
 			continue;
 
+		// skip fields outside of the projection, if one is set
+		if (pProjection && pProjection->find(key) == pProjection->end())
+			continue;
+
 		char * pVal = new char[val.Length() + 2];
 		memcpy((void*)pVal, (void*) val.Text(), val.Length());
 		pVal[val.Length()] = '\0';
@@ -276,7 +398,34 @@ void P4BridgeClient::OutputStat( StrDict *dict )
 		pServer->CallTaggedOutputCallbackFn( pCon->getId(), objId, var.Text(), pVal );
 		delete[] pVal;
 
-		pNew->Data()->SetVar( var, val );
+		if (pNdjson) pNdjson->AddField( ndjsonRecord, var, val );
+
+		if (pNew)
+		{
+			pNew->Data()->SetVar( var, val );
+			bytes += var.Length() + val.Length() + TAGGED_FIELD_OVERHEAD;
+		}
+		else if (keep)
+		{
+			record.Add( var, val );
+		}
+	}
+
+	if (pNdjson)
+	{
+		pNdjson->EndRecord( ndjsonRecord );
+		pNdjson->Write( ndjsonRecord );
+	}
+
+	if (pNew)
+	{
+		CountRetained( bytes );
+	}
+	else if (keep && OpenSpill( pTaggedSpill ))
+	{
+		if (!record.WriteTo( pTaggedSpill ))
+			SpillFailed();
+		spilledItems++;
 	}
 	// flag the end of the object
 	CallTaggedOutputCallbackFn( objId, NULL, NULL );
@@ -349,6 +498,8 @@ void P4BridgeClient::HandleError( P4ClientError * pNewError )
 {
 	LOG_DEBUG(4, pNewError->Message.c_str());
 
+	if (pCapture) pCapture->Reject();
+
 	if( !pFirstError )
 	{
 		// first error so use it to start the list
@@ -384,6 +535,7 @@ void P4BridgeClient::HandleInfoMsg( int msgCode, char level, const char *infMsg
 
 void P4BridgeClient::HandleInfoMsg( P4ClientInfoMsg * pNewMsg )
 {
+	if (pCapture) pCapture->Info( pNewMsg->MsgCode, pNewMsg->Level, pNewMsg->Message.c_str() );
 
 	if( !pFirstInfo )
 	{
@@ -423,6 +575,7 @@ void P4BridgeClient::HandleUrl(const StrPtr* url)
 void P4BridgeClient::OutputError( const char *err )// For broken servers
 {
 	LOG_ENTRY();
+	if (pRecorder) pRecorder->OutputError( err );
 	HandleError( -1, 0, err );
 }
 
@@ -440,6 +593,9 @@ void P4BridgeClient::Diff( FileSys *f1, FileSys *f2, int doPage,
 		return;
 	}
 
+	if ( diffMode != DIFF_OUTPUT_TEXT && DiffInMemory( f1, f2, diffFlags, e ) )
+		return;
+
 	// Time to diff the two text files. Need to ensure that the
 	// files are in binary mode, so we have to create new FileSys
 	// objects to do this.
@@ -484,6 +640,103 @@ void P4BridgeClient::Diff( FileSys *f1, FileSys *f2, int doPage,
 	if ( e->Test() ) HandleError( e );
 }
 
+/*******************************************************************************
+ *
+ *  DiffInMemory
+ *
+ *  Diff two text files without a temporary file. The output is either sent
+ *      a hunk at a time through OutputText, with the same line endings as
+ *      the temporary file path, or kept as DiffHunk records.
+ *
+ ******************************************************************************/
+
+bool P4BridgeClient::DiffInMemory( FileSys *f1, FileSys *f2, char *diffFlags, Error *e )
+{
+	DiffCapture capture;
+	FILE *out = capture.Open();
+	if (!out)
+		return false;
+
+	FileSys *f1_bin = FileSys::Create( FST_BINARY );
+	FileSys *f2_bin = FileSys::Create( FST_BINARY );
+
+	f1_bin->Set( f1->Name() );
+	f2_bin->Set( f2->Name() );
+
+	{
+		DiffObj d;
+
+		d.SetInput( f1_bin, f2_bin, diffFlags, e );
+		if ( ! e->Test() ) d.SetOutput( out );
+		if ( ! e->Test() ) d.DiffWithFlags( diffFlags );
+
+		// the FILE belongs to the capture, it is closed by Finish()
+	}
+	capture.Finish();
+
+	delete f1_bin;
+	delete f2_bin;
+
+	if ( e->Test() )
+	{
+		HandleError( e );
+		return true;
+	}
+
+	const std::string &text = capture.Text();
+	int file = (int) diffFiles.size();
+	diffFiles.push_back( f2->Name() );
+
+	if (diffMode == DIFF_OUTPUT_STRUCTURED)
+	{
+		DiffCapture::Split( text.data(), text.size(), file, (long long) diffText.size(), diffHunks );
+		diffText.append( text );
+		return true;
+	}
+
+	vector<DiffHunk> hunks;
+	DiffCapture::Split( text.data(), text.size(), file, 0, hunks );
+
+	StrBuf b;
+	for (size_t i = 0; i < hunks.size(); i++)
+	{
+		const char *p = text.data() + hunks[i].textOffset;
+		const char *end = p + hunks[i].textLength;
+
+		// lines end in \r\n, as when they are read back from the temp file
+		b.Clear();
+		while (p < end)
+		{
+			const char *eol = (const char *) memchr( p, '\n', end - p );
+			const char *lineEnd = eol ? eol : end;
+			if (lineEnd > p && lineEnd[-1] == '\r')
+				lineEnd--;
+			b.Append( p, (int) (lineEnd - p) );
+			b.Append( "\r\n" );
+			p = eol ? eol + 1 : end;
+		}
+		OutputText( b.Text(), b.Length() );
+	}
+	return true;
+}
+
+const DiffHunk* P4BridgeClient::GetDiffHunks(int* count)
+{
+	if (count) *count = (int) diffHunks.size();
+	return diffHunks.empty() ? NULL : diffHunks.data();
+}
+
+const char* P4BridgeClient::GetDiffText(long long* length)
+{
+	if (length) *length = (long long) diffText.size();
+	return diffText.empty() ? NULL : diffText.c_str();
+}
+
+const char* P4BridgeClient::GetDiffFile(int idx)
+{
+	return ((idx >= 0) && (idx < (int) diffFiles.size())) ? diffFiles[idx].c_str() : NULL;
+}
+
 
 /*******************************************************************************
  *
@@ -498,6 +751,41 @@ void P4BridgeClient::CallBinaryResultsCallbackFn(void * data, int length )
 	pServer->CallBinaryResultsCallbackFn( pCon->getId(), data,  length );
 }
 
+/*******************************************************************************
+ *
+ *  CallProgressCallbackFn
+ *
+ *  Simple wrapper to call the callback function (if it has been set)
+ *
+ ******************************************************************************/
+
+int P4BridgeClient::CallProgressCallbackFn( const ProgressInfo &info )
+{
+	return pServer->CallProgressCallbackFn( pCon->getId(), &info );
+}
+
+/*******************************************************************************
+ *
+ *  CreateProgress
+ *
+ *  The p4api deletes the progress when it is done with it. Without a
+ *   progress callback there is nothing to report, so none is created and the
+ *   api does no progress work at all.
+ *
+ ******************************************************************************/
+
+ClientProgress *P4BridgeClient::CreateProgress( int type )
+{
+	if (!pServer->GetProgressCallbackFn())
+		return NULL;
+	return new P4BridgeProgress(&progressTotals, type, pServer->GetProgressInterval());
+}
+
+int P4BridgeClient::ProgressIndicator()
+{
+	return pServer->GetProgressCallbackFn() ? 1 : 0;
+}
+
 /*******************************************************************************
  *
  *  OutputBinary
@@ -510,9 +798,21 @@ void P4BridgeClient::CallBinaryResultsCallbackFn(void * data, int length )
 
 void P4BridgeClient::OutputBinary( const char *data, int length )
 {
+	ActivityGuard activity(pCon);
+
+	if (pRecorder) pRecorder->OutputBinary( data, length );
+	if (pCapture) pCapture->Reject();
+
 	CallBinaryResultsCallbackFn((void *) data, length );
 
+	if (spilling)
+	{
+		SpillAppend( pBinarySpill, data, length );
+		return;
+	}
+
 	Binary_results.insert(Binary_results.end(), data, data + length);
+	CountRetained( length );
 }
 
 /*******************************************************************************
@@ -561,6 +861,108 @@ P4ClientInfoMsg * P4BridgeClient::GetInfoResults()
 	return pFirstInfo;
 }
 
+// Append UTF-8 text to the pool as UTF-16, returns the number of 16 bit
+//  units added. Bytes that are not valid UTF-8 become U+FFFD.
+static int AppendUtf16(vector<char> &pool, const std::string &text)
+{
+	const unsigned char *p = (const unsigned char *) text.data();
+	const unsigned char *end = p + text.length();
+	int units = 0;
+	while (p < end)
+	{
+		unsigned int cp = *p;
+		size_t n = 1;
+		if (cp >= 0x80)
+		{
+			n = Utils::Utf8Decode(p, end, cp);
+			if (!n)
+			{
+				cp = 0xFFFD;
+				n = 1;
+			}
+		}
+		p += n;
+
+		unsigned short u[2];
+		int count = 1;
+		if (cp >= 0x10000)
+		{
+			cp -= 0x10000;
+			u[0] = (unsigned short) (0xD800 | (cp >> 10));
+			u[1] = (unsigned short) (0xDC00 | (cp & 0x3FF));
+			count = 2;
+		}
+		else
+		{
+			u[0] = (unsigned short) cp;
+		}
+		pool.insert(pool.end(), (const char *) u, (const char *) (u + count));
+		units += count;
+	}
+	return units;
+}
+
+/*******************************************************************************
+ *
+ *  PackMessages
+ *
+ *  Collect the info or error output in one crossing, instead of one call
+ *   per field per message walking the linked list.
+ *
+ ******************************************************************************/
+
+const PackedMessage* P4BridgeClient::PackMessages(int which, bool utf16, int* count,
+	const char** pool, int* poolSize)
+{
+	packedMessages.clear();
+	packedPool.clear();
+
+	PackedMessage msg;
+	if (which == PACKED_ERRORS)
+	{
+		for (P4ClientError *err = pFirstError; err; err = err->Next)
+		{
+			msg.code = err->ErrorCode;
+			msg.level = err->Severity;
+			msg.offset = (int) (utf16 ? packedPool.size() / 2 : packedPool.size());
+			if (utf16)
+			{
+				msg.length = AppendUtf16(packedPool, err->Message);
+			}
+			else
+			{
+				packedPool.insert(packedPool.end(), err->Message.begin(), err->Message.end());
+				msg.length = (int) err->Message.length();
+			}
+			packedMessages.push_back(msg);
+		}
+	}
+	else
+	{
+		for (P4ClientInfoMsg *info = pFirstInfo; info; info = info->Next)
+		{
+			msg.code = info->MsgCode;
+			msg.level = info->Level;
+			msg.offset = (int) (utf16 ? packedPool.size() / 2 : packedPool.size());
+			if (utf16)
+			{
+				msg.length = AppendUtf16(packedPool, info->Message);
+			}
+			else
+			{
+				packedPool.insert(packedPool.end(), info->Message.begin(), info->Message.end());
+				msg.length = (int) info->Message.length();
+			}
+			packedMessages.push_back(msg);
+		}
+	}
+
+	if (count) *count = (int) packedMessages.size();
+	if (pool) *pool = packedPool.empty() ? NULL : packedPool.data();
+	if (poolSize) *poolSize = (int) packedPool.size();
+	return packedMessages.empty() ? NULL : packedMessages.data();
+}
+
 /*******************************************************************************
  *
  *  GetTextResults
@@ -573,9 +975,18 @@ P4ClientInfoMsg * P4BridgeClient::GetInfoResults()
 
 const char* P4BridgeClient::GetTextResults()
 {
+	if (pTextSpill)
+		return pTextSpill->Map(true);
 	return text_results.Text();
 }
 
+size_t P4BridgeClient::GetTextResultsLength()
+{
+	if (pTextSpill)
+		return (size_t) pTextSpill->Size();
+	return (size_t) text_results.Length();
+}
+
 /*******************************************************************************
  *
  *  GetTaggedOutput
@@ -593,6 +1004,10 @@ StrDictListIterator* P4BridgeClient::GetTaggedOutput()
 	{
 		return new StrDictListIterator(results_dictionary_head);
 	}
+	if (pTaggedSpill && pTaggedSpill->Size() > 0)
+	{
+		return new StrDictListIterator(pTaggedSpill);
+	}
 	return NULL;
 }
 
@@ -608,9 +1023,141 @@ StrDictListIterator* P4BridgeClient::GetTaggedOutput()
 
 const unsigned char* P4BridgeClient::GetBinaryResults()
 {
+	if (pBinarySpill)
+		return (const unsigned char*) pBinarySpill->Map();
 	return Binary_results.data();
 }
 
+size_t P4BridgeClient::GetBinaryResultsCount()
+{
+	if (pBinarySpill)
+		return (size_t) pBinarySpill->Size();
+	return Binary_results.size();
+}
+
+/*******************************************************************************
+ *
+ *  SetSpill
+ *
+ *  Set when the results of a command are moved out of memory. See Spill().
+ *
+ ******************************************************************************/
+
+void P4BridgeClient::SetSpill(long long thresholdBytes, const char* dir)
+{
+	spillThreshold = (thresholdBytes > 0) ? thresholdBytes : 0;
+	spillDir = dir ? dir : "";
+}
+
+void P4BridgeClient::CountRetained(long long bytes)
+{
+	retainedBytes += bytes;
+	if ((spillThreshold > 0) && !spillFailed && (retainedBytes > spillThreshold))
+	{
+		Spill();
+	}
+}
+
+/*******************************************************************************
+ *
+ *  Spill
+ *
+ *  Move the text, binary and tagged output collected so far to temporary 
+ *      files and free the memory it used. Output for the rest of the command 
+ *      is appended to the files, and the Get*Results functions read it back 
+ *      through a memory mapping. If the files can not be written the results
+ *      stay in memory.
+ *
+ ******************************************************************************/
+
+void P4BridgeClient::Spill()
+{
+	LOG_ENTRY();
+	bool ok = true;
+
+	if (ok && text_results.Length() > 0)
+		ok = SpillAppend( pTextSpill, text_results.Text(), text_results.Length() );
+
+	if (ok && !Binary_results.empty())
+		ok = SpillAppend( pBinarySpill, Binary_results.data(), Binary_results.size() );
+
+	int items = 0;
+	for (StrDictList* pItem = results_dictionary_head; ok && pItem; pItem = pItem->Next())
+	{
+		SpillRecord record;
+		StrRef var, val;
+		for (int i = 0; pItem->Data()->GetVar( i, var, val ); i++)
+		{
+			record.Add( var, val );
+		}
+		ok = OpenSpill( pTaggedSpill ) && record.WriteTo( pTaggedSpill );
+		items++;
+	}
+
+	if (!ok)
+	{
+		LOG_ERROR("Could not spill the command results, keeping them in memory");
+		DeleteSpill();
+		spillFailed = true;
+		return;
+	}
+
+	text_results.Reset();
+	vector<unsigned char>().swap(Binary_results);
+	DELETE_OBJECT( results_dictionary_head )
+	results_dictionary_tail = NULL;
+	spilledItems = items;
+	spilling = true;
+
+	// the records in memory were the only users of the pooled strings
+	if (internMode != TAGGED_INTERN_PER_CONNECTION)
+		taggedStrings.Clear();
+}
+
+bool P4BridgeClient::OpenSpill(SpillFile*& pFile)
+{
+	if (pFile)
+		return true;
+
+	pFile = new SpillFile();
+	if (!pFile->Open(spillDir))
+	{
+		DELETE_OBJECT( pFile )
+		SpillFailed();
+		return false;
+	}
+	return true;
+}
+
+bool P4BridgeClient::SpillAppend(SpillFile*& pFile, const void* data, size_t len)
+{
+	if (!OpenSpill( pFile ))
+		return false;
+	if (!pFile->Append(data, len))
+	{
+		SpillFailed();
+		return false;
+	}
+	return true;
+}
+
+void P4BridgeClient::SpillFailed()
+{
+	// once spilling there is nowhere else for the output to go
+	if (spilling && !spillFailed)
+	{
+		HandleError( E_FAILED, 0, "Could not write the command results to the spill file, the results are incomplete" );
+	}
+	spillFailed = true;
+}
+
+void P4BridgeClient::DeleteSpill()
+{
+	DELETE_OBJECT( pTextSpill )
+	DELETE_OBJECT( pBinarySpill )
+	DELETE_OBJECT( pTaggedSpill )
+}
+
 /*******************************************************************************
  *
  *  SetDataSet
@@ -640,11 +1187,43 @@ StrPtr * P4BridgeClient::GetDataSet( void )
 	 return data_set;
 }
 
+/*******************************************************************************
+ *
+ *  SetDataSetBuffer
+ *
+ *  Use a native buffer as the Input Data of the next command. Nothing is
+ *      copied until the API asks for the data.
+ *
+ ******************************************************************************/
+
+bool P4BridgeClient::SetDataSetBuffer(const char * data, long long length)
+{
+	// a StrBuf holds at most INT_MAX bytes, the command must not go on to
+	//  read an earlier source instead
+	if (length < 0 || length >= INT_MAX)
+	{
+		ClearInputSource();
+		return false;
+	}
+	data_buffer = data;
+	data_buffer_length = data ? length : 0;
+	return true;
+}
+
+void P4BridgeClient::ClearInputSource()
+{
+	data_buffer = NULL;
+	data_buffer_length = 0;
+	pInputDataCallbackFn = NULL;
+}
+
 
 void P4BridgeClient::Prompt( const StrPtr &msg, StrBuf &rsp, 
 				int noEcho, Error *e )
 {
+	ActivityGuard activity(pCon);
 	pServer->Prompt(pCon->getId(), msg, rsp, noEcho, e);
+	if (pRecorder) pRecorder->Prompt( msg, rsp, noEcho );
 }
 
 /*******************************************************************************
@@ -659,8 +1238,43 @@ void P4BridgeClient::Prompt( const StrPtr &msg, StrBuf &rsp,
 void P4BridgeClient::InputData( StrBuf *buf, Error *err )
 {
 	buf->Clear();
-	if (data_set)
+	if (pInputDataCallbackFn)
+	{
+		// the callback writes straight into the API buffer, the chunks grow
+		//  so hundreds of MB do not take thousands of calls
+		int chunk = INPUT_CHUNK_MIN;
+		for (;;)
+		{
+			int used = buf->Length();
+			if (chunk > INT_MAX - 1 - used)
+				chunk = INT_MAX - 1 - used;
+			if (chunk <= 0)
+			{
+				err->Set( E_FAILED, "Input data is too large" );
+				break;
+			}
+
+			char *p = buf->Alloc( chunk );
+			int n = pServer->CallInputDataCallbackFn( pInputDataCallbackFn, pCon->getId(), p, chunk );
+			buf->SetLength( used + ((n > 0) ? ((n < chunk) ? n : chunk) : 0) );
+			if (n <= 0)
+			{
+				if (n < 0)
+					err->Set( E_FAILED, "Input data callback failed" );
+				break;
+			}
+			if (chunk < INPUT_CHUNK_MAX)
+				chunk *= 2;
+		}
+	}
+	else if (data_buffer)
+	{
+		buf->Set( data_buffer, (int) data_buffer_length );
+	}
+	else if (data_set)
+	{
 		buf->Set( data_set );
+	}
 	buf->Terminate();
 }
 
@@ -672,8 +1286,6 @@ void P4BridgeClient::InputData( StrBuf *buf, Error *err )
  *
  ******************************************************************************/
 
-#define DELETE_OBJECT(obj) if( obj != NULL ) { delete obj; obj = NULL; }
-#define DELETE_ARRAY(obj)  if( obj != NULL ) { delete[] obj; obj = NULL; }
 
 void P4BridgeClient::clear_results()
 {
@@ -692,16 +1304,269 @@ void P4BridgeClient::clear_results()
 	results_dictionary_tail = NULL;
 	text_results.Reset();
 	Binary_results.clear();
+
+	DeleteSpill();
+	spilling = false;
+	spillFailed = false;
+	spilledItems = 0;
+	streamedItems = 0;
+	retainedBytes = 0;
+
+	// nothing refers to the pooled strings once the list is gone
+	if ((internMode != TAGGED_INTERN_PER_CONNECTION) ||
+		(taggedStrings.Bytes() > TAGGED_POOL_MAX_BYTES))
+	{
+		taggedStrings.Clear();
+	}
+	taggedIds.clear();
+	taggedColumn.clear();
+	taggedStringTable.clear();
+	vector<char>().swap(serializedResults);
+
+	std::string().swap(diffText);
+	vector<DiffHunk>().swap(diffHunks);
+	diffFiles.clear();
+
+	resolveSummary.clear();
+	resolvePaths.clear();
+	resolveTypes.clear();
+
+	vector<PackedMessage>().swap(packedMessages);
+	vector<char>().swap(packedPool);
+
+	progressTotals.Reset();
+}
+
+/*******************************************************************************
+ *
+ *  Serialize
+ *
+ *  Serialize the results into a buffer held by the client, valid until the
+ *      next call or command.
+ *
+ ******************************************************************************/
+
+const char* P4BridgeClient::Serialize(long long* length)
+{
+	P4ResultSet::Serialize(this, serializedResults);
+	if (length) *length = (long long) serializedResults.size();
+	return serializedResults.data();
+}
+
+/*******************************************************************************
+ *
+ *  GetTaggedOutputIds
+ *
+ *  The interned tagged output flattened into one array so it can be read in
+ *      a single call. Each item is its field count followed by a key id and
+ *      value id per field, the strings are in GetTaggedStrings().
+ *
+ ******************************************************************************/
+
+bool P4BridgeClient::ReadSpilledIds(vector<int>& ids)
+{
+	ids.clear();
+	if (internMode == TAGGED_INTERN_OFF)
+		return false;
+	if (!pTaggedSpill)
+		return true;
+
+	const char* base = pTaggedSpill->Map();
+	size_t size = (size_t) pTaggedSpill->Size();
+	if (!base)
+		return false;
+
+	// nothing else is in the pool unless it is kept for the connection, so
+	//  each read interns the records from scratch and gets the same ids
+	if (internMode != TAGGED_INTERN_PER_CONNECTION)
+		taggedStrings.Clear();
+
+	SpilledStrDict record;
+	size_t next = 0;
+	while (next < size && (next = record.Set(base, next, size)) != 0)
+	{
+		size_t countAt = ids.size();
+		ids.push_back(0);
+		StrRef var, val;
+		int i = 0;
+		for (; record.GetVar(i, var, val); i++)
+		{
+			ids.push_back((int) taggedStrings.Intern(var.Text(), var.Length()));
+			ids.push_back((int) taggedStrings.Intern(val.Text(), val.Length()));
+		}
+		ids[countAt] = i;
+
+		if (taggedStrings.Bytes() > TAGGED_POOL_MAX_BYTES)
+		{
+			// the results were spilled to keep them out of memory, so don't
+			//  pull them back in; without ids the records are read one at
+			//  a time from the spill file
+			LOG_INFO("Spilled tagged output is too large to intern");
+			ids.clear();
+			if (internMode != TAGGED_INTERN_PER_CONNECTION)
+				taggedStrings.Clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+const int* P4BridgeClient::GetTaggedOutputIds(int* length)
+{
+	taggedIds.clear();
+	if (spilling)
+	{
+		ReadSpilledIds(taggedIds);
+		if (length) *length = (int) taggedIds.size();
+		return taggedIds.empty() ? NULL : taggedIds.data();
+	}
+
+	for (StrDictList* pItem = results_dictionary_head; pItem; pItem = pItem->Next())
+	{
+		PooledStrDict* pDict = pItem->Pooled();
+		if (!pDict)
+		{
+			// stored before interning was turned on
+			taggedIds.clear();
+			break;
+		}
+		taggedIds.push_back(pDict->Count());
+		for (int i = 0; i < pDict->Count(); i++)
+		{
+			taggedIds.push_back((int) pDict->KeyId(i));
+			taggedIds.push_back((int) pDict->ValueId(i));
+		}
+	}
+	if (length) *length = (int) taggedIds.size();
+	return taggedIds.empty() ? NULL : taggedIds.data();
+}
+
+const int* P4BridgeClient::GetTaggedColumn(const char* key, int* length)
+{
+	taggedColumn.clear();
+	if (spilling)
+	{
+		vector<int> ids;
+		ReadSpilledIds(ids);
+
+		// spilled keys are only in the pool once the records are read
+		int keyId = key ? taggedStrings.Find(key, strlen(key)) : -1;
+		for (size_t at = 0; at < ids.size(); at += 1 + 2 * ids[at])
+		{
+			int valId = -1;
+			for (int i = 0; keyId >= 0 && i < ids[at]; i++)
+			{
+				if (ids[at + 1 + 2 * i] == keyId)
+				{
+					valId = ids[at + 2 + 2 * i];
+					break;
+				}
+			}
+			taggedColumn.push_back(valId);
+		}
+		if (length) *length = (int) taggedColumn.size();
+		return taggedColumn.empty() ? NULL : taggedColumn.data();
+	}
+
+	int keyId = key ? taggedStrings.Find(key, strlen(key)) : -1;
+	for (StrDictList* pItem = results_dictionary_head; pItem; pItem = pItem->Next())
+	{
+		PooledStrDict* pDict = pItem->Pooled();
+		if (!pDict)
+		{
+			taggedColumn.clear();
+			break;
+		}
+		taggedColumn.push_back((keyId >= 0) ? pDict->FindValueId((unsigned int) keyId) : -1);
+	}
+	if (length) *length = (int) taggedColumn.size();
+	return taggedColumn.empty() ? NULL : taggedColumn.data();
+}
+
+const char* P4BridgeClient::GetTaggedStringTable(int* length)
+{
+	taggedStringTable.clear();
+	for (int id = 0; id < taggedStrings.Count(); id++)
+	{
+		const char* str = taggedStrings.Get(id);
+		taggedStringTable.insert(taggedStringTable.end(), str, str + taggedStrings.Length(id) + 1);
+	}
+	if (length) *length = (int) taggedStringTable.size();
+	return taggedStringTable.data();
 }
 
 int	P4BridgeClient::Resolve( ClientMerge *m, Error *e )
 {
-	return pServer->Resolve( pCon->getId(), m, e );
+	if (pResolvePolicy)
+	{
+		int rule = -1;
+		MergeStatus status = pResolvePolicy->Apply( m, rule );
+		FileSys *yours = m->GetYourFile();
+		AddResolveSummary( (yours && yours->Path()) ? yours->Path()->Text() : "", "content", rule, status,
+			m->GetYourChunks(), m->GetTheirChunks(), m->GetBothChunks(), m->GetConflictChunks() );
+		if (pRecorder) pRecorder->Resolve( CALL_RESOLVE_CONTENT, status );
+		return status;
+	}
+	int result = pServer->Resolve( pCon->getId(), m, e );
+	if (pRecorder) pRecorder->Resolve( CALL_RESOLVE_CONTENT, result );
+	return result;
 }
 
 int	P4BridgeClient::Resolve( ClientResolveA *r, int preview, Error *e )
 {
-	return pServer->Resolve(pCon->getId(), r, preview, e );
+	if (pResolvePolicy)
+	{
+		std::string type = P4ResolvePolicy::ActionType( r );
+		int rule = -1;
+		MergeStatus status = pResolvePolicy->Apply( r, type, rule );
+		AddResolveSummary( "", type, rule, status, 0, 0, 0, 0 );
+
+		// a preview reports what the policy would do, but resolves nothing
+		if (preview)
+			status = CMS_SKIP;
+		if (pRecorder) pRecorder->Resolve( CALL_RESOLVE_ACTION, status );
+		return status;
+	}
+	int result = pServer->Resolve(pCon->getId(), r, preview, e );
+	if (pRecorder) pRecorder->Resolve( CALL_RESOLVE_ACTION, result );
+	return result;
+}
+
+void P4BridgeClient::AddResolveSummary(const char *path, const std::string &type, int rule, MergeStatus result,
+	int yourChunks, int theirChunks, int bothChunks, int conflictChunks)
+{
+	ResolveSummary record;
+	record.path = NULL;
+	record.type = NULL;
+	record.rule = rule;
+	record.result = (int) result;
+	record.yourChunks = yourChunks;
+	record.theirChunks = theirChunks;
+	record.bothChunks = bothChunks;
+	record.conflictChunks = conflictChunks;
+	resolveSummary.push_back( record );
+	resolvePaths.push_back( path );
+	resolveTypes.push_back( type );
+}
+
+/*******************************************************************************
+ *
+ *  GetResolveSummary
+ *
+ *  The strings move as the vectors grow, so the records only point to them
+ *      once the command is done and they are read.
+ *
+ ******************************************************************************/
+
+const ResolveSummary* P4BridgeClient::GetResolveSummary(int* count)
+{
+	for (size_t i = 0; i < resolveSummary.size(); i++)
+	{
+		resolveSummary[i].path = resolvePaths[i].c_str();
+		resolveSummary[i].type = resolveTypes[i].c_str();
+	}
+	if (count) *count = (int) resolveSummary.size();
+	return resolveSummary.empty() ? NULL : resolveSummary.data();
 }
 
 /*******************************************************************************
@@ -721,6 +1586,23 @@ StrDictList::StrDictList()
 	: p4base(Type()) 
 { 
 	pStrDict = new StrBufDict(); 
+	pPooled = NULL;
+	pNext = NULL;
+}
+
+StrDictList::StrDictList(StringPool* pool)
+	: p4base(Type())
+{
+	pPooled = new PooledStrDict(pool);
+	pStrDict = pPooled;
+	pNext = NULL;
+}
+
+StrDictList::StrDictList(StrDict* adopt)
+	: p4base(Type())
+{
+	pStrDict = adopt;
+	pPooled = NULL;
 	pNext = NULL;
 }
 
@@ -742,6 +1624,12 @@ StrDictListIterator::StrDictListIterator()
 	: p4base(Type())
 {
 	curEntry = NULL;
+	spill = NULL;
+	recordBase = NULL;
+	recordSize = 0;
+	spillDict = NULL;
+	spillItem = NULL;
+	spillNext = 0;
 }
 
 /*******************************************************************************
@@ -752,9 +1640,49 @@ StrDictListIterator::StrDictListIterator(StrDictList* ndict)
  : p4base(Type())
 {
 	curEntry = NULL;
+	spill = NULL;
+	recordBase = NULL;
+	recordSize = 0;
+	spillDict = NULL;
+	spillItem = NULL;
+	spillNext = 0;
 	Init(ndict);
 }
 
+/*******************************************************************************
+ * Constructor
+ ******************************************************************************/
+
+StrDictListIterator::StrDictListIterator(SpillFile* nspill)
+ : p4base(Type())
+{
+	curEntry = NULL;
+	spill = nspill;
+	recordBase = NULL;
+	recordSize = 0;
+	spillDict = new SpilledStrDict();
+	spillItem = new StrDictList(spillDict);
+	spillNext = 0;
+	Init(NULL);
+}
+
+/*******************************************************************************
+ * Constructor
+ ******************************************************************************/
+
+StrDictListIterator::StrDictListIterator(const char* records, size_t size)
+ : p4base(Type())
+{
+	curEntry = NULL;
+	spill = NULL;
+	recordBase = records;
+	recordSize = size;
+	spillDict = new SpilledStrDict();
+	spillItem = new StrDictList(spillDict);
+	spillNext = 0;
+	Init(NULL);
+}
+
 /*******************************************************************************
  * Destructor
  *******************************************************************************
@@ -790,6 +1718,8 @@ StrDictList::~StrDictList()
 StrDictListIterator::~StrDictListIterator()
 {
 	Reset();
+	// owns spillDict
+	DELETE_OBJECT( spillItem )
 }
 
 /*******************************************************************************
@@ -820,6 +1750,18 @@ int StrDictListIterator::Init(StrDictList* ndict)
 
 StrDictList* StrDictListIterator::GetNextItem()
 {
+	if (spillItem)
+	{
+		// the item is reused, pointing at the next record
+		const char* base = spill ? spill->Map() : recordBase;
+		size_t size = spill ? (size_t) spill->Size() : recordSize;
+		size_t next = (spillNext < size) ? spillDict->Set(base, spillNext, size) : 0;
+		curItem = next ? spillItem : NULL;
+		spillNext = next ? next : size;
+		idx = 0;
+		return curItem;
+	}
+
 	if (curItem == NULL)
 	{
 		curItem = dict;
@@ -890,6 +1832,7 @@ void StrDictListIterator::Reset()
 {
 	curItem = NULL;
 	idx = 0;
+	spillNext = 0;
 
 	if (curEntry != NULL)
 	{
@@ -27,6 +27,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *******************************************************************************/
 
 #include <vector>
+#include <set>
+#include <string>
+
+#include "StringPool.h"
+#include "DiffCapture.h"
+#include "ResolvePolicy.h"
+#include "ProgressReporter.h"
 
 using std::vector;
 
@@ -51,6 +58,18 @@ class P4ClientMerge;
 class P4ClientResolve;
 class P4BridgeServer;
 class P4Connection;
+class P4FileIndex;
+class P4NdjsonWriter;
+class P4CallRecorder;
+class ResultCapture;
+class SpillFile;
+class SpilledStrDict;
+
+// How the keys and values of tagged output are stored, see
+//  P4BridgeClient::SetInternMode()
+#define TAGGED_INTERN_OFF				0	// a StrBufDict per record
+#define TAGGED_INTERN_PER_COMMAND		1	// a StringPool cleared with the results
+#define TAGGED_INTERN_PER_CONNECTION	2	// a StringPool kept between commands
 
 #ifndef STDCALL
 #if defined OS_NT
@@ -74,6 +93,11 @@ typedef void STDCALL IntTextTextCallbackFn(int, int, const char*, const char*);
 
 typedef void STDCALL PromptCallbackFn( int, const char *, char *, int, int);
 
+// Fills the buffer with the next part of the input data for a command:
+//  cmdId, buffer, buffer size. Returns the bytes written, 0 at the end of the
+//  data or -1 to fail the command.
+typedef int STDCALL InputDataCallbackFn( int, char *, int );
+
 // original from the P4 API:
 // ClientApi* client, ClientUser *ui, const char *cmd, StrArray &args, StrDict &pVars, int threads, Error *e
 // current for us: server pointer, cmd, arg list (IntPtr[] + count), dict iterator, thread count
@@ -81,6 +105,10 @@ typedef int STDCALL ParallelTransferCallbackFn(int*, const char*, const char**,
 
 typedef int STDCALL ResolveCallbackFn( int, P4ClientMerge *);
 typedef int STDCALL ResolveACallbackFn( int, P4ClientResolve *, int preview);
+
+// Receives the progress of a command: cmdId, totals. Returns non zero to
+//  cancel the command.
+typedef int STDCALL ProgressCallbackFn( int, const ProgressInfo * );
 /*******************************************************************************
  *
  *  KeyValuePair
@@ -117,17 +145,25 @@ class StrDictList : p4base
 {
 public:
 	StrDictList();
+	// Keep the keys and values in a pool shared with other items
+	StrDictList(StringPool* pool);
+	// Take ownership of an existing dictionary
+	StrDictList(StrDict* adopt);
 	StrDictList* Next() { return pNext; }
 	void Next(StrDictList* pNew) { pNext = pNew; }
 
 	StrDict* Data() { return pStrDict; }
 
+	// The same dictionary if its strings are pooled, otherwise NULL
+	PooledStrDict* Pooled() { return pPooled; }
+
 	virtual ~StrDictList();
 
 	virtual int Type(void) { return tStrDictList; }
 
 private:
 	StrDict* pStrDict;
+	PooledStrDict* pPooled;
 	StrDictList* pNext;
 };
 
@@ -144,6 +180,10 @@ class StrDictListIterator : p4base
 {
 public:
 	StrDictListIterator(StrDictList* ndict);
+	// Iterate the records of tagged output spilled to a file
+	StrDictListIterator(SpillFile* nspill);
+	// Iterate records in the same format held in memory, see ResultSet.h
+	StrDictListIterator(const char* records, size_t size);
 	virtual ~StrDictListIterator();
 	int Init(StrDictList* ndict);
 
@@ -165,6 +205,16 @@ private:
 	StrDictList* curItem;
 	KeyValuePair* curEntry;
 	StrDictList* dict; // head of the list to iterate
+
+	// When iterating spilled or serialized output, the item returned is
+	//  reused for each record and points into the file's mapping or the
+	//  records
+	SpillFile* spill;
+	const char* recordBase;
+	size_t recordSize;
+	SpilledStrDict* spillDict;
+	StrDictList* spillItem;
+	size_t spillNext;
 };
 
 /*******************************************************************************
@@ -214,6 +264,20 @@ public:
 	virtual int Type(void) { return tP4ClientInfoMsg; }
 };
 
+// Which list P4BridgeClient::PackMessages() packs
+#define PACKED_INFO		0
+#define PACKED_ERRORS	1
+
+// One message of the packed info or error output. offset and length are
+//  in units of the string pool: bytes for UTF-8, 16 bit units for UTF-16.
+struct PackedMessage
+{
+	int code;		// MsgCode of an info message, ErrorCode of an error
+	int level;		// Level of an info message, Severity of an error
+	int offset;
+	int length;
+};
+
 /*******************************************************************************
  *
  *  P4ClientMerge
@@ -386,6 +450,54 @@ private:
 	// how many entries in the list
 	int results_dictionary_count;
 
+	// Keys and values of the tagged output, unless interning is off
+	int internMode;
+	StringPool taggedStrings;
+
+	// Once the results held pass spillThreshold bytes they are moved to
+	//  temporary files, and output for the rest of the command goes there
+	long long spillThreshold;
+	string spillDir;
+	long long retainedBytes;
+	bool spilling;
+	bool spillFailed;
+	int spilledItems;
+	SpillFile* pTextSpill;
+	SpillFile* pBinarySpill;
+	SpillFile* pTaggedSpill;
+
+	// Add to the bytes held and spill once they pass the threshold
+	void CountRetained(long long bytes);
+	void Spill();
+	void DeleteSpill();
+	void SpillFailed();
+	// Create one of the spill files if needed, and append to it
+	bool OpenSpill(SpillFile*& pFile);
+	bool SpillAppend(SpillFile*& pFile, const void* data, size_t len);
+
+	// The spilled tagged output in the form of GetTaggedOutputIds(), its
+	//  strings are interned again as they were dropped with the records
+	bool ReadSpilledIds(vector<int>& ids);
+
+	// Buffers returned by the batch accessors, valid until the next call
+	vector<char> serializedResults;
+	vector<int> taggedIds;
+	vector<int> taggedColumn;
+	vector<char> taggedStringTable;
+
+	// How Diff() reports its output, one of the DIFF_OUTPUT_ values. With
+	//  DIFF_OUTPUT_STRUCTURED the hunks of every file diffed by the command
+	//  are kept in diffHunks, their text in diffText and the local file
+	//  names in diffFiles.
+	int diffMode;
+	std::string diffText;
+	vector<DiffHunk> diffHunks;
+	vector<std::string> diffFiles;
+
+	// Diff into memory, returns false if that is not possible so the
+	//  temporary file is used instead
+	bool DiffInMemory( FileSys *f1, FileSys *f2, char *diffFlags, Error *e );
+
 	// Linked list to hold the errors (if any) returned by a command.
 	P4ClientError  *pFirstError;
 	P4ClientError  *pLastError;
@@ -409,12 +521,65 @@ private:
 	//  command. The data must be set before the command is run.
 	StrBuf *data_set;
 
+	// Instead of data_set, the next command can read its data from a native
+	//  buffer owned by the caller, or a chunk at a time from a callback.
+	//  Either is only used for one command.
+	const char *data_buffer;
+	long long data_buffer_length;
+	InputDataCallbackFn *pInputDataCallbackFn;
+
 	// Save the error from an exception to be reported in the exception handler block
 	// to prevent possible recursion if it happens when reporting an error.
 	StrBuf * ExceptionError;
 
 	PromptCallbackFn * pPromptCallbackFn;
 
+	// Optional set of tagged field names to keep, if NULL all fields are kept.
+	//  Used by prepared commands to project the tagged output.
+	const std::set<std::string> * pProjection;
+
+	// Optional index updated from the tagged output of the running command
+	P4FileIndex * pFileIndex;
+	int fileIndexKind;
+
+	// Optional writer the tagged output of the running command is streamed
+	//  to as NDJSON. Unless it keeps results, records are not stored here.
+	P4NdjsonWriter * pNdjson;
+	std::string ndjsonRecord;
+	int streamedItems;
+
+	// Optional recorder the calls of the running command are written to
+	P4CallRecorder * pRecorder;
+
+	// Unicode mode of the messages of a recording being replayed, -1 to
+	//  ask the server
+	int replayUnicode;
+
+	// The Unicode mode messages are formatted in
+	int UnicodeMessages();
+
+	// Optional capture of the output of a command the result cache keeps
+	ResultCapture * pCapture;
+
+	// Optional policy deciding the resolves of the running command instead
+	//  of the resolve callbacks. A record of each file is kept in
+	//  resolveSummary, with the strings it points to in resolvePaths and
+	//  resolveTypes.
+	P4ResolvePolicy * pResolvePolicy;
+	vector<ResolveSummary> resolveSummary;
+	vector<std::string> resolvePaths;
+	vector<std::string> resolveTypes;
+
+	void AddResolveSummary(const char *path, const std::string &type, int rule, MergeStatus result,
+		int yourChunks, int theirChunks, int bothChunks, int conflictChunks);
+
+	// The info or error output packed by PackMessages()
+	vector<PackedMessage> packedMessages;
+	vector<char> packedPool;
+
+	// Progress of the running command, reported by P4BridgeProgress
+	P4ProgressTotals progressTotals;
+
 	P4Connection* pCon;
 
 	// Construct + Destructor
@@ -443,6 +608,10 @@ public:
 	virtual void Diff( FileSys *f1, FileSys *f2, int doPage, 
 				char *diffFlags, Error *e );
 
+	// Progress is only asked for when the server has a progress callback
+	virtual ClientProgress *CreateProgress( int type );
+	virtual int ProgressIndicator();
+
 	void HandleError( P4ClientError * pNewError );
 	void HandleError( int severity, int	errorCode, const char *errMsg );
 
@@ -458,6 +627,9 @@ public:
 	void CallTaggedOutputCallbackFn( int objId, const char *pKey, const char * pVal );
 	void CallErrorCallbackFn( int severity, int errorId, const char * errMsg );
 	void CallBinaryResultsCallbackFn(void * data, int length );
+	int CallProgressCallbackFn( const ProgressInfo &info );
+
+	const ProgressInfo& GetProgress() { return progressTotals.GetInfo(); }
 
 	// Clear the results after a command completes and the results have been
 	//  gathered by the client
@@ -468,6 +640,48 @@ public:
 	StrDictListIterator* GetTaggedOutput(  );
 	int GetTaggedOutputCount( ) {return results_dictionary_count;}
 
+	// The tagged output as it is held, for code that copies it such as
+	//  the result cache. The list still belongs to the client. It is NULL
+	//  once the results are spilled, GetTaggedOutput() works either way.
+	StrDictList* GetTaggedOutputList( ) {return results_dictionary_head;}
+
+	// Move the results to temporary files in dir (the system temporary
+	//  directory if empty) once they hold more than thresholdBytes, zero to
+	//  keep them in memory. Applies from the next command.
+	void SetSpill(long long thresholdBytes, const char* dir);
+	bool IsSpilled() { return spilling; }
+
+	// Choose how tagged output is stored from the next command on, one of
+	//  the TAGGED_INTERN_ values. Per connection pools are kept between
+	//  commands until they grow too large, so ids stay the same across runs.
+	void SetInternMode(int mode) { internMode = mode; }
+	int GetInternMode() { return internMode; }
+
+	// The pool the ids in the batch accessors refer to
+	StringPool* GetTaggedStrings() { return &taggedStrings; }
+
+	// Tagged output as ids: for each item the number of fields followed by
+	//  a key and value id per field. NULL if the output is not interned.
+	//  Spilled output is read back from the spill file and its strings are
+	//  added to the pool.
+	const int* GetTaggedOutputIds(int* length);
+
+	// The value id of one key for each item, -1 where it is not set
+	const int* GetTaggedColumn(const char* key, int* length);
+
+	// Every pooled string in id order, each followed by a NUL
+	const char* GetTaggedStringTable(int* length);
+
+	// All of the results serialized as described in ResultSet.h
+	const char* Serialize(long long* length);
+
+	void SetDiffMode(int mode) { diffMode = mode; }
+
+	// The hunks and text kept by a DIFF_OUTPUT_STRUCTURED diff
+	const DiffHunk* GetDiffHunks(int* count);
+	const char* GetDiffText(long long* length);
+	const char* GetDiffFile(int idx);
+
 	// Get the error output after a command completes
 	P4ClientError * GetErrorResults();
 
@@ -477,6 +691,49 @@ public:
 	void SetDataSet(const char * data);
 	StrPtr * GetDataSet( void );
 
+	// Give the next command its input without copying it first: data must
+	//  stay valid until the command completes. Returns false, leaving no
+	//  input set, if it is too large for the API.
+	bool SetDataSetBuffer(const char * data, long long length);
+
+	// Read the input of the next command from the callback as it is needed
+	void SetDataSetCallback(InputDataCallbackFn * pNew) { pInputDataCallbackFn = pNew; }
+
+	// Forget the buffer or callback once the command is done with it
+	void ClearInputSource();
+
+	// Limit the tagged output stored and reported to the given field names.
+	//  Pass NULL to keep every field. The set must outlive the command.
+	void SetProjection(const std::set<std::string> * projection) { pProjection = projection; }
+
+	// Update the index from the tagged output of the command about to run,
+	//  kind is from P4FileIndex::UpdateKind(). Pass NULL when it completes.
+	void SetFileIndex(P4FileIndex * index, int kind) { pFileIndex = index; fileIndexKind = kind; }
+
+	// Stream the tagged output of the command about to run to the writer.
+	//  Pass NULL when it completes.
+	void SetNdjsonWriter(P4NdjsonWriter * writer) { pNdjson = writer; }
+
+	// Record the calls of the command about to run. Pass NULL when it
+	//  completes.
+	void SetCallRecorder(P4CallRecorder * recorder) { pRecorder = recorder; }
+
+	// Format the messages that follow as recorded in this Unicode mode
+	//  instead of asking the server, -1 to ask it again
+	void SetReplayUnicode(int val) { replayUnicode = val; }
+
+	// Capture the output of the command about to run for the result cache.
+	//  Pass NULL when it completes.
+	void SetResultCapture(ResultCapture * capture) { pCapture = capture; }
+
+	// Decide the resolves of the command about to run with the policy.
+	//  Pass NULL when it completes.
+	void SetResolvePolicy(P4ResolvePolicy * policy) { pResolvePolicy = policy; }
+
+	// The records of the files resolved by a policy, valid until the next
+	//  command
+	const ResolveSummary* GetResolveSummary(int* count);
+
 	void Prompt( const StrPtr &msg, StrBuf &rsp, 
 				int noEcho, Error *e );
 
@@ -485,11 +742,18 @@ public:
 	P4ClientInfoMsg * GetInfoResults();
 	int GetInfoResultsCount();
 
-	// Get the text output after a command completes
+	// Pack the info (PACKED_INFO) or error (PACKED_ERRORS) output into one
+	//  array of messages and one string pool, in UTF-8 or converted to
+	//  UTF-16. Valid until the next call or command.
+	const PackedMessage* PackMessages(int which, bool utf16, int* count,
+		const char** pool, int* poolSize);
+
+	// Get the text output and its length after a command completes
 	const char* GetTextResults();
+	size_t GetTextResultsLength();
 
 	// Get the binary output and its size after a command completes
-	size_t GetBinaryResultsCount() { return Binary_results.size(); }
+	size_t GetBinaryResultsCount();
 	const unsigned char* GetBinaryResults();
 
 	// Callbacks for handling interactive resolve
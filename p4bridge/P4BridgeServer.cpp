@@ -36,6 +36,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "stdafx.h"
 #include "P4BridgeServer.h"
 #include "P4Connection.h"
+#include "IdleConnectionManager.h"
+#include "ResultCache.h"
+#include "FileIndex.h"
+#include "NdjsonWriter.h"
+#include "CallRecorder.h"
 
 #include <spec.h>
 #include <debug.h>
@@ -43,6 +48,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <hostenv.h>
 #include <ident.h>
 #include "ticket.h"
+#include "TicketCache.h"
+#include "ConfigCache.h"
+#include "EnviroSnapshot.h"
 #include "error.h"
 #include "errornum.h"
 #include "errorlog.h"
@@ -213,7 +221,19 @@ P4BridgeServer::P4BridgeServer(void) :
 	fileCharset(CharSetApi::NOCONV),
 	runThreadId(0),
 	pTransfer(NULL),
-	pParallelTransferCallbackFn(NULL)
+	pParallelTransferCallbackFn(NULL),
+	pProgressCallbackFn(NULL),
+	progressIntervalMs(0),
+	commandDeadlineMs(0),
+	commandInactivityMs(0),
+	pFileIndex(NULL),
+	pNdjsonWriter(NULL),
+	pCallRecorder(NULL),
+	pResolvePolicy(NULL),
+	taggedInternMode(TAGGED_INTERN_PER_COMMAND),
+	diffMode(DIFF_OUTPUT_TEXT),
+	spillThreshold(0),
+	stringSlabMode(STRING_SLAB_OFF)
 { 
 }
 
@@ -245,34 +265,53 @@ P4BridgeServer::P4BridgeServer( const char *p4port,
 	fileCharset(CharSetApi::NOCONV),
 	runThreadId(0),
 	pTransfer(NULL),
-	pParallelTransferCallbackFn(NULL)
+	pParallelTransferCallbackFn(NULL),
+	pProgressCallbackFn(NULL),
+	progressIntervalMs(0),
+	commandDeadlineMs(0),
+	commandInactivityMs(0),
+	pFileIndex(NULL),
+	pNdjsonWriter(NULL),
+	pCallRecorder(NULL),
+	pResolvePolicy(NULL),
+	taggedInternMode(TAGGED_INTERN_PER_COMMAND),
+	diffMode(DIFF_OUTPUT_TEXT),
+	spillThreshold(0),
+	stringSlabMode(STRING_SLAB_OFF)
 {
 	LOG_DEBUG3(4,"Creating a new P4BridgeServer on %s for user, %s, and client, %s", p4port, user, ws_client);
-	
-	LOCK(&BridgeLock);
 
-	disposed = 0;
+	{
+		LOCK(&BridgeLock);
 
-	isUnicode = -1;
-	useLogin = 0;
-	supportsExtSubmit = 0;
-	connecting = 0;
+		disposed = 0;
+
+		isUnicode = -1;
+		useLogin = 0;
+		supportsExtSubmit = 0;
+		connecting = 0;
+
+		// Clear the the callbacks 
+		pTaggedOutputCallbackFn = NULL;
+		pErrorCallbackFn = NULL;
+		pInfoResultsCallbackFn = NULL;
+		pTextResultsCallbackFn = NULL;
+		pBinaryResultsCallbackFn = NULL;
+		pPromptCallbackFn = NULL;
+		pResolveCallbackFn = NULL;
+		pResolveACallbackFn = NULL;
 
-	// Clear the the callbacks 
-	pTaggedOutputCallbackFn = NULL;
-	pErrorCallbackFn = NULL;
-	pInfoResultsCallbackFn = NULL;
-	pTextResultsCallbackFn = NULL;
-	pBinaryResultsCallbackFn = NULL;
-	pPromptCallbackFn = NULL;
-	pResolveCallbackFn = NULL;
-	pResolveACallbackFn = NULL;
+		// connect to the server using a untagged protocol
+		if (p4port)		this->p4port = p4port;
+		if (user)		this->user = user;
+		if (ws_client)	this->client = ws_client;
+		if (pass)		this->password = pass;
+	}
 
-	// connect to the server using a untagged protocol
-	if (p4port)		this->p4port = p4port;
-	if (user)		this->user = user;
-	if (ws_client)	this->client = ws_client;
-	if (pass)		this->password = pass;
+	// the idle thread may look at the server as soon as it is registered,
+	//  so only once it is complete. servers_mutex comes before BridgeLock in
+	//  the lock order, so not while BridgeLock is held.
+	IdleConnectionManager::Register(this);
 }
 
 /*******************************************************************************
@@ -285,12 +324,20 @@ P4BridgeServer::P4BridgeServer( const char *p4port,
 
 P4BridgeServer::~P4BridgeServer(void)
 {
+	IdleConnectionManager::Unregister(this);
+	SetFileIndex(NULL);
+	SetNdjsonWriter(NULL);
+	SetResolvePolicy(NULL);
+	StopCallRecording();
+
 	if (disposed != 0)
 	{
 		return;
 	}
 	else
 	{
+		// runMutex before BridgeLock, close_connection() takes both
+		std::lock_guard<std::recursive_mutex> guard(runMutex);
 		LOCK(&BridgeLock); 
 	
 		disposed = 1;
@@ -305,6 +352,7 @@ P4BridgeServer::~P4BridgeServer(void)
 		pResolveCallbackFn = nullptr;
 		pResolveACallbackFn = nullptr;
 		pParallelTransferCallbackFn = nullptr;
+		pProgressCallbackFn = nullptr;
 
 		close_connection();
 	
@@ -348,6 +396,8 @@ bool P4BridgeServer::isInitialized() const
 
 int P4BridgeServer::connected_int( P4ClientError **err )
 {
+	// runMutex before BridgeLock, GetServerProtocols() runs a command
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
 	LOCK(&BridgeLock);
 	LOG_ENTRY();
 
@@ -375,6 +425,9 @@ int P4BridgeServer::connected_int( P4ClientError **err )
 
 		connecting = 0;
 
+		// look this server's tickets up again for the new connection
+		TicketCache::Invalidate(GetServerTicketFile().c_str());
+
 		return 1;
 	}
 
@@ -412,6 +465,8 @@ int P4BridgeServer::connect_and_trust( P4ClientError **err, char* trust_flag, ch
 
 int P4BridgeServer::connect_and_trust_int( P4ClientError **err, char* trust_flag, char* fingerprint )
 {
+	// runMutex before BridgeLock, run_command() takes it again
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
 	LOCK(&BridgeLock); 
 
 	if (connecting || isInitialized())
@@ -486,7 +541,9 @@ int P4BridgeServer::connect_and_trust_int( P4ClientError **err, char* trust_flag
 
 int P4BridgeServer::close_connection()
 {
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
 	LOCK(&BridgeLock); 
+	std::lock_guard<std::recursive_mutex> connectionGuard(connectionMutex);
 	LOG_ENTRY();
 
 	// Close connections
@@ -536,7 +593,9 @@ int P4BridgeServer::close_connection()
 
 int P4BridgeServer::disconnect( void )
 {
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
 	LOCK(&BridgeLock); 
+	std::lock_guard<std::recursive_mutex> connectionGuard(connectionMutex);
 	LOG_ENTRY();
 
 	if (pConnection)
@@ -562,6 +621,7 @@ int P4BridgeServer::disconnect( void )
 
 string P4BridgeServer::get_charset( )
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	LOG_ENTRY();
 	// TODO: store the string charset name instead of potentially regenerating a connection
 	return getConnection()->GetCharset().Text();
@@ -619,6 +679,7 @@ CharSetApi::CharSet GetDefaultCharSet()
 
 string P4BridgeServer::set_charset( const char* c, const char * filec )
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	CharSetApi::CharSet cs;
 	if (c)
 	{
@@ -697,11 +758,14 @@ string P4BridgeServer::set_charset( const char* c, const char * filec )
 
 void P4BridgeServer::set_cwd( const char* newCwd )
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	// cache for later
 	pCwd = (newCwd) ? newCwd : "";
 	LOCK(GetEnviroLock());
 	getConnection()->SetCwd(pCwd.c_str());  // update both the connection 
 	GetEnviro()->Config(StrRef(pCwd.c_str()));  // and the BridgeServer Enviro
+	TicketCache::EnviroChanged();
+	EnviroSnapshot::GlobalChanged();
 }
 
 /*******************************************************************************
@@ -716,6 +780,7 @@ static StrBuf EmptStr("");
 
 string P4BridgeServer::get_cwd( void )
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	LOG_LOC();
 	return getConnection()->GetCwd().Text();
 
@@ -816,93 +881,32 @@ char *GetInfo(char* lpstrVffInfo, char *InfoItem)
 
 /*******************************************************************************
  *
- * run_command
+ * GetProcessProgramIdentity
  *
- * Run a command using the supplied parameters. The command can either be run 
- *  in tagged or untagged protocol. If the target server supports Unicode, the 
- *  strings in the parameter list need to be encoded in the character set 
- *  specified by a previous call to set_charset().
+ * Compute the default program name and version used to label connections
+ *  for p4 monitor. On Windows this needs the module path and its version
+ *  resource, so it is only done once per process and the result cached.
  *
  ******************************************************************************/
 
-int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char const* const* args, int argc)
-{
-	P4ClientError* err = NULL;
-	LOG_ENTRY();
-
-	if (connected(&err))
-	{
-		LOG_LOC();
-		DELETE_OBJECT(err)
-	}
-	Error e;
-
-	StrBuf msg;
-
-	P4Connection* connection = getConnection(cmdId);
-	if (!connection)
-	{
-		LOG_ERROR1("Error getting connection for command: %d", cmdId);
-		return 0;
-	}
+static std::once_flag program_identity_once;
+static string program_identity_name;
+static string program_identity_version;
 
-	P4BridgeClient* ui = connection->getUi();
-	if (ui)
-	{
-		if (err != NULL)
-		{
-			// couldn't connect
-			ui->HandleError(err);
-			return 0;
-		}
-		ui->clear_results();
-	}
-	else
-	{
-		LOG_ERROR("connection did not have a P4BridgeClient ui object");
-		return 0;
-	}
-
-	connection->IsAlive(1);
-
-	// Connect to server
-	if (connection->Dropped())
-	{
-		connection->Final(&e);
-		if (e.Test())
-		{
-			ui->HandleError(&e);
-			return 0;
-		}
-		connection->clientNeedsInit = 1;
-	}
-	if (connection->clientNeedsInit)
-	{
-		connection->Init(&e);
-		if (e.Test())
-		{
-			ui->HandleError(&e);
-			return 0;
-		}
-		connection->clientNeedsInit = 0;
-	}
-	bool setProdName = pProgramName.empty();
-	bool setProdVer = pProgramVer.empty();
+static void ComputeProgramIdentity(string &name, string &version)
+{
+	bool setProdName = true;
 
 #ifdef OS_NT
-	char* pModPath = NULL;
-	if (setProdName || setProdVer)
+	// need to get the module path to set the name and version
+	char* pModPath = new char[MAX_PATH];
+	if (GetModuleFileName(NULL, pModPath, MAX_PATH) == 0)
 	{
-		// need to get the module path to set either the name and/or version
-		pModPath = new char[MAX_PATH];
-		if (GetModuleFileName(NULL, pModPath, MAX_PATH) == 0)
-		{
-			DELETE_ARRAY( pModPath );
-		}
+		DELETE_ARRAY( pModPath );
 	}
 	// Label Connections for p4 monitor
 
-	if (setProdVer && pModPath)
+	if (pModPath)
 	{
 		DWORD sz = GetFileVersionInfoSize(pModPath, NULL);
 		UINT BufLen;
@@ -913,9 +917,9 @@ int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char con
 			char* lpData = new char[sz];
 			if (GetFileVersionInfo(pModPath, 0, sz, lpData))
 			{
-				pProgramVer = GetInfo(lpData, "ProductVersion");
+				version = GetInfo(lpData, "ProductVersion");
 
-				if (pProgramVer.empty())
+				if (version.empty())
 				{
 					if (VerQueryValue(lpData, "\\", (LPVOID*)&pFileInfo, (PUINT)&BufLen))
 					{
@@ -926,7 +930,7 @@ int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char con
 
 						std::stringstream ss;
 						ss << MajorVersion << "." << MinorVersion << "." << BuildNumber << "." << RevisionNumber;
-						pProgramVer = ss.str();
+						version = ss.str();
 					}
 				}
 			}
@@ -935,7 +939,7 @@ int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char con
 				char* prodName = GetInfo(lpData, "ProductName");
 				if (prodName)
 				{
-					pProgramName = prodName;
+					name = prodName;
 					setProdName = false;
 				}
 			}
@@ -958,7 +962,7 @@ int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char con
 				(LPTSTR)&errorText,
 				0,
 				NULL);
-			pProgramVer = errorText;
+			version = errorText;
 			LocalFree(errorText);
 		}
 #endif
@@ -980,32 +984,64 @@ int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char con
 		}
 		if (idx2 < idx1)
 		{
-			pProgramName.resize((idx1 - idx2) + 1);
+			name.resize((idx1 - idx2) + 1);
 			idx1 = idx2;
 			while ((idx1 < MAX_PATH) && (pModPath[idx1] != '\0'))
 			{
-				pProgramName[idx1 - idx2] = pModPath[idx1++];
+				name[idx1 - idx2] = pModPath[idx1++];
 			}
-			pProgramName[idx1 - idx2] = '\0';
+			name[idx1 - idx2] = '\0';
 		}
 	}
 	DELETE_ARRAY(pModPath);
 #endif
 
 #ifndef OS_NT
-	if (setProdVer) {
-        char programVerBuf[10];
-		snprintf(programVerBuf, 9, "1.0.0.1");
-		pProgramVer = programVerBuf;
-	}
+	char programVerBuf[10];
+	snprintf(programVerBuf, 9, "1.0.0.1");
+	version = programVerBuf;
+
 	if (setProdName)
 	{
 		StrBuf newProdName;
 		StrRef api_name(p4api_ident.ident);
 		StrOps::Replace(newProdName, api_name, StrRef("@(#)P4API"), StrRef("P4NET"));
-		pProgramName = newProdName.Text();
+		name = newProdName.Text();
 	}
 #endif
+}
+
+void P4BridgeServer::GetProcessProgramIdentity(string &name, string &version)
+{
+	std::call_once(program_identity_once, []() {
+		ComputeProgramIdentity(program_identity_name, program_identity_version);
+	});
+	name = program_identity_name;
+	version = program_identity_version;
+}
+
+/*******************************************************************************
+ *
+ * SetProgramIdentity
+ *
+ * Set the program name and version on a connection. Any value not supplied
+ *  by the client is taken from the per process identity.
+ *
+ ******************************************************************************/
+
+void P4BridgeServer::SetProgramIdentity(P4Connection* connection)
+{
+	if (pProgramName.empty() || pProgramVer.empty())
+	{
+		string name;
+		string version;
+		GetProcessProgramIdentity(name, version);
+
+		if (pProgramName.empty())
+			pProgramName = name;
+		if (pProgramVer.empty())
+			pProgramVer = version;
+	}
 
 	if (!pProgramName.empty())
 		connection->SetProg(pProgramName.c_str());
@@ -1016,6 +1052,219 @@ int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char con
 		connection->SetVersion(pProgramVer.c_str());
 	else
 		connection->SetVersion("NoVersionSpecified"); //Nobody liked "1.0" );
+}
+
+/*******************************************************************************
+ *
+ * init_connection
+ *
+ * (Re)initialize the connection if it was dropped or disconnected.
+ *
+ ******************************************************************************/
+
+int P4BridgeServer::init_connection(P4Connection* connection, P4BridgeClient* ui, Error *e)
+{
+	if (connection->Dropped())
+	{
+		connection->Final(e);
+		if (e->Test())
+		{
+			ui->HandleError(e);
+			return 0;
+		}
+		connection->clientNeedsInit = 1;
+	}
+	if (connection->clientNeedsInit)
+	{
+		connection->Init(e);
+		if (e->Test())
+		{
+			ui->HandleError(e);
+			return 0;
+		}
+		connection->clientNeedsInit = 0;
+
+		if (connection->idleDisconnected)
+		{
+			connection->idleDisconnected = 0;
+			IdleConnectionManager::CountReconnect();
+		}
+	}
+	return 1;
+}
+
+/*******************************************************************************
+ *
+ * run_command
+ *
+ * Run a command using the supplied parameters. The command can either be run 
+ *  in tagged or untagged protocol. If the target server supports Unicode, the 
+ *  strings in the parameter list need to be encoded in the character set 
+ *  specified by a previous call to set_charset().
+ *
+ ******************************************************************************/
+
+int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char const* const* args, int argc)
+{
+	return run_command_int(cmd, cmdId, tagged, args, argc, NULL);
+}
+
+/*******************************************************************************
+ *
+ * run_prepared
+ *
+ * Run a command captured by a P4PreparedCommand. The argument list, tag mode
+ *  and projection were built when the command was prepared, and the program
+ *  identity is only computed once per process, so repeated runs of the same
+ *  query only pay for the command itself.
+ *
+ ******************************************************************************/
+
+int P4BridgeServer::run_prepared(P4PreparedCommand* prepared, int cmdId)
+{
+	LOG_ENTRY();
+	prepared->IncrementRunCount();
+	if (cmdId == 0)
+		cmdId = prepared->GetCmdId();
+	return run_command_int(prepared->GetCmd(), cmdId, prepared->GetTagged(),
+		prepared->GetArgv(), prepared->GetArgc(), prepared->GetProjection());
+}
+
+// A borrowed input buffer or callback is only good for one command. Clears
+//  it from the connection's client however the command returns, going
+//  through the member as the connection may be replaced while it runs.
+class InputSourceGuard
+{
+public:
+	InputSourceGuard(P4Connection*& connection) : connection(connection) {}
+	~InputSourceGuard()
+	{
+		if (connection && connection->getUi())
+			connection->getUi()->ClearInputSource();
+	}
+
+private:
+	P4Connection*& connection;
+};
+
+int P4BridgeServer::run_command_int(const char* cmd, int cmdId, int tagged, char const* const* args, int argc,
+	const std::set<string>* projection)
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+
+	P4Connection* connection = getConnection(cmdId);
+	P4BridgeClient* ui = connection->getUi();
+	InputSourceGuard inputGuard(pConnection);
+
+	// the previous results are cleared with the new mode, so a pool is not
+	//  kept after switching to per command interning
+	if (ui)
+	{
+		ui->SetInternMode(taggedInternMode);
+		ui->SetDiffMode(diffMode);
+		ui->SetSpill(spillThreshold, spillDir.c_str());
+	}
+
+	// strings handed out for the previous command go with its results
+	if (stringSlabMode == STRING_SLAB_PER_COMMAND)
+		stringSlab.Clear();
+
+	// read-only commands may be answered from the result cache
+	string cacheKey;
+	ResultCapture capture;
+	if (ui && ResultCache::IsCacheable(cmd))
+	{
+		// the password or ticket the command runs with is part of the key
+		string auth = connection->GetPassword().Text();
+		string ticket;
+		if (TicketCache::Lookup(GetServerTicketFile().c_str(), connection->GetPort().Text(),
+			connection->GetUser().Text(), ticket))
+		{
+			auth.push_back('\0');
+			auth.append(ticket);
+		}
+
+		cacheKey = ResultCache::MakeKey(connection->GetPort().Text(), connection->GetUser().Text(),
+			connection->GetClient().Text(), auth.c_str(), connection->GetCharset().Text(),
+			connection->GetCwd().Text(), cmd, tagged, args, argc, projection);
+		if (ResultCache::Replay(cacheKey, ui))
+		{
+			return 1;
+		}
+		ui->SetResultCapture(&capture);
+	}
+
+	int ret = execute_command(cmd, cmdId, tagged, args, argc, projection);
+
+	if (TicketCache::ChangesTickets(cmd))
+		TicketCache::Invalidate(GetServerTicketFile().c_str());
+
+	if (!cacheKey.empty() && pConnection && pConnection->getUi())
+	{
+		P4BridgeClient* cacheUi = pConnection->getUi();
+		cacheUi->SetResultCapture(NULL);
+		if (ret)
+			ResultCache::Store(cacheKey, pConnection->GetPort().Text(), cmd, &capture, cacheUi);
+	}
+
+	// record the last use for the idle connection manager
+	if (pConnection)
+		pConnection->ReleaseTime = P4Connection::NowMs();
+
+	return ret;
+}
+
+int P4BridgeServer::execute_command(const char* cmd, int cmdId, int tagged, char const* const* args, int argc,
+	const std::set<string>* projection)
+{
+	P4ClientError* err = NULL;
+	LOG_ENTRY();
+
+	if (connected(&err))
+	{
+		LOG_LOC();
+		DELETE_OBJECT(err)
+	}
+	Error e;
+
+	StrBuf msg;
+
+	P4Connection* connection = getConnection(cmdId);
+	if (!connection)
+	{
+		LOG_ERROR1("Error getting connection for command: %d", cmdId);
+		return 0;
+	}
+
+	P4BridgeClient* ui = connection->getUi();
+	if (ui)
+	{
+		if (err != NULL)
+		{
+			// couldn't connect
+			ui->HandleError(err);
+			return 0;
+		}
+		ui->clear_results();
+	}
+	else
+	{
+		LOG_ERROR("connection did not have a P4BridgeClient ui object");
+		return 0;
+	}
+
+	connection->IsAlive(1);
+
+	// arm the deadline and inactivity timeout for this command
+	connection->SetTimeouts(commandDeadlineMs, commandInactivityMs);
+	connection->StartCommandTimer();
+
+	// Connect to server
+	if (!init_connection(connection, ui, &e))
+	{
+		return 0;
+	}
+	SetProgramIdentity(connection);
 
 	connection->SetVar(P4Tag::v_tag, tagged ? "yes" : 0);
 
@@ -1033,8 +1282,43 @@ int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char con
 		ui->SetTransfer(nullptr);
 	}
 
+	ui->SetProjection(projection);
+	if (pFileIndex)
+	{
+		ui->SetFileIndex(pFileIndex, P4FileIndex::UpdateKind(cmd, args, argc));
+	}
+	ui->SetNdjsonWriter(pNdjsonWriter);
+	ui->SetResolvePolicy(pResolvePolicy);
+	ui->SetCallRecorder(pCallRecorder);
+	if (pCallRecorder)
+	{
+		pCallRecorder->Command(cmd, args, argc);
+	}
+
+	// the timeouts are enforced per connection through IsAlive(), which the
+	//  API polls while it waits on the network, so net.maxwait is left alone
 	Run_int(connection, cmd, ui);
 
+	ui->SetProjection(NULL);
+	ui->SetFileIndex(NULL, FILEINDEX_NONE);
+	ui->SetNdjsonWriter(NULL);
+	ui->SetResolvePolicy(NULL);
+	ui->SetCallRecorder(NULL);
+	if (pNdjsonWriter)
+	{
+		pNdjsonWriter->Flush();
+	}
+
+	// keep any partial results, but report why the command was cut off
+	if (connection->GetTimeoutStatus() == CMD_DEADLINE_EXCEEDED)
+	{
+		ui->HandleError(E_FAILED, 0, "Command exceeded its deadline and was cancelled");
+	}
+	else if (connection->GetTimeoutStatus() == CMD_INACTIVITY_TIMEOUT)
+	{
+		ui->HandleError(E_FAILED, 0, "Command received no output within its inactivity timeout and was cancelled");
+	}
+
 	// clean up the Transfer object if we allocated one.
 	if (pTransfer != nullptr){
 		DELETE_OBJECT( pTransfer );
@@ -1081,6 +1365,7 @@ int P4BridgeServer::run_command(const char* cmd, int cmdId, int tagged, char con
 
 P4Connection* P4BridgeServer::getConnection(int id /*= 99999999*/)
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	if (!pConnection)
 	{
 		LOG_LOC();
@@ -1094,6 +1379,7 @@ P4Connection* P4BridgeServer::getConnection(int id /*= 99999999*/)
 		if (!pProgramVer.empty()) pConnection->SetVersion(pProgramVer.c_str());
 		if (!pCwd.empty()) pConnection->SetCwd(pCwd.c_str());
 		if (!ticketFile.empty()) pConnection->SetTicketFile(ticketFile.c_str());
+		ApplyVars(pConnection);
 
 		pConnection->SetProtocol("specstring", "");
 		pConnection->SetProtocol("enableStreams", "");
@@ -1124,9 +1410,293 @@ void P4BridgeServer::cancel_command(int cmdId)
 
 bool P4BridgeServer::IsConnected()
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	return pConnection && pConnection->IsConnected();
 }
 
+void P4BridgeServer::SetCommandTimeouts(int deadlineMs, int inactivityMs)
+{
+	LOG_ENTRY();
+	commandDeadlineMs = (deadlineMs > 0) ? deadlineMs : 0;
+	commandInactivityMs = (inactivityMs > 0) ? inactivityMs : 0;
+}
+
+void P4BridgeServer::SetTaggedIntern(int mode)
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	taggedInternMode = ((mode >= TAGGED_INTERN_OFF) && (mode <= TAGGED_INTERN_PER_CONNECTION)) ?
+		mode : TAGGED_INTERN_PER_COMMAND;
+}
+
+void P4BridgeServer::SetDiffMode(int mode)
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	diffMode = ((mode >= DIFF_OUTPUT_TEXT) && (mode <= DIFF_OUTPUT_STRUCTURED)) ?
+		mode : DIFF_OUTPUT_TEXT;
+}
+
+void P4BridgeServer::SetStringSlab(int mode)
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	stringSlabMode = ((mode >= STRING_SLAB_OFF) && (mode <= STRING_SLAB_PER_COMMAND)) ?
+		mode : STRING_SLAB_OFF;
+}
+
+Utils::StringSlab* P4BridgeServer::GetStringSlab()
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	return (stringSlabMode != STRING_SLAB_OFF) ? &stringSlab : NULL;
+}
+
+void P4BridgeServer::ReleaseAllStrings()
+{
+	stringSlab.Clear();
+}
+
+void P4BridgeServer::SetResultSpill(long long thresholdBytes, const char* dir)
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	spillThreshold = (thresholdBytes > 0) ? thresholdBytes : 0;
+	spillDir = dir ? dir : "";
+}
+
+int P4BridgeServer::GetCommandTimeoutStatus(int cmdId)
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	// the status belongs to the last command run on the connection
+	if (!pConnection || pConnection->getId() != cmdId)
+	{
+		return CMD_NOT_TIMED_OUT;
+	}
+	return pConnection->GetTimeoutStatus();
+}
+
+/*******************************************************************************
+ *
+ * DisconnectIfIdle
+ *
+ * Called from the IdleConnectionManager thread. If no command is running and
+ *  the connection has not been used for idleMs, disconnect it the same way
+ *  disconnect() does, keeping the results and settings.
+ *
+ ******************************************************************************/
+
+int P4BridgeServer::DisconnectIfIdle(long long now, int idleMs)
+{
+	std::unique_lock<std::recursive_mutex> guard(runMutex, std::try_to_lock);
+	if (!guard.owns_lock())
+	{
+		// running a command
+		return 0;
+	}
+	{
+		std::lock_guard<std::recursive_mutex> connectionGuard(connectionMutex);
+		if (disposed || !pConnection || !pConnection->IsConnected())
+		{
+			return 0;
+		}
+		if ((now - (long long) pConnection->ReleaseTime) < idleMs)
+		{
+			return 0;
+		}
+	}
+
+	LOG_DEBUG1(4, "Disconnecting idle connection to %s", p4port.c_str());
+	disconnect();
+	std::lock_guard<std::recursive_mutex> connectionGuard(connectionMutex);
+	if (pConnection)
+		pConnection->idleDisconnected = 1;
+	return 1;
+}
+
+bool P4BridgeServer::IsIdleDisconnected()
+{
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
+	return pConnection && pConnection->idleDisconnected && !pConnection->IsConnected();
+}
+
+int P4BridgeServer::GetIdleState()
+{
+	std::unique_lock<std::recursive_mutex> guard(runMutex, std::try_to_lock);
+	if (!guard.owns_lock())
+	{
+		// running a command
+		return IDLE_STATE_LIVE;
+	}
+	if (IsConnected())
+	{
+		return IDLE_STATE_LIVE;
+	}
+	return IsIdleDisconnected() ? IDLE_STATE_IDLE : IDLE_STATE_NONE;
+}
+
+int P4BridgeServer::Prewarm()
+{
+	LOG_ENTRY();
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+
+	P4ClientError* err = NULL;
+	if (!connected(&err))
+	{
+		DELETE_OBJECT(err);
+		return 0;
+	}
+	DELETE_OBJECT(err);
+
+	P4Connection* connection = getConnection();
+	Error e;
+	int ret = init_connection(connection, connection->getUi(), &e);
+	connection->ReleaseTime = P4Connection::NowMs();
+	return ret;
+}
+
+/*******************************************************************************
+ *
+ * SetAttached
+ *
+ *  Swap the object a server uses, an index, writer or policy, under runMutex,
+ *   then detach from the old one and attach to the new one through their
+ *   links without it. The owner of a link calls back into the server under
+ *   the link lock when it is deleted, so runMutex must not be held here.
+ *
+ ******************************************************************************/
+
+template<class T>
+void P4BridgeServer::SetAttached(T*& current, std::shared_ptr<ServerLink>& currentLink, T* next)
+{
+	std::shared_ptr<ServerLink> oldLink;
+	std::shared_ptr<ServerLink> newLink;
+	{
+		std::lock_guard<std::recursive_mutex> guard(runMutex);
+		if (current == next)
+			return;
+		oldLink.swap(currentLink);
+		current = next;
+		if (next)
+		{
+			newLink = next->GetLink();
+			currentLink = newLink;
+		}
+	}
+
+	if (oldLink)
+		oldLink->Detach(this);
+	if (newLink && !newLink->Attach(this))
+	{
+		// being deleted
+		std::lock_guard<std::recursive_mutex> guard(runMutex);
+		if (current == next)
+		{
+			current = NULL;
+			currentLink.reset();
+		}
+	}
+}
+
+/*******************************************************************************
+ *
+ * SetFileIndex
+ *
+ *  Keep the index up to date from the tagged output of the commands run on
+ *   this server, NULL stops updating it.
+ *
+ ******************************************************************************/
+
+void P4BridgeServer::SetFileIndex(P4FileIndex* pIndex)
+{
+	SetAttached(pFileIndex, fileIndexLink, pIndex);
+}
+
+void P4BridgeServer::FileIndexDeleted(P4FileIndex* pIndex)
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	if (pFileIndex == pIndex)
+	{
+		pFileIndex = NULL;
+		fileIndexLink.reset();
+	}
+}
+
+/*******************************************************************************
+ *
+ * SetNdjsonWriter
+ *
+ *  Stream the tagged output of the commands run on this server to the writer,
+ *   NULL stops streaming.
+ *
+ ******************************************************************************/
+
+void P4BridgeServer::SetNdjsonWriter(P4NdjsonWriter* pWriter)
+{
+	SetAttached(pNdjsonWriter, ndjsonWriterLink, pWriter);
+}
+
+void P4BridgeServer::NdjsonWriterDeleted(P4NdjsonWriter* pWriter)
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	if (pNdjsonWriter == pWriter)
+	{
+		pNdjsonWriter = NULL;
+		ndjsonWriterLink.reset();
+	}
+}
+
+/*******************************************************************************
+ *
+ * StartCallRecording
+ *
+ * The recorder belongs to the server. It is only read by commands while they
+ *  run, so it is swapped under the run mutex.
+ *
+ ******************************************************************************/
+
+bool P4BridgeServer::StartCallRecording(const char* path)
+{
+	LOG_ENTRY();
+	P4CallRecorder* pRecorder = new P4CallRecorder();
+	if (!pRecorder->Open(path))
+	{
+		delete pRecorder;
+		return false;
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	delete pCallRecorder;
+	pCallRecorder = pRecorder;
+	return true;
+}
+
+void P4BridgeServer::StopCallRecording()
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	delete pCallRecorder;
+	pCallRecorder = NULL;
+}
+
+/*******************************************************************************
+ *
+ * SetResolvePolicy
+ *
+ *  Decide the resolves of the commands run on this server with the policy,
+ *   NULL goes back to the resolve callbacks.
+ *
+ ******************************************************************************/
+
+void P4BridgeServer::SetResolvePolicy(P4ResolvePolicy* pPolicy)
+{
+	SetAttached(pResolvePolicy, resolvePolicyLink, pPolicy);
+}
+
+void P4BridgeServer::ResolvePolicyDeleted(P4ResolvePolicy* pPolicy)
+{
+	std::lock_guard<std::recursive_mutex> guard(runMutex);
+	if (pResolvePolicy == pPolicy)
+	{
+		pResolvePolicy = NULL;
+		resolvePolicyLink.reset();
+	}
+}
+
 int P4BridgeServer::GetServerProtocols(P4ClientError **err)
 {
 	LOG_ENTRY();
@@ -1335,6 +1905,7 @@ void  P4BridgeServer::set_connection(const char* newPort,
 
 void P4BridgeServer::set_client( const char* newVal )
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 		// close the connection to force reconnection with new value(s)
 	LOG_ENTRY();
 	this->client = (newVal ? newVal : "");
@@ -1352,6 +1923,7 @@ void P4BridgeServer::set_client( const char* newVal )
 
 void P4BridgeServer::set_user( const char* newVal )
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 		// close the connection to force reconnection with new value(s)
 	LOG_ENTRY();
 	this->user = (newVal ? newVal : "");
@@ -1373,6 +1945,7 @@ void P4BridgeServer::set_port( const char* newVal )
 	LOG_ENTRY();
 		// close the connection to force reconnection with new value(s)
 		close_connection();
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	this->p4port = (newVal ? newVal : "");
 }
 
@@ -1386,6 +1959,7 @@ void P4BridgeServer::set_port( const char* newVal )
 
 void P4BridgeServer::set_password( const char* newVal )
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	// close the connection to force reconnection with new value(s)
 	LOG_ENTRY();
 	this->password = (newVal ? newVal : "");
@@ -1403,6 +1977,7 @@ void P4BridgeServer::set_password( const char* newVal )
 
 void P4BridgeServer::set_ticketFile(const char* newVal)
 	{
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 		// close the connection to force reconnection with new value(s)
 	LOG_ENTRY();
 	this->ticketFile = (newVal ? newVal : "");
@@ -1446,6 +2021,7 @@ void P4BridgeServer::set_programVer( const char* newVal )
 
 string P4BridgeServer::get_client()
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	LOG_ENTRY();
 	return getConnection()->GetClient().Text();
 }
@@ -1460,6 +2036,7 @@ string P4BridgeServer::get_client()
 
 string P4BridgeServer::get_user()
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	LOG_ENTRY();
 	return getConnection()->GetUser().Text();
 }
@@ -1474,6 +2051,7 @@ string P4BridgeServer::get_user()
 
 string P4BridgeServer::get_port()
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	LOG_ENTRY();
 	return getConnection()->GetPort().Text();
 }
@@ -1488,6 +2066,7 @@ string P4BridgeServer::get_port()
 
 string P4BridgeServer::get_password()
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	LOG_ENTRY();
 	return getConnection()->GetPassword().Text();
 }
@@ -1568,34 +2147,10 @@ string P4BridgeServer::get_programVer()
 string P4BridgeServer::get_config_Int(const char * cwd)
 {
 	// NOTE: do not use _enviro, this is a hypothetical question about a directory
-	Enviro enviroLocal;
-	LOG_LOC();
-
-	// update (not set) P4CONFIG to _enviro's.  This allows API users to use "Update"
-	// to alter the P4CONFIG locally without setting in the system registry
-
-	LOCK(GetEnviroLock());
-	// if the P4CONFIG for the env is null, don't bother updating enviroLocal
-
-	const char* curConfig = GetEnviro()->Get("P4CONFIG");
-    LOG_DEBUG1(4, "GetEnviro()->Get(P4CONFIG) = %s", curConfig);
-	if (curConfig != NULL)
-		enviroLocal.Update("P4CONFIG", curConfig);
-
-	// reload the configuration
-	LOG_DEBUG1(4, "Set enviroLocal to %s", cwd);
-	enviroLocal.Config(StrRef(cwd));
-
-	StrBuf sb = enviroLocal.GetConfig();
-	LOG_DEBUG1(4, "enviroLocal config is %s", sb.Text());
-
-	if (sb == "noconfig")
-	return sb.Text();
-
-	const StrArray* ret = enviroLocal.GetConfigs();
-	const StrBuf* sbp = ret->Get(0);
-	LOG_DEBUG1(4, "enviroLocal config is %s", sbp->Text());
-		return sbp->Text();
+	ConfigValues values;
+	ConfigCache::Resolve(cwd, values);
+	LOG_DEBUG1(4, "config for cwd is %s", values.configFile.c_str());
+	return values.configFile;
 }
 
 string P4BridgeServer::get_config(const char * cwd)
@@ -1648,6 +2203,61 @@ const char* P4BridgeServer::Get( const char *var )
 	return P4BridgeServer::Get_Int( var );
 }
 
+bool P4BridgeServer::GetEnviroValue( const char *var, string &value )
+{
+	LOCK(GetEnviroLock());
+	const char *val = GetEnviro()->Get( var );
+	value = val ? val : "";
+	return val != NULL;
+}
+
+/*******************************************************************************
+ *
+ * UpdateVar
+ *
+ *  Set one of this server's own settings. The connection is given the
+ *   settings it has a setter for: P4TICKETS (unless a ticket file was set),
+ *   P4TRUST, P4IGNORE, P4HOST, P4LANGUAGE and P4ENVIRO. Unsetting one only
+ *   reaches the connection when it is next created.
+ *
+ ******************************************************************************/
+
+void P4BridgeServer::UpdateVar( const char *var, const char *value )
+{
+	serverEnviro.Update(var, value);
+
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
+	if (pConnection)
+		ApplyVars(pConnection);
+}
+
+void P4BridgeServer::ApplyVars( P4Connection* connection )
+{
+	std::shared_ptr<const EnviroSnapshot::Vars> vars = serverEnviro.Overrides();
+	for (EnviroSnapshot::Vars::const_iterator it = vars->begin(); it != vars->end(); ++it)
+	{
+		if (!it->second.set)
+			continue;
+
+		const char *val = it->second.value.c_str();
+		if (it->first == "P4TICKETS")
+		{
+			if (ticketFile.empty())
+				connection->SetTicketFile(val);
+		}
+		else if (it->first == "P4TRUST")
+			connection->SetTrustFile(val);
+		else if (it->first == "P4IGNORE")
+			connection->SetIgnoreFile(val);
+		else if (it->first == "P4HOST")
+			connection->SetHost(val);
+		else if (it->first == "P4LANGUAGE")
+			connection->SetLanguage(val);
+		else if (it->first == "P4ENVIRO")
+			connection->SetEnviroFile(val);
+	}
+}
+
 void P4BridgeServer::Set_Int( const char *var, const char *value )
 {
 	LOCK(GetEnviroLock());
@@ -1658,6 +2268,9 @@ void P4BridgeServer::Set_Int( const char *var, const char *value )
 	// This may be fixed in the enviro rework in p21.2 
 	Error e;
 	GetEnviro()->Set( var, value, &e );  // write to registry (NT) or enviro file (Linux,OSX)
+	TicketCache::EnviroChanged();
+	ConfigCache::Invalidate();
+	EnviroSnapshot::GlobalChanged();
 	
         if( e.Test() )
         {
@@ -1687,6 +2300,9 @@ void P4BridgeServer::Update_Int( const char *var, const char *value )
 {
 	LOCK(GetEnviroLock());
 	GetEnviro()->Update( var, value);
+	TicketCache::EnviroChanged();
+	ConfigCache::Invalidate();
+	EnviroSnapshot::GlobalChanged();
 }
 
 void P4BridgeServer::Update( const char *var, const char *value )
@@ -1707,6 +2323,9 @@ void P4BridgeServer::Reload_Int()
 {
 	LOCK(GetEnviroLock());
 	GetEnviro()->Reload();
+	TicketCache::EnviroChanged();
+	ConfigCache::Invalidate();
+	EnviroSnapshot::GlobalChanged();
 }
 
 void P4BridgeServer::Reload()
@@ -1735,6 +2354,7 @@ void P4BridgeServer::ListEnviro(Enviro *penviro)
 
 void P4BridgeServer::SetProtocol_Int(const char *var, const char *value)
 {
+	std::lock_guard<std::recursive_mutex> guard(connectionMutex);
 	// Note: this must be called before connecting or the server will ignore
 	//       and we only do that when getConnection() is called
 	LOG_ENTRY();
@@ -1886,6 +2506,49 @@ void P4BridgeServer::CallBinaryResultsCallbackFn( int cmdId, void * data, int le
 	}
 }
 
+/*******************************************************************************
+ *
+ *  CallProgressCallbackFn
+ *
+ *  Simple wrapper to call the callback function (if it has been set).
+ *   Returns non zero if the callback asked to cancel the command.
+ *
+ ******************************************************************************/
+
+int P4BridgeServer::CallProgressCallbackFn( int cmdId, const ProgressInfo * info )
+{
+	try
+	{
+		if ((cmdId > 0) && (pProgressCallbackFn))
+		{
+			return (*pProgressCallbackFn)( cmdId, info );
+		}
+	}
+	catch (exception& e)
+	{
+		LOG_LOC();
+		getConnection()->getUi()->HandleError( E_FATAL, 0, e.what() );
+	}
+	return 0;
+}
+
+int P4BridgeServer::CallInputDataCallbackFn( InputDataCallbackFn * pFn, int cmdId, char * buffer, int size )
+{
+	try
+	{
+		if (pFn)
+		{
+			return (*pFn)( cmdId, buffer, size );
+		}
+	}
+	catch (exception& e)
+	{
+		LOG_LOC();
+		getConnection()->getUi()->HandleError( E_FATAL, 0, e.what() );
+	}
+	return -1;
+}
+
 // Set the call back function to receive the tagged output
 void P4BridgeServer::SetTaggedOutputCallbackFn(IntTextTextCallbackFn* pNew)
 {
@@ -1936,6 +2599,13 @@ void P4BridgeServer::SetInfoResultsCallbackFn(IntIntIntTextCallbackFn* pNew)
 	pInfoResultsCallbackFn = pNew;
 }
 
+// Set the call back function to receive progress
+void P4BridgeServer::SetProgressCallbackFn(ProgressCallbackFn* pNew, int intervalMs)
+{
+	pProgressCallbackFn = pNew;
+	progressIntervalMs = (intervalMs > 0) ? intervalMs : 0;
+}
+
 // Set the call back function to receive the text output
 void P4BridgeServer::SetTextResultsCallbackFn(TextCallbackFn* pNew)
 {
@@ -2045,11 +2715,13 @@ int P4BridgeServer::IsIgnored_Int( const StrPtr &path )
 	// If the Enviro copy constructor wasn't broken on NT, I'd use it instead.
 	// ClientApi client(GetEnviro());  // pass in settings from current enviro
 
-	char *iValue = GetEnviro()->Get("P4IGNORE");
+	// read from the shared copy, without the enviro lock
+	string iValue;
+	const char *pValue = EnviroSnapshot::GetGlobal("P4IGNORE", iValue) ? iValue.c_str() : NULL;
 
 	Error e;
 	Enviro tenviro;
-	tenviro.Set("P4IGNORE", iValue, &e);
+	tenviro.Set("P4IGNORE", pValue, &e);
     if( e.Test() )
     {
         StrBuf errbuf;
@@ -2089,46 +2761,45 @@ int P4BridgeServer::IsIgnored( const StrPtr &path )
 
 string P4BridgeServer::GetTicketFile()
 {
+	// ticketfile - where users login tickets are stashed, read from the
+	//  shared copy when it is set
+	string value;
+	if (EnviroSnapshot::GetGlobal("P4TICKETS", value))
+		return value;
+
 	LOCK(GetEnviroLock());
-        StrBuf ticketfile;
-	char* c;
+	StrBuf ticketfile;
 	HostEnv h;
-
-	// ticketfile - where users login tickets are stashed
-        c = GetEnviro()->Get("P4TICKETS");
-        if(c)
-	{
-		ticketfile.Set( c );
-	}
-	else 
-	{
-		h.GetTicketFile( ticketfile, GetEnviro() );
-	}
+	h.GetTicketFile( ticketfile, GetEnviro() );
 	return ticketfile.Text();
 }
 
 string P4BridgeServer::GetTicket(char* uri, char* user)
 {
-	LOCK(GetEnviroLock());
-        StrBuf ticketfile;
-	char* c;
-	HostEnv h;
+	// the file is only read when it changed since the last lookup
+	string ticket;
+	TicketCache::Lookup(NULL, uri, user, ticket);
+	return ticket;
+}
 
-	// ticketfile - where users login tickets are stashed
-        c = GetEnviro()->Get( "P4TICKETS" );
-	if (c)
-	{
-		ticketfile.Set( c );
-	}
-	else 
+string P4BridgeServer::GetServerTicketFile()
+{
 	{
-		h.GetTicketFile( ticketfile, GetEnviro() );
+		std::lock_guard<std::recursive_mutex> guard(connectionMutex);
+		if (!ticketFile.empty())
+			return ticketFile;
 	}
-    Ticket t(&ticketfile);
-    StrBuf port(uri);
-    StrBuf userStr(user);
+	string value;
+	if (serverEnviro.Get("P4TICKETS", value))
+		return value;
+	return "";
+}
 
-	return t.GetTicket(port, userStr);
+string P4BridgeServer::GetServerTicket(const char* port, const char* user)
+{
+	string ticket;
+	TicketCache::Lookup(GetServerTicketFile().c_str(), port, user, ticket);
+	return ticket;
 }
 
 LogCallbackFn* P4BridgeServer::SetLogCallFn(LogCallbackFn *log_fn)
@@ -2212,3 +2883,38 @@ int ParallelTransfer::Transfer(ClientApi* client,
 	// not bridge server to tell?  fail!
 	return (!pBridgeServer) ? 1 : pBridgeServer->DoTransfer(client, ui, cmd, args, pVars, threads, e);
 }
+
+// the prepared command
+P4PreparedCommand::P4PreparedCommand(const char *_cmd, int _cmdId, int _tagged, char const * const * _args, int argc) :
+	p4base(tP4PreparedCommand),
+	cmd(_cmd ? _cmd : ""),
+	cmdId(_cmdId),
+	tagged(_tagged),
+	runCount(0)
+{
+	args.reserve(argc > 0 ? argc : 0);
+	for (int i = 0; i < argc; i++)
+	{
+		args.push_back(_args[i] ? _args[i] : "");
+	}
+	// build argv once all the strings are in place so the pointers stay valid
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		argv.push_back(&args[i][0]);
+	}
+}
+
+P4PreparedCommand::~P4PreparedCommand()
+{
+	LOG_LOC();
+}
+
+void P4PreparedCommand::SetProjection(char const * const * keys, int count)
+{
+	projection.clear();
+	for (int i = 0; i < count; i++)
+	{
+		if (keys[i])
+			projection.insert(keys[i]);
+	}
+}
@@ -39,9 +39,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "P4Connection.h"
 
 #include "Lock.h"
+#include "EnviroSnapshot.h"
+#include "ServerLink.h"
 
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
+#include <mutex>
+#include <atomic>
 
 using std::string;
 
@@ -67,6 +73,48 @@ protected:
 	P4BridgeServer *pBridgeServer;
 };
 
+/*
+	Prepared command - captures the command, arguments, tag mode and field projection
+	once so that it can be executed many times with minimal per-run setup
+*/
+
+class P4PreparedCommand : public p4base
+{
+public:
+	P4PreparedCommand(const char *cmd, int cmdId, int tagged, char const * const * args, int argc);
+	virtual ~P4PreparedCommand();
+
+	virtual int Type(void) { return tP4PreparedCommand; }
+
+	// Restrict the tagged output to the given field names, count == 0 clears it
+	void SetProjection(char const * const * keys, int count);
+	const std::set<string> * GetProjection() const { return projection.empty() ? NULL : &projection; }
+
+	const char * GetCmd() const { return cmd.c_str(); }
+	int GetCmdId() const { return cmdId; }
+	int GetTagged() const { return tagged; }
+	int GetArgc() const { return (int) argv.size(); }
+	char * const * GetArgv() const { return argv.empty() ? NULL : &argv[0]; }
+
+	// number of times the command has been executed
+	int GetRunCount() const { return runCount; }
+	void IncrementRunCount() { runCount++; }
+
+protected:
+	string cmd;
+	int cmdId;
+	int tagged;
+
+	// a prepared command can be run on several servers at once
+	std::atomic<int> runCount;
+
+	// argv points into args, so args must not be modified after construction
+	std::vector<string> args;
+	std::vector<char *> argv;
+
+	std::set<string> projection;
+};
+
 /*******************************************************************************
  *
  *  This is the function prototypes for the call backs used to log status, 
@@ -206,6 +254,11 @@ protected:
 	PromptCallbackFn * pPromptCallbackFn;
 	ParallelTransferCallbackFn* pParallelTransferCallbackFn;
 
+	// Receives the progress of sync, submit, shelve, print and the like, no
+	//  more often than every progressIntervalMs
+	ProgressCallbackFn* pProgressCallbackFn;
+	int progressIntervalMs;
+
 	ResolveCallbackFn * pResolveCallbackFn;
 	ResolveACallbackFn * pResolveACallbackFn;
 
@@ -285,6 +338,11 @@ public:
 	// The 800 pound gorilla in the room, execute a command
 	int run_command( const char *cmd, int cmdId, int tagged, char const * const * args, int argc );
 
+	// Execute a command captured by a P4PreparedCommand, cmdId zero runs it
+	//  with the id it was prepared with. The prepared command is not changed,
+	//  so it can be run with several ids at once.
+	int run_prepared( P4PreparedCommand *prepared, int cmdId );
+
 	int resolve( const char *file, int tagged );
 
 	// Set the connection data used
@@ -314,6 +372,9 @@ public:
 	/* it is inherited by the P4Connection class */
 	/* beware, the client has a default Enviro too, and it might not match! */
 
+	// The static functions below read and change the process wide settings,
+	//  under the enviro lock. A server's own settings are read with GetVar().
+
 	static const char* Get( const char *var );
 	static void Set( const char *var, const char *value );
 	static void Update(const char *var, const char *value );
@@ -322,6 +383,24 @@ public:
 	static void ListEnviro(Enviro* ptr);
 	static Enviro *GetEnviro();
 
+	// Copy a value from the static Enviro under its lock, returns false if
+	//  the variable is not set
+	static bool GetEnviroValue( const char *var, string &value );
+
+	// This server's own settings, seeded from the static Enviro. Updating
+	//  them does not change the static Enviro or any other server.
+	bool GetVar( const char *var, string &value ) const { return serverEnviro.Get(var, value); }
+	void UpdateVar( const char *var, const char *value );
+	void ResetVar( const char *var ) { serverEnviro.Reset(var); }
+
+	// The ticket file this server's commands use: the one given to
+	//  set_ticketFile(), else this server's P4TICKETS, else empty for the
+	//  default ticket file
+	string GetServerTicketFile();
+
+	// The ticket this server has for port and user, from its ticket file
+	string GetServerTicket( const char* port, const char* user );
+
 	// set things like "-vnet.maxwait=5"  here.
 	// or just a number like "5"
 	//  output will be on stdout
@@ -336,10 +415,75 @@ public:
 
 	void cancel_command(int cmdId);
 	bool IsConnected();
+
+	// Limit how long commands may run, in milliseconds, zero for no limit.
+	//  deadlineMs is measured from the start of the command, inactivityMs
+	//  from the last output received. Applies to commands run after the call.
+	void SetCommandTimeouts(int deadlineMs, int inactivityMs);
+
+	// Did the last command time out? Returns one of the CMD_* timeout values
+	int GetCommandTimeoutStatus(int cmdId);
+
+	// How tagged output is stored, one of the TAGGED_INTERN_ values. Applies
+	//  to commands run after the call.
+	void SetTaggedIntern(int mode);
+
+	// How diffs run on the client are reported, one of the DIFF_OUTPUT_
+	//  values. Applies to commands run after the call.
+	void SetDiffMode(int mode);
+
+	// Where the strings returned by this server's exports are allocated, one
+	//  of the STRING_SLAB_ values. A slab string must not be used, or passed
+	//  to ReleaseString(), after ReleaseAllStrings(), or after the next
+	//  command with STRING_SLAB_PER_COMMAND.
+	void SetStringSlab(int mode);
+	Utils::StringSlab* GetStringSlab();
+	void ReleaseAllStrings();
+
+	// Move the results of a command to temporary files in dir once they
+	//  pass thresholdBytes, zero to keep them in memory. See
+	//  P4BridgeClient::SetSpill().
+	void SetResultSpill(long long thresholdBytes, const char* dir);
+
+	// Idle connection management, see IdleConnectionManager. DisconnectIfIdle
+	//  returns 1 if the connection was closed, a running command is never
+	//  interrupted. GetIdleState returns IDLE_STATE_LIVE for a server that is
+	//  running a command rather than waiting for it.
+	int DisconnectIfIdle(long long now, int idleMs);
+	bool IsIdleDisconnected();
+	int GetIdleState();
+
+	// Reconnect now rather than on the next command, so a pooled server is
+	//  ready when it is handed out
+	int Prewarm();
+
+	// Update the index from the tagged output of commands run on this server,
+	//  NULL to stop. FileIndexDeleted is called by the index when it goes away.
+	void SetFileIndex(P4FileIndex* pIndex);
+	void FileIndexDeleted(P4FileIndex* pIndex);
+
+	// Stream the tagged output of commands run on this server to the writer,
+	//  NULL to stop. NdjsonWriterDeleted is called by the writer when it goes
+	//  away.
+	void SetNdjsonWriter(P4NdjsonWriter* pWriter);
+	void NdjsonWriterDeleted(P4NdjsonWriter* pWriter);
+
+	// Record the calls the p4api makes while commands run on this server to
+	//  a file, see CallRecorder.h. False if the file can not be written.
+	bool StartCallRecording(const char* path);
+	void StopCallRecording();
+
+	// Decide the resolves of commands run on this server with the policy
+	//  instead of the resolve callbacks, NULL to stop. ResolvePolicyDeleted
+	//  is called by the policy when it goes away.
+	void SetResolvePolicy(P4ResolvePolicy* pPolicy);
+	void ResolvePolicyDeleted(P4ResolvePolicy* pPolicy);
 		
 	// If the P4 Server is Unicode enabled, the output will be in
 	// UTF-8 or UTF-16 based on the char set specified by the client
 	void UseUnicode(int val) { isUnicode = val; }
+	// -1 until the server has been asked
+	int GetUnicodeState() { return isUnicode; }
 
 	// Put the calls to the callback in Structured Exception Handlers to catch
 	//  any problems in the call like bad function pointers.
@@ -348,6 +492,8 @@ public:
 	void CallTaggedOutputCallbackFn( int cmdId, int objId, const char *pKey, const char * pVal );
 	void CallErrorCallbackFn( int cmdId, int severity, int errorId, const char * errMsg );
 	void CallBinaryResultsCallbackFn( int cmdId, void * data, int length );
+	int CallProgressCallbackFn( int cmdId, const ProgressInfo * info );
+	int CallInputDataCallbackFn( InputDataCallbackFn * pFn, int cmdId, char * buffer, int size );
 
 	// Set the call back function to receive the tagged output
 	void SetTaggedOutputCallbackFn(IntTextTextCallbackFn* pNew);
@@ -367,6 +513,12 @@ public:
 	// Set the call back function to receive the information output
 	void SetInfoResultsCallbackFn(IntIntIntTextCallbackFn* pNew);
 
+	// Set the call back function to receive progress, at most once every
+	//  intervalMs milliseconds. NULL stops progress reporting.
+	void SetProgressCallbackFn(ProgressCallbackFn* pNew, int intervalMs);
+	ProgressCallbackFn* GetProgressCallbackFn() { return pProgressCallbackFn; }
+	int GetProgressInterval() { return progressIntervalMs; }
+
 	// Set the call back function to receive the text output
 	void SetTextResultsCallbackFn(TextCallbackFn* pNew);
 
@@ -382,6 +534,8 @@ public:
 	
 	static int IsIgnored( const StrPtr &path );
 
+	// The process wide ticket file and tickets, see GetServerTicket() for
+	//  a server's own
 	static string GetTicketFile( );
 	static string GetTicket( char* port, char* user );
 
@@ -406,6 +560,12 @@ protected:
 
 	string pCwd;	// cache it for reconnects
 
+	// settings of this server, see UpdateVar()
+	EnviroSnapshot serverEnviro;
+
+	// Pass the settings this server has its own values for to a connection
+	void ApplyVars( P4Connection* connection );
+
 	// UI support
 
 	// If the P4 Server is Unicode enabled, the output will be in
@@ -420,6 +580,36 @@ protected:
 	
 	P4Connection* getConnection(int id = 99999999);
 
+	int run_command_int( const char *cmd, int cmdId, int tagged, char const * const * args, int argc,
+		const std::set<string> *projection );
+	int execute_command( const char *cmd, int cmdId, int tagged, char const * const * args, int argc,
+		const std::set<string> *projection );
+
+	// Reconnect if needed, returns 0 and reports the error on failure
+	int init_connection( P4Connection* connection, P4BridgeClient* ui, Error *e );
+
+	// held while a command runs, and by close_connection() and disconnect(),
+	//  so the idle manager leaves a running command's connection alone.
+	// Lock order, outermost first:
+	//   a ServerLink lock or IdleConnectionManager servers_mutex, runMutex,
+	//   BridgeLock, connectionMutex, enviro lock
+	//  so anything that needs runMutex takes it before BridgeLock.
+	std::recursive_mutex runMutex;
+
+	// held briefly by the accessors while they use pConnection and by
+	//  anything that creates, disconnects or deletes it, never for a whole
+	//  command, so an accessor does not wait for a running command
+	std::recursive_mutex connectionMutex;
+
+	// Switch the index, writer or policy a server uses, see ServerLink
+	template<class T>
+	void SetAttached(T*& current, std::shared_ptr<ServerLink>& currentLink, T* next);
+
+	// Set the program name and version on the connection, filling in any the
+	//  client did not supply from the identity computed once per process
+	void SetProgramIdentity( P4Connection* connection );
+	static void GetProcessProgramIdentity( string &name, string &version );
+
 
 	static int IsIgnored_Int( const StrPtr &path );
 	string get_config_Int( );
@@ -449,6 +639,39 @@ protected:
 	int connecting;
 
 	int disposed;
+
+	// Per command time limits passed to the connection, in milliseconds
+	int commandDeadlineMs;
+	int commandInactivityMs;
+
+	// Index kept up to date from the commands run, may be NULL
+	P4FileIndex* pFileIndex;
+	std::shared_ptr<ServerLink> fileIndexLink;
+
+	// Writer the tagged output of the commands run is streamed to, may be NULL
+	P4NdjsonWriter* pNdjsonWriter;
+	std::shared_ptr<ServerLink> ndjsonWriterLink;
+
+	// Recorder the calls of the commands run are written to, may be NULL
+	P4CallRecorder* pCallRecorder;
+
+	// Policy deciding the resolves of the commands run, may be NULL
+	P4ResolvePolicy* pResolvePolicy;
+	std::shared_ptr<ServerLink> resolvePolicyLink;
+
+	// How the tagged output of the commands run is stored
+	int taggedInternMode;
+
+	// How the diffs run by commands are reported
+	int diffMode;
+
+	// Results larger than this are spilled to files in spillDir, 0 for never
+	long long spillThreshold;
+	string spillDir;
+
+	// Strings returned across the boundary when stringSlabMode is set
+	Utils::StringSlab stringSlab;
+	int stringSlabMode;
 };
 
 
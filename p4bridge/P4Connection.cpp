@@ -6,6 +6,8 @@
 
 #include "clientapi.h"
 
+#include <chrono>
+
 #ifdef _DEBUG_MEMORY
 P4Connection::P4Connection(P4BridgeServer* pServer, int _cmdId) : ClientApi() , p4base(tP4Connection)
 #else
@@ -18,6 +20,15 @@ P4Connection::P4Connection(P4BridgeServer* pServer, int _cmdId) : ClientApi()
 
 	ui = new P4BridgeClient(pServer, this);
 		isAlive = 1;
+
+	deadlineMs = 0;
+	inactivityMs = 0;
+	commandStart = 0;
+	lastActivity = 0;
+	timeoutStatus = CMD_NOT_TIMED_OUT;
+
+	idleDisconnected = 0;
+	ReleaseTime = NowMs();
 }
 
 P4Connection::~P4Connection(void)
@@ -40,9 +51,50 @@ void P4Connection::cancel_command()
 	isAlive = 0;
 }
 
+static std::atomic<P4Connection::ClockFn*> pClock(NULL);
+
+void P4Connection::SetClock(ClockFn* clock)
+{
+	pClock = clock;
+}
+
+long long P4Connection::NowMs()
+{
+	ClockFn* clock = pClock;
+	if (clock)
+	{
+		return (*clock)();
+	}
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void P4Connection::StartCommandTimer()
+{
+	commandStart = NowMs();
+	lastActivity = commandStart;
+	timeoutStatus = CMD_NOT_TIMED_OUT;
+}
+
 // KeepAlive functionality
 int	P4Connection::IsAlive()
 {
+	if (isAlive && (deadlineMs > 0 || inactivityMs > 0))
+	{
+		long long now = NowMs();
+		if (deadlineMs > 0 && (now - commandStart) >= deadlineMs)
+		{
+			LOG_DEBUG1(3, "P4Connection::IsAlive command %d exceeded its deadline", cmdId);
+			timeoutStatus = CMD_DEADLINE_EXCEEDED;
+			isAlive = 0;
+		}
+		else if (inactivityMs > 0 && (now - lastActivity) >= inactivityMs)
+		{
+			LOG_DEBUG1(3, "P4Connection::IsAlive command %d timed out waiting for output", cmdId);
+			timeoutStatus = CMD_INACTIVITY_TIMEOUT;
+			isAlive = 0;
+		}
+	}
 	LOG_DEBUG1(4, "P4Connection:::IsAlive == %d", isAlive);
 	return isAlive;
 }
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <atomic>
+
 class Client;
 class P4BridgeClient;
 class P4BridgeServer;
 
+// Values returned by P4Connection::GetTimeoutStatus()
+#define CMD_NOT_TIMED_OUT		0
+#define CMD_DEADLINE_EXCEEDED	1
+#define CMD_INACTIVITY_TIMEOUT	2
+
 #ifdef _DEBUG_MEMORY
 class P4Connection : public ClientApi, public KeepAlive, p4base
 #else
@@ -17,6 +24,20 @@ private:
 	int	isAlive;
 	int cmdId;
 
+	// Per command time limits in milliseconds, zero means no limit
+	int deadlineMs;
+	int inactivityMs;
+
+	// Start of the current command and time of the last output received
+	long long commandStart;
+	std::atomic<long long> lastActivity;
+
+	// Why the current command was cut off, if it was
+	int timeoutStatus;
+
+	// Set when the IdleConnectionManager disconnected this connection
+	int idleDisconnected;
+
 	// these are for the connection manager
 	P4Connection(P4BridgeServer* pServer, int cmdId);
 	virtual ~P4Connection();
@@ -44,6 +65,17 @@ public:
 
 	void cancel_command();
 
+	// Command deadline and inactivity timeout, enforced in IsAlive()
+	void SetTimeouts(int deadline, int inactivity) { deadlineMs = deadline; inactivityMs = inactivity; }
+	int GetInactivityTimeout() const { return inactivityMs; }
+	void StartCommandTimer();
+
+	// Record that output was received for the running command
+	void Touch() { lastActivity = NowMs(); }
+
+	// CMD_NOT_TIMED_OUT, CMD_DEADLINE_EXCEEDED or CMD_INACTIVITY_TIMEOUT
+	int GetTimeoutStatus() const { return timeoutStatus; }
+
 	void SetCharset( CharSetApi::CharSet c, CharSetApi::CharSet filec );
 
 	const StrPtr	&GetClient();
@@ -52,8 +84,17 @@ public:
 
 	void		SetTicketFile(const char *c);
 
+	// Time the connection was last used, in NowMs() units
 	unsigned long long ReleaseTime;
 
+	// Milliseconds from a steady clock, for timeouts and idle tracking
+	static long long NowMs();
+
+	// Replace the clock behind NowMs(), NULL restores the steady clock.
+	//  Lets the timeout tests run without sleeping.
+	typedef long long ClockFn();
+	static void SetClock(ClockFn* clock);
+
 #ifdef _DEBUG_MEMORY
 	    // Simple type identification for registering objects
 	virtual int Type(void) {return tP4Connection;}
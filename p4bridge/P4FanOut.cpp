@@ -0,0 +1,369 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: P4FanOut.cpp
+ *
+ * Description	:  P4FanOut
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4Connection.h"
+#include "P4FanOut.h"
+
+#include <thread>
+#include <atomic>
+
+#ifdef OS_NT
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#define DELETE_OBJECT(obj) if( obj != NULL ) { delete obj; obj = NULL; }
+
+// Values returned by ProbeConnect()
+#define PROBE_FAILED		0
+#define PROBE_CONNECTED		1
+#define PROBE_TIMED_OUT		2
+#define PROBE_SKIPPED		3
+
+// Milliseconds left before deadline, 0 once it has passed
+static int RemainingMs(long long deadline)
+{
+	long long left = deadline - P4Connection::NowMs();
+	return (left > 0) ? (int) left : 0;
+}
+
+/*******************************************************************************
+ *
+ *  ProbeConnect
+ *
+ *  The P4API connect blocks for as long as the operating system lets it and
+ *   does not poll the KeepAlive, so a target that drops packets would hold
+ *   its thread well past the deadline. Open a plain TCP connection to the
+ *   port first, waiting at most timeoutMs, and only hand the target to the
+ *   P4API once it answers. Ports that are not TCP (rsh:, jsh:) are skipped.
+ *
+ ******************************************************************************/
+
+static int ProbeConnect(const string &port, int timeoutMs)
+{
+	string addr = port;
+
+	// strip a transport prefix such as "tcp:", "ssl6:" or "tcp46:"
+	size_t colon = addr.find(':');
+	if (colon != string::npos)
+	{
+		string prefix = addr.substr(0, colon);
+		if ((prefix == "rsh") || (prefix == "jsh"))
+			return PROBE_SKIPPED;
+		if ((prefix.compare(0, 3, "tcp") == 0) || (prefix.compare(0, 3, "ssl") == 0))
+			addr = addr.substr(colon + 1);
+	}
+
+	string host = "localhost";
+	string service = addr;
+	size_t sep = addr.rfind(':');
+	if (sep != string::npos)
+	{
+		host = addr.substr(0, sep);
+		service = addr.substr(sep + 1);
+		if ((host.size() > 1) && (host[0] == '[') && (host[host.size() - 1] == ']'))
+			host = host.substr(1, host.size() - 2);
+	}
+	if (host.empty() || service.empty())
+		return PROBE_SKIPPED;
+
+#ifdef OS_NT
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		return PROBE_SKIPPED;
+#endif
+
+	int result = PROBE_FAILED;
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	struct addrinfo *info = NULL;
+	if (getaddrinfo(host.c_str(), service.c_str(), &hints, &info) == 0)
+	{
+		long long deadline = P4Connection::NowMs() + timeoutMs;
+		for (struct addrinfo *ai = info; ai && (result == PROBE_FAILED); ai = ai->ai_next)
+		{
+			long long left = deadline - P4Connection::NowMs();
+			if (left <= 0)
+			{
+				result = PROBE_TIMED_OUT;
+				break;
+			}
+#ifdef OS_NT
+			SOCKET fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+			if (fd == INVALID_SOCKET)
+				continue;
+			u_long nonBlocking = 1;
+			ioctlsocket(fd, FIONBIO, &nonBlocking);
+			int rc = connect(fd, ai->ai_addr, (int) ai->ai_addrlen);
+			bool pending = (rc != 0) && (WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+			int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+			if (fd < 0)
+				continue;
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+			int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+			bool pending = (rc != 0) && (errno == EINPROGRESS);
+#endif
+			if (rc == 0)
+				result = PROBE_CONNECTED;
+			if (pending)
+			{
+				fd_set writeSet, errorSet;
+				FD_ZERO(&writeSet);
+				FD_ZERO(&errorSet);
+				FD_SET(fd, &writeSet);
+				FD_SET(fd, &errorSet);
+				struct timeval tv;
+				tv.tv_sec = (long) (left / 1000);
+				tv.tv_usec = (long) ((left % 1000) * 1000);
+				int ready = select((int) fd + 1, NULL, &writeSet, &errorSet, &tv);
+				if (ready == 0)
+				{
+					result = PROBE_TIMED_OUT;
+				}
+				else if ((ready > 0) && FD_ISSET(fd, &writeSet))
+				{
+					int err = 0;
+					socklen_t len = sizeof(err);
+					getsockopt(fd, SOL_SOCKET, SO_ERROR, (char *) &err, &len);
+					if (err == 0)
+						result = PROBE_CONNECTED;
+				}
+			}
+#ifdef OS_NT
+			closesocket(fd);
+#else
+			close(fd);
+#endif
+		}
+		freeaddrinfo(info);
+	}
+	else
+	{
+		// let the P4API report the name lookup failure
+		result = PROBE_SKIPPED;
+	}
+
+#ifdef OS_NT
+	WSACleanup();
+#endif
+	return result;
+}
+
+P4FanOut::P4FanOut() :
+	p4base(tP4FanOut)
+{
+}
+
+P4FanOut::~P4FanOut()
+{
+	for (size_t i = 0; i < targets.size(); i++)
+	{
+		Clear(targets[i]);
+	}
+}
+
+void P4FanOut::Clear(Target &target)
+{
+	DELETE_OBJECT(target.pServer);
+	DELETE_OBJECT(target.pConnectError);
+	target.status = FANOUT_NOT_RUN;
+	target.elapsedMs = 0;
+}
+
+void P4FanOut::AddTarget(const char *port, const char *user, const char *password,
+	const char *client, const char *charset)
+{
+	Target target;
+	target.port = port ? port : "";
+	target.user = user ? user : "";
+	target.password = password ? password : "";
+	target.client = client ? client : "";
+	target.charset = charset ? charset : "";
+	target.pServer = NULL;
+	target.pConnectError = NULL;
+	target.status = FANOUT_NOT_RUN;
+	target.elapsedMs = 0;
+	targets.push_back(target);
+}
+
+/*******************************************************************************
+ *
+ *  Run
+ *
+ *  Run the command against every target using up to maxThreads threads. Each
+ *   thread takes the next target that has not been started, so slow servers
+ *   do not hold up the others. Results from a previous run are discarded.
+ *
+ ******************************************************************************/
+
+int P4FanOut::Run(const char *cmd, int tagged, char const * const * args, int argc,
+	int timeoutMs, int maxThreads)
+{
+	LOG_ENTRY();
+	int count = (int) targets.size();
+	if (count == 0)
+		return 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		Clear(targets[i]);
+	}
+
+	if ((maxThreads <= 0) || (maxThreads > count))
+		maxThreads = count;
+
+	std::atomic<int> next(0);
+	auto worker = [&]() {
+		int idx;
+		while ((idx = next++) < count)
+		{
+			RunTarget(targets[idx], idx, cmd, tagged, args, argc, timeoutMs);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < maxThreads; i++)
+	{
+		threads.push_back(std::thread(worker));
+	}
+	// the calling thread does its share too
+	worker();
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+
+	int succeeded = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (targets[i].status == FANOUT_OK)
+			succeeded++;
+	}
+	return succeeded;
+}
+
+void P4FanOut::RunTarget(Target &target, int idx, const char *cmd, int tagged,
+	char const * const * args, int argc, int timeoutMs)
+{
+	long long start = P4Connection::NowMs();
+	try
+	{
+		target.pServer = new P4BridgeServer(target.port.c_str(), target.user.c_str(),
+			target.password.c_str(), target.client.c_str());
+
+		// one deadline for the whole target: the probe, the help command run
+		//  while connecting and the command each get what is left of it
+		long long deadline = start + timeoutMs;
+		int probe = PROBE_SKIPPED;
+		if (timeoutMs > 0)
+		{
+			probe = ProbeConnect(target.port, RemainingMs(deadline));
+			if (RemainingMs(deadline) <= 0)
+				probe = PROBE_TIMED_OUT;
+			else
+				target.pServer->SetCommandTimeouts(RemainingMs(deadline), 0);
+		}
+
+		if (probe == PROBE_TIMED_OUT)
+		{
+			target.pConnectError = new P4ClientError(E_FAILED, 0,
+				"Connect to server did not complete within the timeout");
+			target.status = FANOUT_TIMED_OUT;
+		}
+		else if (!target.pServer->connected(&target.pConnectError))
+		{
+			target.status = FANOUT_CONNECT_FAILED;
+		}
+		else
+		{
+			if (target.pServer->unicodeServer())
+			{
+				target.pServer->set_charset(target.charset.empty() ? NULL : target.charset.c_str());
+			}
+
+			if (timeoutMs > 0)
+			{
+				// 0 would be no limit at all, a spent deadline cancels at once
+				int left = RemainingMs(deadline);
+				target.pServer->SetCommandTimeouts((left > 0) ? left : 1, 0);
+			}
+
+			if (target.pServer->run_command(cmd, idx, tagged, args, argc))
+				target.status = FANOUT_OK;
+			else if (target.pServer->GetCommandTimeoutStatus(idx) != CMD_NOT_TIMED_OUT)
+				target.status = FANOUT_TIMED_OUT;
+			else
+				target.status = FANOUT_FAILED;
+		}
+	}
+	catch (std::exception& e)
+	{
+		P4BridgeServer::ReportException(e, "P4FanOut::RunTarget");
+		target.status = FANOUT_FAILED;
+	}
+	target.elapsedMs = (int) (P4Connection::NowMs() - start);
+}
+
+P4BridgeServer* P4FanOut::GetServer(int idx)
+{
+	return ((idx >= 0) && (idx < Count())) ? targets[idx].pServer : NULL;
+}
+
+int P4FanOut::GetStatus(int idx)
+{
+	return ((idx >= 0) && (idx < Count())) ? targets[idx].status : FANOUT_NOT_RUN;
+}
+
+P4ClientError* P4FanOut::GetConnectError(int idx)
+{
+	return ((idx >= 0) && (idx < Count())) ? targets[idx].pConnectError : NULL;
+}
+
+int P4FanOut::GetElapsed(int idx)
+{
+	return ((idx >= 0) && (idx < Count())) ? targets[idx].elapsedMs : 0;
+}
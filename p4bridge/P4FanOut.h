@@ -0,0 +1,102 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: P4FanOut.h
+ *
+ * Description	:  P4FanOut runs one command against a list of servers at the
+ *  same time, each on its own thread. Every target gets its own
+ *  P4BridgeServer, which is kept after the run so its tagged output, text
+ *  and errors can be read with the usual result functions.
+ *
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+
+using std::string;
+
+class P4BridgeServer;
+class P4ClientError;
+
+// Values returned by P4FanOut::GetStatus()
+#define FANOUT_NOT_RUN			-3
+#define FANOUT_CONNECT_FAILED	-2
+#define FANOUT_TIMED_OUT		-1
+#define FANOUT_FAILED			0
+#define FANOUT_OK				1
+
+class P4FanOut : public p4base
+{
+public:
+	P4FanOut();
+	virtual ~P4FanOut();
+
+	virtual int Type(void) { return tP4FanOut; }
+
+	// Add a server to run the command against, charset may be NULL to use
+	//  utf8 for Unicode servers
+	void AddTarget(const char *port, const char *user, const char *password,
+		const char *client, const char *charset);
+
+	// Run the command against every target. timeoutMs limits each target,
+	//  maxThreads limits how many run at once (<= 0 for one per target).
+	//  Returns the number of targets the command succeeded on.
+	int Run(const char *cmd, int tagged, char const * const * args, int argc,
+		int timeoutMs, int maxThreads);
+
+	int Count() const { return (int) targets.size(); }
+
+	// Per target results, idx is the order targets were added
+	P4BridgeServer* GetServer(int idx);
+	int GetStatus(int idx);
+	P4ClientError* GetConnectError(int idx);
+	int GetElapsed(int idx);
+
+private:
+	struct Target
+	{
+		string port;
+		string user;
+		string password;
+		string client;
+		string charset;
+
+		P4BridgeServer* pServer;
+		P4ClientError* pConnectError;
+		int status;
+		int elapsedMs;
+	};
+
+	std::vector<Target> targets;
+
+	void RunTarget(Target &target, int idx, const char *cmd, int tagged,
+		char const * const * args, int argc, int timeoutMs);
+
+	void Clear(Target &target);
+};
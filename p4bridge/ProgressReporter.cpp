@@ -0,0 +1,148 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: ProgressReporter.cpp
+ *
+ * Description	:  P4ProgressTotals and P4BridgeProgress
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4Connection.h"
+#include "ProgressReporter.h"
+
+P4ProgressTotals::P4ProgressTotals(P4BridgeClient* pUi) :
+	pUi(pUi)
+{
+	Reset();
+}
+
+void P4ProgressTotals::Reset()
+{
+	memset(&info, 0, sizeof(info));
+	startMs = 0;
+	lastReportMs = 0;
+}
+
+int P4ProgressTotals::Report(int type, int intervalMs, bool force, bool done)
+{
+	long long now = P4Connection::NowMs();
+	if (!startMs)
+		startMs = now;
+
+	info.type = type;
+	if (!force && lastReportMs && (now - lastReportMs < intervalMs))
+		return 0;
+	lastReportMs = now;
+
+	info.done = done ? 1 : 0;
+	info.elapsedMs = now - startMs;
+	info.bytesPerSecond = (info.elapsedMs > 0) ? (info.bytesDone * 1000) / info.elapsedMs : 0;
+	return pUi->CallProgressCallbackFn(info);
+}
+
+P4BridgeProgress::P4BridgeProgress(P4ProgressTotals* pTotals, int type, int intervalMs) :
+	pTotals(pTotals),
+	type(type),
+	units(CPU_UNSPECIFIED),
+	intervalMs(intervalMs),
+	total(0),
+	bytesReported(0)
+{
+	// start the clock, and let the UI know transfers have begun
+	pTotals->Report(type, intervalMs, false, false);
+}
+
+long long P4BridgeProgress::ToBytes(P4INT64 count)
+{
+	switch (units)
+	{
+	case CPU_KBYTES:
+		return (long long) count * 1024;
+	case CPU_MBYTES:
+		return (long long) count * 1024 * 1024;
+	default:
+		return -1;
+	}
+}
+
+void P4BridgeProgress::Description(const StrPtr *desc, int units)
+{
+	this->units = units;
+}
+
+void P4BridgeProgress::Total(P4INT64 total)
+{
+	if ((units == CPU_FILES) || (type == CPT_FILESTRANSFERRED))
+	{
+		pTotals->SetFilesTotal(total);
+	}
+	else if (ToBytes(total) >= 0)
+	{
+		// a file's size is added once, a second Total() corrects it
+		pTotals->AddBytesTotal(ToBytes(total) - ToBytes(this->total));
+	}
+	this->total = (long long) total;
+}
+
+int P4BridgeProgress::Update(P4INT64 position)
+{
+	if ((units == CPU_FILES) || (type == CPT_FILESTRANSFERRED))
+	{
+		pTotals->SetFilesDone(position);
+	}
+	else if (ToBytes(position) >= 0)
+	{
+		long long bytes = ToBytes(position);
+		pTotals->AddBytesDone(bytes - bytesReported);
+		bytesReported = bytes;
+	}
+	return pTotals->Report(type, intervalMs, false, false);
+}
+
+void P4BridgeProgress::Done(int fail)
+{
+	bool files = (units == CPU_FILES) || (type == CPT_FILESTRANSFERRED);
+	if (!fail)
+	{
+		if (files)
+		{
+			pTotals->SetFilesDone(total);
+		}
+		else if (ToBytes(total) > bytesReported)
+		{
+			// the last update is often skipped for a small remainder
+			pTotals->AddBytesDone(ToBytes(total) - bytesReported);
+			bytesReported = ToBytes(total);
+		}
+	}
+
+	// the file count ends the command's transfers, always report it
+	pTotals->Report(type, intervalMs, files, files);
+}
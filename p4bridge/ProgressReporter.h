@@ -0,0 +1,108 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: ProgressReporter.h
+ *
+ * Description	:  Progress of the running command, added up in the bridge.
+ *  The p4api creates a ClientProgress for the file count of a command and
+ *  one for each file sent or received. P4BridgeProgress passes their
+ *  updates to the command's P4ProgressTotals, which calls the progress
+ *  callback with the totals no more often than the interval asked for, so
+ *  a UI can show progress without a callback per file.
+ *
+ ******************************************************************************/
+
+#include <clientprog.h>
+
+class P4BridgeClient;
+
+// The totals passed to the progress callback. Plain fixed size fields so it
+//  can be marshaled as a struct.
+struct ProgressInfo
+{
+	int type;					// CPT_ value of the latest update
+	int done;					// 1 on the last report, when the file count completes
+	long long filesDone;
+	long long filesTotal;		// 0 until the server sends the file count
+	long long bytesDone;
+	long long bytesTotal;		// size of the files started so far
+	long long elapsedMs;		// since the first progress of the command
+	long long bytesPerSecond;
+};
+
+class P4ProgressTotals
+{
+public:
+	P4ProgressTotals(P4BridgeClient* pUi);
+
+	// Start over for the next command
+	void Reset();
+
+	void SetFilesTotal(long long total) { info.filesTotal = total; }
+	void SetFilesDone(long long count) { info.filesDone = count; }
+	void AddBytesTotal(long long bytes) { info.bytesTotal += bytes; }
+	void AddBytesDone(long long bytes) { info.bytesDone += bytes; }
+
+	// Call the progress callback if intervalMs has passed since the last
+	//  call, or force is set. Returns non zero if the callback asked to
+	//  cancel the command.
+	int Report(int type, int intervalMs, bool force, bool done);
+
+	const ProgressInfo& GetInfo() const { return info; }
+
+private:
+	P4BridgeClient* pUi;
+	ProgressInfo info;
+	long long startMs;
+	long long lastReportMs;
+};
+
+class P4BridgeProgress : public ClientProgress
+{
+public:
+	P4BridgeProgress(P4ProgressTotals* pTotals, int type, int intervalMs);
+	virtual ~P4BridgeProgress() {}
+
+	virtual void Description(const StrPtr *desc, int units);
+	virtual void Total(P4INT64 total);
+	virtual int Update(P4INT64 position);
+	virtual void Done(int fail);
+
+private:
+	// The number of bytes for a count in units, -1 if units are not a size
+	long long ToBytes(P4INT64 count);
+
+	P4ProgressTotals* pTotals;
+	int type;
+	int units;
+	int intervalMs;
+	long long total;
+	long long bytesReported;
+};
@@ -0,0 +1,211 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ResolvePolicy.cpp
+ *
+ * Description	:  P4ResolvePolicy
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "ResolvePolicy.h"
+
+#include <ctype.h>
+
+P4ResolvePolicy::P4ResolvePolicy() :
+	p4base(tP4ResolvePolicy),
+	link(new ServerLink())
+{
+}
+
+P4ResolvePolicy::~P4ResolvePolicy()
+{
+	link->OwnerDeleted([this](P4BridgeServer *pServer) { pServer->ResolvePolicyDeleted(this); });
+}
+
+bool P4ResolvePolicy::AddRule(const char *pattern, const char *resolveType, int action)
+{
+	if (action < RESOLVE_ACTION_SAFE || action > RESOLVE_ACTION_SKIP)
+		return false;
+
+	Rule rule;
+	rule.pattern = pattern ? pattern : "";
+	rule.type = resolveType ? resolveType : "";
+	for (size_t i = 0; i < rule.type.size(); i++)
+		rule.type[i] = (char) tolower((unsigned char) rule.type[i]);
+	rule.action = action;
+
+	std::lock_guard<std::mutex> guard(rulesMutex);
+	rules.push_back(rule);
+	return true;
+}
+
+void P4ResolvePolicy::Clear()
+{
+	std::lock_guard<std::mutex> guard(rulesMutex);
+	rules.clear();
+}
+
+int P4ResolvePolicy::Count()
+{
+	std::lock_guard<std::mutex> guard(rulesMutex);
+	return (int) rules.size();
+}
+
+static bool SameChar(char a, char b)
+{
+	if (a == '\\') a = '/';
+	if (b == '\\') b = '/';
+#ifdef OS_NT
+	return tolower((unsigned char) a) == tolower((unsigned char) b);
+#else
+	return a == b;
+#endif
+}
+
+bool P4ResolvePolicy::Match(const char *pattern, const char *path)
+{
+	while (*pattern)
+	{
+		if (strncmp(pattern, "...", 3) == 0)
+		{
+			pattern += 3;
+			if (!*pattern)
+				return true;
+			for (const char *p = path; ; p++)
+			{
+				if (Match(pattern, p))
+					return true;
+				if (!*p)
+					return false;
+			}
+		}
+		if (*pattern == '*')
+		{
+			pattern++;
+			for (const char *p = path; ; p++)
+			{
+				if (Match(pattern, p))
+					return true;
+				if (!*p || *p == '/' || *p == '\\')
+					return false;
+			}
+		}
+		if (!*path || !SameChar(*pattern, *path))
+			return false;
+		pattern++;
+		path++;
+	}
+	return *path == '\0';
+}
+
+std::string P4ResolvePolicy::ActionType(ClientResolveA *r)
+{
+	Error er;
+	er = r->GetType();
+	StrBuf text;
+	er.Fmt(text, EF_PLAIN | EF_NOXLATE);
+
+	// "Filetype resolve" and the like, keep the first word
+	std::string type;
+	for (const char *p = text.Text(); *p && !isspace((unsigned char) *p); p++)
+		type.push_back((char) tolower((unsigned char) *p));
+	return type;
+}
+
+/*******************************************************************************
+ *
+ *  Apply
+ *
+ *  An auto resolve that cannot be done, such as -as on a file changed on both
+ *   sides, leaves the file to the next rule.
+ *
+ ******************************************************************************/
+
+MergeStatus P4ResolvePolicy::Apply(ClientMerge *m, int &rule)
+{
+	FileSys *yours = m->GetYourFile();
+	const char *path = (yours && yours->Path()) ? yours->Path()->Text() : "";
+
+	std::lock_guard<std::mutex> guard(rulesMutex);
+	for (size_t i = 0; i < rules.size(); i++)
+	{
+		const Rule &r = rules[i];
+		if (!r.type.empty() && r.type != "content")
+			continue;
+		if (!r.pattern.empty() && !Match(r.pattern.c_str(), path))
+			continue;
+
+		MergeStatus status = CMS_SKIP;
+		switch (r.action)
+		{
+		case RESOLVE_ACTION_SAFE:	status = m->AutoResolve(CMF_SAFE); break;
+		case RESOLVE_ACTION_MERGE:	status = m->AutoResolve(CMF_AUTO); break;
+		case RESOLVE_ACTION_FORCE:	status = m->AutoResolve(CMF_FORCE); break;
+		case RESOLVE_ACTION_THEIRS:	status = CMS_THEIRS; break;
+		case RESOLVE_ACTION_YOURS:	status = CMS_YOURS; break;
+		}
+		if (status == CMS_SKIP && r.action != RESOLVE_ACTION_SKIP)
+			continue;
+
+		rule = (int) i;
+		return status;
+	}
+	rule = -1;
+	return CMS_SKIP;
+}
+
+MergeStatus P4ResolvePolicy::Apply(ClientResolveA *r, const std::string &type, int &rule)
+{
+	std::lock_guard<std::mutex> guard(rulesMutex);
+	for (size_t i = 0; i < rules.size(); i++)
+	{
+		const Rule &rl = rules[i];
+		if (!rl.type.empty() && rl.type != type)
+			continue;
+		if (!rl.pattern.empty())
+			continue;
+
+		MergeStatus status = CMS_SKIP;
+		switch (rl.action)
+		{
+		case RESOLVE_ACTION_SAFE:	status = r->AutoResolve(CMF_SAFE); break;
+		case RESOLVE_ACTION_MERGE:	status = r->AutoResolve(CMF_AUTO); break;
+		case RESOLVE_ACTION_FORCE:	status = r->AutoResolve(CMF_FORCE); break;
+		case RESOLVE_ACTION_THEIRS:	status = CMS_THEIRS; break;
+		case RESOLVE_ACTION_YOURS:	status = CMS_YOURS; break;
+		}
+		if (status == CMS_SKIP && rl.action != RESOLVE_ACTION_SKIP)
+			continue;
+
+		rule = (int) i;
+		return status;
+	}
+	rule = -1;
+	return CMS_SKIP;
+}
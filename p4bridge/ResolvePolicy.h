@@ -0,0 +1,117 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ResolvePolicy.h
+ *
+ * Description	:  P4ResolvePolicy decides resolves inside the bridge, so a
+ *  resolve of many files does not call back into managed code for each one.
+ *  It is an ordered list of rules; for each file the first rule that matches
+ *  and can be applied decides the result, files no rule decides are skipped.
+ *  A record of every decision is kept with the results of the command.
+ *
+ *  Rule patterns match the local file, with "..." for any characters and
+ *  "*" for any characters but a '/'. Action resolves (branch, delete, move,
+ *  filetype...) do not give the bridge a file, so only rules without a
+ *  pattern apply to them.
+ *
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "ServerLink.h"
+
+class P4BridgeServer;
+
+// What a rule does with a file
+#define RESOLVE_ACTION_SAFE		0	// accept when only one side changed, like -as
+#define RESOLVE_ACTION_MERGE	1	// accept a merge with no conflicts, like -am
+#define RESOLVE_ACTION_FORCE	2	// accept the merge even with conflicts, like -af
+#define RESOLVE_ACTION_THEIRS	3	// like -at
+#define RESOLVE_ACTION_YOURS	4	// like -ay
+#define RESOLVE_ACTION_SKIP		5
+
+// The record kept for each file resolved by a policy, laid out to be read
+//  directly from managed code
+struct ResolveSummary
+{
+	const char *path;		// the local file, empty for action resolves
+	const char *type;		// "content", or the type of an action resolve
+	int rule;				// the rule that decided, -1 if none did
+	int result;				// the MergeStatus returned
+	int yourChunks;			// chunk counts of a content resolve, else 0
+	int theirChunks;
+	int bothChunks;
+	int conflictChunks;
+};
+
+class P4ResolvePolicy : public p4base
+{
+public:
+	P4ResolvePolicy();
+	virtual ~P4ResolvePolicy();
+
+	virtual int Type(void) { return tP4ResolvePolicy; }
+
+	// Add a rule after the existing ones. pattern and resolveType may be
+	//  NULL or empty to match every file or every type of resolve.
+	//  Returns false for an unknown action.
+	bool AddRule(const char *pattern, const char *resolveType, int action);
+	void Clear();
+	int Count();
+
+	// Decide a resolve, rule is set to the rule used or -1. type is the
+	//  type of an action resolve from ActionType().
+	MergeStatus Apply(ClientMerge *m, int &rule);
+	MergeStatus Apply(ClientResolveA *r, const std::string &type, int &rule);
+
+	// The type of an action resolve in lower case: "branch", "delete",
+	//  "filetype", "move"...
+	static std::string ActionType(ClientResolveA *r);
+
+	// Servers using this policy, they are detached when it is deleted
+	std::shared_ptr<ServerLink> GetLink() { return link; }
+
+	// Match a path against a rule pattern, '\\' counts as '/'
+	static bool Match(const char *pattern, const char *path);
+
+private:
+	struct Rule
+	{
+		std::string pattern;
+		std::string type;
+		int action;
+	};
+
+	std::mutex rulesMutex;
+	std::vector<Rule> rules;
+
+	std::shared_ptr<ServerLink> link;
+};
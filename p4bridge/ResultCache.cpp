@@ -0,0 +1,416 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ResultCache.cpp
+ *
+ * Description	:  ResultCache
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4Connection.h"
+#include "ResultCache.h"
+
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <sstream>
+#include <functional>
+
+// Rough per item overhead of the containers, so a result with many small
+//  fields is not counted as nearly free
+#define ITEM_OVERHEAD 32
+
+#define EVENT_INFO		'i'
+#define EVENT_TAGGED	't'
+#define EVENT_TEXT		'x'
+
+struct CachedResult
+{
+	// one callback, in the order the command made them
+	struct Event
+	{
+		char kind;
+		int code;
+		char level;
+		string msg;
+		std::vector< std::pair<string, string> > fields;
+	};
+
+	string port;
+	string cmd;
+	long long expires;
+	size_t bytes;
+
+	std::vector<Event> events;
+};
+
+typedef std::list<string> LruList;
+
+struct CacheSlot
+{
+	std::shared_ptr<const CachedResult> result;
+	LruList::iterator lru;
+};
+
+// everything below is guarded by cache_mutex
+static std::mutex cache_mutex;
+static std::unordered_map<string, CacheSlot> cache;
+// most recently used at the front
+static LruList lru;
+static size_t cache_bytes = 0;
+static size_t max_bytes = 0;
+static int ttl_ms = 0;
+static std::set<string> commands;
+static bool commands_set = false;
+
+static int hit_count = 0;
+static int miss_count = 0;
+static int eviction_count = 0;
+
+static const char* default_commands[] = { "depots", "streams", "users", "groups", "protects", "info" };
+
+static void SetDefaultCommands()
+{
+	commands.clear();
+	for (size_t i = 0; i < sizeof(default_commands) / sizeof(default_commands[0]); i++)
+	{
+		commands.insert(default_commands[i]);
+	}
+	commands_set = true;
+}
+
+ResultCapture::ResultCapture() :
+	result(new CachedResult())
+{
+	result->bytes = 0;
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	limit = max_bytes;
+}
+
+ResultCapture::~ResultCapture()
+{
+}
+
+void ResultCapture::Reject()
+{
+	result.reset();
+}
+
+void ResultCapture::Info(int code, char level, const char *msg)
+{
+	if (!result)
+		return;
+	CachedResult::Event event;
+	event.kind = EVENT_INFO;
+	event.code = code;
+	event.level = level;
+	event.msg = msg ? msg : "";
+	result->bytes += event.msg.length() + ITEM_OVERHEAD;
+	result->events.push_back(event);
+	if (result->bytes > limit)
+		Reject();
+}
+
+void ResultCapture::Tagged(StrDict *dict)
+{
+	if (!result || !dict)
+		return;
+	CachedResult::Event event;
+	event.kind = EVENT_TAGGED;
+	event.code = 0;
+	event.level = 0;
+	result->events.push_back(event);
+	std::vector< std::pair<string, string> > &fields = result->events.back().fields;
+
+	StrRef var, val;
+	for (int i = 0; dict->GetVar(i, var, val); i++)
+	{
+		fields.push_back(std::make_pair(string(var.Text(), var.Length()), string(val.Text(), val.Length())));
+		result->bytes += var.Length() + val.Length() + ITEM_OVERHEAD;
+	}
+	result->bytes += ITEM_OVERHEAD;
+	if (result->bytes > limit)
+		Reject();
+}
+
+void ResultCapture::Text(const char *data, int length)
+{
+	if (!result || !data || (length <= 0))
+		return;
+	// text arrives in chunks, keep a run of them as one event
+	if (result->events.empty() || (result->events.back().kind != EVENT_TEXT))
+	{
+		CachedResult::Event event;
+		event.kind = EVENT_TEXT;
+		event.code = 0;
+		event.level = 0;
+		result->events.push_back(event);
+		result->bytes += ITEM_OVERHEAD;
+	}
+	result->events.back().msg.append(data, length);
+	result->bytes += length;
+	if (result->bytes > limit)
+		Reject();
+}
+
+static void Drop(std::unordered_map<string, CacheSlot>::iterator it)
+{
+	cache_bytes -= it->second.result->bytes;
+	lru.erase(it->second.lru);
+	cache.erase(it);
+}
+
+static void DropAll()
+{
+	cache.clear();
+	lru.clear();
+	cache_bytes = 0;
+}
+
+void ResultCache::Configure(int maxBytes, int ttlMs)
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	max_bytes = (maxBytes > 0) ? (size_t) maxBytes : 0;
+	ttl_ms = (ttlMs > 0) ? ttlMs : 0;
+	if (!commands_set)
+		SetDefaultCommands();
+
+	if (max_bytes == 0)
+	{
+		DropAll();
+		return;
+	}
+
+	// shrink to the new size
+	while (cache_bytes > max_bytes && !lru.empty())
+	{
+		Drop(cache.find(lru.back()));
+		eviction_count++;
+	}
+}
+
+bool ResultCache::IsEnabled()
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	return (max_bytes > 0) && (ttl_ms > 0);
+}
+
+void ResultCache::SetCommands(char const * const * cmds, int count)
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	if (!cmds || count <= 0)
+	{
+		SetDefaultCommands();
+		return;
+	}
+	commands.clear();
+	for (int i = 0; i < count; i++)
+	{
+		if (cmds[i])
+			commands.insert(cmds[i]);
+	}
+	commands_set = true;
+}
+
+bool ResultCache::IsCacheable(const char *cmd)
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	if (!cmd || (max_bytes == 0) || (ttl_ms == 0))
+		return false;
+	return commands.find(cmd) != commands.end();
+}
+
+string ResultCache::MakeKey(const char *port, const char *user, const char *client,
+	const char *auth, const char *charset, const char *cwd, const char *cmd, int tagged,
+	char const * const * args, int argc, const std::set<string> *projection)
+{
+	// the fields are separated by nulls, which can't appear in any of them
+	string key;
+	key.append(port ? port : "").push_back('\0');
+	key.append(user ? user : "").push_back('\0');
+	key.append(client ? client : "").push_back('\0');
+	// hashed so the cache does not keep another copy of the secret
+	std::ostringstream authHash;
+	authHash << std::hex << std::hash<string>()(auth ? auth : "");
+	key.append(authHash.str()).push_back('\0');
+	key.append(charset ? charset : "").push_back('\0');
+	key.append(cwd ? cwd : "").push_back('\0');
+	key.append(cmd ? cmd : "").push_back('\0');
+	key.push_back(tagged ? 't' : 'u');
+	for (int i = 0; i < argc; i++)
+	{
+		key.push_back('\0');
+		key.append(args[i] ? args[i] : "");
+	}
+	if (projection)
+	{
+		key.push_back('\0');
+		key.push_back('\0');
+		for (std::set<string>::const_iterator it = projection->begin(); it != projection->end(); ++it)
+		{
+			key.append(*it).push_back('\0');
+		}
+	}
+	return key;
+}
+
+/*******************************************************************************
+ *
+ *  Replay
+ *
+ *  The results are shared, so the lock is only held to find them. Replaying
+ *   into the ui calls back into the client, which must not happen under the
+ *   lock.
+ *
+ ******************************************************************************/
+
+bool ResultCache::Replay(const string &key, P4BridgeClient *ui)
+{
+	std::shared_ptr<const CachedResult> result;
+	{
+		std::lock_guard<std::mutex> guard(cache_mutex);
+		std::unordered_map<string, CacheSlot>::iterator it = cache.find(key);
+		if (it == cache.end())
+		{
+			miss_count++;
+			return false;
+		}
+		if (it->second.result->expires <= P4Connection::NowMs())
+		{
+			Drop(it);
+			miss_count++;
+			return false;
+		}
+		hit_count++;
+		lru.splice(lru.begin(), lru, it->second.lru);
+		result = it->second.result;
+	}
+
+	LOG_DEBUG1(4, "Replaying cached results of %s", result->cmd.c_str());
+
+	ui->clear_results();
+
+	for (size_t i = 0; i < result->events.size(); i++)
+	{
+		const CachedResult::Event &event = result->events[i];
+		if (event.kind == EVENT_INFO)
+		{
+			ui->HandleInfoMsg(event.code, event.level, event.msg.c_str());
+		}
+		else if (event.kind == EVENT_TAGGED)
+		{
+			StrBufDict dict;
+			for (size_t j = 0; j < event.fields.size(); j++)
+			{
+				const std::pair<string, string> &entry = event.fields[j];
+				dict.SetVar(StrRef(entry.first.c_str(), (int) entry.first.length()),
+					StrRef(entry.second.c_str(), (int) entry.second.length()));
+			}
+			ui->OutputStat(&dict);
+		}
+		else
+		{
+			ui->OutputText(event.msg.c_str(), (int) event.msg.length());
+		}
+	}
+	return true;
+}
+
+void ResultCache::Store(const string &key, const char *port, const char *cmd,
+	ResultCapture *capture, P4BridgeClient *ui)
+{
+	// spilled results are too big to keep in memory twice
+	if (!capture || !capture->result || ui->GetErrorResults() != NULL ||
+		ui->GetBinaryResultsCount() > 0 || ui->IsSpilled())
+		return;
+
+	std::shared_ptr<CachedResult> result = capture->result;
+	capture->result.reset();
+	result->port = port ? port : "";
+	result->cmd = cmd ? cmd : "";
+	size_t bytes = result->bytes + key.length() + ITEM_OVERHEAD;
+	result->bytes = bytes;
+
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	// too big to ever fit, or turned off while the command ran
+	if (bytes > max_bytes || ttl_ms == 0)
+		return;
+
+	result->expires = P4Connection::NowMs() + ttl_ms;
+
+	std::unordered_map<string, CacheSlot>::iterator it = cache.find(key);
+	if (it != cache.end())
+		Drop(it);
+
+	while (cache_bytes + bytes > max_bytes && !lru.empty())
+	{
+		Drop(cache.find(lru.back()));
+		eviction_count++;
+	}
+
+	lru.push_front(key);
+	CacheSlot &slot = cache[key];
+	slot.result = result;
+	slot.lru = lru.begin();
+	cache_bytes += bytes;
+}
+
+int ResultCache::Invalidate(const char *port, const char *cmd)
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	int count = 0;
+	std::unordered_map<string, CacheSlot>::iterator it = cache.begin();
+	while (it != cache.end())
+	{
+		const CachedResult &result = *it->second.result;
+		if ((!port || result.port == port) && (!cmd || result.cmd == cmd))
+		{
+			std::unordered_map<string, CacheSlot>::iterator drop = it++;
+			Drop(drop);
+			count++;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	return count;
+}
+
+void ResultCache::GetCounts(int *hits, int *misses, int *evictions, int *entries, int *bytes)
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	if (hits) *hits = hit_count;
+	if (misses) *misses = miss_count;
+	if (evictions) *evictions = eviction_count;
+	if (entries) *entries = (int) cache.size();
+	if (bytes) *bytes = (int) cache_bytes;
+}
@@ -0,0 +1,119 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: ResultCache.h
+ *
+ * Description	:  ResultCache keeps the results of read-only commands such as
+ *  depots, users and groups so that repeating the same command within a
+ *  time to live is answered without a round trip to the server. The cache
+ *  is off until given a size, is shared by every P4BridgeServer, and evicts
+ *  the least recently used results when it is full.
+ *
+ ******************************************************************************/
+
+#include <set>
+#include <string>
+#include <memory>
+
+using std::string;
+
+class P4BridgeClient;
+class StrDict;
+struct CachedResult;
+
+/*******************************************************************************
+ *
+ *  ResultCapture
+ *
+ *  Attached to the ui while a cacheable command runs, it keeps the info,
+ *   tagged and text output in the order it arrived so a replay calls back
+ *   in the same order. It gives up once the results are bigger than the
+ *   cache could hold.
+ *
+ ******************************************************************************/
+
+class ResultCapture
+{
+public:
+	ResultCapture();
+	~ResultCapture();
+
+	void Info(int code, char level, const char *msg);
+	void Tagged(StrDict *dict);
+	void Text(const char *data, int length);
+
+	// binary output and errors are not cached
+	void Reject();
+
+private:
+	friend class ResultCache;
+
+	std::shared_ptr<CachedResult> result;
+	size_t limit;
+};
+
+class ResultCache
+{
+public:
+	// Set the size limit in bytes and the time to live in milliseconds. A size
+	//  of zero turns the cache off and drops everything in it.
+	static void Configure(int maxBytes, int ttlMs);
+	static bool IsEnabled();
+
+	// Replace the list of commands that may be cached, a count of zero
+	//  restores the default list
+	static void SetCommands(char const * const * cmds, int count);
+
+	// Is the cache on and the command one that may be cached?
+	static bool IsCacheable(const char *cmd);
+
+	// Build the key for a run of a command. Everything that changes the
+	//  results is part of the key, including auth, the password or ticket
+	//  the command runs with, so users who share a name and workspace but
+	//  not a login never see each other's results.
+	static string MakeKey(const char *port, const char *user, const char *client,
+		const char *auth, const char *charset, const char *cwd, const char *cmd, int tagged,
+		char const * const * args, int argc, const std::set<string> *projection);
+
+	// If there are unexpired results for the key, replay them into the ui,
+	//  calling any callbacks as if the command had run, and return true
+	static bool Replay(const string &key, P4BridgeClient *ui);
+
+	// Keep the results captured for the key. Results with errors or binary
+	//  output, or that the ui spilled to disk, are not kept.
+	static void Store(const string &key, const char *port, const char *cmd,
+		ResultCapture *capture, P4BridgeClient *ui);
+
+	// Drop the results for a server and/or command, NULL matches all.
+	//  Returns the number of results dropped.
+	static int Invalidate(const char *port, const char *cmd);
+
+	static void GetCounts(int *hits, int *misses, int *evictions, int *entries, int *bytes);
+};
@@ -0,0 +1,82 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: ResultSession.cpp
+ *
+ * Description	:  P4ResultSession
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "ResultSession.h"
+
+P4ResultSession::P4ResultSession() :
+	p4base(tP4ResultSession)
+{
+}
+
+P4ResultSession::~P4ResultSession()
+{
+	ReleaseAll();
+}
+
+p4base* P4ResultSession::Adopt(p4base* pObj)
+{
+	if (pObj && (pObj != this))
+		handles.push_back(pObj);
+	return pObj;
+}
+
+int P4ResultSession::ReleaseAll()
+{
+	int count = (int) handles.size();
+	for (size_t i = handles.size(); i > 0; i--)
+	{
+		delete handles[i - 1];
+	}
+	// keep the capacity, a session is usually reused for the next command
+	handles.clear();
+	return count;
+}
+
+int P4ResultSession::ReleaseMany(void** handles, int count)
+{
+	if (!handles)
+		return 0;
+
+	int released = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (!handles[i])
+			continue;
+		// cast to a p4base first so the right destructor is called
+		delete static_cast<p4base*>(handles[i]);
+		released++;
+	}
+	return released;
+}
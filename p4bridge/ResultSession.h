@@ -0,0 +1,69 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: ResultSession.h
+ *
+ * Description	:  P4ResultSession owns the handles handed out while reading a
+ *  command's results, iterators, cloned errors and the like, and deletes
+ *  them all in one call instead of one Release() per handle. A handle given
+ *  to a session must not be released on its own.
+ *
+ *  P4ResultSession is not thread safe, the owner must serialize access.
+ *
+ ******************************************************************************/
+
+#include <vector>
+
+class P4ResultSession : public p4base
+{
+public:
+	P4ResultSession();
+	virtual ~P4ResultSession();
+
+	virtual int Type(void) { return tP4ResultSession; }
+
+	// Take ownership of a handle, returns it. NULL and the session itself
+	//  are ignored.
+	p4base* Adopt(p4base* pObj);
+
+	int Count() const { return (int) handles.size(); }
+
+	// Delete every handle owned, newest first so an iterator goes before
+	//  the result set it reads. Returns the number deleted, the session can
+	//  be used again.
+	int ReleaseAll();
+
+	// Delete count handles that are not owned by a session, NULL entries
+	//  are skipped. Returns the number deleted.
+	static int ReleaseMany(void** handles, int count);
+
+private:
+	std::vector<p4base*> handles;
+};
@@ -0,0 +1,337 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ResultSet.cpp
+ *
+ * Description	:  P4ResultSet
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4BridgeClient.h"
+#include "ResultSpill.h"
+#include "ResultSet.h"
+#include "ByteOrder.h"
+
+#define DELETE_OBJECT(obj) if( obj != NULL ) { delete obj; obj = NULL; }
+
+// Section kinds
+#define RS_TAGGED	1
+#define RS_INFO		2
+#define RS_ERRORS	3
+#define RS_TEXT		4
+#define RS_BINARY	5
+
+#define RS_HEADER_SIZE 8
+#define RS_SECTION_HEADER_SIZE 12
+
+// Write a section header, returns where its data starts
+static size_t BeginSection(std::vector<char> &out, unsigned int kind)
+{
+	PutU32(out, kind);
+	out.resize(out.size() + 8);
+	return out.size();
+}
+
+static void EndSection(std::vector<char> &out, size_t start)
+{
+	SetU64(out, start - 8, out.size() - start);
+}
+
+P4ResultSet::P4ResultSet() :
+	p4base(tP4ResultSet),
+	pFirstError(NULL),
+	pFirstInfo(NULL)
+{
+	Clear();
+}
+
+P4ResultSet::~P4ResultSet()
+{
+	Clear();
+}
+
+void P4ResultSet::Clear()
+{
+	blob.clear();
+	taggedOffset = 0;
+	taggedSize = 0;
+	taggedCount = 0;
+	textOffset = 0;
+	textSize = 0;
+	binaryOffset = 0;
+	binarySize = 0;
+	DELETE_OBJECT(pFirstError);
+	DELETE_OBJECT(pFirstInfo);
+}
+
+/*******************************************************************************
+ *
+ *  Serialize
+ *
+ *  Write every part of the results, empty parts included, so the result set
+ *   loaded from the blob looks the same as the client did.
+ *
+ ******************************************************************************/
+
+void P4ResultSet::Serialize(P4BridgeClient *ui, std::vector<char> &out)
+{
+	LOG_ENTRY();
+	out.clear();
+	out.insert(out.end(), "P4RS", "P4RS" + 4);
+	PutU32(out, RESULT_SET_VERSION);
+
+	// through an iterator, the output may have been spilled
+	size_t start = BeginSection(out, RS_TAGGED);
+	PutU32(out, 0);
+	unsigned int count = 0;
+	StrDictListIterator *pTagged = ui->GetTaggedOutput();
+	if (pTagged)
+	{
+		StrDictList *pItem;
+		while ((pItem = pTagged->GetNextItem()) != NULL)
+		{
+			SpillRecord record;
+			StrRef var, val;
+			for (int i = 0; pItem->Data()->GetVar(i, var, val); i++)
+			{
+				record.Add(var, val);
+			}
+			record.AppendTo(out);
+			count++;
+		}
+		delete pTagged;
+	}
+	SetU32(out, start, count);
+	EndSection(out, start);
+
+	start = BeginSection(out, RS_INFO);
+	for (P4ClientInfoMsg *pInfo = ui->GetInfoResults(); pInfo; pInfo = pInfo->Next)
+	{
+		PutU32(out, (unsigned int) pInfo->MsgCode);
+		out.push_back(pInfo->Level);
+		PutString(out, pInfo->Message.c_str(), pInfo->Message.length());
+	}
+	EndSection(out, start);
+
+	start = BeginSection(out, RS_ERRORS);
+	for (P4ClientError *pError = ui->GetErrorResults(); pError; pError = pError->Next)
+	{
+		PutU32(out, (unsigned int) pError->Severity);
+		PutU32(out, (unsigned int) pError->ErrorCode);
+		PutString(out, pError->Message.c_str(), pError->Message.length());
+	}
+	EndSection(out, start);
+
+	start = BeginSection(out, RS_TEXT);
+	// the text may hold NULs, so it is copied by length
+	const char *text = ui->GetTextResults();
+	if (text)
+		out.insert(out.end(), text, text + ui->GetTextResultsLength());
+	out.push_back('\0');
+	EndSection(out, start);
+
+	start = BeginSection(out, RS_BINARY);
+	size_t binaryCount = ui->GetBinaryResultsCount();
+	if (binaryCount > 0)
+	{
+		const char *binary = (const char *) ui->GetBinaryResults();
+		out.insert(out.end(), binary, binary + binaryCount);
+	}
+	EndSection(out, start);
+}
+
+/*******************************************************************************
+ *
+ *  Load
+ *
+ *  Everything is checked before it is used, the data may come from a file or
+ *   another process. Tagged records are only validated here and read in place
+ *   by the iterator.
+ *
+ ******************************************************************************/
+
+bool P4ResultSet::Load(const char *data, size_t length)
+{
+	LOG_ENTRY();
+	Clear();
+
+	if (!data || length < RS_HEADER_SIZE || memcmp(data, "P4RS", 4) != 0)
+		return false;
+	unsigned int version = GetU32(data + 4);
+	if (version == 0 || version > RESULT_SET_VERSION)
+		return false;
+
+	blob.assign(data, data + length);
+	const char *base = &blob[0];
+
+	P4ClientError *pLastError = NULL;
+	P4ClientInfoMsg *pLastInfo = NULL;
+
+	bool ok = true;
+	size_t offset = RS_HEADER_SIZE;
+	while (ok && offset < length)
+	{
+		if (length - offset < RS_SECTION_HEADER_SIZE)
+		{
+			ok = false;
+			break;
+		}
+		unsigned int kind = GetU32(base + offset);
+		unsigned long long sectionSize = GetU64(base + offset + 4);
+		offset += RS_SECTION_HEADER_SIZE;
+		if (sectionSize > length - offset)
+		{
+			ok = false;
+			break;
+		}
+		size_t end = offset + (size_t) sectionSize;
+
+		switch (kind)
+		{
+		case RS_TAGGED:
+			{
+				if (end - offset < 4)
+				{
+					ok = false;
+					break;
+				}
+				unsigned int count = GetU32(base + offset);
+				size_t pos = offset + 4;
+				SpilledStrDict dict;
+				for (unsigned int i = 0; ok && i < count; i++)
+				{
+					pos = dict.Set(base, pos, end);
+					ok = (pos != 0);
+				}
+				if (ok && pos != end)
+					ok = false;
+				taggedOffset = offset + 4;
+				taggedSize = end - taggedOffset;
+				taggedCount = (int) count;
+			}
+			break;
+
+		case RS_INFO:
+			for (size_t pos = offset; ok && pos < end; )
+			{
+				if (end - pos < 5)
+				{
+					ok = false;
+					break;
+				}
+				int code = (int) GetU32(base + pos);
+				char level = base[pos + 4];
+				pos += 5;
+				const char *msg = GetString(base, pos, end);
+				if (!msg)
+				{
+					ok = false;
+					break;
+				}
+				P4ClientInfoMsg *pInfo = new P4ClientInfoMsg(code, level, msg);
+				if (pLastInfo)
+					pLastInfo->Next = pInfo;
+				else
+					pFirstInfo = pInfo;
+				pLastInfo = pInfo;
+			}
+			break;
+
+		case RS_ERRORS:
+			for (size_t pos = offset; ok && pos < end; )
+			{
+				if (end - pos < 8)
+				{
+					ok = false;
+					break;
+				}
+				int severity = (int) GetU32(base + pos);
+				int errorCode = (int) GetU32(base + pos + 4);
+				pos += 8;
+				const char *msg = GetString(base, pos, end);
+				if (!msg)
+				{
+					ok = false;
+					break;
+				}
+				P4ClientError *pError = new P4ClientError(severity, errorCode, msg);
+				if (pLastError)
+					pLastError->Next = pError;
+				else
+					pFirstError = pError;
+				pLastError = pError;
+			}
+			break;
+
+		case RS_TEXT:
+			if (end == offset || base[end - 1] != '\0')
+			{
+				ok = false;
+				break;
+			}
+			textOffset = offset;
+			textSize = end - offset - 1;
+			break;
+
+		case RS_BINARY:
+			binaryOffset = offset;
+			binarySize = end - offset;
+			break;
+
+		default:
+			// from a later version, skip it
+			break;
+		}
+		offset = end;
+	}
+
+	if (!ok)
+	{
+		LOG_ERROR("Damaged result set");
+		Clear();
+	}
+	return ok;
+}
+
+StrDictListIterator* P4ResultSet::GetTaggedOutput()
+{
+	if (taggedCount == 0)
+		return NULL;
+	return new StrDictListIterator(&blob[taggedOffset], taggedSize);
+}
+
+const char* P4ResultSet::GetTextResults()
+{
+	return textSize ? &blob[textOffset] : "";
+}
+
+const unsigned char* P4ResultSet::GetBinaryResults()
+{
+	return binarySize ? (const unsigned char *) &blob[binaryOffset] : NULL;
+}
@@ -0,0 +1,101 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ResultSet.h
+ *
+ * Description	:  P4ResultSet is the complete result of a command, tagged
+ *  output, info, errors, text and binary output, serialized into one blob
+ *  that can be kept in a cache or sent to another process and loaded back
+ *  without running the command again.
+ *
+ *  The blob starts with the 4 bytes "P4RS" and a 32 bit version, followed by
+ *  sections. Each section is a 32 bit kind and a 64 bit length followed by
+ *  that many bytes, so a reader can skip kinds it does not know. Numbers are
+ *  little endian. Tagged output is a 32 bit record count followed by the
+ *  records described in ResultSpill.h, and is read in place.
+ *
+ ******************************************************************************/
+
+#include <vector>
+
+class P4BridgeClient;
+class P4ClientError;
+class P4ClientInfoMsg;
+class StrDictListIterator;
+
+// Version written by Serialize(), Load() accepts this and older versions
+#define RESULT_SET_VERSION 1
+
+class P4ResultSet : public p4base
+{
+public:
+	P4ResultSet();
+	virtual ~P4ResultSet();
+
+	virtual int Type(void) { return tP4ResultSet; }
+
+	// Serialize the results held by a client, replacing the contents of out
+	static void Serialize(P4BridgeClient *ui, std::vector<char> &out);
+
+	// Load a copy of a serialized result set, false if the data is not one,
+	//  is damaged or is from a newer version
+	bool Load(const char *data, size_t length);
+
+	// A new iterator over the tagged output, NULL if there is none. It reads
+	//  the result set, so must be released first.
+	StrDictListIterator* GetTaggedOutput();
+	int GetTaggedOutputCount() { return taggedCount; }
+
+	P4ClientError* GetErrorResults() { return pFirstError; }
+	P4ClientInfoMsg* GetInfoResults() { return pFirstInfo; }
+
+	const char* GetTextResults();
+	size_t GetTextResultsLength() { return textSize; }
+
+	const unsigned char* GetBinaryResults();
+	size_t GetBinaryResultsCount() { return binarySize; }
+
+private:
+	void Clear();
+
+	std::vector<char> blob;
+
+	size_t taggedOffset;
+	size_t taggedSize;
+	int taggedCount;
+
+	size_t textOffset;
+	size_t textSize;
+
+	size_t binaryOffset;
+	size_t binarySize;
+
+	P4ClientError *pFirstError;
+	P4ClientInfoMsg *pFirstInfo;
+};
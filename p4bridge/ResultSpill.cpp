@@ -0,0 +1,360 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ResultSpill.cpp
+ *
+ * Description	:  ResultSpill
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "ResultSpill.h"
+#include "ByteOrder.h"
+
+#ifndef OS_NT
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Appends are collected until there is this much to write
+#define SPILL_WRITE_BUFFER (256 * 1024)
+
+// The smallest field in a record: two lengths and two NUL terminators
+#define SPILL_MIN_FIELD_SIZE (2 * (4 + 1))
+
+SpillFile::SpillFile() :
+#ifdef OS_NT
+	hFile(INVALID_HANDLE_VALUE),
+	hMap(NULL),
+#else
+	fd(-1),
+#endif
+	view(NULL),
+	viewSize(0),
+	size(0),
+	written(0),
+	terminated(false)
+{
+}
+
+SpillFile::~SpillFile()
+{
+	Unmap();
+#ifdef OS_NT
+	// opened delete on close
+	if (hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile);
+#else
+	if (fd >= 0)
+		close(fd);
+#endif
+}
+
+#ifdef OS_NT
+bool SpillFile::Open(const std::string &dir)
+{
+	char tempDir[MAX_PATH + 1];
+	if (dir.empty())
+	{
+		DWORD len = GetTempPathA(sizeof(tempDir), tempDir);
+		if (len == 0 || len > sizeof(tempDir))
+			return false;
+	}
+	else
+	{
+		strncpy(tempDir, dir.c_str(), sizeof(tempDir) - 1);
+		tempDir[sizeof(tempDir) - 1] = '\0';
+	}
+
+	char path[MAX_PATH + 1];
+	if (!GetTempFileNameA(tempDir, "p4b", 0, path))
+		return false;
+
+	hFile = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		DeleteFileA(path);
+		return false;
+	}
+	return true;
+}
+
+bool SpillFile::Write(const char *data, size_t len, long long offset)
+{
+	LARGE_INTEGER pos;
+	pos.QuadPart = offset;
+	if (!SetFilePointerEx(hFile, pos, NULL, FILE_BEGIN))
+		return false;
+	while (len > 0)
+	{
+		DWORD chunk = (len > 0x40000000) ? 0x40000000 : (DWORD) len;
+		DWORD done = 0;
+		if (!WriteFile(hFile, data, chunk, &done, NULL) || done == 0)
+			return false;
+		data += done;
+		len -= done;
+	}
+	return true;
+}
+
+void SpillFile::Unmap()
+{
+	if (view)
+		UnmapViewOfFile(view);
+	if (hMap)
+		CloseHandle(hMap);
+	view = NULL;
+	hMap = NULL;
+	viewSize = 0;
+}
+#else
+bool SpillFile::Open(const std::string &dir)
+{
+	std::string path = dir;
+	if (path.empty())
+	{
+		const char *tmp = getenv("TMPDIR");
+		path = (tmp && *tmp) ? tmp : "/tmp";
+	}
+	path += "/p4bridge-spill-XXXXXX";
+
+	std::vector<char> name(path.begin(), path.end());
+	name.push_back('\0');
+	fd = mkstemp(&name[0]);
+	if (fd < 0)
+		return false;
+
+	// nothing else needs the name, and the file goes away with the process
+	unlink(&name[0]);
+	return true;
+}
+
+bool SpillFile::Write(const char *data, size_t len, long long offset)
+{
+	while (len > 0)
+	{
+		ssize_t done = pwrite(fd, data, len, (off_t) offset);
+		if (done <= 0)
+			return false;
+		data += done;
+		len -= done;
+		offset += done;
+	}
+	return true;
+}
+
+void SpillFile::Unmap()
+{
+	if (view)
+		munmap(view, viewSize);
+	view = NULL;
+	viewSize = 0;
+}
+#endif
+
+bool SpillFile::Append(const void *data, size_t len)
+{
+	if (len == 0)
+		return true;
+
+	const char *p = (const char *) data;
+	if (buffer.size() + len > SPILL_WRITE_BUFFER)
+	{
+		if (!Flush())
+			return false;
+		if (len >= SPILL_WRITE_BUFFER)
+		{
+			// too big to be worth copying
+			if (!Write(p, len, written))
+				return false;
+			written += len;
+			terminated = false;
+			size += len;
+			return true;
+		}
+	}
+	buffer.insert(buffer.end(), p, p + len);
+	size += len;
+	return true;
+}
+
+bool SpillFile::Flush()
+{
+	if (buffer.empty())
+		return true;
+
+	// overwrites the terminator, if there is one
+	if (!Write(&buffer[0], buffer.size(), written))
+		return false;
+	written += buffer.size();
+	terminated = false;
+	buffer.clear();
+	return true;
+}
+
+const char *SpillFile::Map(bool terminate)
+{
+	if (!Flush())
+		return NULL;
+
+	if (terminate && !terminated)
+	{
+		if (!Write("", 1, written))
+			return NULL;
+		terminated = true;
+	}
+
+	size_t len = (size_t) (written + (terminated ? 1 : 0));
+	if (len == 0)
+		return "";
+
+	if (view && viewSize == len)
+		return view;
+
+	Unmap();
+#ifdef OS_NT
+	hMap = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!hMap)
+		return NULL;
+	view = (char *) MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, len);
+	if (!view)
+	{
+		Unmap();
+		return NULL;
+	}
+#else
+	void *p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	view = (char *) p;
+#endif
+	viewSize = len;
+	return view;
+}
+
+/*******************************************************************************
+ *
+ *  SpillRecord
+ *
+ ******************************************************************************/
+
+SpillRecord::SpillRecord() :
+	count(0)
+{
+	data.resize(4);
+}
+
+void SpillRecord::AddString(const StrPtr &s)
+{
+	PutString(data, s.Text(), s.Length());
+}
+
+void SpillRecord::Add(const StrPtr &key, const StrPtr &val)
+{
+	AddString(key);
+	AddString(val);
+	count++;
+}
+
+bool SpillRecord::WriteTo(SpillFile *file)
+{
+	SetU32(data, 0, count);
+	return file->Append(&data[0], data.size());
+}
+
+void SpillRecord::AppendTo(std::vector<char> &out)
+{
+	SetU32(data, 0, count);
+	out.insert(out.end(), data.begin(), data.end());
+}
+
+/*******************************************************************************
+ *
+ *  SpilledStrDict
+ *
+ ******************************************************************************/
+
+// Read a length and the string after it, false if it runs past the end
+static bool ReadString(const char *base, size_t &offset, size_t size, StrRef &s)
+{
+	size_t len;
+	const char *p = GetString(base, offset, size, len);
+	if (!p)
+		return false;
+	s.Set((char *) p, (unsigned int) len);
+	return true;
+}
+
+size_t SpilledStrDict::Set(const char *base, size_t offset, size_t size)
+{
+	fields.clear();
+
+	if (!base || offset + 4 > size)
+		return 0;
+	unsigned int count = GetU32(base + offset);
+	offset += 4;
+
+	// the count is read from the data, do not trust it further than the
+	//  bytes left could hold
+	if (count > (size - offset) / SPILL_MIN_FIELD_SIZE)
+		return 0;
+
+	fields.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (!ReadString(base, offset, size, fields[i].key) ||
+			!ReadString(base, offset, size, fields[i].value))
+		{
+			fields.clear();
+			return 0;
+		}
+	}
+	return offset;
+}
+
+StrPtr *SpilledStrDict::VGetVar(const StrPtr &var)
+{
+	for (size_t i = 0; i < fields.size(); i++)
+	{
+		const StrRef &key = fields[i].key;
+		if (key.Length() == var.Length() && memcmp(key.Text(), var.Text(), key.Length()) == 0)
+			return &fields[i].value;
+	}
+	return NULL;
+}
+
+int SpilledStrDict::VGetVarX(int x, StrRef &var, StrRef &val)
+{
+	if (x < 0 || x >= (int) fields.size())
+		return 0;
+	var.Set(fields[x].key.Text(), fields[x].key.Length());
+	val.Set(fields[x].value.Text(), fields[x].value.Length());
+	return 1;
+}
@@ -0,0 +1,137 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ResultSpill.h
+ *
+ * Description	:  SpillFile holds command results that grew past the spill
+ *  threshold in an unlinked temporary file. Data is only ever appended and is
+ *  read back through a read-only memory mapping of the whole file, so the
+ *  memory used for a large result is paged by the system instead of held in
+ *  the heap.
+ *
+ *  Tagged output is written as records: the number of fields, then for each
+ *  field the length and NUL terminated text of the key and of the value,
+ *  the count and lengths being 32 bit little endian whatever the platform,
+ *  see ByteOrder.h. SpilledStrDict reads a record in place. The same
+ *  records are used by serialized result sets, see ResultSet.h.
+ *
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+
+class SpillFile
+{
+public:
+	SpillFile();
+	~SpillFile();
+
+	// Create the file in dir, or in the system temporary directory if dir
+	//  is empty. The file is removed when the SpillFile is deleted.
+	bool Open(const std::string &dir);
+
+	bool Append(const void *data, size_t len);
+
+	// Bytes appended so far
+	long long Size() const { return size; }
+
+	// Map the whole file. terminate puts a NUL after the data so text can be
+	//  returned as a string. The mapping is valid until the file grows and is
+	//  mapped again, or the SpillFile is deleted. Returns NULL on failure.
+	const char *Map(bool terminate = false);
+
+private:
+	SpillFile(const SpillFile &);
+	SpillFile &operator=(const SpillFile &);
+
+	bool Flush();
+	bool Write(const char *data, size_t len, long long offset);
+	void Unmap();
+
+#ifdef OS_NT
+	HANDLE hFile;
+	HANDLE hMap;
+#else
+	int fd;
+#endif
+
+	char *view;
+	size_t viewSize;
+
+	long long size;			// bytes appended
+	long long written;		// bytes in the file, not counting the terminator
+	bool terminated;		// a NUL follows the data in the file
+
+	std::vector<char> buffer;
+};
+
+// One tagged record being built for a SpillFile
+class SpillRecord
+{
+public:
+	SpillRecord();
+
+	void Add(const StrPtr &key, const StrPtr &val);
+	int Count() const { return count; }
+
+	bool WriteTo(SpillFile *file);
+	void AppendTo(std::vector<char> &out);
+
+private:
+	void AddString(const StrPtr &s);
+
+	std::vector<char> data;
+	unsigned int count;
+};
+
+// A read only view of a record in a mapped SpillFile
+class SpilledStrDict : public StrDict
+{
+public:
+	SpilledStrDict() {}
+	virtual ~SpilledStrDict() {}
+
+	// Point at the record at offset, returns the offset of the next record
+	//  or 0 if the record is not complete
+	size_t Set(const char *base, size_t offset, size_t size);
+
+protected:
+	virtual StrPtr *VGetVar(const StrPtr &var);
+	virtual void VSetVar(const StrPtr &var, const StrPtr &val) {}
+	virtual int VGetVarX(int x, StrRef &var, StrRef &val);
+
+private:
+	struct Field
+	{
+		StrRef key;
+		StrRef value;
+	};
+
+	std::vector<Field> fields;
+};
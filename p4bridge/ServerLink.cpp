@@ -0,0 +1,66 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ServerLink.cpp
+ *
+ * Description	:  ServerLink
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "ServerLink.h"
+
+ServerLink::ServerLink() :
+	ownerAlive(true)
+{
+}
+
+bool ServerLink::Attach(P4BridgeServer *pServer)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if (!ownerAlive)
+		return false;
+	servers.insert(pServer);
+	return true;
+}
+
+void ServerLink::Detach(P4BridgeServer *pServer)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	servers.erase(pServer);
+}
+
+void ServerLink::OwnerDeleted(const std::function<void(P4BridgeServer*)> &deleted)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	ownerAlive = false;
+	for (std::set<P4BridgeServer*>::iterator it = servers.begin(); it != servers.end(); ++it)
+	{
+		deleted(*it);
+	}
+	servers.clear();
+}
@@ -0,0 +1,68 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: ServerLink.h
+ *
+ * Description	:  ServerLink keeps the servers attached to an object such as
+ *  a P4FileIndex, P4NdjsonWriter or P4ResolvePolicy, so the servers can be
+ *  told when it is deleted. The owner and every attached server hold the
+ *  link, so it outlives whichever of them goes first.
+ *
+ *  The owner calls back into the servers while holding the link lock, and a
+ *  server detaches under the same lock, so a server that is being deleted
+ *  is never called back once Detach returns. Because of that, Attach and
+ *  Detach must not be called with the server's runMutex held.
+ *
+ ******************************************************************************/
+
+#include <set>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+class P4BridgeServer;
+
+class ServerLink
+{
+public:
+	ServerLink();
+
+	// Returns false once the owner is being deleted
+	bool Attach(P4BridgeServer *pServer);
+	void Detach(P4BridgeServer *pServer);
+
+	// Called from the owner's destructor, calls deleted for every attached
+	//  server and refuses new ones
+	void OwnerDeleted(const std::function<void(P4BridgeServer*)> &deleted);
+
+private:
+	std::mutex mutex;
+	bool ownerAlive;
+	std::set<P4BridgeServer*> servers;
+};
@@ -0,0 +1,281 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: StringPool.cpp
+ *
+ * Description	:  StringPool
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "StringPool.h"
+
+// Size of the blocks strings are packed into. Longer strings get a block of
+//  their own.
+#define STRING_POOL_BLOCK (64 * 1024)
+
+#define STRING_POOL_MIN_SLOTS 64
+
+// Values longer than this are added without looking for a copy, hashing
+//  them costs more than sharing the rare duplicate saves
+#define POOLED_DICT_MAX_INTERN 256
+
+StringPool::StringPool() :
+	current(NULL),
+	currentUsed(0),
+	blockBytes(0),
+	interned(0)
+{
+	Clear();
+}
+
+StringPool::~StringPool()
+{
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		delete[] blocks[i];
+	}
+}
+
+void StringPool::Clear()
+{
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		delete[] blocks[i];
+	}
+	blocks.clear();
+	current = NULL;
+	currentUsed = 0;
+	blockBytes = 0;
+
+	strings.clear();
+	lengths.clear();
+	slots.assign(STRING_POOL_MIN_SLOTS, 0);
+	interned = 0;
+
+	// id 0 is the empty string
+	strings.push_back("");
+	lengths.push_back(0);
+}
+
+size_t StringPool::Bytes() const
+{
+	return blockBytes +
+		strings.capacity() * sizeof(const char *) +
+		lengths.capacity() * sizeof(unsigned int) +
+		slots.capacity() * sizeof(unsigned int);
+}
+
+// FNV-1a
+size_t StringPool::Hash(const char *s, size_t len)
+{
+	unsigned int h = 2166136261u;
+	for (size_t i = 0; i < len; i++)
+	{
+		h ^= (unsigned char) s[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+char *StringPool::Store(const char *s, size_t len)
+{
+	char *p;
+	if (len + 1 > STRING_POOL_BLOCK / 4)
+	{
+		// a block of its own, keep filling the current one
+		p = new char[len + 1];
+		blocks.push_back(p);
+		blockBytes += len + 1;
+	}
+	else
+	{
+		if (!current || currentUsed + len + 1 > STRING_POOL_BLOCK)
+		{
+			current = new char[STRING_POOL_BLOCK];
+			currentUsed = 0;
+			blocks.push_back(current);
+			blockBytes += STRING_POOL_BLOCK;
+		}
+		p = current + currentUsed;
+		currentUsed += len + 1;
+	}
+	memcpy(p, s, len);
+	p[len] = '\0';
+	return p;
+}
+
+void StringPool::Rehash(size_t size)
+{
+	// move the entries of the old table, which leaves out the added strings
+	std::vector<unsigned int> old(size, 0);
+	old.swap(slots);
+	size_t mask = size - 1;
+	for (size_t i = 0; i < old.size(); i++)
+	{
+		if (!old[i])
+			continue;
+		unsigned int id = old[i] - 1;
+		size_t slot = Hash(strings[id], lengths[id]) & mask;
+		while (slots[slot])
+			slot = (slot + 1) & mask;
+		slots[slot] = id + 1;
+	}
+}
+
+int StringPool::Find(const char *s, size_t len) const
+{
+	if (len == 0)
+		return 0;
+
+	size_t mask = slots.size() - 1;
+	size_t slot = Hash(s, len) & mask;
+	while (slots[slot])
+	{
+		unsigned int id = slots[slot] - 1;
+		if (lengths[id] == len && memcmp(strings[id], s, len) == 0)
+			return (int) id;
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+unsigned int StringPool::Intern(const char *s, size_t len)
+{
+	if (!s || len == 0)
+		return 0;
+
+	size_t mask = slots.size() - 1;
+	size_t slot = Hash(s, len) & mask;
+	while (slots[slot])
+	{
+		unsigned int id = slots[slot] - 1;
+		if (lengths[id] == len && memcmp(strings[id], s, len) == 0)
+			return id;
+		slot = (slot + 1) & mask;
+	}
+
+	unsigned int id = (unsigned int) strings.size();
+	strings.push_back(Store(s, len));
+	lengths.push_back((unsigned int) len);
+	slots[slot] = id + 1;
+	interned++;
+
+	// keep the table at most half full
+	if (interned * 2 > slots.size())
+		Rehash(slots.size() * 2);
+
+	return id;
+}
+
+unsigned int StringPool::Add(const char *s, size_t len)
+{
+	if (!s || len == 0)
+		return 0;
+
+	unsigned int id = (unsigned int) strings.size();
+	strings.push_back(Store(s, len));
+	lengths.push_back((unsigned int) len);
+	return id;
+}
+
+/*******************************************************************************
+ *
+ *  PooledStrDict
+ *
+ ******************************************************************************/
+
+int PooledStrDict::FindValueId(unsigned int key) const
+{
+	for (size_t i = 0; i < fields.size(); i++)
+	{
+		if (fields[i].key == key)
+			return (int) fields[i].val;
+	}
+	return -1;
+}
+
+int PooledStrDict::FindField(const StrPtr &var) const
+{
+	// a key that is not in the pool is not in any dictionary
+	int key = pool->Find(var.Text(), var.Length());
+	if (key < 0)
+		return -1;
+
+	for (size_t i = 0; i < fields.size(); i++)
+	{
+		if (fields[i].key == (unsigned int) key)
+			return (int) i;
+	}
+	return -1;
+}
+
+StrPtr *PooledStrDict::VGetVar(const StrPtr &var)
+{
+	int idx = FindField(var);
+	return (idx >= 0) ? &fields[idx].value : NULL;
+}
+
+void PooledStrDict::VSetVar(const StrPtr &var, const StrPtr &val)
+{
+	unsigned int id = (val.Length() > POOLED_DICT_MAX_INTERN) ?
+		pool->Add(val.Text(), val.Length()) : pool->Intern(val.Text(), val.Length());
+
+	int idx = FindField(var);
+	if (idx < 0)
+	{
+		Field field;
+		field.key = pool->Intern(var.Text(), var.Length());
+		fields.push_back(field);
+		idx = (int) fields.size() - 1;
+	}
+	Field &field = fields[idx];
+	field.val = id;
+	field.value.Set((char *) pool->Get(id), pool->Length(id));
+}
+
+void PooledStrDict::VRemoveVar(const StrPtr &var)
+{
+	int idx = FindField(var);
+	if (idx >= 0)
+		fields.erase(fields.begin() + idx);
+}
+
+int PooledStrDict::VGetVarX(int x, StrRef &var, StrRef &val)
+{
+	if (x < 0 || x >= (int) fields.size())
+		return 0;
+
+	var.Set((char *) pool->Get(fields[x].key), pool->Length(fields[x].key));
+	val.Set(fields[x].value.Text(), fields[x].value.Length());
+	return 1;
+}
+
+void PooledStrDict::VClear()
+{
+	fields.clear();
+}
@@ -0,0 +1,132 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: StringPool.h
+ *
+ * Description	:  StringPool stores each distinct string once and refers to
+ *  it by a small integer id. Strings are packed into large blocks that are
+ *  never moved, so a pointer returned by Get() stays valid until the pool is
+ *  cleared or deleted. Id 0 is always the empty string.
+ *
+ *  StringPool is not thread safe, the owner must serialize access.
+ *
+ *  PooledStrDict is a StrDict that keeps its keys and values in a
+ *  StringPool shared by many dictionaries, so the same field names and
+ *  values in every record of a large result are stored once.
+ *
+ ******************************************************************************/
+
+#include <vector>
+#include <string.h>
+
+class StringPool
+{
+public:
+	StringPool();
+	~StringPool();
+
+	// The id of the string, adding it if it is new
+	unsigned int Intern(const char *s, size_t len);
+	unsigned int Intern(const char *s) { return s ? Intern(s, strlen(s)) : 0; }
+
+	// A new id for the string without looking for an existing copy, used
+	//  for long values that are unlikely to repeat. Find() does not see it.
+	unsigned int Add(const char *s, size_t len);
+
+	// The id of the string, or -1 if it is not in the pool
+	int Find(const char *s, size_t len) const;
+
+	const char *Get(unsigned int id) const { return (id < strings.size()) ? strings[id] : NULL; }
+	unsigned int Length(unsigned int id) const { return (id < lengths.size()) ? lengths[id] : 0; }
+
+	int Count() const { return (int) strings.size(); }
+
+	// Memory held by the pool, in bytes
+	size_t Bytes() const;
+
+	void Clear();
+
+private:
+	StringPool(const StringPool &);
+	StringPool &operator=(const StringPool &);
+
+	char *Store(const char *s, size_t len);
+	void Rehash(size_t size);
+
+	static size_t Hash(const char *s, size_t len);
+
+	std::vector<char *> blocks;
+	char *current;
+	size_t currentUsed;
+	size_t blockBytes;
+
+	std::vector<const char *> strings;
+	std::vector<unsigned int> lengths;
+
+	// open addressing hash table of id + 1, 0 marks an empty slot. Only
+	//  interned strings are in it, not the ones from Add().
+	std::vector<unsigned int> slots;
+	size_t interned;
+};
+
+class PooledStrDict : public StrDict
+{
+public:
+	PooledStrDict(StringPool *pool) : pool(pool) {}
+	virtual ~PooledStrDict() {}
+
+	int Count() const { return (int) fields.size(); }
+	unsigned int KeyId(int idx) const { return fields[idx].key; }
+	unsigned int ValueId(int idx) const { return fields[idx].val; }
+
+	// The id of the value for a key id, -1 if the key is not set
+	int FindValueId(unsigned int key) const;
+
+protected:
+	// A StrPtr returned by VGetVar() is valid until the dictionary is changed
+	virtual StrPtr *VGetVar(const StrPtr &var);
+	virtual void VSetVar(const StrPtr &var, const StrPtr &val);
+	virtual void VRemoveVar(const StrPtr &var);
+	virtual int VGetVarX(int x, StrRef &var, StrRef &val);
+	virtual void VClear();
+
+private:
+	struct Field
+	{
+		StrRef value;
+		unsigned int key;
+		unsigned int val;
+	};
+
+	StringPool *pool;
+	std::vector<Field> fields;
+
+	int FindField(const StrPtr &var) const;
+};
@@ -0,0 +1,232 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: TicketCache.cpp
+ *
+ * Description	:  TicketCache
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4Connection.h"
+#include "TicketCache.h"
+#include "ticket.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+namespace {
+	struct Value
+	{
+		bool found;
+		std::string ticket;
+	};
+
+	// The tickets read from one version of a file. A changed file gets a
+	//  new table, so a lookup holding the old one is never disturbed.
+	struct Table
+	{
+		Table() { memset(&stamp, 0, sizeof(stamp)); }
+
+		Utils::FileStamp stamp;
+		std::mutex mutex;						// guards tickets
+		std::map<std::string, Value> tickets;	// by port and user
+	};
+
+	struct Entry
+	{
+		Entry() : checkedMs(0), checking(false), table(new Table()) {}
+
+		long long checkedMs;	// 0 until the file has been checked
+		bool checking;			// a lookup is checking the file
+		std::shared_ptr<Table> table;
+	};
+
+	// every ticket file looked up, guarded by cache_mutex. It is only held
+	//  to find a file's table, never while a file is checked or read.
+	std::mutex cache_mutex;
+	std::map<std::string, Entry> files;
+	std::string default_path;
+	bool default_path_set = false;
+	int enviro_generation = 0;
+	int recheck_ms = TICKET_CACHE_RECHECK_MS;
+
+	std::atomic<int> hit_count(0);
+	std::atomic<int> miss_count(0);
+	std::atomic<int> reload_count(0);
+}
+
+/*******************************************************************************
+ *
+ *  Lookup
+ *
+ *  The file is checked before it is read, so a change made while it is
+ *   being read is caught by the next check. One lookup checks a file that
+ *   is due, the others go on with its current table meanwhile. A ticket
+ *   not yet in the table is read without any lock held; two lookups of it
+ *   at once both read the file and store the same value.
+ *
+ ******************************************************************************/
+
+bool TicketCache::Lookup(const char *path, const char *port, const char *user, std::string &ticket)
+{
+	ticket.clear();
+	std::string file = (path && *path) ? path : DefaultPath();
+	if (file.empty())
+		return false;
+
+	std::string key = std::string(port ? port : "") + "=" + (user ? user : "");
+	long long now = P4Connection::NowMs();
+
+	std::shared_ptr<Table> table;
+	bool check = false;
+	{
+		std::lock_guard<std::mutex> guard(cache_mutex);
+		Entry &entry = files[file];
+		table = entry.table;
+		// until a file has been checked every lookup checks it, there is
+		//  no table to go on with
+		if (!entry.checkedMs || (!entry.checking && (now - entry.checkedMs >= recheck_ms)))
+		{
+			entry.checking = true;
+			check = true;
+		}
+	}
+
+	if (check)
+	{
+		Utils::FileStamp stamp;
+		Utils::GetFileStamp(file, stamp);
+
+		std::lock_guard<std::mutex> guard(cache_mutex);
+		Entry &entry = files[file];
+		if (stamp != entry.table->stamp)
+		{
+			if (entry.checkedMs)
+				reload_count++;
+			entry.table = std::make_shared<Table>();
+			entry.table->stamp = stamp;
+		}
+		// never 0 once checked
+		entry.checkedMs = now ? now : 1;
+		entry.checking = false;
+		table = entry.table;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(table->mutex);
+		std::map<std::string, Value>::iterator it = table->tickets.find(key);
+		if (it != table->tickets.end())
+		{
+			hit_count++;
+			ticket = it->second.ticket;
+			return it->second.found;
+		}
+	}
+
+	miss_count++;
+	Value value;
+	value.found = false;
+	if (table->stamp.exists)
+	{
+		StrBuf pathBuf(file.c_str());
+		StrBuf portBuf(port ? port : "");
+		StrBuf userBuf(user ? user : "");
+		Ticket t(&pathBuf);
+		char *found = t.GetTicket(portBuf, userBuf);
+		if (found)
+		{
+			value.found = true;
+			value.ticket = found;
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(table->mutex);
+	table->tickets[key] = value;
+	ticket = value.ticket;
+	return value.found;
+}
+
+std::string TicketCache::DefaultPath()
+{
+	int generation;
+	{
+		std::lock_guard<std::mutex> guard(cache_mutex);
+		if (default_path_set)
+			return default_path;
+		generation = enviro_generation;
+	}
+
+	// resolved outside the cache lock, it takes the environment lock
+	std::string path = P4BridgeServer::GetTicketFile();
+
+	// don't keep it if the environment changed while it was resolved
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	if (generation == enviro_generation)
+	{
+		default_path = path;
+		default_path_set = true;
+	}
+	return path;
+}
+
+void TicketCache::Invalidate(const char *path)
+{
+	std::string file = (path && *path) ? path : DefaultPath();
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	files.erase(file);
+}
+
+void TicketCache::EnviroChanged()
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	default_path_set = false;
+	default_path.clear();
+	enviro_generation++;
+}
+
+void TicketCache::SetRecheckInterval(int ms)
+{
+	std::lock_guard<std::mutex> guard(cache_mutex);
+	recheck_ms = (ms > 0) ? ms : 0;
+}
+
+void TicketCache::GetCounts(int *hits, int *misses, int *reloads)
+{
+	if (hits) *hits = hit_count;
+	if (misses) *misses = miss_count;
+	if (reloads) *reloads = reload_count;
+}
+
+bool TicketCache::ChangesTickets(const char *cmd)
+{
+	return cmd && (!strcmp(cmd, "login") || !strcmp(cmd, "logout") || !strcmp(cmd, "passwd") ||
+		!strcmp(cmd, "login2"));
+}
@@ -0,0 +1,81 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: TicketCache.h
+ *
+ * Description	:  TicketCache keeps the tickets looked up in each ticket
+ *  file for the whole process, so deciding whether to log in does not read
+ *  and parse the file every time. The entries of a file are dropped when
+ *  its modification time, size or inode change, and after a login, logout
+ *  or connect run by the bridge. Lookups go through Ticket::GetTicket, so
+ *  ports and users match exactly as they do for the P4API.
+ *
+ *  The file is checked at most once per recheck interval, a lookup inside
+ *  the interval does no file I/O at all. Each version of a file has its own
+ *  table of tickets, and files are checked and read outside the lock that
+ *  guards the cache, so a slow ticket file does not hold up other lookups.
+ *
+ ******************************************************************************/
+
+#include <string>
+
+// Default for how often a ticket file is checked for changes
+#define TICKET_CACHE_RECHECK_MS	1000
+
+class TicketCache
+{
+public:
+	// Get the ticket for port and user from a ticket file, or from the
+	//  default ticket file (P4TICKETS) if path is NULL or empty. Returns
+	//  false if there is no ticket.
+	static bool Lookup(const char *path, const char *port, const char *user, std::string &ticket);
+
+	// The default ticket file, resolved once until the environment changes
+	static std::string DefaultPath();
+
+	// Drop the cached tickets of one ticket file, or of the default ticket
+	//  file if path is NULL or empty. Called after a command that changes
+	//  tickets, other files are left alone.
+	static void Invalidate(const char *path);
+
+	// Forget the default ticket file, called when the environment changes
+	static void EnviroChanged();
+
+	// How often in milliseconds a file is checked for changes, 0 to check
+	//  on every lookup
+	static void SetRecheckInterval(int ms);
+
+	// hits: lookups answered from the cache
+	// misses: lookups that read the file
+	// reloads: times a file was found to have changed
+	static void GetCounts(int *hits, int *misses, int *reloads);
+
+	// True for the commands that write the ticket file
+	static bool ChangesTickets(const char *cmd);
+};
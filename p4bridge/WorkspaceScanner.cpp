@@ -0,0 +1,682 @@
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/*******************************************************************************
+ * Name		: WorkspaceScanner.cpp
+ *
+ * Description	:  P4WorkspaceScan
+ *
+ ******************************************************************************/
+#include "stdafx.h"
+#include "P4BridgeServer.h"
+#include "P4BridgeClient.h"
+#include "WorkspaceScanner.h"
+
+#include "filesys.h"
+#include "ignore.h"
+#include "md5.h"
+#include "strarray.h"
+#include "enviro.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <cstring>
+
+#ifndef OS_NT
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef OS_NT
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+// Files are mapped this much at a time, a multiple of the page size and of
+//  the Windows allocation granularity
+#define DIGEST_WINDOW (16 * 1024 * 1024)
+
+#define DIGEST_LENGTH 32
+
+P4WorkspaceScan::P4WorkspaceScan() :
+	p4base(tP4WorkspaceScan)
+{
+}
+
+P4WorkspaceScan::~P4WorkspaceScan()
+{
+}
+
+/*******************************************************************************
+ *
+ *  MapFile
+ *
+ *  Pass the content of a file to consume a window at a time.
+ *
+ ******************************************************************************/
+
+#ifdef OS_NT
+bool MapFile(const string &path, const std::function<void(const char *, size_t)> &consume)
+{
+	int wlen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+	if (wlen <= 0)
+		return false;
+	std::vector<wchar_t> wpath(wlen);
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], wlen);
+
+	HANDLE hFile = CreateFileW(&wpath[0], GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size))
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	bool ok = true;
+	if (size.QuadPart > 0)
+	{
+		HANDLE hMap = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!hMap)
+		{
+			CloseHandle(hFile);
+			return false;
+		}
+		for (long long offset = 0; ok && offset < size.QuadPart; offset += DIGEST_WINDOW)
+		{
+			long long remaining = size.QuadPart - offset;
+			SIZE_T len = (SIZE_T) ((remaining < DIGEST_WINDOW) ? remaining : DIGEST_WINDOW);
+			void *view = MapViewOfFile(hMap, FILE_MAP_READ, (DWORD) (offset >> 32),
+				(DWORD) (offset & 0xFFFFFFFF), len);
+			if (!view)
+			{
+				ok = false;
+				break;
+			}
+			consume((const char *) view, (size_t) len);
+			UnmapViewOfFile(view);
+		}
+		CloseHandle(hMap);
+	}
+	CloseHandle(hFile);
+	return ok;
+}
+#else
+bool MapFile(const string &path, const std::function<void(const char *, size_t)> &consume)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	bool ok = true;
+	for (long long offset = 0; offset < (long long) st.st_size; offset += DIGEST_WINDOW)
+	{
+		long long remaining = (long long) st.st_size - offset;
+		size_t len = (size_t) ((remaining < DIGEST_WINDOW) ? remaining : DIGEST_WINDOW);
+		void *view = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, (off_t) offset);
+		if (view == MAP_FAILED)
+		{
+			ok = false;
+			break;
+		}
+		madvise(view, len, MADV_SEQUENTIAL);
+		consume((const char *) view, len);
+		munmap(view, len);
+	}
+	close(fd);
+	return ok;
+}
+#endif
+
+/*******************************************************************************
+ *
+ *  DigestFile
+ *
+ *  MD5 of a file as it is on disk. The server digests text files with LF
+ *  line endings, so if the file has any CRLF, textDigest and textSize are
+ *  set from a second pass that reads each CRLF as LF; otherwise textDigest
+ *  is left empty.
+ *
+ ******************************************************************************/
+
+bool DigestFile(const string &path, string &digest, string &textDigest, long long &textSize)
+{
+	MD5 md5;
+	bool crlf = false;
+	bool pendingCR = false;
+	if (!MapFile(path, [&](const char *p, size_t len)
+		{
+			md5.Update(StrRef((char *) p, (int) len));
+			if (crlf || !len)
+				return;
+			if (pendingCR && *p == '\n')
+				crlf = true;
+			for (const char *cr = (const char *) memchr(p, '\r', len); !crlf && cr;
+				cr = (const char *) memchr(cr + 1, '\r', len - (cr + 1 - p)))
+			{
+				crlf = (cr + 1 < p + len) && cr[1] == '\n';
+			}
+			pendingCR = p[len - 1] == '\r';
+		}))
+		return false;
+
+	StrBuf result;
+	md5.Final(result);
+	digest = result.Text();
+	textDigest.clear();
+	if (!crlf)
+		return true;
+
+	MD5 text;
+	textSize = 0;
+	pendingCR = false;
+	auto write = [&](const char *p, size_t len)
+	{
+		if (!len)
+			return;
+		text.Update(StrRef((char *) p, (int) len));
+		textSize += (long long) len;
+	};
+	if (!MapFile(path, [&](const char *p, size_t len)
+		{
+			const char *end = p + len;
+			if (pendingCR && p < end && *p != '\n')
+				write("\r", 1);
+			pendingCR = false;
+			const char *start = p;
+			for (const char *cr = (const char *) memchr(p, '\r', len); cr;
+				cr = (const char *) memchr(cr + 1, '\r', end - (cr + 1)))
+			{
+				if (cr + 1 == end)
+				{
+					// decided by the first byte of the next window
+					write(start, cr - start);
+					start = end;
+					pendingCR = true;
+					break;
+				}
+				if (cr[1] == '\n')
+				{
+					write(start, cr - start);
+					start = cr + 1;
+				}
+			}
+			write(start, end - start);
+		}))
+		return false;
+	if (pendingCR)
+		write("\r", 1);
+
+	text.Final(result);
+	textDigest = result.Text();
+	return true;
+}
+
+/*******************************************************************************
+ *
+ *  Scan
+ *
+ *  Each thread has its own queue of directories to scan. New directories go
+ *   on the back of the finder's queue and are scanned depth first from there,
+ *   while idle threads steal from the front of other queues, which holds the
+ *   directories nearest the root and so the most work. pending counts the
+ *   directories queued or being scanned, the walk is done when it reaches 0.
+ *
+ ******************************************************************************/
+
+namespace {
+	struct DirQueue
+	{
+		std::mutex mutex;
+		std::deque<string> dirs;
+	};
+
+	bool PopDir(DirQueue &queue, string &dir, bool fromBack)
+	{
+		std::lock_guard<std::mutex> guard(queue.mutex);
+		if (queue.dirs.empty())
+			return false;
+		if (fromBack)
+		{
+			dir = queue.dirs.back();
+			queue.dirs.pop_back();
+		}
+		else
+		{
+			dir = queue.dirs.front();
+			queue.dirs.pop_front();
+		}
+		return true;
+	}
+
+	void PushDir(DirQueue &queue, const string &dir)
+	{
+		std::lock_guard<std::mutex> guard(queue.mutex);
+		queue.dirs.push_back(dir);
+	}
+}
+
+int P4WorkspaceScan::Scan(const char *root, int flags, int threads)
+{
+	LOG_ENTRY();
+	entries.clear();
+	packed.clear();
+	if (!root || !*root)
+		return 0;
+
+	if (threads <= 0)
+		threads = (int) std::thread::hardware_concurrency();
+	if (threads <= 0)
+		threads = 1;
+
+	// the ignore file name only needs to be looked up once
+	string ignoreName;
+	if (!(flags & SCAN_NO_IGNORE))
+	{
+		const char *p4ignore = P4BridgeServer::Get("P4IGNORE");
+		if (p4ignore)
+			ignoreName = p4ignore;
+	}
+
+	string start = root;
+	if (start.length() > 1 && (start[start.length() - 1] == '/' || start[start.length() - 1] == PATH_SEPARATOR))
+		start.erase(start.length() - 1);
+
+	std::unique_ptr<DirQueue[]> queues(new DirQueue[threads]);
+	std::vector< std::vector<Entry> > found(threads);
+	std::atomic<int> pending(1);
+	queues[0].dirs.push_back(start);
+
+	auto worker = [&](int self) {
+		// the ignore rules are cached by directory and not thread safe, so
+		//  every thread gets its own
+		Ignore ignore;
+		StrRef ignoreRef(ignoreName.c_str(), (int) ignoreName.length());
+		std::unique_ptr<FileSys> fs(FileSys::Create(FST_TEXT));
+		int idle = 0;
+
+		while (true)
+		{
+			string dir;
+			bool got = PopDir(queues[self], dir, true);
+			for (int i = 1; !got && i < threads; i++)
+			{
+				got = PopDir(queues[(self + i) % threads], dir, false);
+			}
+			if (!got)
+			{
+				if (pending == 0)
+					break;
+				// others are still scanning and may queue more work
+				if (++idle < 64)
+					std::this_thread::yield();
+				else
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				continue;
+			}
+			idle = 0;
+
+			try
+			{
+				Error e;
+				fs->Set(StrRef(dir.c_str(), (int) dir.length()));
+				std::unique_ptr<StrArray> names(fs->ScanDir(&e));
+				if (names && !e.Test())
+				{
+					for (int i = 0; i < names->Count(); i++)
+					{
+						const char *name = names->Get(i)->Text();
+						if (!strcmp(name, ".") || !strcmp(name, ".."))
+							continue;
+
+						string path = dir;
+						path += PATH_SEPARATOR;
+						path += name;
+
+						fs->Set(StrRef(path.c_str(), (int) path.length()));
+						int stat = fs->Stat();
+						if (!(stat & FSF_EXISTS))
+							continue;
+
+						// symlinks are versioned as links, never followed
+						if ((stat & FSF_DIRECTORY) && !(stat & FSF_SYMLINK))
+						{
+							// an ignored directory is not walked at all. As
+							//  with reconcile, a file under it can't be added
+							//  back by a later rule.
+							if (!ignoreName.empty())
+							{
+								string everything = path;
+								everything += PATH_SEPARATOR;
+								everything += "...";
+								if (ignore.Reject(StrRef(everything.c_str(), (int) everything.length()), ignoreRef))
+									continue;
+							}
+							pending++;
+							PushDir(queues[self], path);
+							continue;
+						}
+
+						if (!ignoreName.empty() &&
+							ignore.Reject(StrRef(path.c_str(), (int) path.length()), ignoreRef))
+							continue;
+
+						Entry entry;
+						entry.path = path;
+						entry.size = (long long) fs->GetSize();
+						entry.mtime = (long long) fs->StatModTime();
+						entry.textSize = entry.size;
+						entry.status = SCAN_NOT_COMPARED;
+						if ((flags & SCAN_DIGEST) && !(stat & FSF_SYMLINK))
+						{
+							if (!DigestFile(path, entry.digest, entry.textDigest, entry.textSize))
+							{
+								entry.digest.clear();
+								entry.textDigest.clear();
+							}
+						}
+						found[self].push_back(entry);
+					}
+				}
+			}
+			catch (std::exception& e)
+			{
+				P4BridgeServer::ReportException(e, "P4WorkspaceScan::Scan");
+			}
+			pending--;
+		}
+	};
+
+	// the threads that did start are always joined, and the calling thread
+	//  always does its share, so the walk finishes even if only it runs
+	std::vector<std::thread> pool;
+	try
+	{
+		pool.reserve(threads - 1);
+		for (int i = 1; i < threads; i++)
+		{
+			pool.emplace_back(worker, i);
+		}
+	}
+	catch (std::exception& e)
+	{
+		P4BridgeServer::ReportException(e, "P4WorkspaceScan::Scan");
+	}
+	try
+	{
+		worker(0);
+	}
+	catch (std::exception& e)
+	{
+		P4BridgeServer::ReportException(e, "P4WorkspaceScan::Scan");
+	}
+	for (size_t i = 0; i < pool.size(); i++)
+	{
+		pool[i].join();
+	}
+
+	size_t total = 0;
+	for (int i = 0; i < threads; i++)
+		total += found[i].size();
+	entries.reserve(total);
+	for (int i = 0; i < threads; i++)
+		entries.insert(entries.end(), found[i].begin(), found[i].end());
+
+	std::sort(entries.begin(), entries.end(),
+		[](const Entry &a, const Entry &b) { return a.path < b.path; });
+
+	return (int) entries.size();
+}
+
+/*******************************************************************************
+ *
+ *  Compare
+ *
+ ******************************************************************************/
+
+string P4WorkspaceScan::PathKey(const string &path)
+{
+#ifdef OS_NT
+	// Windows paths are case insensitive and may use either separator
+	string key = path;
+	for (size_t i = 0; i < key.length(); i++)
+	{
+		if (key[i] == '/')
+			key[i] = '\\';
+		else if (key[i] >= 'A' && key[i] <= 'Z')
+			key[i] = key[i] - 'A' + 'a';
+	}
+	return key;
+#else
+	return path;
+#endif
+}
+
+int P4WorkspaceScan::Compare(StrDictList *fstat)
+{
+	StrDictListIterator it(fstat);
+	return Compare(&it);
+}
+
+/*******************************************************************************
+ *
+ *  DigestKind
+ *
+ *  How the server's digest and fileSize of a file of the given type relate
+ *  to the bytes in the workspace: the same bytes, the same bytes with LF
+ *  line endings, or a form that can't be recreated here (keywords
+ *  expanded, unicode translated to the client charset, symlinks, ...).
+ *
+ ******************************************************************************/
+
+enum { DIGEST_RAW, DIGEST_TEXT, DIGEST_NONE };
+
+static int DigestKind(const char *type)
+{
+	if (!type || !*type)
+		return DIGEST_TEXT;
+
+	string base(type);
+	string modifiers;
+	size_t plus = base.find('+');
+	if (plus != string::npos)
+	{
+		modifiers = base.substr(plus + 1);
+		base.erase(plus);
+	}
+
+	if (base == "ktext" || base == "kxtext" || modifiers.find('k') != string::npos)
+		return DIGEST_NONE;
+	if (base.find("unicode") != string::npos || base.find("utf") != string::npos ||
+		base == "symlink" || base == "apple" || base == "resource")
+		return DIGEST_NONE;
+	if (base.find("binary") != string::npos || base.find("tempobj") != string::npos)
+		return DIGEST_RAW;
+	return DIGEST_TEXT;
+}
+
+int P4WorkspaceScan::Compare(StrDictListIterator *fstat)
+{
+	LOG_ENTRY();
+	packed.clear();
+
+	struct DepotFile
+	{
+		string clientFile;
+		string digest;
+		long long size;
+		int kind;
+		bool have;
+		bool seen;
+	};
+	std::vector<DepotFile> files;
+	std::unordered_map<string, size_t> index;
+
+	StrDictList *pItem;
+	while (fstat && (pItem = fstat->GetNextItem()) != NULL)
+	{
+		StrDict *dict = pItem->Data();
+		StrPtr *clientFile = dict->GetVar("clientFile");
+		if (!clientFile)
+			continue;
+
+		DepotFile file;
+		file.clientFile = clientFile->Text();
+		StrPtr *digest = dict->GetVar("digest");
+		file.digest = digest ? digest->Text() : "";
+		StrPtr *size = dict->GetVar("fileSize");
+		file.size = size ? size->Atoi64() : -1;
+		// the opened type governs the workspace file if there is one
+		StrPtr *type = dict->GetVar("type");
+		if (!type)
+			type = dict->GetVar("headType");
+		file.kind = DigestKind(type ? type->Text() : NULL);
+		StrPtr *haveRev = dict->GetVar("haveRev");
+		StrPtr *headAction = dict->GetVar("headAction");
+		// a file deleted at head is expected to be missing
+		file.have = haveRev && !(headAction && strstr(headAction->Text(), "delete"));
+		file.seen = false;
+
+		index[PathKey(file.clientFile)] = files.size();
+		files.push_back(file);
+	}
+
+	int differences = 0;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		Entry &entry = entries[i];
+		std::unordered_map<string, size_t>::iterator it = index.find(PathKey(entry.path));
+		if (it == index.end())
+		{
+			entry.status = SCAN_ADDED;
+		}
+		else
+		{
+			DepotFile &file = files[it->second];
+			file.seen = true;
+			bool text = file.kind == DIGEST_TEXT;
+			if (file.kind == DIGEST_NONE)
+				entry.status = SCAN_UNVERIFIED;
+			else if (!entry.digest.empty() && !file.digest.empty())
+				entry.status = (entry.digest == file.digest ||
+					(text && entry.textDigest == file.digest)) ? SCAN_UNCHANGED : SCAN_MODIFIED;
+			else if (file.size < 0 || file.size == entry.size || (text && file.size == entry.textSize))
+				entry.status = SCAN_UNVERIFIED;
+			else if (text && entry.digest.empty() && entry.size > file.size)
+				// not digested, so the CRLFs on disk weren't counted
+				entry.status = SCAN_UNVERIFIED;
+			else
+				entry.status = SCAN_MODIFIED;
+		}
+		if (entry.status != SCAN_UNCHANGED)
+			differences++;
+	}
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (files[i].seen || !files[i].have)
+			continue;
+		Entry entry;
+		entry.path = files[i].clientFile;
+		entry.size = -1;
+		entry.textSize = -1;
+		entry.mtime = 0;
+		entry.status = SCAN_DELETED;
+		entries.push_back(entry);
+		differences++;
+	}
+
+	std::sort(entries.begin(), entries.end(),
+		[](const Entry &a, const Entry &b) { return a.path < b.path; });
+
+	return differences;
+}
+
+const P4WorkspaceScan::Entry *P4WorkspaceScan::GetEntry(int idx) const
+{
+	return ((idx >= 0) && (idx < Count())) ? &entries[idx] : NULL;
+}
+
+const char *P4WorkspaceScan::GetPacked(int *length)
+{
+	if (packed.empty() && !entries.empty())
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			total += 2 * sizeof(long long) + 2 * sizeof(int) + DIGEST_LENGTH + entries[i].path.length();
+		}
+		packed.reserve(total);
+
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			const Entry &entry = entries[i];
+			const char *p;
+
+			p = (const char *) &entry.size;
+			packed.insert(packed.end(), p, p + sizeof(long long));
+			p = (const char *) &entry.mtime;
+			packed.insert(packed.end(), p, p + sizeof(long long));
+			p = (const char *) &entry.status;
+			packed.insert(packed.end(), p, p + sizeof(int));
+
+			char digest[DIGEST_LENGTH];
+			memset(digest, 0, DIGEST_LENGTH);
+			memcpy(digest, entry.digest.c_str(), std::min(entry.digest.length(), (size_t) DIGEST_LENGTH));
+			packed.insert(packed.end(), digest, digest + DIGEST_LENGTH);
+
+			int pathLength = (int) entry.path.length();
+			p = (const char *) &pathLength;
+			packed.insert(packed.end(), p, p + sizeof(int));
+			packed.insert(packed.end(), entry.path.begin(), entry.path.end());
+		}
+	}
+
+	if (length)
+		*length = (int) packed.size();
+	return packed.empty() ? NULL : &packed[0];
+}
@@ -0,0 +1,111 @@
+#pragma once
+/*******************************************************************************
+
+Copyright (c) 2010, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+	notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+	notice, this list of conditions and the following disclaimer in the
+	documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: WorkspaceScanner.h
+ *
+ * Description	:  P4WorkspaceScan walks a workspace on a pool of threads,
+ *  applies the P4IGNORE rules, and collects the size, modification time and,
+ *  optionally, MD5 digest of every file. The results can be compared with
+ *  the tagged output of 'fstat -Ol' to find files that were added, deleted or
+ *  changed without asking the server to do the walk.
+ *
+ ******************************************************************************/
+
+#include <string>
+#include <vector>
+
+using std::string;
+
+class StrDictList;
+class StrDictListIterator;
+
+// Flags for P4WorkspaceScan::Scan()
+#define SCAN_DIGEST			0x01	// compute MD5 digests
+#define SCAN_NO_IGNORE		0x02	// do not apply the P4IGNORE rules
+
+// Values of P4WorkspaceScan::Entry::status
+#define SCAN_NOT_COMPARED	0
+#define SCAN_UNCHANGED		1
+#define SCAN_MODIFIED		2
+#define SCAN_ADDED			3	// on disk, not in the depot
+#define SCAN_DELETED		4	// in the have list, not on disk
+#define SCAN_UNVERIFIED		5	// no digest to compare, or a file type the
+								//  server digests in a form not on disk
+
+class P4WorkspaceScan : public p4base
+{
+public:
+	struct Entry
+	{
+		string path;
+		long long size;
+		long long mtime;
+		string digest;	// upper case hex, empty if not computed
+		string textDigest;	// digest with each CRLF read as LF, empty if no CRLF
+		long long textSize;	// size with each CRLF read as LF
+		int status;
+	};
+
+	P4WorkspaceScan();
+	virtual ~P4WorkspaceScan();
+
+	virtual int Type(void) { return tP4WorkspaceScan; }
+
+	// Walk root using up to threads threads (<= 0 for one per core).
+	//  Returns the number of files found. Entries are sorted by path.
+	int Scan(const char *root, int flags, int threads);
+
+	// Compare the scan with the tagged output of 'fstat -Ol' on the
+	//  workspace, setting the status of each entry and adding entries for
+	//  files that are missing from disk. Returns the number of entries that
+	//  are not SCAN_UNCHANGED.
+	int Compare(StrDictList *fstat);
+	int Compare(StrDictListIterator *fstat);
+
+	int Count() const { return (int) entries.size(); }
+	const Entry *GetEntry(int idx) const;
+
+	// The entries packed into one buffer, valid until the next Scan, Compare
+	//  or release. Each entry is, in native byte order:
+	//     long long size, long long mtime, int status,
+	//     char digest[32] (zero filled if not computed),
+	//     int pathLength, char path[pathLength] (UTF-8, no terminator)
+	const char *GetPacked(int *length);
+
+private:
+	std::vector<Entry> entries;
+	std::vector<char> packed;
+
+	static string PathKey(const string &path);
+};
+
+// Compute the MD5 digest of a file using memory mapped reads, returns false
+//  if the file can't be read
+bool DigestFile(const string &path, string &digest);
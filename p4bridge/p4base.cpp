@@ -307,6 +307,24 @@ const char* p4base::GetTypeStr(int type)
 		return "P4ClientInfoMsg";
 	case tParallelTransfer:
 		return "ParallelTransfer";
+	case tP4PreparedCommand:
+		return "P4PreparedCommand";
+	case tP4FanOut:
+		return "P4FanOut";
+	case tP4WorkspaceScan:
+		return "P4WorkspaceScan";
+	case tP4FileIndex:
+		return "P4FileIndex";
+	case tP4ResultSet:
+		return "P4ResultSet";
+	case tP4NdjsonWriter:
+		return "P4NdjsonWriter";
+	case tP4ResolvePolicy:
+		return "P4ResolvePolicy";
+	case tP4ConfigBatch:
+		return "P4ConfigBatch";
+	case tP4ResultSession:
+		return "P4ResultSession";
 	case p4typesCount:
 		return "Error!p4typesCount";
 #ifdef _DEBUG_MEMORY
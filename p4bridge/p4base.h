@@ -67,6 +67,15 @@ enum p4types {
 	tP4ClientResolve,
 	tP4ClientInfoMsg,
 	tParallelTransfer,
+	tP4PreparedCommand,
+	tP4FanOut,
+	tP4WorkspaceScan,
+	tP4FileIndex,
+	tP4ResultSet,
+	tP4NdjsonWriter,
+	tP4ResolvePolicy,
+	tP4ConfigBatch,
+	tP4ResultSession,
 #ifdef _DEBUG_MEMORY
 	tP4Connection,
 	tConnectionManager,
@@ -39,14 +39,26 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <csignal>
 #include <stdexcept>
 #include <typeinfo>
+#include <memory>
 
 using std::exception;
 
 #include "stdafx.h"
 #include "ticket.h"
+#include "TicketCache.h"
+#include "ConfigCache.h"
 #include "p4libs.h"
 #include "signaler.h"
 #include "P4BridgeServer.h"
+#include "IdleConnectionManager.h"
+#include "P4FanOut.h"
+#include "ResultCache.h"
+#include "WorkspaceScanner.h"
+#include "FileIndex.h"
+#include "ResultSet.h"
+#include "NdjsonWriter.h"
+#include "ResultSession.h"
+#include "CallRecorder.h"
 
 #include "enviro.h"
 
@@ -80,6 +92,10 @@ CONSTRUCTOR void initializer()
 // Finalize before bridge DLL unload
 DESTRUCTOR void destructor()
 {
+	// on Windows the bridge stays loaded while the idle thread runs, so
+	//  this is the process exiting and the thread is already gone
+	IdleConnectionManager::Shutdown();
+
 	Error e;
 	P4Libraries::Shutdown(P4LIBRARIES_INIT_P4 | P4LIBRARIES_INIT_OPENSSL, &e);
 		}
@@ -320,31 +336,21 @@ extern "C"
 		}
 	}
 
+	static const char* OrNull(const string& s)
+	{
+		return s.empty() ? NULL : s.c_str();
+	}
+
 	P4BridgeServer* _connection_from_path(const char* cwd)
 	{
 		// create an un-connected p4bridgeserver based on a path
 		// this is handy if you just want to get the connection info 
 		// from a directory path using P4CONFIG or environment variables
-		Enviro t_enviro;
-
-		// Clone the BridgeEnviron to create a temporary enviro to work with.
-		//Enviro t_enviro(*P4BridgeServer::GetEnviro());
-		// The copy constructor crashes on windows, so a work-around follows
-
-		char* p4config = P4BridgeServer::GetEnviro()->Get("P4CONFIG");
-		if (p4config != NULL)
-		{
-			t_enviro.Update("P4CONFIG", p4config);
-	}
+		ConfigValues values;
+		ConfigCache::Resolve(cwd, values);
 
-		StrBuf t_cwd = cwd;
-		t_enviro.Config(t_cwd);
-		char *t_port = t_enviro.Get("P4PORT");		
-		char* t_user = t_enviro.Get("P4USER");		
-		char* t_client = t_enviro.Get("P4CLIENT");
-		char* t_pass = t_enviro.Get("P4PASSWORD");
-
-		return new P4BridgeServer(t_port, t_user, t_pass, t_client);
+		return new P4BridgeServer(OrNull(values.port), OrNull(values.user),
+			OrNull(values.password), OrNull(values.client));
     }
 
     EXPORT P4BridgeServer* ConnectionFromPath(const char * cwd)
@@ -577,7 +583,7 @@ extern "C"
 	const char* _SetCharacterSet(P4BridgeServer* pServer,
 		const char * pCharSet,
                                     const char * pFileCharSet ) {
-		return Utils::AllocString(pServer->set_charset(pCharSet, pFileCharSet));
+		return Utils::AllocString(pServer->set_charset(pCharSet, pFileCharSet), pServer->GetStringSlab());
 	}
 
     EXPORT const char * SetCharacterSet( P4BridgeServer* pServer,
@@ -662,7 +668,7 @@ extern "C"
 
 	const char* _get_client(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_client());
+		return Utils::AllocString(pServer->get_client(), pServer->GetStringSlab());
 	}
 
 	EXPORT const char * get_client( P4BridgeServer* pServer )
@@ -691,7 +697,7 @@ extern "C"
 
 	const char* _get_user(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_user());
+		return Utils::AllocString(pServer->get_user(), pServer->GetStringSlab());
 	}
 
 	EXPORT const char * get_user( P4BridgeServer* pServer )
@@ -699,7 +705,7 @@ extern "C"
 		try
 		{
 			VALIDATE_HANDLE_P(pServer, tP4BridgeServer);
-			return Utils::AllocString(pServer->get_user());
+			return Utils::AllocString(pServer->get_user(), pServer->GetStringSlab());
 		}
 		catch (exception& e)
 		{
@@ -744,7 +750,7 @@ extern "C"
 
 	const char* _get_port(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_port());
+		return Utils::AllocString(pServer->get_port(), pServer->GetStringSlab());
 	}
 
     EXPORT const char * get_port( P4BridgeServer* pServer )
@@ -799,7 +805,7 @@ extern "C"
 
 	const char* _get_password(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_password());
+		return Utils::AllocString(pServer->get_password(), pServer->GetStringSlab());
 	}
 
 	EXPORT const char * get_password( P4BridgeServer* pServer )
@@ -876,7 +882,7 @@ extern "C"
 
 	const char* _get_TicketFile(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_ticketFile());
+		return Utils::AllocString(pServer->get_ticketFile(), pServer->GetStringSlab());
 	}
 
     EXPORT const char * get_ticketFile(P4BridgeServer* pServer)
@@ -906,12 +912,9 @@ extern "C"
 	const char* _get_ticket(char* path, char* port, char* user)
 	{
 		LOG_ENTRY();
-		StrPtr pathStr = StrRef(path);
-		Ticket ticket(&pathStr);
-		StrPtr portStr = StrRef(port);
-		StrPtr userStr = StrRef(user);
-
-		return Utils::AllocString(ticket.GetTicket(portStr, userStr));
+		string ticket;
+		TicketCache::Lookup(path, port, user, ticket);
+		return Utils::AllocString(ticket);
 	}
 
 	EXPORT const char * get_ticket(char* path, char* port, char* user)
@@ -938,7 +941,7 @@ extern "C"
 
 	const char* get_cwd_int(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_cwd());
+		return Utils::AllocString(pServer->get_cwd(), pServer->GetStringSlab());
 	}
 
 	EXPORT const char * get_cwd( P4BridgeServer* pServer )
@@ -991,7 +994,7 @@ extern "C"
 
 	const char* _get_programName(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_programName());
+		return Utils::AllocString(pServer->get_programName(), pServer->GetStringSlab());
 	}
 
 	EXPORT const char * get_programName( P4BridgeServer* pServer )
@@ -1044,7 +1047,7 @@ extern "C"
 
 	const char * _get_programVer(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_programVer());
+		return Utils::AllocString(pServer->get_programVer(), pServer->GetStringSlab());
 	}
 
     EXPORT const char * get_programVer( P4BridgeServer* pServer )
@@ -1125,7 +1128,7 @@ extern "C"
 
 	const char * _get_charset(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_charset());
+		return Utils::AllocString(pServer->get_charset(), pServer->GetStringSlab());
 	}
 
     EXPORT const char * get_charset( P4BridgeServer* pServer )
@@ -1153,7 +1156,7 @@ extern "C"
 	**************************************************************************/
 	const char * _get_config(P4BridgeServer* pServer)
 	{
-		return Utils::AllocString(pServer->get_config());
+		return Utils::AllocString(pServer->get_config(), pServer->GetStringSlab());
 	}
 
 	EXPORT const char * get_config( P4BridgeServer* pServer )
@@ -1189,6 +1192,85 @@ extern "C"
 		}
 	}
 
+	/**************************************************************************
+	*
+	*  ResolveConfigs: Resolve the connection settings of many directories
+	*    from P4CONFIG files, P4ENVIRO and the environment in one call.
+	*    Directories resolved before are answered from a cache unless a 
+	*    config file or directory they depend on has changed.
+	*
+	*    dirs: The directories
+	*
+	*    count: Number of directories
+	*
+	*  Return: Handle to the results, read them with GetConfigRows and 
+	*          release it using Release()
+	**************************************************************************/
+
+	EXPORT P4ConfigBatch* ResolveConfigs( char const * const * dirs, int count )
+	{
+		try
+		{
+			std::unique_ptr<P4ConfigBatch> pBatch(new P4ConfigBatch());
+			pBatch->Resolve(dirs, count);
+			return pBatch.release();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ResolveConfigs");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetConfigRows: Get the settings resolved by ResolveConfigs, as an 
+	*                 array of ConfigInfo in the order of the directories.
+	*
+	*    count: Set to the number of rows
+	*
+	*  Return: The array, NULL if there are none. It is valid until the 
+	*          batch is released.
+	*
+	**************************************************************************/
+
+	EXPORT const ConfigInfo * GetConfigRows( P4ConfigBatch* pBatch, int* count )
+	{
+		try
+		{
+			if (count) *count = 0;
+			VALIDATE_HANDLE_P(pBatch, tP4ConfigBatch)
+			return pBatch->GetRows(count);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetConfigRows");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetConfigCacheRecheck: Set how often a cached directory is checked 
+	*    for changes to the config files it depends on.
+	*
+	*    ms: Interval in milliseconds, 0 to check on every lookup
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void SetConfigCacheRecheck( int ms )
+	{
+		try
+		{
+			ConfigCache::SetRecheckInterval(ms);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetConfigCacheRecheck");
+		}
+	}
+
 	const char* _Get(const char *var)
 	{
 		return Utils::AllocString(P4BridgeServer::Get(var));
@@ -1255,6 +1337,83 @@ extern "C"
 		}
 	}
 
+	/**************************************************************************
+	*
+	*  GetServerVar: Get a setting of one server. A server has the global
+	*    settings until it is given its own with UpdateServerVar.
+	*
+	*    pServer: Pointer to the P4BridgeServer
+	*
+	*  Return: The value, NULL if it is not set
+	**************************************************************************/
+
+	EXPORT const char * GetServerVar( P4BridgeServer* pServer, const char *var )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			string value;
+			if (!pServer->GetVar(var, value))
+				return nullptr;
+			return Utils::AllocString(value, pServer->GetStringSlab());
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetServerVar");
+			return nullptr;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  UpdateServerVar: Give one server its own value for a setting, without
+	*    changing the global settings or any other server.
+	*
+	*    pServer: Pointer to the P4BridgeServer
+	*
+	*    val: The value, NULL to unset it for this server
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void UpdateServerVar( P4BridgeServer* pServer, const char *var, const char *val )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->UpdateVar(var, val);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"UpdateServerVar");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ResetServerVar: Go back to the global value of a setting for one 
+	*    server.
+	*
+	*    pServer: Pointer to the P4BridgeServer
+	*
+	*    var: The setting, NULL for every setting
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void ResetServerVar( P4BridgeServer* pServer, const char *var )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->ResetVar(var);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ResetServerVar");
+		}
+	}
+
 
 	/**************************************************************************
 	*
@@ -1304,6 +1463,114 @@ extern "C"
 		}
 	}
 
+	/**************************************************************************
+	*
+	*  GetServerTicket: Get the existing ticket for a connection from the
+	*    ticket file a server uses, which may be its own P4TICKETS or the
+	*    file given to SetTicketFile.
+	*
+	*    pServer: Pointer to the P4BridgeServer
+	*
+	*  Return: The ticket, NULL if no ticket in file or error
+	**************************************************************************/
+
+	EXPORT const char * GetServerTicket( P4BridgeServer* pServer, const char* port, const char* user )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			string ticket = pServer->GetServerTicket(port, user);
+			if (ticket.empty())
+				return nullptr;
+			return Utils::AllocString(ticket, pServer->GetStringSlab());
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetServerTicket");
+			return nullptr;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  LookupTicket: Get a ticket from the process wide ticket cache. The
+	*    ticket file is only read when it has changed, and not even checked
+	*    more often than the recheck interval.
+	*
+	*    path: Ticket file, NULL for the default (P4TICKETS)
+	*
+	*    buf: Buffer for the ticket, may be NULL to get the length
+	*
+	*    bufSize: Size of buf, including the terminating null
+	*
+	*  Return: Length of the ticket, 0 if there is none, or minus the size
+	*          needed if buf is too small
+	**************************************************************************/
+
+	EXPORT int LookupTicket( const char* path, const char* port, const char* user,
+							 char* buf, int bufSize )
+	{
+		try
+		{
+			string ticket;
+			if (!TicketCache::Lookup(path, port, user, ticket))
+				return 0;
+			int len = (int) ticket.length();
+			if (!buf || bufSize <= len)
+				return -(len + 1);
+			memcpy(buf, ticket.c_str(), len + 1);
+			return len;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"LookupTicket");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetTicketCacheRecheck: Set how often the ticket cache checks a ticket
+	*    file for changes.
+	*
+	*    ms: Interval in milliseconds, 0 to check on every lookup
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void SetTicketCacheRecheck( int ms )
+	{
+		try
+		{
+			TicketCache::SetRecheckInterval(ms);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetTicketCacheRecheck");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetTicketCacheCounts: Get the number of ticket lookups answered from
+	*    the cache, the number that read a ticket file, and the number of 
+	*    times a ticket file was found to have changed.
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void GetTicketCacheCounts( int* hits, int* misses, int* reloads )
+	{
+		try
+		{
+			TicketCache::GetCounts(hits, misses, reloads);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetTicketCacheCounts");
+		}
+	}
+
 	/*
     *     Raw SetProtocol - must be called on a disconnected pServer to be effective, or on a pServer that you reconnect on
 	*/
@@ -1367,118 +1634,1745 @@ extern "C"
 
 	/**************************************************************************
 	*
-	*  CancelCommand: Cancel a running command
+	*  PrepareCommand: Capture a command so it can be run many times with
+	*    ExecutePrepared without rebuilding the argument list each time.
 	*
-	*  Return: None
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    cmd, cmdId, tagged, args, argc: As for RunCommand
+	*
+	*  Return: Handle to the prepared command, release it using Release()
 	**************************************************************************/
 
-	EXPORT void CancelCommand( P4BridgeServer* pServer, int cmdId )
+	EXPORT P4PreparedCommand* PrepareCommand( P4BridgeServer* pServer,
+										  const char *cmd, 
+										  int cmdId,
+										  int tagged, 
+										  char * const *args,
+										  int argc )
 	{
 		try
 		{
-			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
-			pServer->cancel_command(cmdId);
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			if (!cmd)
+			{
+				return NULL;
+			}
+			return new P4PreparedCommand(cmd, cmdId, tagged, args, argc);
 		}
 		catch (exception& e)
 		{
-			P4BridgeServer::ReportException(e,"CancelCommand");
+			P4BridgeServer::ReportException(e,"PrepareCommand");
+			return NULL;
 		}
 	}
 
-	EXPORT int IsConnected(P4BridgeServer* pServer)
+	/**************************************************************************
+	*
+	*  SetPreparedProjection: Limit the tagged output of a prepared command
+	*    to the given field names. A count of zero keeps every field.
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void SetPreparedProjection( P4PreparedCommand* pPrepared,
+										  char * const *keys,
+										  int count )
 	{
 		try
 		{
-			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
-			return pServer->IsConnected();
+			VALIDATE_HANDLE_V(pPrepared, tP4PreparedCommand)
+			pPrepared->SetProjection(keys, count);
 		}
 		catch (exception& e)
 		{
-			P4BridgeServer::ReportException(e,"IsConnected");
-			return 0;
+			P4BridgeServer::ReportException(e,"SetPreparedProjection");
 		}
 	}
 
 	/**************************************************************************
 	*
-	*  SetTaggedOutputCallbackFn: Set the tagged output callback fn.
+	*  ExecutePrepared: Run a prepared command using the P4BridgeServer.
 	*
-	*    pServer: Pointer to the P4BridgeServer 
+	*    cmdId: Id for this run of the command, if zero the id given to 
+	*           PrepareCommand is used
 	*
-	*    pNew: New function pointer 
-	*    
-	*  Return: None
+	*  Return: Zero if there was an error running the command
 	**************************************************************************/
 
-	EXPORT void SetTaggedOutputCallbackFn( P4BridgeServer* pServer, IntTextTextCallbackFn* pNew )
+	EXPORT int ExecutePrepared( P4BridgeServer* pServer,
+										  P4PreparedCommand* pPrepared,
+										  int cmdId )
 	{
 		try
 		{
-			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
-			pServer->SetTaggedOutputCallbackFn(pNew);
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
+			VALIDATE_HANDLE_I(pPrepared, tP4PreparedCommand)
+			// make sure we're connected to the server
+			if (0 == ServerConnect( pServer ))
+			{
+				return 0;
+			}
+			return pServer->run_prepared(pPrepared, cmdId);
 		}
 		catch (exception& e)
 		{
-			P4BridgeServer::ReportException(e,"SetTaggedOutputCallbackFn");
+			P4BridgeServer::ReportException(e,"ExecutePrepared");
+			return 0;
 		}
 	}
 
 	/**************************************************************************
 	*
-	*  GetTaggedOutputCount: Get a count of the number of entries in the tagged 
-	*							output.
-	*
-	*    pServer: Pointer to the P4BridgeServer 
-	*    
-	*  Return: count of the number of entries in the tagged output..
-	*
-	*  NOTE: Call Release() on the returned pointer to free the object
+	*  CancelCommand: Cancel a running command
 	*
+	*  Return: None
 	**************************************************************************/
 
-	EXPORT int GetTaggedOutputCount( P4BridgeServer* pServer, int cmdId )
+	EXPORT void CancelCommand( P4BridgeServer* pServer, int cmdId )
 	{
 		try
 		{
-			VALIDATE_HANDLE_I(pServer, tP4BridgeServer);
-			P4BridgeClient* pUi = pServer->find_ui(cmdId);
-			if (!pUi)
-				return  -1;
-			return pUi->GetTaggedOutputCount();
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->cancel_command(cmdId);
 		}
 		catch (exception& e)
 		{
-			P4BridgeServer::ReportException(e,"GetTaggedOutputCount");
-			return -1;
+			P4BridgeServer::ReportException(e,"CancelCommand");
 		}
 	}
 
 	/**************************************************************************
 	*
-	*  GetTaggedOutput: Get a StrDictListIterator to iterate through
-	*                            the tagged output.
+	*  SetCommandTimeout: Limit how long commands may run. Commands that pass
+	*    the deadline, or receive no output for the inactivity timeout, are
+	*    cancelled with their partial results kept.
 	*
-	*    pServer: Pointer to the P4BridgeServer 
+	*    deadlineMs: Maximum run time in milliseconds, zero for no limit
+	*
+	*    inactivityMs: Maximum time between output in milliseconds, zero
+	*      for no limit
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void SetCommandTimeout( P4BridgeServer* pServer, int deadlineMs, int inactivityMs )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->SetCommandTimeouts(deadlineMs, inactivityMs);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetCommandTimeout");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetCommandTimeoutStatus: Did a command time out?
+	*
+	*  Return: 0 if not, 1 if it passed its deadline, 2 if it timed out 
+	*    waiting for output
+	**************************************************************************/
+
+	EXPORT int GetCommandTimeoutStatus( P4BridgeServer* pServer, int cmdId )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
+			return pServer->GetCommandTimeoutStatus(cmdId);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetCommandTimeoutStatus");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetIdleDisconnect: Disconnect servers whose connection has not been 
+	*    used for idleMs. One background thread checks every server, a 
+	*    disconnected server reconnects on its next command.
+	*
+	*    idleMs: Idle time in milliseconds, zero stops idle disconnects
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void SetIdleDisconnect( int idleMs )
+	{
+		try
+		{
+			IdleConnectionManager::SetIdleTimeout(idleMs);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetIdleDisconnect");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetIdleDisconnect: The idle time set by SetIdleDisconnect.
+	*
+	*  Return: Idle time in milliseconds, zero if idle disconnects are off
+	**************************************************************************/
+
+	EXPORT int GetIdleDisconnect()
+	{
+		try
+		{
+			return IdleConnectionManager::GetIdleTimeout();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetIdleDisconnect");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ShutdownIdleDisconnect: Stop idle disconnects and wait for the 
+	*    background thread to exit. Call it before unloading the bridge, on
+	*    Windows the bridge can not be unloaded once idle disconnects have
+	*    been started.
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void ShutdownIdleDisconnect()
+	{
+		try
+		{
+			IdleConnectionManager::Shutdown();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ShutdownIdleDisconnect");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetIdleConnectionCounts: Connection counts for all servers.
+	*
+	*    live: servers with an open connection
+	*    idle: servers disconnected for being idle, not used since
+	*    reconnected: total reconnects after an idle disconnect
+	*    disconnected: total idle disconnects
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void GetIdleConnectionCounts( int* live, int* idle, int* reconnected, int* disconnected )
+	{
+		try
+		{
+			IdleConnectionManager::GetCounts(live, idle, reconnected, disconnected);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetIdleConnectionCounts");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  PrewarmConnection: (Re)connect now rather than on the next command.
+	*
+	*  Return: Zero if the connection could not be made
+	**************************************************************************/
+
+	EXPORT int PrewarmConnection( P4BridgeServer* pServer )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
+			return pServer->Prewarm();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"PrewarmConnection");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  CreateFanOut: Create an empty list of servers to run a command against
+	*    in parallel using RunFanOut.
+	*
+	*  Return: Handle to the fan-out, release it using Release()
+	**************************************************************************/
+
+	EXPORT P4FanOut* CreateFanOut()
+	{
+		try
+		{
+			return new P4FanOut();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"CreateFanOut");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  FanOutAddTarget: Add a server to a fan-out.
+	*
+	*    charset: Charset to use if the server is Unicode, NULL for utf8
+	*
+	*  Return: The index of the target
+	**************************************************************************/
+
+	EXPORT int FanOutAddTarget( P4FanOut* pFanOut,
+										  const char *P4Port, 
+										  const char *P4User, 
+										  const char *P4Password, 
+										  const char *P4Client, 
+										  const char *Charset )
+	{
+		try
+		{
+			if (!VALIDATE_HANDLE(pFanOut, tP4FanOut))
+			{
+				return -1;
+			}
+			pFanOut->AddTarget(P4Port, P4User, P4Password, P4Client, Charset);
+			return pFanOut->Count() - 1;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"FanOutAddTarget");
+			return -1;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  RunFanOut: Connect to every target and run the command on each, one 
+	*    thread per target. The command id of each run is its target index.
+	*
+	*    cmd, tagged, args, argc: As for RunCommand
+	*
+	*    timeoutMs: Deadline for each target, including connecting, zero for
+	*      no limit
+	*
+	*    maxThreads: Maximum targets to run at once, zero for all of them
+	*
+	*  Return: The number of targets the command succeeded on
+	**************************************************************************/
+
+	EXPORT int RunFanOut( P4FanOut* pFanOut,
+										  const char *cmd, 
+										  int tagged, 
+										  char * const *args,
+										  int argc,
+										  int timeoutMs,
+										  int maxThreads )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pFanOut, tP4FanOut)
+			if (!cmd)
+			{
+				return 0;
+			}
+			return pFanOut->Run(cmd, tagged, args, argc, timeoutMs, maxThreads);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"RunFanOut");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  FanOutGetServer: The P4BridgeServer used for a target. Use it to read
+	*    the results with GetTaggedOutput, GetErrorResults, etc. The server 
+	*    belongs to the fan-out, do not release it.
+	*
+	*  Return: NULL if the target has not been run
+	**************************************************************************/
+
+	EXPORT P4BridgeServer* FanOutGetServer( P4FanOut* pFanOut, int idx )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pFanOut, tP4FanOut)
+			return pFanOut->GetServer(idx);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"FanOutGetServer");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  FanOutGetStatus: How the command went on a target.
+	*
+	*  Return: 1 succeeded, 0 failed, -1 timed out, -2 could not connect, 
+	*    -3 not run
+	**************************************************************************/
+
+	EXPORT int FanOutGetStatus( P4FanOut* pFanOut, int idx )
+	{
+		try
+		{
+			if (!VALIDATE_HANDLE(pFanOut, tP4FanOut))
+			{
+				return FANOUT_NOT_RUN;
+			}
+			return pFanOut->GetStatus(idx);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"FanOutGetStatus");
+			return FANOUT_NOT_RUN;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  FanOutGetConnectError: The error if a target could not connect.
+	*
+	*  Return: NULL if there was no connection error
+	**************************************************************************/
+
+	EXPORT P4ClientError* FanOutGetConnectError( P4FanOut* pFanOut, int idx )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pFanOut, tP4FanOut)
+			return pFanOut->GetConnectError(idx);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"FanOutGetConnectError");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  FanOutGetElapsed: Time taken to connect and run the command on a target.
+	*
+	*  Return: Milliseconds
+	**************************************************************************/
+
+	EXPORT int FanOutGetElapsed( P4FanOut* pFanOut, int idx )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pFanOut, tP4FanOut)
+			return pFanOut->GetElapsed(idx);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"FanOutGetElapsed");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetResultCache: Cache the results of read-only commands such as 
+	*    depots, users and groups so repeated runs within the time to live 
+	*    are answered without a round trip. The cache is shared by all 
+	*    servers and is off until given a size.
+	*
+	*    maxBytes: Size limit, the least recently used results are dropped
+	*      to stay within it. Zero turns the cache off and empties it.
+	*
+	*    ttlMs: How long results are kept, in milliseconds
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void SetResultCache( int maxBytes, int ttlMs )
+	{
+		try
+		{
+			ResultCache::Configure(maxBytes, ttlMs);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetResultCache");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetResultCacheCommands: Replace the list of commands whose results 
+	*    may be cached. A count of zero restores the default list: depots, 
+	*    streams, users, groups, protects and info.
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void SetResultCacheCommands( char * const *cmds, int count )
+	{
+		try
+		{
+			ResultCache::SetCommands(cmds, count);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetResultCacheCommands");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  InvalidateResultCache: Drop cached results, i.e. after changing a 
+	*    group or user.
+	*
+	*    pServer: Drop results from this server's P4PORT, NULL for all
+	*
+	*    cmd: Drop results of this command, NULL for all
+	*
+	*  Return: The number of results dropped
+	**************************************************************************/
+
+	EXPORT int InvalidateResultCache( P4BridgeServer* pServer, const char *cmd )
+	{
+		try
+		{
+			if (pServer == NULL)
+			{
+				return ResultCache::Invalidate(NULL, cmd);
+			}
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
+			string port = pServer->get_port();
+			return ResultCache::Invalidate(port.c_str(), cmd);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"InvalidateResultCache");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetResultCacheCounts: Result cache statistics.
+	*
+	*    hits, misses: Cached runs found and not found (or expired)
+	*    evictions: Results dropped to make room
+	*    entries, bytes: What the cache holds now
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void GetResultCacheCounts( int* hits, int* misses, int* evictions, int* entries, int* bytes )
+	{
+		try
+		{
+			ResultCache::GetCounts(hits, misses, evictions, entries, bytes);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetResultCacheCounts");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ScanWorkspace: Walk a workspace on a pool of threads, applying the 
+	*    P4IGNORE rules and collecting the size, modification time and, 
+	*    optionally, the MD5 digest of every file.
+	*
+	*    root: Directory to walk
+	*
+	*    flags: 1 to compute digests, 2 to skip the P4IGNORE rules
+	*
+	*    threads: Threads to use, zero for one per core
+	*
+	*  Return: Handle to the scan, release it using Release()
+	**************************************************************************/
+
+	EXPORT P4WorkspaceScan* ScanWorkspace( const char *root, int flags, int threads )
+	{
+		try
+		{
+			P4WorkspaceScan* pScan = new P4WorkspaceScan();
+			pScan->Scan(root, flags, threads);
+			return pScan;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ScanWorkspace");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  CompareScan: Compare a scan with the tagged output of an 'fstat -Ol'
+	*    run on the same files, marking each file unchanged, modified, added
+	*    or deleted.
+	*
+	*    pServer, cmdId: The server and command id the fstat was run with
+	*
+	*  Return: The number of files that are not unchanged
+	**************************************************************************/
+
+	EXPORT int CompareScan( P4WorkspaceScan* pScan, P4BridgeServer* pServer, int cmdId )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pScan, tP4WorkspaceScan)
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return 0;
+			// through an iterator, the output may have been spilled
+			StrDictListIterator* pTagged = pUi->GetTaggedOutput();
+			int count = pScan->Compare(pTagged);
+			delete pTagged;
+			return count;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"CompareScan");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetScanCount: The number of files in a scan.
+	*
+	*  Return: Count
+	**************************************************************************/
+
+	EXPORT int GetScanCount( P4WorkspaceScan* pScan )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pScan, tP4WorkspaceScan)
+			return pScan->Count();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetScanCount");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetScanPacked: The files in a scan packed into one buffer, sorted by
+	*    path. Each file is, in native byte order: long long size, long long
+	*    mtime, int status, char digest[32], int pathLength, char path[]. 
+	*    The buffer belongs to the scan.
+	*
+	*    length: Set to the length of the buffer
+	*
+	*  Return: The buffer, NULL if the scan is empty
+	**************************************************************************/
+
+	EXPORT const char * GetScanPacked( P4WorkspaceScan* pScan, int *length )
+	{
+		try
+		{
+			if (length) *length = 0;
+			VALIDATE_HANDLE_P(pScan, tP4WorkspaceScan)
+			return pScan->GetPacked(length);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetScanPacked");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  CreateFileIndex: Create an empty index of the have revision, head 
+	*    revision and open action of workspace files.
+	*
+	*  Return: Handle to the index, release it using Release()
+	**************************************************************************/
+
+	EXPORT P4FileIndex* CreateFileIndex()
+	{
+		try
+		{
+			return new P4FileIndex();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"CreateFileIndex");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  FileIndexLoad: Replace the contents of an index with the tagged 
+	*    output of an fstat or have command.
+	*
+	*    pServer, cmdId: The server and command id the command was run with
+	*
+	*  Return: The number of files in the index
+	**************************************************************************/
+
+	EXPORT int FileIndexLoad( P4FileIndex* pIndex, P4BridgeServer* pServer, int cmdId )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pIndex, tP4FileIndex)
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return 0;
+			StrDictListIterator* pTagged = pUi->GetTaggedOutput();
+			int count = pIndex->Load(pTagged);
+			delete pTagged;
+			return count;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"FileIndexLoad");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  AttachFileIndex: Keep an index up to date from the tagged output of 
+	*    the sync, open, revert and submit commands run on a server.
+	*
+	*    pIndex: The index, NULL to stop updating
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void AttachFileIndex( P4BridgeServer* pServer, P4FileIndex* pIndex )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			if (pIndex != NULL)
+			{
+				VALIDATE_HANDLE_V(pIndex, tP4FileIndex)
+			}
+			pServer->SetFileIndex(pIndex);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"AttachFileIndex");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  FileIndexLookup: What the index knows about a file.
+	*
+	*    path: Depot path or local path of the file
+	*
+	*    haveRev, headRev, change: Set to the revisions and open change
+	*
+	*    action, type: Set to the open action and file type, the strings 
+	*      belong to the index
+	*
+	*  Return: 1 if the file is in the index, 0 if not
+	**************************************************************************/
+
+	EXPORT int FileIndexLookup( P4FileIndex* pIndex, const char *path, 
+										  int *haveRev, 
+										  int *headRev, 
+										  const char **action, 
+										  const char **type, 
+										  int *change )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pIndex, tP4FileIndex)
+			P4FileIndex::FileInfo info;
+			if (!pIndex->Lookup(path, info))
+				return 0;
+			if (haveRev) *haveRev = info.haveRev;
+			if (headRev) *headRev = info.headRev;
+			if (action) *action = info.action;
+			if (type) *type = info.type;
+			if (change) *change = info.change;
+			return 1;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"FileIndexLookup");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  FileIndexCount: The number of files in an index.
+	*
+	*  Return: Count
+	**************************************************************************/
+
+	EXPORT int FileIndexCount( P4FileIndex* pIndex )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pIndex, tP4FileIndex)
+			return pIndex->Count();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"FileIndexCount");
+			return 0;
+		}
+	}
+
+	EXPORT int IsConnected(P4BridgeServer* pServer)
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
+			return pServer->IsConnected();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"IsConnected");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetTaggedOutputCallbackFn: Set the tagged output callback fn.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    pNew: New function pointer 
+	*    
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void SetTaggedOutputCallbackFn( P4BridgeServer* pServer, IntTextTextCallbackFn* pNew )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->SetTaggedOutputCallbackFn(pNew);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetTaggedOutputCallbackFn");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetTaggedOutputCount: Get a count of the number of entries in the tagged 
+	*							output.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*    
+	*  Return: count of the number of entries in the tagged output..
+	*
+	*  NOTE: Call Release() on the returned pointer to free the object
+	*
+	**************************************************************************/
+
+	EXPORT int GetTaggedOutputCount( P4BridgeServer* pServer, int cmdId )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer);
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  -1;
+			return pUi->GetTaggedOutputCount();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetTaggedOutputCount");
+			return -1;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetTaggedOutput: Get a StrDictListIterator to iterate through
+	*                            the tagged output.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*    
+	*  Return: Pointer to a new StrDictListIterator to access the data.
+	*
+	*  NOTE: Call Release() on the returned pointer to free the object
+	*
+	**************************************************************************/
+
+	EXPORT StrDictListIterator * GetTaggedOutput( P4BridgeServer* pServer, int cmdId )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			return pUi->GetTaggedOutput();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"StrDictListIterator");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetTaggedIntern: Choose how the tagged output of later commands is
+	*                            stored.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    mode: 0 to keep a dictionary per item, 1 to share the keys and values
+	*          of a command's items in one string pool (the default), 2 to 
+	*          keep that pool between commands so ids stay the same
+	*
+	**************************************************************************/
+
+	EXPORT void SetTaggedIntern( P4BridgeServer* pServer, int mode )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->SetTaggedIntern(mode);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetTaggedIntern");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetTaggedOutputIds: Get the interned tagged output in one array. Each
+	*                            item is its field count followed by a key id 
+	*                            and value id for each field.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    length: Set to the number of ints in the array
+	*    
+	*  Return: The array, NULL if there is none, it is not interned or it
+	*          was spilled and is too large to intern. It belongs to the 
+	*          server and is valid until the next call or command.
+	*
+	**************************************************************************/
+
+	EXPORT const int * GetTaggedOutputIds( P4BridgeServer* pServer, int cmdId, int* length )
+	{
+		try
+		{
+			if (length) *length = 0;
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			return pUi->GetTaggedOutputIds(length);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetTaggedOutputIds");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetTaggedColumn: Get the value id of one field for every item of the
+	*                            interned tagged output, -1 where it is not set.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    key: Field name
+	*
+	*    length: Set to the number of items
+	*    
+	*  Return: The array, valid until the next call or command.
+	*
+	**************************************************************************/
+
+	EXPORT const int * GetTaggedColumn( P4BridgeServer* pServer, int cmdId, const char* key, int* length )
+	{
+		try
+		{
+			if (length) *length = 0;
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			return pUi->GetTaggedColumn(key, length);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetTaggedColumn");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetTaggedString: Get the string for an id from GetTaggedOutputIds or
+	*                            GetTaggedColumn.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    id: String id
+	*    
+	*  Return: The string, NULL for an unknown id.
+	*
+	**************************************************************************/
+
+	EXPORT const char * GetTaggedString( P4BridgeServer* pServer, int cmdId, int id )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi || id < 0)
+				return  nullptr;
+			return pUi->GetTaggedStrings()->Get((unsigned int) id);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetTaggedString");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetTaggedStringTable: Get every interned string in id order, each 
+	*                            followed by a NUL, so a caller can decode 
+	*                            them all at once.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    length: Set to the size of the table in bytes
+	*    
+	*  Return: The table, valid until the next call or command.
+	*
+	**************************************************************************/
+
+	EXPORT const char * GetTaggedStringTable( P4BridgeServer* pServer, int cmdId, int* length )
+	{
+		try
+		{
+			if (length) *length = 0;
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			return pUi->GetTaggedStringTable(length);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetTaggedStringTable");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetResultSpill: Move the results of a command to temporary files once
+	*                            they grow past a threshold. The results are
+	*                            read back through a memory mapping by the 
+	*                            usual functions.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    thresholdBytes: Spill once this much is held, 0 to never spill
+	*
+	*    dir: Directory for the files, NULL for the system temporary directory
+	*
+	**************************************************************************/
+
+	EXPORT void SetResultSpill( P4BridgeServer* pServer, long long thresholdBytes, const char* dir )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->SetResultSpill(thresholdBytes, dir);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetResultSpill");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  IsResultSpilled: Were the results of the last command spilled?
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*    
+	*  Return: 1 if they are held in temporary files, 0 if in memory.
+	*
+	**************************************************************************/
+
+	EXPORT int IsResultSpilled( P4BridgeServer* pServer, int cmdId )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer);
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return 0;
+			return pUi->IsSpilled() ? 1 : 0;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"IsResultSpilled");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SerializeResults: Serialize all of the results of a command, tagged
+	*                            output, info, errors, text and binary output,
+	*                            into one versioned blob that LoadResults can 
+	*                            read back.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    length: Set to the size of the blob in bytes
+	*    
+	*  Return: The blob. It belongs to the server and is valid until the next
+	*          call or command.
+	*
+	**************************************************************************/
+
+	EXPORT const char * SerializeResults( P4BridgeServer* pServer, int cmdId, long long* length )
+	{
+		try
+		{
+			if (length) *length = 0;
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			return pUi->Serialize(length);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SerializeResults");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  LoadResults: Load a blob written by SerializeResults.
+	*
+	*    data, length: The blob, it is copied
+	*    
+	*  Return: Handle to the result set, NULL if the blob is damaged or from a
+	*          newer version. Release it using Release().
+	*
+	**************************************************************************/
+
+	EXPORT P4ResultSet * LoadResults( const char* data, long long length )
+	{
+		try
+		{
+			if (!data || length <= 0)
+				return NULL;
+			P4ResultSet* pSet = new P4ResultSet();
+			if (!pSet->Load(data, (size_t) length))
+			{
+				delete pSet;
+				return NULL;
+			}
+			return pSet;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"LoadResults");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetResultSetTaggedOutput: Get a StrDictListIterator over the tagged 
+	*                            output of a result set.
+	*
+	*    pSet: Pointer to the P4ResultSet
+	*    
+	*  Return: Pointer to a new StrDictListIterator, NULL if there is no 
+	*          tagged output. Release it before the result set.
+	*
+	**************************************************************************/
+
+	EXPORT StrDictListIterator * GetResultSetTaggedOutput( P4ResultSet* pSet )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pSet, tP4ResultSet)
+			return pSet->GetTaggedOutput();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetResultSetTaggedOutput");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetResultSetTaggedCount: The number of items of tagged output in a
+	*                            result set.
+	*
+	**************************************************************************/
+
+	EXPORT int GetResultSetTaggedCount( P4ResultSet* pSet )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pSet, tP4ResultSet)
+			return pSet->GetTaggedOutputCount();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetResultSetTaggedCount");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetResultSetErrors: Get the first error in a result set, read it like
+	*                            the result of GetErrorResults.
+	*
+	**************************************************************************/
+
+	EXPORT P4ClientError * GetResultSetErrors( P4ResultSet* pSet )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pSet, tP4ResultSet)
+			return pSet->GetErrorResults();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetResultSetErrors");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetResultSetInfo: Get the first info message in a result set, read it
+	*                            like the result of GetInfoResults.
+	*
+	**************************************************************************/
+
+	EXPORT P4ClientInfoMsg * GetResultSetInfo( P4ResultSet* pSet )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pSet, tP4ResultSet)
+			return pSet->GetInfoResults();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetResultSetInfo");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetResultSetText: Get the text output of a result set.
+	*
+	**************************************************************************/
+
+	EXPORT const char * GetResultSetText( P4ResultSet* pSet )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pSet, tP4ResultSet)
+			return pSet->GetTextResults();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetResultSetText");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetResultSetBinary: Get the binary output of a result set.
+	*
+	*    pSet: Pointer to the P4ResultSet
+	*
+	*    length: Set to the size of the binary output in bytes
+	*
+	**************************************************************************/
+
+	EXPORT const unsigned char * GetResultSetBinary( P4ResultSet* pSet, long long* length )
+	{
+		try
+		{
+			if (length) *length = 0;
+			VALIDATE_HANDLE_P(pSet, tP4ResultSet)
+			if (length) *length = (long long) pSet->GetBinaryResultsCount();
+			return pSet->GetBinaryResults();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetResultSetBinary");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  CreateNdjsonFileWriter: Create a writer that streams tagged output as
+	*    newline delimited JSON to a file descriptor, or a HANDLE on Windows.
+	*
+	*    handle: The file descriptor or HANDLE, left open by the writer
+	*
+	*    flags: NDJSON_KEEP_RESULTS (1) to also keep the tagged output,
+	*      NDJSON_LATIN1 (2) to read invalid UTF-8 bytes as Latin-1
+	*
+	*  Return: Handle to the writer, release it using Release()
+	**************************************************************************/
+
+	EXPORT P4NdjsonWriter* CreateNdjsonFileWriter( long long handle, int flags )
+	{
+		try
+		{
+			return new P4NdjsonWriter(handle, flags);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"CreateNdjsonFileWriter");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  CreateNdjsonRingWriter: Create a writer that streams tagged output as
+	*    newline delimited JSON to a ring buffer, drained with ReadNdjson()
+	*    from another thread while the command runs.
+	*
+	*    ringBytes: Size of the ring, a command waits when it is full
+	*
+	*    flags: As for CreateNdjsonFileWriter
+	*
+	*  Return: Handle to the writer, release it using Release()
+	**************************************************************************/
+
+	EXPORT P4NdjsonWriter* CreateNdjsonRingWriter( int ringBytes, int flags )
+	{
+		try
+		{
+			return new P4NdjsonWriter(ringBytes, flags);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"CreateNdjsonRingWriter");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  AttachNdjsonWriter: Stream the tagged output of the commands run on a
+	*    server to a writer.
+	*
+	*    pWriter: The writer, NULL to stop streaming
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void AttachNdjsonWriter( P4BridgeServer* pServer, P4NdjsonWriter* pWriter )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			if (pWriter != NULL)
+			{
+				VALIDATE_HANDLE_V(pWriter, tP4NdjsonWriter)
+			}
+			pServer->SetNdjsonWriter(pWriter);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"AttachNdjsonWriter");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ReadNdjson: Read from the ring of a writer.
+	*
+	*    buffer: Where to copy the output, size bytes long
+	*
+	*    timeoutMs: How long to wait for output, -1 to wait until there is
+	*      some or the writer is closed
+	*
+	*  Return: The number of bytes copied, 0 on timeout, -1 once the writer
+	*    is closed and everything has been read
+	**************************************************************************/
+
+	EXPORT int ReadNdjson( P4NdjsonWriter* pWriter, char* buffer, int size, int timeoutMs )
+	{
+		try
+		{
+			// -1 so a reader loop stops on a bad handle
+			if (!VALIDATE_HANDLE(pWriter, tP4NdjsonWriter))
+				return -1;
+			return pWriter->Read(buffer, size, timeoutMs);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ReadNdjson");
+			return -1;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  FlushNdjsonWriter: Write out the output buffered for a file descriptor.
+	*
+	*  Return: 1 on success, 0 if a write failed
+	**************************************************************************/
+
+	EXPORT int FlushNdjsonWriter( P4NdjsonWriter* pWriter )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pWriter, tP4NdjsonWriter)
+			return pWriter->Flush() ? 1 : 0;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"FlushNdjsonWriter");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  CloseNdjsonWriter: Stop a writer, a reader or command waiting on the
+	*    ring is woken up and later records are dropped.
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void CloseNdjsonWriter( P4NdjsonWriter* pWriter )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pWriter, tP4NdjsonWriter)
+			pWriter->Close();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"CloseNdjsonWriter");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetNdjsonCounts: Get the totals for a writer.
+	*
+	*    records, bytes: Set to the records and bytes written
+	*
+	*    invalid: Set to the number of invalid UTF-8 sequences replaced
+	*
+	*    dropped: Set to the number of records not written
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void GetNdjsonCounts( P4NdjsonWriter* pWriter, long long* records, 
+										  long long* bytes, 
+										  long long* invalid, 
+										  long long* dropped )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pWriter, tP4NdjsonWriter)
+			pWriter->GetCounts(records, bytes, invalid, dropped);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetNdjsonCounts");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetDiffMode: Choose how diffs run on the client by later commands,
+	*    such as diff, are reported.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    mode: 0 for a line at a time through a temporary file (the default),
+	*          1 to diff in memory and send a hunk per text callback, 2 to 
+	*          diff in memory and keep the hunks for GetDiffHunks()
+	*
+	**************************************************************************/
+
+	EXPORT void SetDiffMode( P4BridgeServer* pServer, int mode )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->SetDiffMode(mode);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetDiffMode");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetDiffHunks: Get the hunks of the files diffed by a command run with 
+	*                            diff mode 2, as an array of DiffHunk.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    count: Set to the number of hunks
 	*    
-	*  Return: Pointer to a new StrDictListIterator to access the data.
+	*  Return: The array, NULL if there are no hunks. It is valid until the 
+	*          next command.
 	*
-	*  NOTE: Call Release() on the returned pointer to free the object
+	**************************************************************************/
+
+	EXPORT const DiffHunk * GetDiffHunks( P4BridgeServer* pServer, int cmdId, int* count )
+	{
+		try
+		{
+			if (count) *count = 0;
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			return pUi->GetDiffHunks(count);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetDiffHunks");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetDiffText: Get the text the DiffHunk offsets refer to.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    length: Set to the size of the text in bytes
+	*    
+	*  Return: The text, valid until the next command.
 	*
 	**************************************************************************/
 
-	EXPORT StrDictListIterator * GetTaggedOutput( P4BridgeServer* pServer, int cmdId )
+	EXPORT const char * GetDiffText( P4BridgeServer* pServer, int cmdId, long long* length )
 	{
 		try
 		{
+			if (length) *length = 0;
 			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
 			P4BridgeClient* pUi = pServer->find_ui(cmdId);
 			if (!pUi)
 				return  nullptr;
-			return pUi->GetTaggedOutput();
+			return pUi->GetDiffText(length);
 		}
 		catch (exception& e)
 		{
-			P4BridgeServer::ReportException(e,"StrDictListIterator");
+			P4BridgeServer::ReportException(e,"GetDiffText");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetDiffFile: Get the local file of DiffHunk::file.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    idx: The file number
+	*    
+	*  Return: The file name, NULL if idx is out of range.
+	*
+	**************************************************************************/
+
+	EXPORT const char * GetDiffFile( P4BridgeServer* pServer, int cmdId, int idx )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			return pUi->GetDiffFile(idx);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetDiffFile");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  CreateResolvePolicy: Create an empty policy for deciding resolves in
+	*    the bridge.
+	*
+	*  Return: Handle to the policy, release it using Release()
+	**************************************************************************/
+
+	EXPORT P4ResolvePolicy* CreateResolvePolicy()
+	{
+		try
+		{
+			return new P4ResolvePolicy();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"CreateResolvePolicy");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ResolvePolicyAddRule: Add a rule after the existing rules of a policy.
+	*
+	*    pattern: Local files the rule applies to, "..." matches anything and
+	*      "*" anything but a '/'. NULL or empty for every file.
+	*
+	*    resolveType: "content", "branch", "delete", "filetype", "move"...
+	*      NULL or empty for every type
+	*
+	*    action: 0 safe, 1 merge without conflicts, 2 force merge, 3 theirs,
+	*      4 yours, 5 skip
+	*
+	*  Return: 1 if the rule was added, 0 for an unknown action
+	**************************************************************************/
+
+	EXPORT int ResolvePolicyAddRule( P4ResolvePolicy* pPolicy, const char *pattern,
+										  const char *resolveType, int action )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pPolicy, tP4ResolvePolicy)
+			return pPolicy->AddRule(pattern, resolveType, action) ? 1 : 0;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ResolvePolicyAddRule");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ResolvePolicyClear: Remove every rule of a policy.
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void ResolvePolicyClear( P4ResolvePolicy* pPolicy )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pPolicy, tP4ResolvePolicy)
+			pPolicy->Clear();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ResolvePolicyClear");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  AttachResolvePolicy: Decide the resolves of the commands run on a 
+	*    server with a policy instead of the resolve callbacks.
+	*
+	*    pPolicy: The policy, NULL to go back to the callbacks
+	*
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void AttachResolvePolicy( P4BridgeServer* pServer, P4ResolvePolicy* pPolicy )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			if (pPolicy != NULL)
+			{
+				VALIDATE_HANDLE_V(pPolicy, tP4ResolvePolicy)
+			}
+			pServer->SetResolvePolicy(pPolicy);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"AttachResolvePolicy");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetResolveSummary: Get a record of each file resolved by a policy
+	*                            during a command, as an array of 
+	*                            ResolveSummary.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    count: Set to the number of records
+	*    
+	*  Return: The array, NULL if there are none. It is valid until the next
+	*          command.
+	*
+	*  The chunk counts are the ones the API's merge reports, so a policy
+	*  that skips every file previews a content resolve without resolving.
+	*
+	**************************************************************************/
+
+	EXPORT const ResolveSummary * GetResolveSummary( P4BridgeServer* pServer, int cmdId, int* count )
+	{
+		try
+		{
+			if (count) *count = 0;
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			return pUi->GetResolveSummary(count);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetResolveSummary");
 			return(nullptr);
 		}
 	}
@@ -1558,6 +3452,34 @@ extern "C"
 		}
 	}
 
+	/**************************************************************************
+	*
+	*  SetProgressCallbackFn: Set the progress callback fn.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    pNew: New function pointer, NULL to stop progress reporting
+	*
+	*    intervalMs: Least time between two calls, the last report of a
+	*                command is always made
+	*    
+	*  Return: None
+	**************************************************************************/
+
+	EXPORT void SetProgressCallbackFn( P4BridgeServer* pServer, ProgressCallbackFn* pNew,
+		int intervalMs )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->SetProgressCallbackFn(pNew, intervalMs);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetProgressCallbackFn");
+		}
+	}
+
 	/**************************************************************************
 	*
 	*  GetInfoResultsCount: Get the count of the number of the info output.
@@ -1568,48 +3490,130 @@ extern "C"
 	*
 	**************************************************************************/
 
-	EXPORT int GetInfoResultsCount( P4BridgeServer* pServer, int cmdId)
+	EXPORT int GetInfoResultsCount( P4BridgeServer* pServer, int cmdId)
+	{
+		try
+		{
+			VALIDATE_HANDLE_B(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  -1;
+			return pUi->GetInfoResultsCount();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetInfoResultsCount");
+			return -1;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetInfoResults: Get the info output.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*    
+	*  Return: Pointer to access the data.
+	*
+	**************************************************************************/
+
+	EXPORT P4ClientInfoMsg * GetInfoResults( P4BridgeServer* pServer, int cmdId)
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			if (!pUi->GetInfoResults())
+				return  nullptr;
+			return pUi->GetInfoResults();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"GetInfoResults");
+			return nullptr;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  GetPackedInfoResults: Get all of the info output in one call.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    utf16: non zero to convert the messages to UTF-16
+	*
+	*    count: Set to the number of messages
+	*
+	*    pool: Set to the string pool the messages point into
+	*
+	*    poolSize: Set to the size of the pool in bytes
+	*
+	*  Return: Array of count PackedMessage {code, level, offset, length},
+	*    offset and length are in pool units. Valid until the next call or
+	*    command, NULL if there are no messages.
+	*
+	**************************************************************************/
+
+	EXPORT const PackedMessage * GetPackedInfoResults( P4BridgeServer* pServer, int cmdId,
+		int utf16, int* count, const char** pool, int* poolSize)
 	{
 		try
 		{
-			VALIDATE_HANDLE_B(pServer, tP4BridgeServer)
+			if (count) *count = 0;
+			if (pool) *pool = NULL;
+			if (poolSize) *poolSize = 0;
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
 			P4BridgeClient* pUi = pServer->find_ui(cmdId);
 			if (!pUi)
-				return  -1;
-			return pUi->GetInfoResultsCount();
+				return  nullptr;
+			return pUi->PackMessages(PACKED_INFO, utf16 != 0, count, pool, poolSize);
 		}
 		catch (exception& e)
 		{
-			P4BridgeServer::ReportException(e,"GetInfoResultsCount");
-			return -1;
+			P4BridgeServer::ReportException(e,"GetPackedInfoResults");
+			return nullptr;
 		}
 	}
 
 	/**************************************************************************
 	*
-	*  GetInfoResults: Get the info output.
+	*  GetPackedErrorResults: Get all of the error output in one call.
 	*
 	*    pServer: Pointer to the P4BridgeServer 
-	*    
-	*  Return: Pointer to access the data.
+	*
+	*    utf16: non zero to convert the messages to UTF-16
+	*
+	*    count: Set to the number of messages
+	*
+	*    pool: Set to the string pool the messages point into
+	*
+	*    poolSize: Set to the size of the pool in bytes
+	*
+	*  Return: Array of count PackedMessage {code, severity, offset, length},
+	*    offset and length are in pool units. Valid until the next call or
+	*    command, NULL if there are no messages.
 	*
 	**************************************************************************/
 
-	EXPORT P4ClientInfoMsg * GetInfoResults( P4BridgeServer* pServer, int cmdId)
+	EXPORT const PackedMessage * GetPackedErrorResults( P4BridgeServer* pServer, int cmdId,
+		int utf16, int* count, const char** pool, int* poolSize)
 	{
 		try
 		{
+			if (count) *count = 0;
+			if (pool) *pool = NULL;
+			if (poolSize) *poolSize = 0;
 			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
 			P4BridgeClient* pUi = pServer->find_ui(cmdId);
 			if (!pUi)
 				return  nullptr;
-			if (!pUi->GetInfoResults())
-				return  nullptr;
-			return pUi->GetInfoResults();
+			return pUi->PackMessages(PACKED_ERRORS, utf16 != 0, count, pool, poolSize);
 		}
 		catch (exception& e)
 		{
-			P4BridgeServer::ReportException(e,"GetInfoResults");
+			P4BridgeServer::ReportException(e,"GetPackedErrorResults");
 			return nullptr;
 		}
 	}
@@ -1801,6 +3805,71 @@ extern "C"
 		}
 	}
 
+	/**************************************************************************
+	*
+	*  SetDataSetBuffer: Use a native buffer as the input data of the next
+	*    command without copying it. The buffer must stay valid (pinned) 
+	*    until the command completes.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    data: Pointer to the data
+	*
+	*    length: Size of the data in bytes
+	*    
+	*  Return: 1 on success, 0 if the data is too large
+	*
+	**************************************************************************/
+
+	EXPORT int SetDataSetBuffer( P4BridgeServer* pServer, int cmdId,
+										   const char * data, long long length )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->get_ui(cmdId);
+			if (!pUi)
+				return 0;
+			return pUi->SetDataSetBuffer(data, length) ? 1 : 0;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetDataSetBuffer");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  SetDataSetCallback: Read the input data of the next command a chunk 
+	*    at a time from a callback, as the command needs it.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    pNew: Callback filling a buffer, returns the bytes written, 0 at the
+	*      end of the data or -1 to fail the command
+	*    
+	*  Return: None
+	*
+	**************************************************************************/
+
+	EXPORT void SetDataSetCallback( P4BridgeServer* pServer, int cmdId,
+										   InputDataCallbackFn* pNew )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->get_ui(cmdId);
+			if (!pUi)
+				return;
+			pUi->SetDataSetCallback(pNew);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetDataSetCallback");
+		}
+	}
+
 	/**************************************************************************
 	*
 	*  SetPromptCallbackFn: Set the callback for replying to a server prompt.
@@ -1999,6 +4068,279 @@ extern "C"
 		}
 	}
 
+	/**************************************************************************
+	*
+	*  SetStringSlab: Choose where the strings returned for a server are
+	*                 allocated.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    mode: 0 to allocate each string on its own, to be released with
+	*          ReleaseString (the default), 1 to carve them from a slab
+	*          released with ReleaseAll, 2 to also release the slab when the
+	*          server's next command runs. ReleaseString on a slab string
+	*          does nothing until the slab is released; after that it must
+	*          not be called at all.
+	*
+	**************************************************************************/
+
+	EXPORT void SetStringSlab( P4BridgeServer* pServer, int mode )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->SetStringSlab(mode);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"SetStringSlab");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ReleaseAll: Release every slab string returned for a server.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	**************************************************************************/
+
+	EXPORT void ReleaseAll( P4BridgeServer* pServer )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->ReleaseAllStrings();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ReleaseAll");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ReleaseMany: Delete many objects allocated on the bridge's heap in
+	*               one call.
+	*
+	*    handles: The objects, NULL entries are skipped
+	*
+	*    count: Number of handles
+	*    
+	*  Return: The number of objects deleted.
+	*
+	**************************************************************************/
+
+	EXPORT int ReleaseMany( void** handles, int count )
+	{
+		try
+		{
+			return P4ResultSession::ReleaseMany(handles, count);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ReleaseMany");
+			return -1;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  CreateResultSession: Create a session that owns the handles read from 
+	*                       a command's results and deletes them together.
+	*
+	*  Return: Handle to the session, release it using Release(), which 
+	*          also deletes the handles it owns
+	*
+	**************************************************************************/
+
+	EXPORT P4ResultSession* CreateResultSession()
+	{
+		try
+		{
+			return new P4ResultSession();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"CreateResultSession");
+			return NULL;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ResultSessionAdopt: Give handles to a session. They must not be 
+	*                      released on their own afterwards.
+	*
+	*    pSession: Pointer to the P4ResultSession
+	*
+	*    handles: The objects, NULL entries are skipped
+	*
+	*    count: Number of handles
+	*    
+	*  Return: The number of handles the session owns, 0 if the session 
+	*          is not valid.
+	*
+	**************************************************************************/
+
+	EXPORT int ResultSessionAdopt( P4ResultSession* pSession, void** handles, int count )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pSession, tP4ResultSession)
+			for (int i = 0; handles && i < count; i++)
+			{
+				pSession->Adopt(static_cast<p4base*>(handles[i]));
+			}
+			return pSession->Count();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ResultSessionAdopt");
+			return -1;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ResultSessionGetTaggedOutput: GetTaggedOutput, with the iterator owned
+	*                                by a session.
+	*
+	*    pSession: Pointer to the P4ResultSession
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*    
+	*  Return: Pointer to a StrDictListIterator, do not Release() it.
+	*
+	**************************************************************************/
+
+	EXPORT StrDictListIterator * ResultSessionGetTaggedOutput( P4ResultSession* pSession,
+		P4BridgeServer* pServer, int cmdId )
+	{
+		try
+		{
+			VALIDATE_HANDLE_P(pSession, tP4ResultSession)
+			VALIDATE_HANDLE_P(pServer, tP4BridgeServer)
+			P4BridgeClient* pUi = pServer->find_ui(cmdId);
+			if (!pUi)
+				return  nullptr;
+			StrDictListIterator* pIterator = pUi->GetTaggedOutput();
+			// the iterator's p4base is not public, see Release()
+			pSession->Adopt(static_cast<p4base*>((void*) pIterator));
+			return pIterator;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ResultSessionGetTaggedOutput");
+			return(nullptr);
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ReleaseResultSession: Delete every handle a session owns, the session
+	*                        can be used again.
+	*
+	*    pSession: Pointer to the P4ResultSession
+	*    
+	*  Return: The number of handles deleted.
+	*
+	**************************************************************************/
+
+	EXPORT int ReleaseResultSession( P4ResultSession* pSession )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pSession, tP4ResultSession)
+			return pSession->ReleaseAll();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ReleaseResultSession");
+			return -1;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  StartCallRecording: Record the calls the p4api makes while commands
+	*    run on a server to a file, replacing any recording in progress.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    path: The file to write
+	*    
+	*  Return: 1 if recording, 0 if the file can not be written.
+	*
+	**************************************************************************/
+
+	EXPORT int StartCallRecording( P4BridgeServer* pServer, const char* path )
+	{
+		try
+		{
+			VALIDATE_HANDLE_I(pServer, tP4BridgeServer)
+			return pServer->StartCallRecording(path) ? 1 : 0;
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"StartCallRecording");
+			return 0;
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  StopCallRecording: Finish the recording of a server.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	**************************************************************************/
+
+	EXPORT void StopCallRecording( P4BridgeServer* pServer )
+	{
+		try
+		{
+			VALIDATE_HANDLE_V(pServer, tP4BridgeServer)
+			pServer->StopCallRecording();
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"StopCallRecording");
+		}
+	}
+
+	/**************************************************************************
+	*
+	*  ReplayCallRecording: Push a recording through the client of a command
+	*    as fast as possible, without a server. The results are read as 
+	*    usual afterwards.
+	*
+	*    pServer: Pointer to the P4BridgeServer 
+	*
+	*    path: The recording
+	*
+	*    repeat: How many times to replay it, the results of the last are kept
+	*    
+	*  Return: The number of calls replayed, -1 if the file is not a recording.
+	*
+	**************************************************************************/
+
+	EXPORT int ReplayCallRecording( P4BridgeServer* pServer, int cmdId, const char* path,
+		int repeat )
+	{
+		try
+		{
+			if (!VALIDATE_HANDLE(pServer, tP4BridgeServer))
+				return -1;
+			return P4CallRecorder::Replay(path, pServer, cmdId, repeat);
+		}
+		catch (exception& e)
+		{
+			P4BridgeServer::ReportException(e,"ReplayCallRecording");
+			return -1;
+		}
+	}
+
 	/**************************************************************************
 	* class KeyValuePair
 	**************************************************************************/
@@ -2844,13 +5186,14 @@ extern "C"
         EXPORT int GetAllocObjCount()            { return p4typesCount;  }
         EXPORT int GetAllocObj(int type)         { return p4base::GetItemCount(type); }
         EXPORT const char* GetAllocObjName(int type) {   return p4base::GetTypeStr(type);        }
-        EXPORT long GetStringAllocs()            { return Utils::AllocCount(); }
-        EXPORT long GetStringReleases()          { return Utils::FreeCount(); }
 #else
         EXPORT int GetAllocObjCount()            { return 0; }
         EXPORT int GetAllocObj(int type)         { return 0; }
         EXPORT const char* GetAllocObjName(int type) { return "only available in _DEBUG builds"; }
-        EXPORT long GetStringAllocs()            { return 0; }
-        EXPORT long GetStringReleases()          { return 0; }
 #endif
+        // string counts are kept in every build, 64 bit to match the
+        //  managed declarations on every platform
+        EXPORT long long GetStringAllocs()       { return Utils::AllocCount(); }
+        EXPORT long long GetStringReleases()     { return Utils::FreeCount(); }
+        EXPORT long long GetSlabStringAllocs()   { return Utils::SlabAllocCount(); }
 
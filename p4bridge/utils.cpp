@@ -39,63 +39,158 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "P4BridgeServer.h"
 
 #include <set>
+#include <atomic>
+#include <map>
 
 #ifndef OS_NT
-#if defined(_DEBUG)
-
-#endif
-
-#include <atomic>
+#include <sys/stat.h>
 #define __STDC_WANT_LIB_EXT1__ 1  // for strcpy_s
 #endif
 
+// Size of the blocks slab strings are carved from. Longer strings get a
+//  block of their own.
+#define STRING_SLAB_BLOCK (16 * 1024)
 
 namespace Utils
 {
-#if defined(_DEBUG)
+	// counted in release builds too, the cost is an interlocked add
+	static std::atomic<long> allocs(0);
+	static std::atomic<long> frees(0);
+	static std::atomic<long> slabAllocs(0);
 
-#ifdef OS_NT
-	volatile long allocs = 0;
-	volatile long frees = 0;
-
-#define ALLOC_COUNT(p)	{ InterlockedIncrement(&allocs); }
-#define FREE_COUNT(p)	{ InterlockedIncrement(&frees); }
-	long AllocCount() { return allocs; }
-	long FreeCount() { return frees; }
-#else // Linux or OSX
-    std::atomic<long> allocs{0};
-    std::atomic<long> frees{0};
-
-#define ALLOC_COUNT(p) { allocs.fetch_add(1, std::memory_order_relaxed); }
-#define FREE_COUNT(p)  { frees.fetch_add(1, std::memory_order_relaxed); }
-    long AllocCount() { return allocs.load(); }
-    long FreeCount() { return frees.load(); }
-#endif
+	long AllocCount() { return allocs.load(); }
+	long FreeCount() { return frees.load(); }
+	long SlabAllocCount() { return slabAllocs.load(); }
 
-#else // Not _DEBUG
-#define ALLOC_COUNT(p) {  }
-#define FREE_COUNT(p) {  }
+	// The blocks of every slab by start address, with their sizes. There
+	//  are few of them, and none unless a slab is in use, so ReleaseString()
+	//  only takes the lock while some slab holds strings.
+	static std::mutex slabBlocksMutex;
+	static std::map<const char*, size_t> slabBlocks;
+	static std::atomic<int> slabBlockCount(0);
 
-	long AllocCount() { return 0; }
-	long FreeCount() { return 0; }
-#endif
+	static void AddSlabBlock(const char* block, size_t size)
+	{
+		std::lock_guard<std::mutex> guard(slabBlocksMutex);
+		slabBlocks[block] = size;
+		slabBlockCount++;
+	}
+
+	static void RemoveSlabBlock(const char* block)
+	{
+		std::lock_guard<std::mutex> guard(slabBlocksMutex);
+		if (slabBlocks.erase(block))
+			slabBlockCount--;
+	}
+
+	bool StringSlab::Owns(const void* p)
+	{
+		if (slabBlockCount.load() == 0)
+			return false;
+		const char* c = (const char*) p;
+		std::lock_guard<std::mutex> guard(slabBlocksMutex);
+		std::map<const char*, size_t>::iterator it = slabBlocks.upper_bound(c);
+		if (it == slabBlocks.begin())
+			return false;
+		--it;
+		return c < it->first + it->second;
+	}
+
+	StringSlab::StringSlab() :
+		current(NULL),
+		currentUsed(0),
+		bytes(0),
+		count(0)
+	{
+	}
+
+	StringSlab::~StringSlab()
+	{
+		Clear();
+	}
 
-	const char* AllocString(const string& s)
+	char* StringSlab::Alloc(size_t len)
 	{
-		return AllocString(s.c_str());
+		size_t need = len + 1;
+		std::lock_guard<std::mutex> guard(mutex);
+		char* p;
+		if (need > STRING_SLAB_BLOCK / 4)
+		{
+			// a block of its own, keep filling the current one
+			p = new char[need];
+			blocks.push_back(p);
+			AddSlabBlock(p, need);
+			bytes += need;
+		}
+		else
+		{
+			if (!current || currentUsed + need > STRING_SLAB_BLOCK)
+			{
+				current = new char[STRING_SLAB_BLOCK];
+				currentUsed = 0;
+				blocks.push_back(current);
+				AddSlabBlock(current, STRING_SLAB_BLOCK);
+				bytes += STRING_SLAB_BLOCK;
+			}
+			p = current + currentUsed;
+			currentUsed += need;
+		}
+		count++;
+		return p;
 	}
 
-	const char* AllocString(const char* p)
+	void StringSlab::Clear()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		for (size_t i = 0; i < blocks.size(); i++)
+		{
+			RemoveSlabBlock(blocks[i]);
+			delete[] blocks[i];
+		}
+		blocks.clear();
+		current = NULL;
+		currentUsed = 0;
+		bytes = 0;
+		count = 0;
+	}
+
+	int StringSlab::Count()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		return count;
+	}
+
+	size_t StringSlab::Bytes()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		return bytes;
+	}
+
+	const char* AllocString(const string& s, StringSlab* pSlab)
+	{
+		return AllocString(s.c_str(), pSlab);
+	}
+
+	const char* AllocString(const char* p, StringSlab* pSlab)
 	{
 		// return NULL, some of the p4.net-api code -> p4bridge code relies on NULL 
 		// re: debug tracking, don't bother tracking NULL allocs, that's not useful
 		if (p == NULL) return NULL;
 		size_t len = strlen(p);
 		if (len == 0) return NULL;
-		char* ret = new char[len + 1];
+		char* ret;
+		if (pSlab)
+		{
+			ret = pSlab->Alloc(len);
+			slabAllocs.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			ret = new char[len + 1];
+			allocs.fetch_add(1, std::memory_order_relaxed);
+		}
 		LOG_DEBUG3(4, "Alloc [%d]: (%p) %s", AllocCount(), ret, p);
-		ALLOC_COUNT(ret);
-		strncpy(ret, p, len);
+		memcpy(ret, p, len);
 		ret[len] = '\0';      // null terminate
 		return ret;
 	}
@@ -108,13 +203,87 @@ namespace Utils
 	void ReleaseString(void* p)
 	{
 		if (!p) return;	// skip the debug logging code
+		// slab strings go with their slab
+		if (StringSlab::Owns(p)) return;
 		LOG_DEBUG3(4, "Free [%d]: (%p) %s", FreeCount(), p, p);
-		FREE_COUNT((const char*)p);
-		delete[] (const char *)p;
+		frees.fetch_add(1, std::memory_order_relaxed);
+		delete[] (char*)p;
 	}
 
 	string stringFromPtr(const char* s)
 	{
 		return (s == NULL) ? string() : s;
 	}
-}
\ No newline at end of file
+
+	size_t Utf8Decode(const unsigned char *p, const unsigned char *end, unsigned int &cp)
+	{
+		unsigned char c = p[0];
+		size_t n;
+		if (c >= 0xC2 && c <= 0xDF)
+		{
+			n = 2;
+			cp = c & 0x1F;
+		}
+		else if (c >= 0xE0 && c <= 0xEF)
+		{
+			n = 3;
+			cp = c & 0x0F;
+		}
+		else if (c >= 0xF0 && c <= 0xF4)
+		{
+			n = 4;
+			cp = c & 0x07;
+		}
+		else
+		{
+			return 0;
+		}
+
+		if ((size_t) (end - p) < n)
+			return 0;
+		for (size_t i = 1; i < n; i++)
+		{
+			if ((p[i] & 0xC0) != 0x80)
+				return 0;
+			cp = (cp << 6) | (p[i] & 0x3F);
+		}
+		if (n == 3 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF)))
+			return 0;
+		if (n == 4 && (cp < 0x10000 || cp > 0x10FFFF))
+			return 0;
+		return n;
+	}
+
+	void GetFileStamp(const std::string &path, FileStamp &stamp)
+	{
+		memset(&stamp, 0, sizeof(stamp));
+#ifdef OS_NT
+		int wlen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+		if (wlen <= 0)
+			return;
+		std::wstring wpath(wlen, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wpath[0], wlen);
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		if (!GetFileAttributesExW(wpath.c_str(), GetFileExInfoStandard, &data))
+			return;
+		stamp.exists = true;
+		stamp.mtime = ((long long) data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+		stamp.size = ((long long) data.nFileSizeHigh << 32) | data.nFileSizeLow;
+#else
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0)
+			return;
+		stamp.exists = true;
+		// whole seconds would miss a change made right after the last one
+#if defined(OS_MACOSX)
+		stamp.mtime = (long long) st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(OS_LINUX)
+		stamp.mtime = (long long) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+		stamp.mtime = (long long) st.st_mtime;
+#endif
+		stamp.size = (long long) st.st_size;
+		stamp.inode = (long long) st.st_ino;
+#endif
+	}
+}
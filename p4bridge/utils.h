@@ -36,11 +36,54 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  ******************************************************************************/
 
 #include <string>
+#include <vector>
+#include <mutex>
+
+// Values for P4BridgeServer::SetStringSlab()
+#define STRING_SLAB_OFF			0	// every string is allocated on its own
+#define STRING_SLAB_HOLD		1	// strings are kept until ReleaseAll
+#define STRING_SLAB_PER_COMMAND	2	// also released when the next command runs
 
 namespace Utils {
-	// allocate a new string buffer to cross the C++/C# boundry
-	const char* AllocString(const char* p);
-	const char* AllocString(const std::string &s);
+	// Strings carved from large blocks and released all at once by Clear(),
+	//  instead of one allocation and one ReleaseString() per string.
+	//  ReleaseString() on a string of a live slab does nothing; once the
+	//  slab is cleared its strings must not be released at all.
+	//  Thread safe.
+	class StringSlab
+	{
+	public:
+		StringSlab();
+		~StringSlab();
+
+		// Room for len bytes, not counting the terminator that
+		//  AllocString() adds
+		char* Alloc(size_t len);
+
+		void Clear();
+
+		int Count();
+		size_t Bytes();
+
+		// True if p is in a block of any slab that has not been cleared
+		static bool Owns(const void* p);
+
+	private:
+		StringSlab(const StringSlab &);
+		StringSlab &operator=(const StringSlab &);
+
+		std::mutex mutex;
+		std::vector<char*> blocks;
+		char* current;
+		size_t currentUsed;
+		size_t bytes;
+		int count;
+	};
+
+	// allocate a new string buffer to cross the C++/C# boundry, from pSlab
+	//  if it is not NULL
+	const char* AllocString(const char* p, StringSlab* pSlab = NULL);
+	const char* AllocString(const std::string &s, StringSlab* pSlab = NULL);
 
 	// release the buffer, called by the client when it's done
 	void ReleaseString(void* p);
@@ -48,6 +91,34 @@ namespace Utils {
 
 	std::string stringFromPtr(const char* s);
 
+	// The length of the valid UTF-8 sequence at p and its code point in cp,
+	//  0 if it is not one. Overlong forms, surrogates and code points past
+	//  U+10FFFF are not valid, nor is plain ASCII.
+	size_t Utf8Decode(const unsigned char *p, const unsigned char *end, unsigned int &cp);
+
+	// Counted in every build: strings allocated on their own, released,
+	//  and carved from a slab
 	long AllocCount();
 	long FreeCount();
+	long SlabAllocCount();
+
+	// What is known about a file without opening it, used to notice that a
+	//  cached file has changed. Windows has no inode without opening the
+	//  file, a rewrite there still changes the modification time.
+	struct FileStamp
+	{
+		bool exists;
+		long long mtime;
+		long long size;
+		long long inode;
+
+		bool operator==(const FileStamp &o) const
+		{
+			return exists == o.exists && mtime == o.mtime && size == o.size && inode == o.inode;
+		}
+		bool operator!=(const FileStamp &o) const { return !(*this == o); }
+	};
+
+	// Fill stamp for a file or directory, exists is false if it is missing
+	void GetFileStamp(const std::string &path, FileStamp &stamp);
 }